@@ -53,7 +53,7 @@ _DTYPE_MX_TO_NP = {
     6: np.int64,
 }
 
-__all__ = ["Predictor", "load_ndarray_file"]
+__all__ = ["Predictor", "PredictorBatcher", "load_ndarray_file"]
 
 
 py_str = lambda x: x.decode('utf-8')
@@ -148,6 +148,7 @@ mx_float = ctypes.c_float
 mx_float_p = ctypes.POINTER(mx_float)
 PredictorHandle = ctypes.c_void_p
 NDListHandle = ctypes.c_void_p
+PredBatcherHandle = ctypes.c_void_p
 
 devstr2type = {'cpu': 1, 'gpu': 2, 'cpu_pinned': 3}
 
@@ -322,6 +323,57 @@ class Predictor(object):
             mx_uint(data.size)))
         return data
 
+    def get_input_shape(self, key):
+        """Get the shape an input is bound to.
+
+        Parameters
+        ----------
+        key : str
+            The name of the input.
+
+        Returns
+        -------
+        shape : tuple of int
+        """
+        pdata = ctypes.POINTER(mx_uint)()
+        ndim = mx_uint()
+        _check_call(_LIB.MXPredGetInputShape(
+            self.handle, c_str(key),
+            ctypes.byref(pdata),
+            ctypes.byref(ndim)))
+        return tuple(pdata[:ndim.value])
+
+    def set_reshape_cache(self, capacity, bucket_axis=-1, bucket_size=1):
+        """Cache the executors bound by reshape, keyed by input shapes.
+
+        Parameters
+        ----------
+        capacity : int
+            Maximum number of cached executors, 0 disables the cache.
+        bucket_axis : int, optional
+            Axis of every input rounded up to a multiple of bucket_size before
+            the lookup, -1 to use the shapes as given. Inputs are then padded
+            to the shapes returned by get_input_shape.
+        bucket_size : int, optional
+            The bucket size.
+        """
+        _check_call(_LIB.MXPredSetReshapeCache(
+            self.handle, mx_uint(capacity), ctypes.c_int(bucket_axis), mx_uint(bucket_size)))
+
+    def get_reshape_cache_stats(self):
+        """Get the number of reshapes which reused a cached executor and
+        which bound a new one.
+
+        Returns
+        -------
+        hits, misses : int
+        """
+        hits = ctypes.c_uint64()
+        misses = ctypes.c_uint64()
+        _check_call(_LIB.MXPredGetReshapeCacheStats(
+            self.handle, ctypes.byref(hits), ctypes.byref(misses)))
+        return hits.value, misses.value
+
     def set_monitor_callback(self, callback, monitor_all=False):
         cb_type = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_void_p)
         self._monitor_callback = cb_type(_monitor_callback_wrapper(callback))
@@ -331,6 +383,100 @@ class Predictor(object):
                                                   ctypes.c_int(monitor_all)))
 
 
+class PredictorBatcher(object):
+    """Serves single samples from many threads with one predictor, merging
+    concurrent requests into batches.
+
+    Parameters
+    ----------
+    predictor : Predictor
+        The predictor, created with max_batch_size as the first dimension of
+        every input shape. It must not be used directly while the batcher exists.
+
+    max_batch_size : int
+        The batch size the predictor was created with.
+
+    timeout_us : int, optional
+        Maximum time in microseconds a request waits for the batch to fill up.
+    """
+    def __init__(self, predictor, max_batch_size, timeout_us=1000):
+        handle = PredBatcherHandle()
+        _check_call(_LIB.MXPredBatcherCreate(
+            predictor.handle, mx_uint(max_batch_size), mx_uint(timeout_us),
+            ctypes.byref(handle)))
+        # the batcher runs the executor of the predictor
+        self.predictor = predictor
+        self.handle = handle
+
+    def __del__(self):
+        _check_call(_LIB.MXPredBatcherFree(self.handle))
+
+    def forward(self, num_outputs=1, **kwargs):
+        """Run one sample, blocking until its outputs are ready. Thread safe.
+
+        Parameters
+        ----------
+        num_outputs : int, optional
+            Number of outputs to return, from the first output on.
+        **kwargs
+            Keyword arguments of input variable name to the data of one sample.
+
+        Returns
+        -------
+        out : list of numpy array
+            One sample of each output, without the batch dimension.
+
+        Examples
+        --------
+        >>> out = batcher.forward(data=mysample)[0]
+        """
+        keys = []
+        inputs = []
+        for k, v in kwargs.items():
+            if not isinstance(v, np.ndarray):
+                raise ValueError("Expect numpy ndarray as input")
+            keys.append(k)
+            inputs.append(np.asarray(v, dtype=np.float32, order='C'))
+        outputs = []
+        for i in range(num_outputs):
+            pdata = ctypes.POINTER(mx_uint)()
+            ndim = mx_uint()
+            _check_call(_LIB.MXPredGetOutputShape(
+                self.predictor.handle, mx_uint(i),
+                ctypes.byref(pdata), ctypes.byref(ndim)))
+            outputs.append(np.empty(tuple(pdata[1:ndim.value]), dtype=np.float32))
+        _check_call(_LIB.MXPredBatcherForward(
+            self.handle, mx_uint(len(inputs)),
+            c_str_array(keys),
+            c_array(mx_float_p, [v.ctypes.data_as(mx_float_p) for v in inputs]),
+            c_array(mx_uint, [v.size for v in inputs]),
+            mx_uint(num_outputs),
+            c_array(mx_float_p, [v.ctypes.data_as(mx_float_p) for v in outputs]),
+            c_array(mx_uint, [v.size for v in outputs])))
+        return outputs
+
+    def get_stats(self):
+        """Get the histograms collected since the batcher was created.
+
+        Returns
+        -------
+        queue_time_hist : list of int
+            Bucket i counts requests that waited less than 2^i microseconds
+            and at least 2^(i-1).
+        batch_size_hist : list of int
+            Bucket i counts forward passes that ran i requests.
+        """
+        num_queue_time = mx_uint()
+        queue_time = ctypes.POINTER(ctypes.c_uint64)()
+        num_batch_size = mx_uint()
+        batch_size = ctypes.POINTER(ctypes.c_uint64)()
+        _check_call(_LIB.MXPredBatcherGetStats(
+            self.handle, ctypes.byref(num_queue_time), ctypes.byref(queue_time),
+            ctypes.byref(num_batch_size), ctypes.byref(batch_size)))
+        return (list(queue_time[:num_queue_time.value]),
+                list(batch_size[:num_batch_size.value]))
+
+
 def load_ndarray_file(nd_bytes):
     """Load ndarray file and return as list of numpy array.
 
@@ -0,0 +1,78 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""Measure the decoding throughput of ImageRecordIter in images/sec and
+images/sec per decoding thread, with and without the pipelined decoder.
+
+Example::
+
+  python benchmark_image_record_iter.py --rec data/train.rec --threads 4 8 16
+"""
+import argparse
+import time
+
+import mxnet as mx
+
+parser = argparse.ArgumentParser(description="Benchmark ImageRecordIter decoding",
+                                 formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+parser.add_argument('--rec', type=str, required=True, help='path to the .rec file')
+parser.add_argument('--idx', type=str, default='', help='path to the .idx file')
+parser.add_argument('--data-shape', type=str, default='3,224,224', help='output image shape')
+parser.add_argument('--resize', type=int, default=256, help='resize the shorter edge before cropping')
+parser.add_argument('--batch-size', type=int, default=128, help='batch size')
+parser.add_argument('--num-batches', type=int, default=100, help='number of batches to time')
+parser.add_argument('--threads', type=int, nargs='+', default=[4], help='numbers of decoding threads')
+parser.add_argument('--depths', type=int, nargs='+', default=[0, 4],
+                    help='decode_pipeline_depth values to compare, 0 decodes chunk by chunk')
+parser.add_argument('--bind-numa', action='store_true', help='pin the pipeline threads to NUMA nodes')
+args = parser.parse_args()
+
+
+def measure(threads, depth):
+    data_iter = mx.io.ImageRecordIter(
+        path_imgrec=args.rec,
+        path_imgidx=args.idx,
+        data_shape=tuple(int(x) for x in args.data_shape.split(',')),
+        batch_size=args.batch_size,
+        resize=args.resize,
+        rand_crop=True,
+        rand_mirror=True,
+        preprocess_threads=threads,
+        decode_pipeline_depth=depth,
+        bind_numa_nodes=args.bind_numa,
+        verbose=False)
+    # warm up, the first batches include thread start and allocation
+    for _ in range(5):
+        if not data_iter.iter_next():
+            data_iter.reset()
+    num_images = 0
+    start = time.time()
+    while num_images < args.num_batches * args.batch_size:
+        if not data_iter.iter_next():
+            data_iter.reset()
+            continue
+        batch = data_iter.getdata()
+        batch.wait_to_read()
+        num_images += args.batch_size - data_iter.getpad()
+    return num_images / (time.time() - start)
+
+
+print('{:>8} {:>8} {:>12} {:>16}'.format('threads', 'depth', 'images/sec', 'images/sec/core'))
+for threads in args.threads:
+    for depth in args.depths:
+        speed = measure(threads, depth)
+        print('{:8d} {:8d} {:12.1f} {:16.1f}'.format(threads, depth, speed, speed / threads))
@@ -0,0 +1,76 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""Measure the cost per imperative operator of profiling, with and without
+aggregate stats, which also keep latency percentiles and per shape rows.
+
+Example::
+
+  python benchmark_aggregate_stats.py --num-ops 20000 --shapes 1,16 64,64 256,256
+"""
+import argparse
+import os
+import tempfile
+import time
+
+import mxnet as mx
+
+parser = argparse.ArgumentParser(description="Benchmark the overhead of aggregate stats",
+                                 formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+parser.add_argument('--num-ops', type=int, default=20000, help='number of operators to time')
+parser.add_argument('--shapes', type=str, nargs='+', default=['1,16', '64,64', '256,256'],
+                    help='input shapes to cycle through, each adds a per shape row')
+parser.add_argument('--repeat', type=int, default=3, help='runs per mode, the fastest is kept')
+args = parser.parse_args()
+
+arrays = [mx.nd.ones(tuple(int(x) for x in shape.split(','))) for shape in args.shapes]
+
+
+def run():
+    mx.nd.waitall()
+    start = time.time()
+    for i in range(args.num_ops):
+        mx.nd.sqrt(arrays[i % len(arrays)])
+    mx.nd.waitall()
+    return (time.time() - start) * 1e6 / args.num_ops
+
+
+def measure(profile, aggregate_stats):
+    best = float('inf')
+    for _ in range(args.repeat):
+        if profile:
+            mx.profiler.set_config(profile_imperative=True, aggregate_stats=aggregate_stats,
+                                   filename=os.path.join(tempfile.gettempdir(),
+                                                         'benchmark_aggregate_stats.json'))
+            mx.profiler.set_state('run')
+        best = min(best, run())
+        if profile:
+            mx.profiler.set_state('stop')
+            if aggregate_stats:
+                # formats the per shape rows, which recording leaves to the dump
+                mx.profiler.dumps(reset=True)
+    return best
+
+
+run()  # warm up
+baseline = measure(False, False)
+print('{:>28} {:>10} {:>10}'.format('mode', 'us/op', 'overhead'))
+for name, profile, aggregate_stats in [('profiler off', False, False),
+                                       ('profiling', True, False),
+                                       ('profiling + aggregate stats', True, True)]:
+    cost = baseline if not profile else measure(profile, aggregate_stats)
+    print('{:>28} {:10.2f} {:9.1f}%'.format(name, cost, (cost / baseline - 1) * 100))
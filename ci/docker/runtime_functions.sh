@@ -1323,6 +1323,12 @@ integrationtest_ubuntu_cpu_dist_kvstore() {
     python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py --no-multiprecision
     python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py --type=compressed_cpu
     python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py --type=compressed_cpu --no-multiprecision
+    # sharded request handling on the servers
+    export MXNET_KVSTORE_SERVER_UPDATE_THREADS=4
+    python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py
+    python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py --type=gluon_sparse_step_cpu
+    python3 ../../tools/launch.py -n 7 --launcher local python3 dist_sync_kvstore.py --type=compressed_cpu
+    unset MXNET_KVSTORE_SERVER_UPDATE_THREADS
     python3 ../../tools/launch.py -n 3 --launcher local python3 test_server_profiling.py
     popd
 }
@@ -360,7 +360,7 @@ MXNET_DLL int MXAggregateProfileStatsPrint(const char **out_str, int reset);
  * \param out_str will receive a pointer to the output string
  * \param reset clear the aggregate stats after printing
  * \param format whether to return in tabular or json format
- * \param sort_by sort by total, avg, min, max, or count
+ * \param sort_by sort by total, avg, min, max, count or p99
  * \param ascending whether to sort ascendingly
  * \return 0 when success, -1 when failure happens.
  * \note
@@ -368,6 +368,12 @@ MXNET_DLL int MXAggregateProfileStatsPrint(const char **out_str, int reset);
 MXNET_DLL int MXAggregateProfileStatsPrintEx(const char **out_str, int reset, int format,
                                             int sort_by, int ascending);
 
+/*!
+ * \brief Clear the aggregate stats, including the latency histograms, without printing them
+ * \return 0 when success, -1 when failure happens.
+ */
+MXNET_DLL int MXAggregateProfileStatsReset();
+
 /*!
  * \brief Pause profiler tuning collection
  * \param paused If nonzero, profiling pauses. Otherwise, profiling resumes/continues
@@ -735,8 +741,23 @@ MXNET_DLL int MXNDArraySave(const char* fname,
                             uint32_t num_args,
                             NDArrayHandle* args,
                             const char** keys);
+/*!
+ * \brief Save list of dense narray into the file with aligned data,
+ *  so that MXNDArrayLoad can map the file instead of reading it.
+ * \param fname name of the file.
+ * \param num_args number of arguments to save.
+ * \param args the array of NDArrayHandles to be saved.
+ * \param keys the name of the NDArray, optional, can be NULL
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXNDArraySaveAligned(const char* fname,
+                                   uint32_t num_args,
+                                   NDArrayHandle* args,
+                                   const char** keys);
 /*!
  * \brief Load list of narray from the file.
+ *  Local files saved by MXNDArraySaveAligned are mapped, and the
+ *  returned CPU narrays share memory with the mapping.
  * \param fname name of the file.
  * \param out_size number of narray loaded.
  * \param out_arr head of the returning narray handles.
@@ -51,6 +51,8 @@ typedef void *PredictorHandle;
 typedef void *NDListHandle;
 /*! \brief handle to NDArray */
 typedef void *NDArrayHandle;
+/*! \brief handle to a batching front end of a predictor */
+typedef void *PredBatcherHandle;
 /*! \brief callback used for add monitoring to nodes in the graph */
 typedef void (*PredMonitorCallback)(const char*,
                                     NDArrayHandle,
@@ -210,6 +212,10 @@ MXNET_DLL int MXPredCreateMultiThread(const char* symbol_json_str,
  * \param handle The original predictor handle.
  * \param out The reshaped predictor handle.
  * \return 0 when success, -1 when failure.
+ *
+ * \note When the reshape cache of handle is enabled, the bound executor is
+ *  looked up by the (bucketed) input shapes first, and predictors returned for
+ *  the same shapes share one executor. They should not run concurrently.
  */
 MXNET_DLL int MXPredReshape(uint32_t num_input_nodes,
                   const char** input_keys,
@@ -217,6 +223,37 @@ MXNET_DLL int MXPredReshape(uint32_t num_input_nodes,
                   const uint32_t* input_shape_data,
                   PredictorHandle handle,
                   PredictorHandle* out);
+/*!
+ * \brief Set up the cache of executors bound by MXPredReshape.
+ *  The cache is shared by handle and all predictors reshaped from it, and
+ *  replaces the previous one. Its initial capacity is taken from the
+ *  MXNET_PREDICT_RESHAPE_CACHE_SIZE environment variable.
+ * \param handle The predictor handle.
+ * \param capacity Maximum number of cached executors, 0 disables the cache.
+ *  The least recently used executor is evicted first.
+ * \param bucket_axis Axis rounded up before the lookup, -1 to use the shapes
+ *  as given. The same axis of every input given to MXPredReshape is rounded,
+ *  inputs with no more than bucket_axis dimensions are left as they are.
+ * \param bucket_size The bucketed axis is rounded up to a multiple of it.
+ *  The reshaped predictor is bound to the rounded shapes, so the caller pads
+ *  its inputs to the shapes returned by MXPredGetInputShape and ignores the
+ *  padded part of the outputs.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredSetReshapeCache(PredictorHandle handle,
+                                    uint32_t capacity,
+                                    int bucket_axis,
+                                    uint32_t bucket_size);
+/*!
+ * \brief Get the hit and miss counts of the reshape cache of a predictor.
+ * \param handle The predictor handle.
+ * \param hits Number of MXPredReshape calls that reused a cached executor.
+ * \param misses Number of MXPredReshape calls that bound a new executor.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredGetReshapeCacheStats(PredictorHandle handle,
+                                         uint64_t* hits,
+                                         uint64_t* misses);
 /*!
  * \brief Get the shape of output node.
  *  The returned shape_data and shape_ndim is only valid before next call to MXPred function.
@@ -231,6 +268,20 @@ MXNET_DLL int MXPredGetOutputShape(PredictorHandle handle,
                                    uint32_t** shape_data,
                                    uint32_t* shape_ndim);
 
+/*!
+ * \brief Get the shape of an input node, as bound by the predictor.
+ *  The returned shape_data and shape_ndim is only valid before next call to MXPred function.
+ * \param handle The handle of the predictor.
+ * \param key The name of the input node.
+ * \param shape_data Used to hold pointer to the shape data
+ * \param shape_ndim Used to hold shape dimension.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredGetInputShape(PredictorHandle handle,
+                                  const char* key,
+                                  uint32_t** shape_data,
+                                  uint32_t* shape_ndim);
+
 /*!
  * \brief Get the dtype of output node.
  * The returned data type is only valid before next call to MXPred function.
@@ -341,6 +392,71 @@ MXNET_DLL int MXPredSetMonitorCallback(PredictorHandle handle,
  */
 MXNET_DLL int MXNDListFree(NDListHandle handle);
 
+/*!
+ * \brief Create a batcher that serves single-sample requests from many threads
+ *  with one predictor. Requests are queued, merged up to max_batch_size or
+ *  until the oldest one waited timeout_us, run in one forward pass and the
+ *  outputs are scattered back. Create one batcher per model to serve several
+ *  models. The predictor must outlive the batcher and must not be used
+ *  directly while the batcher exists.
+ * \param pred The predictor, created with the batch size as the first
+ *  dimension of every input and output shape.
+ * \param max_batch_size The batch size the predictor was created with.
+ * \param timeout_us Maximum time in microseconds a request waits for the
+ *  batch to fill up.
+ * \param out The created batcher.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherCreate(PredictorHandle pred,
+                                  uint32_t max_batch_size,
+                                  uint32_t timeout_us,
+                                  PredBatcherHandle* out);
+/*!
+ * \brief Run one sample through the batcher, blocking until its outputs are ready.
+ *  Thread safe.
+ * \param handle The batcher.
+ * \param num_inputs Number of inputs, must match the predictor inputs.
+ * \param input_keys The name of each input.
+ * \param input_data The data of one sample for each input.
+ * \param input_sizes The size of each input_data, used for safe checking.
+ * \param num_outputs Number of outputs to fetch, from the first output on.
+ * \param output_data User allocated buffers, one sample for each output.
+ * \param output_sizes The size of each output_data, used for safe checking.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherForward(PredBatcherHandle handle,
+                                   uint32_t num_inputs,
+                                   const char** input_keys,
+                                   const float** input_data,
+                                   const uint32_t* input_sizes,
+                                   uint32_t num_outputs,
+                                   float** output_data,
+                                   const uint32_t* output_sizes);
+/*!
+ * \brief Get the histograms collected by a batcher since it was created.
+ *  Bucket i of the queue time histogram counts requests that waited less
+ *  than 2^i microseconds and at least 2^(i-1). Bucket i of the batch size
+ *  histogram counts forward passes that ran i requests.
+ *  The returned arrays stay valid until the next call on the same handle.
+ * \param handle The batcher.
+ * \param num_queue_time_buckets Number of queue time buckets.
+ * \param queue_time_hist Counts of the queue time histogram.
+ * \param num_batch_size_buckets Number of batch size buckets, max_batch_size + 1.
+ * \param batch_size_hist Counts of the batch size histogram.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherGetStats(PredBatcherHandle handle,
+                                    uint32_t* num_queue_time_buckets,
+                                    const uint64_t** queue_time_hist,
+                                    uint32_t* num_batch_size_buckets,
+                                    const uint64_t** batch_size_hist);
+/*!
+ * \brief Stop a batcher after the queued requests are served and free it.
+ * \param handle The batcher.
+ * \return 0 when success, -1 when failure.
+ */
+MXNET_DLL int MXPredBatcherFree(PredBatcherHandle handle);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
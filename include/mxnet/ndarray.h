@@ -817,6 +817,29 @@ class NDArray {
    * \param keys the name of the NDArray, if saved in the file.
    */
   static void Load(dmlc::Stream* fi, std::vector<NDArray>* data, std::vector<std::string>* keys);
+  /*!
+   * \brief Save list of dense ndarray into the Stream, with the data of each
+   *  ndarray at an aligned offset so the file can be loaded by LoadMapped.
+   *  Load also reads this format.
+   * \param fo The stream of output.
+   * \param data the NDArrays to be saved.
+   * \param names the name of the NDArray, optional, can be zero length.
+   */
+  static void SaveAligned(dmlc::Stream* fo,
+                          const std::vector<NDArray>& data,
+                          const std::vector<std::string>& names);
+  /*!
+   * \brief Load list of ndarray saved by SaveAligned by mapping the file.
+   *  CPU ndarrays point into the mapping without copying, and share
+   *  pages with other processes mapping the same file.
+   * \param fname The local file name.
+   * \param data the NDArrays to be loaded
+   * \param keys the name of the NDArray, if saved in the file.
+   * \return false if the file is not local or not in the aligned format.
+   */
+  static bool LoadMapped(const std::string& fname,
+                         std::vector<NDArray>* data,
+                         std::vector<std::string>* keys);
 
  private:
   friend class Imperative;
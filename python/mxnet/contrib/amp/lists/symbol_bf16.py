@@ -120,6 +120,7 @@ FP32_FUNCS = [
     '_contrib_ifft',
     '_contrib_index_array',
     '_contrib_index_copy',
+    '_contrib_interleaved_selfatt_fused',
     '_contrib_quadratic',
     '_contrib_quantize',
     '_contrib_quantize_v2',
@@ -371,6 +371,7 @@ FP32_FUNCS = [
     '_contrib_MultiBoxDetection',
     '_contrib_MultiBoxPrior',
     '_contrib_MultiBoxTarget',
+    '_contrib_interleaved_selfatt_fused',
 
     # Exponents
     'exp',
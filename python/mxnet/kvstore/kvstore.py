@@ -532,13 +532,26 @@ class KVStore(KVStoreBase):
         a dictionary which includes `threshold` like:
         {'type': '2bit', 'threshold': 0.5}
 
+        1bit Gradient Compression sends the sign of each value, together with one scale
+        per block of 512 values, which is the mean absolute value of the block.
+        Every 512 float values are represented using 17 floats. It takes no arguments:
+        {'type': '1bit'}
+
+        topk and randomk Gradient Compression take a float `ratio` in (0, 0.5].
+        Out of every 1024 values, they send the `ratio` fraction with the largest
+        absolute values (topk) or picked at random (randomk) as index and value pairs,
+        which the receiver adds to the positions they came from:
+        {'type': 'topk', 'ratio': 0.01}
+
+        All types keep the values that were not sent as residual, like 2bit does.
+
         Parameters
         ----------
         compression_params : dict
             A dictionary specifying the type and parameters for gradient compression.
             The key `type` in this dictionary is a
             required string argument and specifies the type of gradient compression.
-            Currently `type` can be only `2bit`
+            `type` can be `2bit`, `1bit`, `topk` or `randomk`.
             Other keys in this dictionary are optional and specific to the type
             of gradient compression.
         """
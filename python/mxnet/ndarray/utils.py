@@ -219,7 +219,7 @@ def load_frombuffer(buf):
             for i in range(out_size.value))
 
 
-def save(fname, data):
+def save(fname, data, aligned=False):
     """Saves a list of arrays or a dict of str->array to file.
 
     Examples of filenames:
@@ -236,6 +236,11 @@ def save(fname, data):
            or list of NDArray, RowSparseNDArray or CSRNDArray, \
            or dict of str to NDArray, RowSparseNDArray or CSRNDArray
         The data to save.
+    aligned : bool, default False
+        Whether to store the data of each array at an aligned offset. Such a
+        file only holds dense arrays, and `load` maps it instead of reading it:
+        CPU arrays share the page cache with other processes loading the same
+        file, and loading does not copy the data.
 
     Examples
     --------
@@ -274,7 +279,8 @@ def save(fname, data):
     else:
         raise ValueError("data needs to either be a NDArray, dict of str, NDArray pairs "
                          "or a list of NDarrays.")
-    check_call(_LIB.MXNDArraySave(c_str(fname),
-                                  mx_uint(len(handles)),
-                                  handles,
-                                  keys))
+    save_fn = _LIB.MXNDArraySaveAligned if aligned else _LIB.MXNDArraySave
+    check_call(save_fn(c_str(fname),
+                       mx_uint(len(handles)),
+                       handles,
+                       keys))
@@ -0,0 +1,115 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# coding: utf-8
+"""Reader of the binary profiler trace. Only uses the standard library, so
+tools/trace2json.py loads this file without loading libmxnet."""
+import json
+import struct
+import warnings
+
+
+def trace_to_json(trace_filename, json_filename):
+    """Convert a binary trace written with `binary_trace=True` to the
+    chrome://tracing json format, which Perfetto also opens. Only reads
+    files, so it also works on a machine without the profiled job.
+
+    Parameters
+    ----------
+    trace_filename : string
+        binary trace written by the profiler
+    json_filename : string
+        output json file
+
+    Returns
+    -------
+    int
+        number of events converted
+    """
+    process_chunk, string_chunk, record_chunk, dropped_chunk = 1, 2, 3, 4
+    category_process = 0xffffffff
+    record = struct.Struct('<QQIIIHcB')
+    strings, processes, category_pids = {}, [], {}
+    num_events, dropped = 0, 0
+    with open(trace_filename, 'rb') as fin, open(json_filename, 'w') as fout:
+        magic, version, record_size = struct.unpack('<8sII', fin.read(16))
+        if magic != b'MXTRACE1' or version != 1 or record_size != record.size:
+            raise ValueError('%s is not a binary profiler trace' % trace_filename)
+        fout.write('{\n    "traceEvents": [\n')
+        separator = ''
+
+        def emit(event):
+            fout.write(separator + '        ' + json.dumps(event))
+            return ',\n'
+
+        def process_name(name, pid):
+            return {'ph': 'M', 'args': {'name': name}, 'pid': pid, 'name': 'process_name'}
+
+        while True:
+            header = fin.read(16)
+            if len(header) < 16:
+                break
+            chunk_type, count, size = struct.unpack('<IIQ', header)
+            payload = fin.read(size)
+            if len(payload) < size:
+                # the job stopped while writing this chunk
+                break
+            if chunk_type == process_chunk:
+                offset = 0
+                for _ in range(count):
+                    length, = struct.unpack_from('<I', payload, offset)
+                    processes.append(payload[offset + 4:offset + 4 + length].decode('utf-8'))
+                    offset += 4 + length
+                for pid, name in enumerate(processes):
+                    separator = emit(process_name(name, pid))
+            elif chunk_type == string_chunk:
+                offset = 0
+                for _ in range(count):
+                    sid, length = struct.unpack_from('<II', payload, offset)
+                    text = payload[offset + 8:offset + 8 + length]
+                    strings[sid] = text.decode('utf-8', 'replace')
+                    offset += 8 + length
+            elif chunk_type == record_chunk:
+                for ts, value, name, cat, pid, tid, phase, _ in record.iter_unpack(payload):
+                    name, cat, phase = strings[name], strings[cat], phase.decode('ascii')
+                    if pid == category_process:
+                        # as in the json dump, events without a device get a process per category
+                        if cat not in category_pids:
+                            category_pids[cat] = len(processes) + len(category_pids)
+                            separator = emit(process_name(cat, category_pids[cat]))
+                        pid = category_pids[cat]
+                    event = {'name': name, 'cat': cat, 'ph': phase, 'ts': ts,
+                             'pid': pid, 'tid': tid}
+                    if phase == 'X':
+                        event['dur'] = value
+                    elif phase == 'C':
+                        event['args'] = {name: value}
+                    elif phase in 'in':
+                        event['s'] = chr(value)
+                    elif phase in 'be':
+                        event['id'] = tid
+                    separator = emit(event)
+                    num_events += 1
+            elif chunk_type == dropped_chunk:
+                dropped += struct.unpack('<Q', payload)[0]
+        fout.write('\n    ],\n    "displayTimeUnit": "ms",\n')
+        fout.write('    "otherData": {"dropped_events": %d}\n}\n' % dropped)
+    if dropped:
+        warnings.warn('%d events were dropped while profiling, the buffers of some threads '
+                      'were full. Increase MXNET_PROFILER_TRACE_BUFFER_SIZE or decrease '
+                      'MXNET_PROFILER_TRACE_FLUSH_MS.' % dropped)
+    return num_events
@@ -59,7 +59,12 @@ std::vector<NDArray*> Invoke(const nnvm::Op* op,
   SetInOut(&ndinputs, &ndoutputs, num_inputs, inputs,
       num_outputs, infered_num_outputs, num_visible_outputs, outputs);
 
-  auto state = Imperative::Get()->Invoke(Context::CPU(), *attrs, ndinputs, ndoutputs);
+  OpStatePtr state;
+  {
+    // the parameters are only in attrs->parsed, which the inference cache does not key on
+    imperative::InferCache::Bypass no_infer_cache;
+    state = Imperative::Get()->Invoke(Context::CPU(), *attrs, ndinputs, ndoutputs);
+  }
   if (Imperative::Get()->is_recording()) {
     ::dmlc::get<T>(attrs->parsed).SetAttrDict(&(attrs->dict));
     Imperative::Get()->RecordOp(std::move(*attrs), ndinputs, ndoutputs, state);
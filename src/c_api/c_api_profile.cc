@@ -212,6 +212,7 @@ struct ProfileConfigParam : public dmlc::Parameter<ProfileConfigParam> {
   bool continuous_dump;
   float dump_period;
   bool aggregate_stats;
+  bool binary_trace;
   int profile_process;
   DMLC_DECLARE_PARAMETER(ProfileConfigParam) {
     DMLC_DECLARE_FIELD(profile_all).set_default(false)
@@ -235,6 +236,10 @@ struct ProfileConfigParam : public dmlc::Parameter<ProfileConfigParam> {
     DMLC_DECLARE_FIELD(aggregate_stats).set_default(false)
       .describe("Maintain aggregate stats, required for MXDumpAggregateStats.  Note that "
       "this can have a negative performance impact. Default is False.");
+    DMLC_DECLARE_FIELD(binary_trace).set_default(false)
+      .describe("Stream a compact binary trace to the file while profiling instead of "
+                "dumping json, so that memory use does not grow with the length of the run. "
+                "Convert the trace with mxnet.profiler.trace_to_json. Default is False.");
     DMLC_DECLARE_FIELD(profile_process)
       .add_enum("worker", static_cast<int>(ProfileProcess::kWorker))
       .add_enum("server", static_cast<int>(ProfileProcess::kServer))
@@ -297,7 +302,8 @@ int MXSetProcessProfilerConfig(int num_params, const char* const* keys, const ch
                                            std::string(param.filename),
                                            param.continuous_dump,
                                            param.dump_period,
-                                           param.aggregate_stats);
+                                           param.aggregate_stats,
+                                           param.binary_trace);
     }
   API_END();
 }
@@ -330,13 +336,26 @@ int MXAggregateProfileStatsPrintEx(const char **out_str, int reset, int format,
       else
         LOG(FATAL) << "Invalid value for parameter format";
     }
-    if (reset != 0)
+    if (reset != 0 && stats)
       stats->clear();
     ret->ret_str = os.str();
     *out_str = (ret->ret_str).c_str();
   API_END();
 }
 
+int MXAggregateProfileStatsReset() {
+  API_BEGIN();
+    profiler::Profiler *profiler = profiler::Profiler::Get();
+    // Keep the stats up until now out of the new counts, dumping them instead
+    // would end the json output unless it is continuous
+    profiler->ExcludeQueuedFromAggregate();
+    std::shared_ptr<profiler::AggregateStats> stats = profiler->GetAggregateStats();
+    if (stats) {
+      stats->clear();
+    }
+  API_END();
+}
+
 int MXDumpProfile(int finished) {
   return MXDumpProcessProfile(finished, static_cast<int>(ProfileProcess::kWorker), nullptr);
 }
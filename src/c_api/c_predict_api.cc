@@ -24,11 +24,22 @@
  */
 #include <dmlc/base.h>
 #include <dmlc/memory_io.h>
+#include <dmlc/parameter.h>
 #include <mxnet/c_predict_api.h>
 #include <mxnet/executor.h>
 #include <mxnet/ndarray.h>
 #include <nnvm/pass_functions.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <unordered_set>
 #include <unordered_map>
 #include "./c_api_common.h"
@@ -37,6 +48,76 @@
 
 using namespace mxnet;
 
+// LRU cache of the executors bound by MXPredReshape, keyed by input shapes.
+// It is shared by a predictor and all predictors reshaped from it, so every
+// cached executor reuses the same parameter arrays.
+struct MXAPIPredReshapeCache {
+  struct Entry {
+    std::shared_ptr<Executor> exec;
+    std::vector<NDArray> arg_arrays;
+    std::vector<NDArray> aux_arrays;
+    std::vector<NDArray> out_arrays;
+    mxnet::ShapeVector out_shapes;
+  };
+
+  MXAPIPredReshapeCache(size_t capacity, int bucket_axis, uint32_t bucket_size)
+      : capacity(capacity), bucket_axis(bucket_axis),
+        bucket_size(std::max<uint32_t>(bucket_size, 1)) {}
+
+  // round the bucketed axis of an input shape up to a multiple of bucket_size
+  mxnet::TShape Bucket(const mxnet::TShape& shape) const {
+    mxnet::TShape ret = shape;
+    if (bucket_axis >= 0 && bucket_axis < ret.ndim() && bucket_size > 1) {
+      const dim_t dim = ret[bucket_axis];
+      ret[bucket_axis] = (dim + bucket_size - 1) / bucket_size * bucket_size;
+    }
+    return ret;
+  }
+
+  static std::string Key(const std::unordered_map<std::string, mxnet::TShape>& shapes) {
+    std::map<std::string, mxnet::TShape> sorted(shapes.begin(), shapes.end());
+    std::ostringstream os;
+    for (const auto& kv : sorted) {
+      os << kv.first << kv.second << ';';
+    }
+    return os.str();
+  }
+
+  bool Get(const std::string& key, Entry* entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+      ++misses;
+      return false;
+    }
+    ++hits;
+    lru.splice(lru.begin(), lru, it->second);
+    *entry = it->second->second;
+    return true;
+  }
+
+  void Put(const std::string& key, const Entry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (capacity == 0 || index.count(key) != 0) return;
+    lru.emplace_front(key, entry);
+    index[key] = lru.begin();
+    while (lru.size() > capacity) {
+      index.erase(lru.back().first);
+      lru.pop_back();
+    }
+  }
+
+  std::mutex mutex;
+  size_t capacity;
+  int bucket_axis;
+  uint32_t bucket_size;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // most recently used first
+  std::list<std::pair<std::string, Entry>> lru;
+  std::unordered_map<std::string, std::list<std::pair<std::string, Entry>>::iterator> index;
+};
+
 // predictor interface
 struct MXAPIPredictor {
   // output arrays
@@ -52,14 +133,18 @@ struct MXAPIPredictor {
 
   // uint32_t buffer for output shapes
   std::vector<uint32_t> out_shapes_buffer;
+  // uint32_t buffer for input shapes
+  std::vector<uint32_t> in_shapes_buffer;
   // key to arguments
   std::unordered_map<std::string, size_t> key2arg;
-  // executor
-  std::unique_ptr<Executor> exec;
+  // executor, shared with the reshape cache
+  std::shared_ptr<Executor> exec;
   // symbol
   nnvm::Symbol sym;
   // Context
   Context ctx;
+  // executors of reshaped predictors
+  std::shared_ptr<MXAPIPredReshapeCache> reshape_cache;
 };
 
 struct MXAPINDList {
@@ -289,6 +374,8 @@ int _CreatePartialOut(const char* symbol_json_str,
     ret->aux_arrays = aux_arrays;
     ret->out_shapes = out_shapes;
     ret->out_dtypes = result_out_types;
+    ret->reshape_cache = std::make_shared<MXAPIPredReshapeCache>(
+        dmlc::GetEnv("MXNET_PREDICT_RESHAPE_CACHE_SIZE", 0), -1, 1);
 
     if (!lazy) {
       std::map<std::string, Context> ctx_map;
@@ -434,31 +521,17 @@ int MXPredCreateMultiThread(const char* symbol_json_str,
       out);
 }
 
-int MXPredReshape(uint32_t num_input_nodes,
-                  const char** input_keys,
-                  const uint32_t* input_shape_indptr,
-                  const uint32_t* input_shape_data,
-                  PredictorHandle handle,
-                  PredictorHandle* out) {
-  _CreateExecutor(handle);
-  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
-  std::unique_ptr<MXAPIPredictor> ret(new MXAPIPredictor());
-
-  API_BEGIN();
-  // shape inference
-  std::unordered_map<std::string, mxnet::TShape> new_shape;
-  for (uint32_t i = 0; i < num_input_nodes; ++i) {
-    new_shape[std::string(input_keys[i])] =
-        mxnet::TShape(input_shape_data + input_shape_indptr[i],
-            input_shape_data + input_shape_indptr[i + 1]);
-  }
-  ret->sym = p->sym;
+// infer the shapes for new input shapes and bind a predictor sharing the
+// parameters and the memory of p
+inline void _ReshapeAndBind(MXAPIPredictor* p,
+                            std::unordered_map<std::string, mxnet::TShape>* new_shape_ptr,
+                            MXAPIPredictor* ret) {
+  std::unordered_map<std::string, mxnet::TShape>& new_shape = *new_shape_ptr;
   std::vector<std::string> arg_names = ret->sym.ListInputNames(Symbol::kReadOnlyArgs);
   std::vector<std::string> aux_names = ret->sym.ListInputNames(Symbol::kAuxiliaryStates);
   mxnet::ShapeVector out_shapes(ret->sym.ListOutputNames().size());
   mxnet::ShapeVector aux_shapes(aux_names.size());
   mxnet::ShapeVector arg_shapes;
-  ret->key2arg = p->key2arg;
 
   try {
     mxnet::ShapeVector in_shapes;
@@ -483,7 +556,6 @@ int MXPredReshape(uint32_t num_input_nodes,
   }
 
   ret->arg_arrays = p->arg_arrays;
-  ret->ctx = p->ctx;
   for (size_t i=0; i < arg_names.size(); ++i) {
     mxnet::TShape newShape = arg_shapes[i];
     NDArray &arr = p->arg_arrays[i];
@@ -519,12 +591,89 @@ int MXPredReshape(uint32_t num_input_nodes,
                                    p->exec.get()));
     ret->out_shapes = out_shapes;
     ret->out_arrays = ret->exec->outputs();
-    ret->out_dtypes = p->out_dtypes;
+  }
+}
+
+int MXPredReshape(uint32_t num_input_nodes,
+                  const char** input_keys,
+                  const uint32_t* input_shape_indptr,
+                  const uint32_t* input_shape_data,
+                  PredictorHandle handle,
+                  PredictorHandle* out) {
+  _CreateExecutor(handle);
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  std::unique_ptr<MXAPIPredictor> ret(new MXAPIPredictor());
+
+  API_BEGIN();
+  // shape inference
+  std::unordered_map<std::string, mxnet::TShape> new_shape;
+  for (uint32_t i = 0; i < num_input_nodes; ++i) {
+    new_shape[std::string(input_keys[i])] =
+        mxnet::TShape(input_shape_data + input_shape_indptr[i],
+            input_shape_data + input_shape_indptr[i + 1]);
+  }
+  ret->sym = p->sym;
+  ret->key2arg = p->key2arg;
+  ret->ctx = p->ctx;
+  ret->out_dtypes = p->out_dtypes;
+  ret->reshape_cache = p->reshape_cache;
+
+  std::shared_ptr<MXAPIPredReshapeCache> cache = p->reshape_cache;
+  if (cache == nullptr || cache->capacity == 0) {
+    _ReshapeAndBind(p, &new_shape, ret.get());
+  } else {
+    for (auto& kv : new_shape) {
+      kv.second = cache->Bucket(kv.second);
+    }
+    const std::string key = MXAPIPredReshapeCache::Key(new_shape);
+    MXAPIPredReshapeCache::Entry entry;
+    if (cache->Get(key, &entry)) {
+      ret->exec = entry.exec;
+      ret->arg_arrays = entry.arg_arrays;
+      ret->aux_arrays = entry.aux_arrays;
+      ret->out_arrays = entry.out_arrays;
+      ret->out_shapes = entry.out_shapes;
+    } else {
+      _ReshapeAndBind(p, &new_shape, ret.get());
+      entry.exec = ret->exec;
+      entry.arg_arrays = ret->arg_arrays;
+      entry.aux_arrays = ret->aux_arrays;
+      entry.out_arrays = ret->out_arrays;
+      entry.out_shapes = ret->out_shapes;
+      cache->Put(key, entry);
+    }
   }
   *out = ret.release();
   API_END();
 }
 
+int MXPredSetReshapeCache(PredictorHandle handle,
+                          uint32_t capacity,
+                          int bucket_axis,
+                          uint32_t bucket_size) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  CHECK_GE(bucket_axis, -1) << "Invalid bucket axis " << bucket_axis;
+  p->reshape_cache = std::make_shared<MXAPIPredReshapeCache>(
+      capacity, bucket_axis, bucket_size);
+  API_END();
+}
+
+int MXPredGetReshapeCacheStats(PredictorHandle handle,
+                               uint64_t* hits,
+                               uint64_t* misses) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  *hits = 0;
+  *misses = 0;
+  if (p->reshape_cache != nullptr) {
+    std::lock_guard<std::mutex> lock(p->reshape_cache->mutex);
+    *hits = p->reshape_cache->hits;
+    *misses = p->reshape_cache->misses;
+  }
+  API_END();
+}
+
 int MXPredGetOutputShape(PredictorHandle handle,
                          uint32_t out_index,
                          uint32_t** shape_data,
@@ -543,6 +692,25 @@ int MXPredGetOutputShape(PredictorHandle handle,
   API_END();
 }
 
+int MXPredGetInputShape(PredictorHandle handle,
+                        const char* key,
+                        uint32_t** shape_data,
+                        uint32_t* shape_ndim) {
+  MXAPIPredictor* p = static_cast<MXAPIPredictor*>(handle);
+  API_BEGIN();
+  auto it = p->key2arg.find(key);
+  if (it == p->key2arg.end()) {
+    LOG(FATAL) << "cannot find input key " << key;
+  }
+  const mxnet::TShape& s = p->arg_arrays[it->second].shape();
+  CHECK_GE(s.ndim(), 0);
+  p->in_shapes_buffer.resize(s.ndim());
+  nnvm::ShapeTypeCast(s.begin(), s.end(), p->in_shapes_buffer.data());
+  *shape_data = p->in_shapes_buffer.data();
+  *shape_ndim = s.ndim();
+  API_END();
+}
+
 int MXPredGetOutputType(PredictorHandle handle,
                         uint32_t out_index,
                         int* out_dtype) {
@@ -678,3 +846,250 @@ int MXNDListFree(NDListHandle handle) {
   delete static_cast<MXAPINDList*>(handle);
   API_END();
 }
+
+// batching front end of a predictor, see MXPredBatcherCreate
+class MXAPIPredBatcher {
+ public:
+  /*! \brief number of buckets in the queue time histogram */
+  static const size_t kNumQueueTimeBuckets = 32;
+
+  MXAPIPredBatcher(PredictorHandle pred_hnd, uint32_t max_batch_size, uint32_t timeout_us)
+      : max_batch_size_(max_batch_size), timeout_(timeout_us) {
+    CHECK_GT(max_batch_size, 0U) << "max_batch_size must be positive";
+    _CreateExecutor(pred_hnd);
+    pred_ = static_cast<MXAPIPredictor*>(pred_hnd);
+    for (const auto& kv : pred_->key2arg) {
+      const mxnet::TShape& shape = pred_->arg_arrays[kv.second].shape();
+      CHECK(shape.ndim() > 0 && static_cast<uint32_t>(shape[0]) == max_batch_size)
+          << "input " << kv.first << " must have the batch size "
+          << max_batch_size << " as its first dimension";
+      key2input_[kv.first] = input_args_.size();
+      input_args_.push_back(kv.second);
+      input_buffers_.emplace_back(shape.Size());
+    }
+    for (const NDArray& out : pred_->out_arrays) {
+      const mxnet::TShape& shape = out.shape();
+      CHECK(shape.ndim() > 0 && static_cast<uint32_t>(shape[0]) == max_batch_size)
+          << "outputs must have the batch size " << max_batch_size
+          << " as their first dimension";
+      output_buffers_.emplace_back(shape.Size());
+    }
+    queue_time_hist_.resize(kNumQueueTimeBuckets, 0);
+    batch_size_hist_.resize(max_batch_size + 1, 0);
+    worker_ = std::thread([this]() { this->Run(); });
+  }
+
+  ~MXAPIPredBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queue_cv_.notify_all();
+    worker_.join();
+  }
+
+  void Forward(uint32_t num_inputs,
+               const char** input_keys,
+               const float** input_data,
+               const uint32_t* input_sizes,
+               uint32_t num_outputs,
+               float** output_data,
+               const uint32_t* output_sizes) {
+    Request req;
+    CHECK_EQ(num_inputs, input_args_.size()) << "every input of the predictor must be given";
+    req.inputs.resize(num_inputs, nullptr);
+    for (uint32_t i = 0; i < num_inputs; ++i) {
+      auto it = key2input_.find(input_keys[i]);
+      if (it == key2input_.end()) {
+        LOG(FATAL) << "cannot find input key " << input_keys[i];
+      }
+      CHECK(req.inputs[it->second] == nullptr) << "input " << input_keys[i] << " given twice";
+      CHECK(input_data[i] != nullptr) << "input " << input_keys[i] << " has no data";
+      CHECK_EQ(input_sizes[i], SampleSize(input_buffers_[it->second]))
+          << "input " << input_keys[i] << " must hold exactly one sample";
+      req.inputs[it->second] = input_data[i];
+    }
+    CHECK_LE(num_outputs, output_buffers_.size()) << "Output index out of range";
+    for (uint32_t i = 0; i < num_outputs; ++i) {
+      CHECK(output_data[i] != nullptr) << "output " << i << " has no buffer";
+      CHECK_EQ(output_sizes[i], SampleSize(output_buffers_[i]))
+          << "output " << i << " must hold exactly one sample";
+      req.outputs.push_back(output_data[i]);
+    }
+    req.enqueue_time = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_.push_back(&req);
+    queue_cv_.notify_one();
+    done_cv_.wait(lock, [&req]() { return req.done; });
+    if (!req.error.empty()) {
+      throw dmlc::Error(req.error);
+    }
+  }
+
+  void GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_time_hist_ret = queue_time_hist_;
+    batch_size_hist_ret = batch_size_hist_;
+  }
+
+  // histograms returned by MXPredBatcherGetStats
+  std::vector<uint64_t> queue_time_hist_ret;
+  std::vector<uint64_t> batch_size_hist_ret;
+
+ private:
+  struct Request {
+    // one sample for each input, in the order of input_args_
+    std::vector<const float*> inputs;
+    // one sample for each requested output
+    std::vector<float*> outputs;
+    std::chrono::steady_clock::time_point enqueue_time;
+    bool done = false;
+    std::string error;
+  };
+
+  inline size_t SampleSize(const std::vector<float>& batch_buffer) const {
+    return batch_buffer.size() / max_batch_size_;
+  }
+
+  // bucket i holds durations in [2^(i-1), 2^i) microseconds
+  static inline size_t QueueTimeBucket(std::chrono::steady_clock::duration d) {
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    size_t bucket = 0;
+    while (us != 0 && bucket + 1 < kNumQueueTimeBuckets) {
+      us >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      // wait for the batch to fill up, at most until the oldest request times out
+      const auto deadline = queue_.front()->enqueue_time + timeout_;
+      queue_cv_.wait_until(lock, deadline, [this]() {
+        return stop_ || queue_.size() >= max_batch_size_;
+      });
+      const size_t batch_size = std::min<size_t>(queue_.size(), max_batch_size_);
+      std::vector<Request*> batch(queue_.begin(), queue_.begin() + batch_size);
+      queue_.erase(queue_.begin(), queue_.begin() + batch_size);
+      const auto start = std::chrono::steady_clock::now();
+      for (Request* req : batch) {
+        ++queue_time_hist_[QueueTimeBucket(start - req->enqueue_time)];
+      }
+      ++batch_size_hist_[batch_size];
+      lock.unlock();
+
+      std::string error;
+      try {
+        RunBatch(batch);
+      } catch (const std::exception& e) {
+        error = e.what();
+      }
+
+      lock.lock();
+      for (Request* req : batch) {
+        req->error = error;
+        req->done = true;
+      }
+      done_cv_.notify_all();
+    }
+  }
+
+  void RunBatch(const std::vector<Request*>& batch) {
+    // gather, rows past the batch keep stale data and their outputs are dropped
+    for (size_t i = 0; i < input_args_.size(); ++i) {
+      std::vector<float>& buffer = input_buffers_[i];
+      const size_t sample_size = SampleSize(buffer);
+      for (size_t b = 0; b < batch.size(); ++b) {
+        std::memcpy(buffer.data() + b * sample_size, batch[b]->inputs[i],
+                    sample_size * sizeof(float));
+      }
+      pred_->arg_arrays[input_args_[i]].SyncCopyFromCPU(buffer.data(), buffer.size());
+    }
+    pred_->exec->Forward(false);
+    // scatter
+    size_t num_outputs = 0;
+    for (const Request* req : batch) {
+      num_outputs = std::max(num_outputs, req->outputs.size());
+    }
+    for (size_t i = 0; i < num_outputs; ++i) {
+      std::vector<float>& buffer = output_buffers_[i];
+      const size_t sample_size = SampleSize(buffer);
+      pred_->out_arrays[i].SyncCopyToCPU(buffer.data(), buffer.size());
+      for (size_t b = 0; b < batch.size(); ++b) {
+        if (i < batch[b]->outputs.size()) {
+          std::memcpy(batch[b]->outputs[i], buffer.data() + b * sample_size,
+                      sample_size * sizeof(float));
+        }
+      }
+    }
+  }
+
+  MXAPIPredictor* pred_;
+  size_t max_batch_size_;
+  std::chrono::microseconds timeout_;
+  // input key to input index, and the argument index of each input
+  std::unordered_map<std::string, size_t> key2input_;
+  std::vector<size_t> input_args_;
+  // staging buffers holding a whole batch, only used by the worker
+  std::vector<std::vector<float> > input_buffers_;
+  std::vector<std::vector<float> > output_buffers_;
+  // request queue and histograms, guarded by mutex_
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::deque<Request*> queue_;
+  bool stop_ = false;
+  std::vector<uint64_t> queue_time_hist_;
+  std::vector<uint64_t> batch_size_hist_;
+  // thread running the batches
+  std::thread worker_;
+};
+
+int MXPredBatcherCreate(PredictorHandle pred,
+                        uint32_t max_batch_size,
+                        uint32_t timeout_us,
+                        PredBatcherHandle* out) {
+  API_BEGIN();
+  *out = new MXAPIPredBatcher(pred, max_batch_size, timeout_us);
+  API_END();
+}
+
+int MXPredBatcherForward(PredBatcherHandle handle,
+                         uint32_t num_inputs,
+                         const char** input_keys,
+                         const float** input_data,
+                         const uint32_t* input_sizes,
+                         uint32_t num_outputs,
+                         float** output_data,
+                         const uint32_t* output_sizes) {
+  MXAPIPredBatcher* p = static_cast<MXAPIPredBatcher*>(handle);
+  API_BEGIN();
+  p->Forward(num_inputs, input_keys, input_data, input_sizes,
+             num_outputs, output_data, output_sizes);
+  API_END();
+}
+
+int MXPredBatcherGetStats(PredBatcherHandle handle,
+                          uint32_t* num_queue_time_buckets,
+                          const uint64_t** queue_time_hist,
+                          uint32_t* num_batch_size_buckets,
+                          const uint64_t** batch_size_hist) {
+  MXAPIPredBatcher* p = static_cast<MXAPIPredBatcher*>(handle);
+  API_BEGIN();
+  p->GetStats();
+  *num_queue_time_buckets = static_cast<uint32_t>(p->queue_time_hist_ret.size());
+  *queue_time_hist = p->queue_time_hist_ret.data();
+  *num_batch_size_buckets = static_cast<uint32_t>(p->batch_size_hist_ret.size());
+  *batch_size_hist = p->batch_size_hist_ret.data();
+  API_END();
+}
+
+int MXPredBatcherFree(PredBatcherHandle handle) {
+  API_BEGIN();
+  delete static_cast<MXAPIPredBatcher*>(handle);
+  API_END();
+}
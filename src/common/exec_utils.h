@@ -313,6 +313,12 @@ inline void LogMemoryPlan(const nnvm::Graph& g) {
       }
     }
   }
+  // offline planners also know the least memory any plan needs
+  if (g.attrs.count("storage_lower_bound_bytes") && g.attrs.count("storage_allocated_bytes")) {
+    LOG(INFO) << "planned " << g.GetAttr<size_t>("storage_allocated_bytes") / 1024
+              << " KB, lower bound " << g.GetAttr<size_t>("storage_lower_bound_bytes") / 1024
+              << " KB";
+  }
 }
 
 /* log the static memory plan of the graph. Example:
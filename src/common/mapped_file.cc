@@ -0,0 +1,83 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file mapped_file.cc
+ * \brief private memory mapping of a whole local file
+ */
+#include "./mapped_file.h"
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+namespace mxnet {
+namespace common {
+
+bool LocalFilePath(const std::string& uri, std::string* path) {
+  if (uri.compare(0, 7, "file://") == 0) {
+    *path = uri.substr(7);
+    return true;
+  }
+  if (uri.find("://") != std::string::npos) return false;
+  *path = uri;
+  return true;
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& uri) {
+  std::string path;
+  if (!LocalFilePath(uri, &path)) return nullptr;
+  std::shared_ptr<MappedFile> file(new MappedFile());
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+  file->data_ = static_cast<char*>(addr);
+  file->size_ = static_cast<size_t>(st.st_size);
+  file->mapped_ = true;
+#else
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin) return nullptr;
+  file->buffer_.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+  if (file->buffer_.empty()) return nullptr;
+  file->data_ = file->buffer_.data();
+  file->size_ = file->buffer_.size();
+#endif  // _WIN32
+  return file;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapped_) munmap(data_, size_);
+#endif  // _WIN32
+}
+
+}  // namespace common
+}  // namespace mxnet
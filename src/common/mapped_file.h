@@ -0,0 +1,71 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file mapped_file.h
+ * \brief private memory mapping of a whole local file
+ */
+#ifndef MXNET_COMMON_MAPPED_FILE_H_
+#define MXNET_COMMON_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mxnet {
+namespace common {
+
+/*!
+ * \brief the local path of a file URI, with file:// stripped
+ * \return false for other schemes such as s3:// or hdfs://
+ */
+bool LocalFilePath(const std::string& uri, std::string* path);
+
+/*!
+ * \brief A copy on write mapping of a local file. Pages are shared through the page
+ *  cache and a write copies only the page it touches. Where files cannot be mapped the
+ *  contents are read into memory instead.
+ */
+class MappedFile {
+ public:
+  /*! \return the mapping, or nullptr if the file is not local, missing, empty or unmappable */
+  static std::shared_ptr<MappedFile> Open(const std::string& uri);
+  ~MappedFile();
+
+  char* data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  MappedFile() = default;
+
+  char* data_{nullptr};
+  size_t size_{0};
+  bool mapped_{false};
+  /*! \brief file contents where the file cannot be mapped */
+  std::vector<char> buffer_;
+};
+
+}  // namespace common
+}  // namespace mxnet
+#endif  // MXNET_COMMON_MAPPED_FILE_H_
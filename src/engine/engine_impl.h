@@ -81,6 +81,8 @@ Engine *CreateNaiveEngine();
 Engine *CreateThreadedEnginePooled();
 /*! \return ThreadedEnginePerDevie instance */
 Engine *CreateThreadedEnginePerDevice();
+/*! \return ThreadedEnginePerDevice instance with work-stealing CPU workers */
+Engine *CreateThreadedEngineWorkStealing();
 #endif
 }  // namespace engine
 }  // namespace mxnet
@@ -134,6 +134,7 @@ class NaiveEngine final : public Engine {
           opr->opr_profile->startForDevice(exec_ctx.dev_type, exec_ctx.dev_id);
         }
         opr->fn(ctx, on_complete);
+        profiler::ProfileOperator::current_attributes() = nullptr;
         if (opr->profiling) {
           opr->opr_profile->stop();
         }
@@ -203,6 +204,7 @@ class NaiveEngine final : public Engine {
       exec_fun(RunContext{exec_ctx, &cpu_stream_, nullptr, false}, callback);
     }
     future.wait();
+    profiler::ProfileOperator::current_attributes() = nullptr;
     // increment mutable var version
     for (auto var : mutable_vars) {
       ++var->version_;
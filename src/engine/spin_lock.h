@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file spin_lock.h
+ * \brief Spin lock for the short critical sections of the engine.
+ */
+#ifndef MXNET_ENGINE_SPIN_LOCK_H_
+#define MXNET_ENGINE_SPIN_LOCK_H_
+
+#include <dmlc/base.h>
+#include <atomic>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace mxnet {
+namespace engine {
+
+/*!
+ * \brief Test-and-test-and-set spin lock, usable with std::lock_guard.
+ *  Waiters spin on a plain load so the cache line stays shared, and yield
+ *  the processor after a while so a preempted holder can make progress
+ *  when there are more engine threads than cores.
+ */
+class SpinLock {
+ public:
+  SpinLock() = default;
+  /*! \brief acquire the lock */
+  inline void lock() {
+    for (int spins = 0; ; ++spins) {
+      if (!locked_.exchange(true, std::memory_order_acquire)) return;
+      while (locked_.load(std::memory_order_relaxed)) {
+        if (++spins < kSpinsBeforeYield) {
+          Pause();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+  /*! \brief try to acquire the lock without waiting */
+  inline bool try_lock() {
+    return !locked_.load(std::memory_order_relaxed) &&
+           !locked_.exchange(true, std::memory_order_acquire);
+  }
+  /*! \brief release the lock */
+  inline void unlock() {
+    locked_.store(false, std::memory_order_release);
+  }
+
+ private:
+  /*! \brief number of busy-wait iterations before yielding the thread */
+  static constexpr int kSpinsBeforeYield = 1024;
+
+  static inline void Pause() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+  }
+
+  std::atomic<bool> locked_{false};
+  DISALLOW_COPY_AND_ASSIGN(SpinLock);
+};
+
+}  // namespace engine
+}  // namespace mxnet
+#endif  // MXNET_ENGINE_SPIN_LOCK_H_
@@ -42,6 +42,7 @@
 #include "./engine_impl.h"
 #include "../profiler/profiler.h"
 #include "./openmp.h"
+#include "./spin_lock.h"
 #include "../common/object_pool.h"
 #include "../profiler/custom_op_profiler.h"
 
@@ -189,10 +190,13 @@ class ThreadedVar final
   ExceptionRef var_exception;
 
  private:
-  // TODO(hotpxl) change this to spinlock for faster runtime
   // TODO(hotpxl) consider rename head
-  /*! \brief internal mutex of the ThreadedVar */
-  std::mutex mutex_;
+  /*!
+   * \brief internal lock of the ThreadedVar.
+   *  Critical sections only touch a few pointers and counters,
+   *  so spinning is cheaper than parking the thread on a mutex.
+   */
+  SpinLock lock_;
   /*!
    * \brief number of pending reads operation in the variable.
    *  will be marked as -1 when there is a already triggered pending write.
@@ -387,6 +391,7 @@ class ThreadedEngine : public Engine {
               std::make_shared<std::exception_ptr>(std::current_exception());
           callback();
         }
+        profiler::ProfileOperator::current_attributes() = nullptr;
         if (debug_info) {
           LOG(INFO) << "Fin ExecuteOprFn ";
         }
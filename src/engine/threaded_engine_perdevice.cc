@@ -31,6 +31,7 @@
 #include "../initialize.h"
 #include "./threaded_engine.h"
 #include "./thread_pool.h"
+#include "./work_stealing_queue.h"
 #include "../common/lazy_alloc_array.h"
 #include "../common/utils.h"
 
@@ -43,6 +44,7 @@ namespace engine {
  *  - Use fixed amount of threads for each device.
  *  - Use special threads for copy operations.
  *  - Each stream is allocated and bound to each of the thread.
+ *  - Optionally feed the CPU workers from per-worker work-stealing deques.
  */
 class ThreadedEnginePerDevice : public ThreadedEngine {
  public:
@@ -52,7 +54,13 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   static auto constexpr kPriorityQueue = kPriority;
   static auto constexpr kWorkerQueue = kFIFO;
 
-  ThreadedEnginePerDevice() noexcept(false) {
+  /*!
+   * \brief constructor
+   * \param cpu_work_stealing whether normal CPU tasks are scheduled with
+   *  per-worker work-stealing deques instead of one shared FIFO queue.
+   */
+  explicit ThreadedEnginePerDevice(bool cpu_work_stealing = false) noexcept(false)
+      : cpu_work_stealing_(cpu_work_stealing) {
     this->Start();
   }
   ~ThreadedEnginePerDevice() noexcept(false) {
@@ -65,6 +73,7 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
     gpu_priority_workers_.Clear();
     gpu_copy_workers_.Clear();
     cpu_normal_workers_.Clear();
+    cpu_stealing_workers_.Clear();
     cpu_priority_worker_.reset(nullptr);
   }
 
@@ -107,6 +116,27 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
         // CPU execution.
         if (opr_block->opr->prop == FnProperty::kCPUPrioritized) {
           cpu_priority_worker_->task_queue.Push(opr_block, opr_block->priority);
+        } else if (cpu_work_stealing_) {
+          int dev_id = ctx.dev_id;
+          int nthread = cpu_worker_nthreads_;
+          auto ptr =
+          cpu_stealing_workers_.Get(dev_id, [this, ctx, nthread]() {
+              auto blk = new StealingWorkerBlock(nthread);
+              blk->pool.reset(new ThreadPool(nthread,
+                  [this, ctx, blk](std::shared_ptr<dmlc::ManualEvent> ready_event) {
+                    this->CPUStealingWorker(ctx, blk, ready_event);
+                  }, true));
+            return blk;
+          });
+          if (ptr) {
+            // ops made ready by one of this block's workers stay on its own deque
+            const int worker_id = (stealing_block_ == ptr) ? stealing_worker_id_ : -1;
+            if (opr_block->opr->prop == FnProperty::kDeleteVar) {
+              ptr->task_queue.PushFront(opr_block, worker_id);
+            } else {
+              ptr->task_queue.Push(opr_block, worker_id);
+            }
+          }
         } else {
           int dev_id = ctx.dev_id;
           int nthread = cpu_worker_nthreads_;
@@ -213,9 +243,26 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
     // destructor
     ~ThreadWorkerBlock() noexcept(false) {}
   };
+  // working unit for CPU tasks scheduled by work stealing.
+  struct StealingWorkerBlock {
+    // task queue with one deque per worker
+    WorkStealingTaskQueue<OprBlock*> task_queue;
+    // thread pool that works on this task
+    std::unique_ptr<ThreadPool> pool;
+    // constructor
+    explicit StealingWorkerBlock(int nthread) : task_queue(nthread) {}
+    // destructor
+    ~StealingWorkerBlock() noexcept(false) {}
+  };
 
   /*! \brief whether this is a worker thread. */
   static MX_THREAD_LOCAL bool is_worker_;
+  /*! \brief work-stealing block the current thread works for, if any. */
+  static MX_THREAD_LOCAL StealingWorkerBlock *stealing_block_;
+  /*! \brief id of the current thread inside stealing_block_. */
+  static MX_THREAD_LOCAL int stealing_worker_id_;
+  /*! \brief whether normal CPU tasks use work stealing */
+  bool cpu_work_stealing_;
   /*! \brief number of concurrent thread cpu worker uses */
   size_t cpu_worker_nthreads_;
   /*! \brief number of concurrent thread each gpu worker uses */
@@ -224,6 +271,8 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
   size_t gpu_copy_nthreads_;
   // cpu worker
   common::LazyAllocArray<ThreadWorkerBlock<kWorkerQueue> > cpu_normal_workers_;
+  // cpu worker with work stealing
+  common::LazyAllocArray<StealingWorkerBlock> cpu_stealing_workers_;
   // cpu priority worker
   std::unique_ptr<ThreadWorkerBlock<kPriorityQueue> > cpu_priority_worker_;
   // workers doing normal works on GPU
@@ -303,6 +352,32 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
     }
   }
 
+  /*!
+   * \brief CPU worker that pops from its own deque and steals from its peers.
+   * \param block The task block of the worker.
+   */
+  inline void CPUStealingWorker(Context ctx,
+                                StealingWorkerBlock *block,
+                                const std::shared_ptr<dmlc::ManualEvent>& ready_event) {
+    this->is_worker_ = true;
+    const int worker_id = block->task_queue.RegisterWorker();
+    stealing_block_ = block;
+    stealing_worker_id_ = worker_id;
+    RunContext run_ctx{ctx, nullptr, nullptr, false};
+
+    // execute task
+    OprBlock* opr_block;
+    ready_event->signal();
+
+    // Set default number of threads for OMP parallel regions initiated by this thread
+    OpenMP::Get()->on_start_worker_thread(true);
+
+    while (block->task_queue.Pop(worker_id, &opr_block)) {
+      this->ExecuteOprBlock(run_ctx, opr_block);
+    }
+    stealing_block_ = nullptr;
+  }
+
   /*!
    * \brief Get number of cores this engine should reserve for its own use
    * \param using_gpu Whether there is GPU usage
@@ -338,6 +413,7 @@ class ThreadedEnginePerDevice : public ThreadedEngine {
     SignalQueueForKill(&gpu_normal_workers_);
     SignalQueueForKill(&gpu_copy_workers_);
     SignalQueueForKill(&cpu_normal_workers_);
+    SignalQueueForKill(&cpu_stealing_workers_);
     if (cpu_priority_worker_) {
       cpu_priority_worker_->task_queue.SignalForKill();
     }
@@ -348,7 +424,14 @@ Engine *CreateThreadedEnginePerDevice() {
   return new ThreadedEnginePerDevice();
 }
 
+Engine *CreateThreadedEngineWorkStealing() {
+  return new ThreadedEnginePerDevice(true);
+}
+
 MX_THREAD_LOCAL bool ThreadedEnginePerDevice::is_worker_ = false;
+MX_THREAD_LOCAL ThreadedEnginePerDevice::StealingWorkerBlock *
+    ThreadedEnginePerDevice::stealing_block_ = nullptr;
+MX_THREAD_LOCAL int ThreadedEnginePerDevice::stealing_worker_id_ = -1;
 
 }  // namespace engine
 }  // namespace mxnet
@@ -0,0 +1,299 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file work_stealing_queue.h
+ * \brief Task queue with one work-stealing deque per worker thread.
+ */
+#ifndef MXNET_ENGINE_WORK_STEALING_QUEUE_H_
+#define MXNET_ENGINE_WORK_STEALING_QUEUE_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mxnet {
+namespace engine {
+
+/*!
+ * \brief Bounded Chase-Lev deque.
+ *  The owner thread pushes and pops at the bottom without taking a lock,
+ *  other threads steal from the top with a single CAS.
+ * \tparam T trivially copyable element type, usually a pointer.
+ */
+template<typename T>
+class WorkStealingDeque {
+ public:
+  /*!
+   * \brief constructor
+   * \param capacity maximum number of elements, rounded up to a power of two.
+   */
+  explicit WorkStealingDeque(size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    mask_ = cap - 1;
+    buffer_.reset(new std::atomic<T>[cap]);
+  }
+  /*!
+   * \brief push an element at the bottom, only called by the owner.
+   * \return number of elements after the push, 0 if the deque is full.
+   */
+  inline size_t Push(T item) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(mask_)) return 0;
+    buffer_[b & mask_].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return static_cast<size_t>(b + 1 - t);
+  }
+  /*!
+   * \brief pop the most recently pushed element, only called by the owner.
+   * \return whether an element was popped.
+   */
+  inline bool Pop(T* item) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    *item = buffer_[b & mask_].load(std::memory_order_relaxed);
+    if (t == b) {
+      // last element, race against thieves for it
+      const bool won = top_.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+  /*!
+   * \brief steal the oldest element, may be called by any thread.
+   * \return whether an element was stolen.
+   */
+  inline bool Steal(T* item) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return false;
+    T x = buffer_[t & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return false;
+    }
+    *item = x;
+    return true;
+  }
+  /*! \return whether the deque looks empty, may be stale. */
+  inline bool Empty() const {
+    return top_.load(std::memory_order_seq_cst) >= bottom_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  /*! \brief index of the oldest element, advanced by thieves */
+  std::atomic<int64_t> top_{0};
+  /*! \brief keep top_ and bottom_ on different cache lines */
+  char pad_[64 - sizeof(std::atomic<int64_t>)];
+  /*! \brief index one past the newest element, owned by the owner */
+  std::atomic<int64_t> bottom_{0};
+  /*! \brief ring buffer */
+  std::unique_ptr<std::atomic<T>[]> buffer_;
+  /*! \brief capacity - 1 */
+  size_t mask_;
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+};
+
+/*!
+ * \brief Task queue shared by a fixed group of worker threads.
+ *  Each worker owns a WorkStealingDeque. Tasks pushed by a worker go to its
+ *  own deque without locking; tasks pushed from other threads, or that do
+ *  not fit, go to a shared FIFO injection queue. A worker that runs dry
+ *  looks at the injection queue, then steals from its peers, and finally
+ *  sleeps until new work is pushed or the queue is killed.
+ *
+ *  The interface mirrors dmlc::ConcurrentBlockingQueue so the engine can
+ *  signal it with the same helpers.
+ */
+template<typename T>
+class WorkStealingTaskQueue {
+ public:
+  /*!
+   * \brief constructor
+   * \param num_workers number of worker threads that will call Pop.
+   * \param deque_capacity capacity of each worker's local deque.
+   */
+  explicit WorkStealingTaskQueue(int num_workers, size_t deque_capacity = 1024) {
+    CHECK_GT(num_workers, 0);
+    for (int i = 0; i < num_workers; ++i) {
+      deques_.emplace_back(new WorkStealingDeque<T>(deque_capacity));
+    }
+  }
+  /*!
+   * \brief claim a worker slot, called once by each worker thread.
+   * \return the worker id to pass to Push and Pop.
+   */
+  inline int RegisterWorker() {
+    const int id = num_registered_.fetch_add(1);
+    CHECK_LT(id, static_cast<int>(deques_.size())) << "Too many workers registered";
+    return id;
+  }
+  /*!
+   * \brief push a task.
+   * \param item the task.
+   * \param worker_id id of the calling worker, or -1 if not called from a worker.
+   */
+  inline void Push(T item, int worker_id = -1) {
+    if (worker_id >= 0 && deques_[worker_id]->Push(item) != 0) {
+      NotifyOne();
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(shared_mutex_);
+      shared_.push_back(item);
+      shared_size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    NotifyOne();
+  }
+  /*!
+   * \brief push a task that should run before the queued ones.
+   *  From a worker this is its own deque, which is popped newest first.
+   */
+  inline void PushFront(T item, int worker_id = -1) {
+    if (worker_id >= 0 && deques_[worker_id]->Push(item) != 0) {
+      NotifyOne();
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(shared_mutex_);
+      shared_.push_front(item);
+      shared_size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    NotifyOne();
+  }
+  /*!
+   * \brief pop a task, blocking until one is available.
+   * \param worker_id id of the calling worker.
+   * \param item output task.
+   * \return false if the queue was killed.
+   */
+  bool Pop(int worker_id, T* item) {
+    while (!killed_.load(std::memory_order_acquire)) {
+      if (TryPop(worker_id, item)) return true;
+      // search for a while before going to sleep
+      num_searching_.fetch_add(1);
+      for (int i = 0; i < kSearchRounds; ++i) {
+        if (TryPop(worker_id, item)) {
+          // the last searcher to find work hands the search over
+          if (num_searching_.fetch_sub(1) == 1 && HasWork()) NotifyOne();
+          return true;
+        }
+        if (killed_.load(std::memory_order_acquire)) break;
+        std::this_thread::yield();
+      }
+      num_searching_.fetch_sub(1);
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      num_sleeping_.fetch_add(1);
+      while (!killed_.load(std::memory_order_acquire) && !HasWork()) {
+        sleep_cv_.wait(lock);
+      }
+      num_sleeping_.fetch_sub(1);
+    }
+    return false;
+  }
+  /*! \brief wake up all workers and make Pop return false */
+  void SignalForKill() {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    killed_.store(true, std::memory_order_release);
+    sleep_cv_.notify_all();
+  }
+
+ private:
+  /*! \brief number of attempts a worker makes before sleeping */
+  static constexpr int kSearchRounds = 64;
+
+  inline bool TryPop(int worker_id, T* item) {
+    const int n = static_cast<int>(deques_.size());
+    if (deques_[worker_id]->Pop(item)) return true;
+    if (shared_size_.load(std::memory_order_relaxed) != 0) {
+      std::lock_guard<std::mutex> lock(shared_mutex_);
+      if (!shared_.empty()) {
+        *item = shared_.front();
+        shared_.pop_front();
+        shared_size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    for (int i = 1; i < n; ++i) {
+      if (deques_[(worker_id + i) % n]->Steal(item)) return true;
+    }
+    return false;
+  }
+
+  inline bool HasWork() const {
+    if (shared_size_.load(std::memory_order_seq_cst) != 0) return true;
+    for (const auto& dq : deques_) {
+      if (!dq->Empty()) return true;
+    }
+    return false;
+  }
+
+  /*!
+   * \brief wake up a sleeping worker unless one is already searching.
+   *  The fence pairs with the counter updates in Pop, so either the pusher
+   *  sees the sleeper or the sleeper sees the pushed task.
+   */
+  inline void NotifyOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_sleeping_.load(std::memory_order_relaxed) == 0 ||
+        num_searching_.load(std::memory_order_relaxed) != 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.notify_one();
+  }
+
+  /*! \brief per-worker deques */
+  std::vector<std::unique_ptr<WorkStealingDeque<T> > > deques_;
+  /*! \brief injection queue for tasks pushed from outside the workers */
+  std::deque<T> shared_;
+  std::mutex shared_mutex_;
+  std::atomic<size_t> shared_size_{0};
+  /*! \brief sleeping state */
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic<int> num_sleeping_{0};
+  std::atomic<int> num_searching_{0};
+  std::atomic<int> num_registered_{0};
+  std::atomic<bool> killed_{false};
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingTaskQueue);
+};
+
+}  // namespace engine
+}  // namespace mxnet
+#endif  // MXNET_ENGINE_WORK_STEALING_QUEUE_H_
@@ -0,0 +1,150 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file checkpoint_pass.cc
+ * \brief Choose the forward nodes which the backward pass recomputes
+ */
+
+#include <mxnet/base.h>
+#include <mxnet/op_attr_types.h>
+#include <nnvm/graph.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "./exec_pass.h"
+
+namespace mxnet {
+namespace exec {
+
+namespace {
+
+using nnvm::Node;
+using nnvm::ObjectPtr;
+using nnvm::Op;
+
+/*! \brief Whether the op draws random numbers, judged by the resources it requests */
+bool IsRandom(const Node& node) {
+  auto has_random = [](const std::vector<ResourceRequest>& reqs) {
+    for (const auto& req : reqs) {
+      if (req.type == ResourceRequest::kRandom ||
+          req.type == ResourceRequest::kParallelRandom) return true;
+#if MXNET_USE_CUDNN == 1
+      if (req.type == ResourceRequest::kCuDNNDropoutDesc) return true;
+#endif  // MXNET_USE_CUDNN == 1
+    }
+    return false;
+  };
+  static auto& resource_request = Op::GetAttr<FResourceRequest>("FResourceRequest");
+  static auto& resource_request_ex = Op::GetAttr<FResourceRequestEx>("FResourceRequestEx");
+  const auto fresource_request = resource_request.get(node.op(), nullptr);
+  if (fresource_request != nullptr && has_random(fresource_request(node.attrs))) return true;
+  // the graph is planned before the device is known, so ask for both
+  const auto fresource_request_ex = resource_request_ex.get(node.op(), nullptr);
+  if (fresource_request_ex != nullptr) {
+    for (int dev_mask : {mshadow::cpu::kDevMask, mshadow::gpu::kDevMask}) {
+      if (has_random(fresource_request_ex(node.attrs, dev_mask, DispatchMode::kFComputeEx))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*!
+ * \brief Whether the output of a node can be recomputed cheaply and exactly.
+ *  Ops whose recomputation costs about as much as their backward (matrix products,
+ *  convolutions, recurrent layers) always keep their outputs, which bounds the
+ *  extra compute by one forward pass over the remaining, memory bound ops.
+ */
+bool CanRecompute(const Node& node) {
+  if (node.is_variable()) return false;
+  static const std::unordered_set<std::string> expensive_ops = {
+    "Convolution", "Deconvolution", "FullyConnected", "dot", "batch_dot", "RNN",
+    "Concat", "Embedding", "SoftmaxOutput",
+    "_contrib_interleaved_matmul_selfatt_qk", "_contrib_interleaved_matmul_selfatt_valatt",
+    "_contrib_interleaved_matmul_encdec_qk", "_contrib_interleaved_matmul_encdec_valatt",
+    "_contrib_interleaved_selfatt_fused"
+  };
+  if (expensive_ops.count(node.op()->name)) return false;
+  // Ops with side effects would apply them twice
+  static auto& fmutate_inputs = Op::GetAttr<nnvm::FMutateInputs>("FMutateInputs");
+  if (fmutate_inputs.get(node.op(), nullptr) != nullptr) return false;
+  static auto& fstateful = Op::GetAttr<FCreateOpState>("FCreateOpState");
+  if (fstateful.get(node.op(), nullptr) != nullptr) return false;
+  // Recomputing must give the same output, which rules out random ops
+  static auto& deterministic_output =
+      Op::GetAttr<THasDeterministicOutput>("THasDeterministicOutput");
+  if (deterministic_output.contains(node.op())) return deterministic_output[node.op()];
+  return !IsRandom(node);
+}
+
+// __force_mirroring__ asks for recomputation regardless of cost, as with
+// MXNET_BACKWARD_DO_MIRROR, but random ops are still kept
+bool ForceMirroring(const Node& node) {
+  auto it = node.attrs.dict.find("__force_mirroring__");
+  return it != node.attrs.dict.end() &&
+         (it->second == "True" || it->second == "true" || it->second == "1") &&
+         !IsRandom(node);
+}
+
+}  // namespace
+
+std::function<int(const nnvm::Node& node)> PlanCheckpoints(const nnvm::Graph& g,
+                                                            const std::string& strategy) {
+  CHECK(strategy == "sqrt" || strategy == "all")
+      << "Unknown checkpoint strategy " << strategy << ", expected none, sqrt or all";
+  std::vector<const Node*> candidates;
+  std::vector<bool> recompute;
+  nnvm::DFSVisit(g.outputs, [&](const ObjectPtr& n) {
+      if (n->is_variable()) return;
+      candidates.push_back(n.get());
+      recompute.push_back(CanRecompute(*n));
+    });
+  // Walk the nodes in topological order and keep the output of every segment_size-th
+  // recomputable node, so that sqrt(N) segments of sqrt(N) nodes each are recomputed
+  // and the activations alive at any time are O(sqrt(N)).
+  size_t num_recompute = 0;
+  for (bool r : recompute) num_recompute += r;
+  const size_t segment_size = strategy == "all" ? num_recompute + 1 :
+      static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(num_recompute))));
+  auto mirrored = std::make_shared<std::unordered_set<const Node*> >();
+  size_t in_segment = 0;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (ForceMirroring(*candidates[i])) {
+      mirrored->insert(candidates[i]);
+    } else if (!recompute[i]) {
+      in_segment = 0;
+    } else if (++in_segment < segment_size) {
+      mirrored->insert(candidates[i]);
+    } else {
+      in_segment = 0;
+    }
+  }
+  return [mirrored](const nnvm::Node& node) -> int {
+    return mirrored->count(&node);
+  };
+}
+
+}  // namespace exec
+}  // namespace mxnet
@@ -37,6 +37,7 @@
 #include <string>
 #include <utility>
 #include <tuple>
+#include <functional>
 
 namespace mxnet {
 namespace exec {
@@ -221,6 +222,19 @@ Graph DetectInplaceAddTo(Graph g);
  */
 Graph EliminateCommonExpr(Graph && g);
 
+/*!
+ * \brief Choose the forward nodes which the gradient pass recomputes from the kept
+ *  outputs (checkpoints) instead of keeping their own outputs until backward.
+ *
+ * \param g input forward graph
+ * \param strategy "sqrt" keeps one output in every sqrt(N) recomputable nodes,
+ *  "all" recomputes every node that is cheap and safe to recompute
+ *
+ * \return mirror function for MXGradient
+ */
+std::function<int(const nnvm::Node& node)> PlanCheckpoints(const nnvm::Graph& g,
+                                                            const std::string& strategy);
+
 /*!
  * \brief Fuse pointwise operations in the graph.
  *
@@ -174,6 +174,10 @@ void GraphExecutor::Print(std::ostream &os) const {  // NOLINT(*)
   // message to be backward compatible with the memonger
   size_t total_bytes = graph_.GetAttr<size_t>("storage_allocated_bytes");
   os << "Total " << (total_bytes >> 20UL) << " MB allocated\n";
+  if (graph_.attrs.count("storage_lower_bound_bytes")) {
+    size_t lower_bound = graph_.GetAttr<size_t>("storage_lower_bound_bytes");
+    os << "Planned " << total_bytes << " bytes, lower bound " << lower_bound << " bytes\n";
+  }
   os << "Total " << 11 << " TempSpace resource requested\n";
 }
 
@@ -376,10 +380,15 @@ nnvm::Graph GraphExecutor::InitFullGraph(nnvm::Symbol symbol,
   zero_ops.push_back(nnvm::Op::Get("zeros_like"));
   zero_ops.push_back(nnvm::Op::Get("_zeros"));
 
+  // checkpointing replaces MXNET_BACKWARD_DO_MIRROR when it is enabled
+  std::string checkpoint = dmlc::GetEnv("MXNET_BACKWARD_CHECKPOINT", std::string("none"));
+  std::function<int(const nnvm::Node&)> mirror_fun = need_mirror;
+  if (checkpoint != "none") mirror_fun = PlanCheckpoints(g, checkpoint);
+
   // take gradient
   nnvm::Graph g_grad = nnvm::pass::MXGradient(
       g, symbol.outputs, xs, head_grad_entry_,
-      AggregateGradient, need_mirror, nullptr,
+      AggregateGradient, mirror_fun, nullptr,
       zero_ops, "_copy");
   CHECK_EQ(g_grad.outputs.size(), xs.size());
   for (const auto &e : g_grad.outputs) {
@@ -733,6 +742,8 @@ void GraphExecutor::FinishInitGraph(nnvm::Symbol symbol,
       if (vstorage_type[i] != kDefaultStorage) arg_storage_id[i] = kDynamicStorageID;
     }
     g.attrs["storage"] = std::make_shared<dmlc::any>(std::move(arg_storage_id));
+    g.attrs["mem_planner"] = std::make_shared<dmlc::any>(
+        dmlc::GetEnv("MXNET_MEMORY_PLANNER", std::string("default")));
     g = nnvm::ApplyPass(g, "MXPlanMemory");
   }
   g = DetectInplaceAddTo(g);
@@ -770,6 +781,7 @@ void GraphExecutor::FinishInitGraph(nnvm::Symbol symbol,
   }
   this->InitCachedOps();
   this->InitOpSegs();
+  this->InitOprSchedules();
 }
 
 /*!
@@ -1387,6 +1399,43 @@ void GraphExecutor::BulkOpSegs(size_t from_node, size_t up_to_node, size_t segme
   }
 }
 
+void GraphExecutor::InitOprSchedules() {
+  fwd_schedule_ = OprSchedule();
+  bwd_schedule_ = OprSchedule();
+  if (monitor_callback_ || is_dynamic_) return;
+  size_t total_num_nodes = graph_.indexed_graph().num_nodes();
+  fwd_schedule_ = CreateOprSchedule(0, num_forward_nodes_);
+  bwd_schedule_ = CreateOprSchedule(num_forward_nodes_, total_num_nodes);
+}
+
+GraphExecutor::OprSchedule GraphExecutor::CreateOprSchedule(size_t topo_start,
+                                                            size_t topo_end) const {
+  OprSchedule ret;
+  const auto& idx = graph_.indexed_graph();
+  // mirror the push order of RunOps without monitor callbacks
+  for (size_t nid = topo_start; nid < topo_end; ++nid) {
+    const auto& seg_op = cached_seg_opr_[nid];
+    if (seg_op.opr != nullptr && seg_op.topo_end <= topo_end) {
+      ret.oprs.emplace_back(seg_op.opr, seg_op.ctx);
+      nid = seg_op.topo_end - 1;
+      continue;
+    }
+    if (idx[nid].source->is_variable()) continue;
+    const OpNode& opnode = op_nodes_[nid];
+    if (opnode.skip_exec_node) continue;
+    // copies and subgraphs are not engine operators, leave them to RunOps
+    if (opnode.exec->exec_type() == ExecType::kCrossDeviceCopy ||
+        opnode.exec->exec_type() == ExecType::kSubgraphExec ||
+        opnode.cached_opr == nullptr) {
+      ret.oprs.clear();
+      return ret;
+    }
+    ret.oprs.emplace_back(opnode.cached_opr, opnode.ctx);
+  }
+  ret.valid = true;
+  return ret;
+}
+
 void GraphExecutor::ExecuteMonInputCallback(size_t nid) {
   static const auto& flist_inputs =
       nnvm::Op::GetAttr<nnvm::FListInputNames>("FListInputNames");
@@ -1442,10 +1491,27 @@ void GraphExecutor::RunOps(bool is_train, size_t topo_start, size_t topo_end) {
     opnode.exec->op_ctx.need_grad = need_grad_;
   }
 
+  // Replay the operators resolved at bind time for full passes of static graphs
+  const OprSchedule* schedule = nullptr;
+  if (monitor_callback_ == nullptr && !this->is_dynamic_) {
+    if (topo_start == 0 && topo_end == num_forward_nodes_) {
+      schedule = &fwd_schedule_;
+    } else if (topo_start == num_forward_nodes_ && topo_end == idx.num_nodes()) {
+      schedule = &bwd_schedule_;
+    }
+  }
+  if (schedule != nullptr && schedule->valid) {
+    bool profiling = profiler::Profiler::Get()->GetState() == profiler::Profiler::kRunning;
+    for (const auto& opr : schedule->oprs) {
+      Engine::Get()->Push(opr.first, opr.second, 0, profiling);
+    }
+    return;
+  }
+
   mxnet::ShapeVector rshape = graph_.MoveCopyAttr<mxnet::ShapeVector>("shape");
   // Push Ops
   for (size_t nid = topo_start; nid < topo_end; ++nid) {
-    auto seg_op = cached_seg_opr_[nid];
+    const auto& seg_op = cached_seg_opr_[nid];
     // Check segments first
     if (monitor_callback_ == nullptr && seg_op.opr != nullptr && seg_op.topo_end <= topo_end) {
       bool profiling = profiler::Profiler::Get()->GetState() == profiler::Profiler::kRunning;
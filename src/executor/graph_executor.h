@@ -152,6 +152,13 @@ class GraphExecutor : public Executor {
     // list of op executors
     std::vector<std::shared_ptr<OpExecutor> > exec_list;
   };
+  // engine operators pushed by one pass of RunOps, resolved at bind time
+  struct OprSchedule {
+    // whether every node of the pass can be replayed from the schedule
+    bool valid = false;
+    // operators in push order, with the context to push each of them on
+    std::vector<std::pair<Engine::OprHandle, Context> > oprs;
+  };
   // Initialize in_args, arg_grads, and aux_states
   void InitArguments(const nnvm::IndexedGraph& idx,
                      const mxnet::ShapeVector& inferred_shapes,
@@ -196,6 +203,10 @@ class GraphExecutor : public Executor {
   void InitCachedOps();
   // initialize the opr segments for bulk exec
   void InitOpSegs();
+  // initialize the replay schedules of the forward and backward pass
+  void InitOprSchedules();
+  // resolve the operators RunOps would push for [topo_start, topo_end)
+  OprSchedule CreateOprSchedule(size_t topo_start, size_t topo_end) const;
   // initialize the resources in the graph
   // initialize the memory of data entries
   // shared_pool: extra memory shared from other parts
@@ -259,6 +270,10 @@ class GraphExecutor : public Executor {
   bool prefer_bulk_execution_;
   // cached segment operator
   std::vector<CachedSegOpr> cached_seg_opr_;
+  // replay schedule of the forward pass
+  OprSchedule fwd_schedule_;
+  // replay schedule of the backward pass
+  OprSchedule bwd_schedule_;
   // verbose logging
   bool log_verbose_ = false;
   // subgraph property name
@@ -41,7 +41,7 @@ struct CachedOp::DynamicRuntime {
 CachedOp::CachedOp(
     const nnvm::Symbol& sym,
     const std::vector<std::pair<std::string, std::string> >& flags) {
-  config_.Init(flags);
+  config_.InitWithEnv(flags);
   this->dynamic_shape_checked_ = false;
 
   if (config_.static_shape) {
@@ -51,7 +51,7 @@ CachedOp::CachedOp(
   auto grad_graph = nnvm::Graph();
   std::unordered_map<uint32_t, uint32_t> fwd_input_to_grad_output;
   CreateFullGraph(sym.Copy(), &fwd_graph_, &grad_graph, &full_graph_,
-                  &ograd_entries_, &fwd_input_to_grad_output);
+                  &ograd_entries_, &fwd_input_to_grad_output, config_.backward_checkpoint);
 
   {
     const auto& idx = fwd_graph_.indexed_graph();
@@ -224,6 +224,7 @@ bool CachedOp::SetForwardGraph(
     storage[idx.entry_id(idx.outputs()[i])] = exec::kExternalStorageID;
   }
 
+  g.attrs["mem_planner"] = std::make_shared<dmlc::any>(config_.mem_planner);
   auto mem_plan = MXPlanMemory(
       &g, std::move(storage), g.GetAttr<std::vector<uint32_t> >(AddPrefix(prefix, REF_COUNT)),
       AddPrefix(prefix, STORAGE_PLAN));
@@ -352,6 +353,7 @@ bool CachedOp::SetBackwardGraph(
   for (const auto i : idx.input_nodes()) storage[idx.entry_id(i, 0)] = exec::kExternalStorageID;
   for (const auto i : idx.outputs()) storage[idx.entry_id(i)] = exec::kExternalStorageID;
 
+  g.attrs["mem_planner"] = std::make_shared<dmlc::any>(config_.mem_planner);
   auto mem_plan = MXPlanMemory(
       &g, std::move(storage),
       g.GetAttr<std::vector<uint32_t> >(AddPrefix(BACKWARD, REF_COUNT)),
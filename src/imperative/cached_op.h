@@ -130,7 +130,8 @@ void CreateForwardGraph(const nnvm::Symbol &sym, nnvm::Graph *fwd_graph) {
 void CreateBackwardGraph(nnvm::Graph* fwd_graph,
                          nnvm::Graph* grad_graph,
                          std::vector<nnvm::NodeEntry>* ograd_entries,
-                         std::unordered_map<uint32_t, uint32_t>* fwd_input_to_grad_output) {
+                         std::unordered_map<uint32_t, uint32_t>* fwd_input_to_grad_output,
+                         const std::string& checkpoint = "none") {
   using namespace nnvm;
   static const std::vector<const Op*> zero_ops{Op::Get("zeros_like"), Op::Get("_zeros")};
   ograd_entries->reserve(fwd_graph->outputs.size());
@@ -159,9 +160,11 @@ void CreateBackwardGraph(nnvm::Graph* fwd_graph,
   CHECK(!xs.empty())
     << "There are no inputs in computation graph that require gradients.";
 
+  std::function<int(const nnvm::Node&)> mirror_fun = nullptr;
+  if (checkpoint != "none") mirror_fun = exec::PlanCheckpoints(*fwd_graph, checkpoint);
   *grad_graph = pass::MXGradient(
     *fwd_graph, fwd_graph->outputs, xs, *ograd_entries,
-    exec::AggregateGradient, nullptr, nullptr,
+    exec::AggregateGradient, mirror_fun, nullptr,
     zero_ops, "_copy");
 }
 
@@ -171,7 +174,8 @@ void CreateFullGraph(const nnvm::Symbol& sym,
                      nnvm::Graph* grad_graph,
                      nnvm::Graph* full_graph,
                      std::vector<nnvm::NodeEntry>* ograd_entries,
-                     std::unordered_map<uint32_t, uint32_t>* fwd_input_to_grad_output) {
+                     std::unordered_map<uint32_t, uint32_t>* fwd_input_to_grad_output,
+                     const std::string& checkpoint = "none") {
   using namespace nnvm;
   CreateForwardGraph(sym, fwd_graph);
 
@@ -181,7 +185,7 @@ void CreateFullGraph(const nnvm::Symbol& sym,
 
   // construct backward graph
   CreateBackwardGraph(fwd_graph, grad_graph, ograd_entries,
-                      fwd_input_to_grad_output);
+                      fwd_input_to_grad_output, checkpoint);
 
   // Add backward graph outputs to full graph
   full_graph->outputs = fwd_graph->outputs;
@@ -315,6 +319,8 @@ struct CachedOpConfig : public dmlc::Parameter<CachedOpConfig> {
   mxnet::Tuple<uint32_t> data_indices;
   mxnet::Tuple<uint32_t> param_indices;
   std::string subgraph;
+  std::string mem_planner;
+  std::string backward_checkpoint;
   DMLC_DECLARE_PARAMETER(CachedOpConfig) {
     DMLC_DECLARE_FIELD(static_alloc)
     .set_default(false)
@@ -346,6 +352,34 @@ struct CachedOpConfig : public dmlc::Parameter<CachedOpConfig> {
     DMLC_DECLARE_FIELD(is_dynamic)
     .set_default(false)
     .describe("Whether the graph contains dynamic shape operators.");
+    DMLC_DECLARE_FIELD(mem_planner)
+    .set_default(std::string("default"))
+    .describe("Memory planner of the static memory plan: default, greedy_by_size, "
+              "interval_coloring or auto.");
+    DMLC_DECLARE_FIELD(backward_checkpoint)
+    .set_default(std::string("none"))
+    .describe("Forward outputs to recompute in backward instead of keeping them: "
+              "none, sqrt or all.");
+  }
+  /*!
+   * \brief Initialize from the flags, falling back to MXNET_MEMORY_PLANNER and
+   *  MXNET_BACKWARD_CHECKPOINT for the ones not given. The environment is read on every
+   *  construction, as GraphExecutor does on every bind.
+   */
+  void InitWithEnv(const std::vector<std::pair<std::string, std::string> >& flags) {
+    Init(flags);
+    auto given = [&flags](const char* key) {
+      for (const auto& kv : flags) {
+        if (kv.first == key) return true;
+      }
+      return false;
+    };
+    if (!given("mem_planner")) {
+      mem_planner = dmlc::GetEnv("MXNET_MEMORY_PLANNER", mem_planner);
+    }
+    if (!given("backward_checkpoint")) {
+      backward_checkpoint = dmlc::GetEnv("MXNET_BACKWARD_CHECKPOINT", backward_checkpoint);
+    }
   }
 };
 
@@ -435,7 +469,7 @@ class CachedOp {
       sym.outputs = fwd_graph_.outputs;
       CreateFullGraph(sym.Copy(), &info.fwd_graph, &info.grad_graph,
                       &info.full_graph, &info.ograd_entries,
-                      &info.fwd_input_to_grad_output);
+                      &info.fwd_input_to_grad_output, config_.backward_checkpoint);
 
       OptimizeGraph(&info.full_graph, &info.fwd_graph, &info.grad_graph,
                     context_, fwd_graph_.outputs.size(), inlining_);
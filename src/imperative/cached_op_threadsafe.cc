@@ -33,35 +33,106 @@ DMLC_REGISTER_PARAMETER(CachedOpThreadSafeConfig);
 constexpr uint32_t kEidNotExist = std::numeric_limits<uint32_t>::max();
 
 
-struct CachedOpThreadSafe::GraphInfo {
-  nnvm::Graph fwd_graph;
-};
-
 struct CachedOpThreadSafe::DynamicRuntime {
-  GraphInfo info;
+  std::shared_ptr<const nnvm::Graph> fwd_graph;
   std::vector<OpStatePtr> op_states;
 };
 
-OpStatePtr CachedOpThreadSafe::GetCachedOpState(
-    const Context& ctx) {
+OpStatePtr CachedOpThreadSafe::GetTemplateState(const Context& ctx) {
+  // Called with graph_cache_mutex_ held. The graph of the state is only used
+  // as a template for GetForwardGraph and never modified, so one state per
+  // device is enough.
+  auto& states = cached_op_states_[ctx];
+  if (states.empty()) {
+    nnvm::Graph full_graph;
+    states.push_back(OpStatePtr::Create<CachedOpState>(ctx, fwd_graph_, full_graph, false));
+  }
+  return states.front();
+}
+
+std::shared_ptr<const nnvm::Graph> CachedOpThreadSafe::GetForwardGraph(
+    const Context& default_ctx,
+    const std::vector<NDArray*>& inputs) {
+  GraphSignature sig;
+  sig.ctx = default_ctx;
+  sig.shapes.reserve(inputs.size());
+  sig.dtypes.reserve(inputs.size());
+  sig.stypes.reserve(inputs.size());
+  for (auto input : inputs) {
+    sig.shapes.emplace_back(input->shape());
+    sig.dtypes.emplace_back(input->dtype());
+    sig.stypes.emplace_back(input->storage_type());
+  }
+
+  std::shared_ptr<const GraphCache> cache = std::atomic_load(&graph_cache_);
+  if (cache) {
+    auto it = cache->find(sig);
+    if (it != cache->end()) {
+      it->second->last_use.store(++use_clock_, std::memory_order_relaxed);
+      return it->second->graph;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(graph_cache_mutex_);
+  // another thread may have added the graph while we were waiting
+  cache = std::atomic_load(&graph_cache_);
+  if (cache) {
+    auto it = cache->find(sig);
+    if (it != cache->end()) {
+      it->second->last_use.store(++use_clock_, std::memory_order_relaxed);
+      return it->second->graph;
+    }
+  }
+  auto state_ptr = GetTemplateState(default_ctx);
+  auto& state = state_ptr.get_state<CachedOpState>();
+  GraphInfo info;
+  info.fwd_graph = state.info.fwd_graph;
+  // the below call runs the NNVM graph passes: type inference,
+  // shape inference, storage type inference and if the graph
+  // doesn't have dynamic shapes it also plans memory
+  // for intermediate and final outputs in the graph
+  SetForwardGraph(&info, false, inputs);
+  auto entry = std::make_shared<GraphCacheEntry>();
+  entry->graph = std::make_shared<const nnvm::Graph>(std::move(info.fwd_graph));
+  entry->last_use.store(++use_clock_, std::memory_order_relaxed);
 
-  for (const auto& i : cached_op_states_[ctx]) {
-    // only create one state per device when not using static memory
-    if (!config_.static_alloc || i.unique()) {
-      return i;
+  // copy on write, readers holding the old cache are unaffected. The entries
+  // are shared with the old cache, so uses recorded through it still count.
+  auto new_cache = cache ? std::make_shared<GraphCache>(*cache) : std::make_shared<GraphCache>();
+  if (new_cache->size() >= config_.graph_cache_size && !new_cache->empty()) {
+    auto lru = new_cache->begin();
+    for (auto it = new_cache->begin(); it != new_cache->end(); ++it) {
+      if (it->second->last_use.load(std::memory_order_relaxed) <
+          lru->second->last_use.load(std::memory_order_relaxed)) {
+        lru = it;
+      }
     }
+    new_cache->erase(lru);
   }
-  nnvm::Graph full_graph;
-  auto state_ptr = OpStatePtr::Create<CachedOpState>(ctx, fwd_graph_, full_graph, false);
+  new_cache->emplace(std::move(sig), entry);
+  std::atomic_store(&graph_cache_, std::shared_ptr<const GraphCache>(std::move(new_cache)));
+  return entry->graph;
+}
 
-  cached_op_states_[ctx].push_back(state_ptr);
-  return state_ptr;
+namespace {
+
+// The flags for the base CachedOp, whose config rejects the ones only the
+// thread safe op knows
+std::vector<std::pair<std::string, std::string> > BaseCachedOpFlags(
+    const std::vector<std::pair<std::string, std::string> >& flags) {
+  std::vector<std::pair<std::string, std::string> > base_flags;
+  for (const auto& flag : flags) {
+    if (flag.first != "graph_cache_size") base_flags.push_back(flag);
+  }
+  return base_flags;
 }
 
+}  // namespace
 
 CachedOpThreadSafe::CachedOpThreadSafe(const nnvm::Symbol& sym,
                                        const std::vector<std::pair<std::string,
-                                       std::string> >& flags) : CachedOp(sym, flags) {
+                                       std::string> >& flags)
+    : CachedOp(sym, BaseCachedOpFlags(flags)) {
   using namespace nnvm;
   using namespace imperative;
   static const std::vector<const Op *> zero_ops{Op::Get("zeros_like"),
@@ -90,26 +161,14 @@ OpStatePtr CachedOpThreadSafe::DynamicForward(const Context& default_ctx,
   using namespace nnvm;
   using namespace imperative;
 
-  auto state_ptr = GetCachedOpState(default_ctx);
   auto op_state = OpStatePtr::Create<DynamicRuntime>();
   auto &runtime = op_state.get_state<DynamicRuntime>();
-  {
-    auto &state = state_ptr.get_state<CachedOpState>();
-    // Need to lock the mutex on the state, this allows
-    // for multi context push of ops to dependency engine.
-    // SetForwardGraph runs infer passes on graphs as well
-    // as the planmemory pass.
-    std::lock_guard<std::mutex> lock(state.mutex);
-    // the below call runs the NNVM graph passes: type inference,
-    // shape inference, storage type inference and if the graph
-    // doesn't have dynamic shapes it also plans and allocates memory
-    // for intermediate and final outputs in the graph
-    SetForwardGraph(&state.info, false, inputs);
-    runtime.info.fwd_graph = state.info.fwd_graph;
-  }
-  nnvm::Graph &g = runtime.info.fwd_graph;
+  // The graph is shared between all threads running with the same input
+  // signature and must not be modified.
+  runtime.fwd_graph = GetForwardGraph(default_ctx, inputs);
+  const nnvm::Graph &g = *runtime.fwd_graph;
   const auto &idx = g.indexed_graph();
-  size_t max_nodes = runtime.info.fwd_graph.indexed_graph().num_nodes();
+  size_t max_nodes = idx.num_nodes();
   runtime.op_states.resize(max_nodes);
   auto &states = runtime.op_states;
 
@@ -149,17 +208,6 @@ OpStatePtr CachedOpThreadSafe::DynamicForward(const Context& default_ctx,
 OpStatePtr CachedOpThreadSafe::Forward(const std::shared_ptr<CachedOp>& op_ptr,
                                        const std::vector<NDArray*>& inputs,
                                        const std::vector<NDArray*>& outputs) {
-  // Acquiring lock on the mutex in forward
-  // Without this there are issues with static_forward,
-  // specifically with static_shape=True and dynamic_forward.
-  // Adding the lock here for safety,
-  // The perf hit would be acceptable because this involves just pushing
-  // ops to engine and not actual execution
-  // We are putting this lock here because without this there is a hang
-  // in the accept4 call in CUDA lib.
-  // TODO(anirudh2290): Investigate this issue more as it also prevents parallel
-  // push of ops for different contexts
-  std::lock_guard<std::mutex> lock(mutex_);
   CHECK_EQ(inputs.size(), num_inputs());
   Context default_ctx = inputs[0]->ctx();
   const auto& idx = fwd_graph_.indexed_graph();
@@ -172,10 +220,26 @@ OpStatePtr CachedOpThreadSafe::Forward(const std::shared_ptr<CachedOp>& op_ptr,
         << " is on " << inputs[i]->ctx();
   }
 
+  // Forward calls on cpu run concurrently: graphs are looked up in a
+  // read-mostly cache and each static_alloc call gets a state with its own
+  // buffers from the pool of CachedOp states (CachedOp::GetCachedOpState).
+  // On gpu we still serialize the calls, without this there is a hang in the
+  // accept4 call in CUDA lib.
+  // TODO(anirudh2290): Investigate this issue more as it also prevents parallel
+  // push of ops for different contexts
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  if (default_ctx.dev_mask() != cpu::kDevMask) lock.lock();
+
+  // The check runs shape inference on a cached state, so make sure that no
+  // other thread runs forward until it is done.
+  std::call_once(dynamic_shape_once_, [&]() {
+    dynamic_shape_ = CheckDynamicShapeExists(default_ctx, inputs, true);
+  });
+
   int prev_bulk_size = Engine::Get()->set_bulk_size(config_.forward_bulk_size);
   OpStatePtr op_state;
   try {
-    if (CheckDynamicShapeExists(default_ctx, inputs, true)) {
+    if (dynamic_shape_) {
       LOG(FATAL) << "Dynamic shapes aren't supported with thread-safe cached op";
     }
     if (config_.static_alloc) {
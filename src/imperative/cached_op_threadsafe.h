@@ -25,6 +25,8 @@
 #include <mxnet/imperative.h>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <string>
 #include <unordered_map>
@@ -45,6 +47,8 @@ struct CachedOpThreadSafeConfig
   mxnet::Tuple<uint32_t> param_indices;
   // decides the bulk size for dynamic forward
   uint32_t forward_bulk_size;
+  // maximum number of input signatures whose forward graph is kept
+  uint32_t graph_cache_size;
   bool static_alloc;
   bool static_shape;
   DMLC_DECLARE_PARAMETER(CachedOpThreadSafeConfig) {
@@ -60,6 +64,10 @@ struct CachedOpThreadSafeConfig
     DMLC_DECLARE_FIELD(forward_bulk_size)
      .set_default(Imperative::BulkExecMaxNodeTrainFwd())
      .describe("Segment size of bulk execution during dynamic forward");
+    DMLC_DECLARE_FIELD(graph_cache_size)
+     .set_default(64)
+     .describe("Maximum number of input shape/type signatures for which the "
+               "inferred and memory planned forward graph is cached.");
     DMLC_DECLARE_FIELD(data_indices)
         .set_default(mxnet::Tuple<uint32_t>())
         .describe("Position of argument variables.");
@@ -112,11 +120,60 @@ class CachedOpThreadSafe : public CachedOp {
     return sym;
   }
 
-  struct GraphInfo;
+
  private:
   struct DynamicRuntime;
 
-  OpStatePtr GetCachedOpState(const Context& ctx);
+  /*! \brief Attributes of the inputs which determine the forward graph */
+  struct GraphSignature {
+    Context ctx;
+    mxnet::ShapeVector shapes;
+    std::vector<int> dtypes;
+    std::vector<int> stypes;
+
+    bool operator==(const GraphSignature& other) const {
+      return ctx == other.ctx && shapes == other.shapes &&
+             dtypes == other.dtypes && stypes == other.stypes;
+    }
+  };
+
+  struct GraphSignatureHash {
+    size_t operator()(const GraphSignature& sig) const {
+      size_t ret = std::hash<Context>()(sig.ctx);
+      for (size_t i = 0; i < sig.shapes.size(); ++i) {
+        ret = dmlc::HashCombine(ret, sig.shapes[i]);
+        ret = dmlc::HashCombine(ret, sig.dtypes[i]);
+        ret = dmlc::HashCombine(ret, sig.stypes[i]);
+      }
+      return ret;
+    }
+  };
+
+  /*! \brief Cached forward graph, shared by all copies of the cache */
+  struct GraphCacheEntry {
+    std::shared_ptr<const nnvm::Graph> graph;
+    // value of use_clock_ when the graph was last used, for LRU eviction
+    std::atomic<uint64_t> last_use{0};
+  };
+
+  using GraphCache = std::unordered_map<GraphSignature,
+                                        std::shared_ptr<GraphCacheEntry>,
+                                        GraphSignatureHash>;
+
+  /*!
+   * \brief Get the state holding the unspecialized forward graph of a device,
+   *  used as the template for GetForwardGraph. Unlike CachedOp::GetCachedOpState
+   *  it never hands out states for concurrent execution.
+   */
+  OpStatePtr GetTemplateState(const Context& ctx);
+  /*!
+   * \brief Get the inferred and memory planned forward graph for the inputs.
+   *  The graphs are kept in a copy-on-write cache, so that threads running
+   *  forward with already seen inputs never take a lock. When the cache is
+   *  full the least recently used graph is evicted.
+   */
+  std::shared_ptr<const nnvm::Graph> GetForwardGraph(const Context& default_ctx,
+                                                     const std::vector<NDArray*>& inputs);
 
   OpStatePtr DynamicForward(const Context& default_ctx,
                             const std::vector<NDArray*>& inputs,
@@ -124,8 +181,18 @@ class CachedOpThreadSafe : public CachedOp {
 
   CachedOpThreadSafeConfig config_;
   nnvm::Graph fwd_graph_;
+  // serializes forward calls on gpu
   std::mutex mutex_;
+  // protects cached_op_states_ and updates of graph_cache_
+  std::mutex graph_cache_mutex_;
+  // makes sure the dynamic shape check runs exactly once
+  std::once_flag dynamic_shape_once_;
+  bool dynamic_shape_ = false;
   std::unordered_map<Context, std::vector<OpStatePtr>> cached_op_states_;
+  // only read and replaced through std::atomic_load and std::atomic_store
+  std::shared_ptr<const GraphCache> graph_cache_;
+  // logical time of graph cache lookups
+  std::atomic<uint64_t> use_clock_{0};
 };
 
 using CachedOpThreadSafePtr = std::shared_ptr<CachedOpThreadSafe>;
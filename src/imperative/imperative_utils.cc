@@ -127,6 +127,64 @@ void InvokeOperator(const nnvm::IndexedGraph& idx,
 namespace mxnet {
 namespace imperative {
 
+namespace {
+
+template<typename T>
+inline void AppendKey(std::string* key, const T& value) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void AppendKey(std::string* key, const NDArray& arr) {
+  const bool none = arr.is_none();
+  AppendKey(key, none);
+  if (none) return;
+  const mxnet::TShape& shape = arr.shape();
+  AppendKey(key, shape.ndim());
+  for (int i = 0; i < shape.ndim(); ++i) AppendKey(key, shape[i]);
+  AppendKey(key, arr.dtype());
+  AppendKey(key, arr.storage_type());
+}
+
+}  // namespace
+
+const InferCache::Entry* InferCache::Find(const nnvm::NodeAttrs& attrs,
+                                          const Context& ctx,
+                                          const std::vector<NDArray*>& inputs,
+                                          const std::vector<NDArray*>& outputs) {
+  static auto& infershape = nnvm::Op::GetAttr<mxnet::FInferShape>("FInferShape");
+  key_.clear();
+  if (capacity_ == 0 || num_bypass_ > 0) return nullptr;
+  // The key is built from the attribute dict, so ops whose parsed parameters do not
+  // come from it (see Bypass), ops holding subgraphs or user code, and ops with data
+  // dependent output shapes always run their inference functions.
+  if (!attrs.subgraphs.empty() || !infershape.count(attrs.op)) return nullptr;
+  if (attrs.dict.empty() && !attrs.parsed.empty()) return nullptr;
+  if (attrs.op->name == "Custom" || attrs.op->name == "_CachedOp") return nullptr;
+  AppendKey(&key_, attrs.op);
+  AppendKey(&key_, ctx.dev_type);
+  AppendKey(&key_, Imperative::Get()->is_np_shape());
+  AppendKey(&key_, Imperative::Get()->is_training());
+  for (const auto& kv : attrs.dict) {
+    key_.append(kv.first);
+    key_.push_back('\0');
+    key_.append(kv.second);
+    key_.push_back('\0');
+  }
+  AppendKey(&key_, inputs.size());
+  for (const NDArray* arr : inputs) AppendKey(&key_, *arr);
+  AppendKey(&key_, outputs.size());
+  for (const NDArray* arr : outputs) AppendKey(&key_, *arr);
+  auto it = entries_.find(key_);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+
+void InferCache::Insert(Entry&& entry) {
+  if (key_.empty()) return;
+  if (entries_.size() >= capacity_) entries_.clear();
+  entries_.emplace(std::move(key_), std::move(entry));
+  key_.clear();
+}
+
 void RunGraph(
     const bool retain_graph,
     const nnvm::IndexedGraph& idx,
@@ -25,6 +25,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include "../executor/graph_executor.h"
 #include "../executor/cuda_graphs.h"
 #include "../executor/exec_pass.h"
@@ -33,6 +34,7 @@
 #include "../common/exec_utils.h"
 #include "../operator/nn/mkldnn/mkldnn_base-inl.h"
 #include "../operator/operator_common.h"
+#include "../profiler/profiler.h"
 
 #ifndef MXNET_IMPERATIVE_IMPERATIVE_UTILS_H_
 #define MXNET_IMPERATIVE_IMPERATIVE_UTILS_H_
@@ -97,12 +99,76 @@ inline Context GetContext(const nnvm::NodeAttrs& attrs,
   return ctx;
 }
 
-// Set the shape, dtype, storage type and dispatch mode via the attribute inference functions
-inline void SetShapeType(const Context& ctx,
-                         const nnvm::NodeAttrs& attrs,
-                         const std::vector<NDArray*>& inputs,
-                         const std::vector<NDArray*>& outputs,
-                         DispatchMode* dispatch_mode) {
+/*!
+ * \brief Per thread cache of the shape, type and storage type inference of imperative
+ *  calls, keyed on the op, its attributes, the device and the shapes, types and storage
+ *  types of the inputs and outputs. Repeated calls skip the inference functions.
+ */
+class InferCache {
+ public:
+  /*! \brief inferred attributes of a call, as left in MXAPIThreadLocalEntry */
+  struct Entry {
+    mxnet::ShapeVector in_shapes, out_shapes;
+    std::vector<int> in_types, out_types;
+    std::vector<int> in_stypes, out_stypes;
+    DispatchMode dispatch_mode;
+  };
+
+  InferCache() : capacity_(dmlc::GetEnv("MXNET_IMPERATIVE_INFER_CACHE_SIZE", 1024)) {}
+
+  static InferCache* Get() {
+    return dmlc::ThreadLocalStore<InferCache>::Get();
+  }
+  /*!
+   * \brief Look up the inference result of a call. On a miss, the result passed to the
+   *  following Insert is stored under the key of this call.
+   * \return the cached entry, or nullptr on a miss or for calls which are not cached
+   */
+  const Entry* Find(const nnvm::NodeAttrs& attrs,
+                    const Context& ctx,
+                    const std::vector<NDArray*>& inputs,
+                    const std::vector<NDArray*>& outputs);
+  /*!
+   * \brief Disables the cache of the calling thread while in scope, for calls whose
+   *  parsed parameters are not reflected in the attribute dict, such as those of the FFI.
+   */
+  class Bypass {
+   public:
+    Bypass() : cache_(InferCache::Get()) { ++cache_->num_bypass_; }
+    ~Bypass() { --cache_->num_bypass_; }
+
+   private:
+    InferCache* cache_;
+  };
+  /*! \brief store the inference result of the last missed Find */
+  void Insert(Entry&& entry);
+  /*! \brief set the maximum number of entries, 0 disables the cache */
+  void set_capacity(size_t capacity) {
+    capacity_ = capacity;
+    entries_.clear();
+  }
+  size_t size() const {
+    return entries_.size();
+  }
+
+ private:
+  size_t capacity_;
+  /*! \brief number of live Bypass objects of this thread */
+  int num_bypass_ = 0;
+  /*! \brief key of the last Find, empty if that call is not cached */
+  std::string key_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+/*!
+ * \brief Infer shapes, types and storage types of a call into MXAPIThreadLocalEntry.
+ * \return whether the output shapes are only known after the op has run
+ */
+inline bool InferShapeType(const Context& ctx,
+                           const nnvm::NodeAttrs& attrs,
+                           const std::vector<NDArray*>& inputs,
+                           const std::vector<NDArray*>& outputs,
+                           DispatchMode* dispatch_mode) {
   static auto& infershape = nnvm::Op::GetAttr<mxnet::FInferShape>("FInferShape");
   static auto& infertype = nnvm::Op::GetAttr<nnvm::FInferType>("FInferType");
   static auto& inferstorage = nnvm::Op::GetAttr<FInferStorageType>("FInferStorageType");
@@ -200,6 +266,38 @@ inline void SetShapeType(const Context& ctx,
 
   CHECK_EQ(out_storage_types.size(), outputs.size());
   CHECK(*dispatch_mode != DispatchMode::kUndefined);
+  return is_dynamic_shape_existing;
+}
+
+// Set the shape, dtype, storage type and dispatch mode via the attribute inference functions
+inline void SetShapeType(const Context& ctx,
+                         const nnvm::NodeAttrs& attrs,
+                         const std::vector<NDArray*>& inputs,
+                         const std::vector<NDArray*>& outputs,
+                         DispatchMode* dispatch_mode) {
+  MXAPIThreadLocalEntry<> *ret = MXAPIThreadLocalStore<>::Get();
+  InferCache* cache = InferCache::Get();
+  bool is_dynamic_shape_existing = false;
+  if (const InferCache::Entry* cached = cache->Find(attrs, ctx, inputs, outputs)) {
+    ret->arg_shapes = cached->in_shapes;
+    ret->out_shapes = cached->out_shapes;
+    ret->arg_types = cached->in_types;
+    ret->out_types = cached->out_types;
+    ret->arg_storage_types = cached->in_stypes;
+    ret->out_storage_types = cached->out_stypes;
+    *dispatch_mode = cached->dispatch_mode;
+    if (*dispatch_mode == DispatchMode::kFComputeFallback) {
+      common::LogStorageFallback(attrs, ctx.dev_mask(), &ret->arg_storage_types,
+                                 &ret->out_storage_types);
+    }
+  } else {
+    is_dynamic_shape_existing = InferShapeType(ctx, attrs, inputs, outputs, dispatch_mode);
+    cache->Insert({ret->arg_shapes, ret->out_shapes, ret->arg_types, ret->out_types,
+                   ret->arg_storage_types, ret->out_storage_types, *dispatch_mode});
+  }
+  const mxnet::ShapeVector& out_shapes = ret->out_shapes;
+  const std::vector<int>& out_types = ret->out_types;
+  const std::vector<int>& out_storage_types = ret->out_storage_types;
 
   for (size_t i = 0; i < outputs.size(); ++i) {
     NDArrayStorageType storage_type = static_cast<NDArrayStorageType>(out_storage_types[i]);
@@ -393,6 +491,28 @@ inline void DerefInputOutput(const std::vector<NDArray*>& inputs,
   for (NDArray* i : outputs) p_outputs->emplace_back(*i);
 }
 
+/*!
+ * \brief Record the shapes of the operator being executed for the per shape aggregate
+ *  profiler statistics, if they are collected
+ */
+inline void RecordProfileShapes(const std::vector<NDArray>& inputs,
+                                const std::vector<NDArray>& outputs) {
+  profiler::ProfileOperator::Attributes *attributes =
+    profiler::ProfileOperator::current_attributes();
+  if (attributes == nullptr) return;
+  // only hash the shapes per call, the signature is formatted once per distinct shapes
+  size_t hash = std::hash<size_t>()(inputs.size());
+  for (const NDArray& i : inputs) hash = dmlc::HashCombine(hash, i.shape());
+  for (const NDArray& o : outputs) hash = dmlc::HashCombine(hash, o.shape());
+  attributes->shape_hash_ = std::max<uint64_t>(hash, 1);
+  profiler::ShapeSignatures::Add(attributes->shape_hash_, [&]() {
+    profiler::ProfileOperator::Attributes shapes;
+    for (const NDArray& i : inputs) shapes.inputs_.emplace_back(i.shape());
+    for (const NDArray& o : outputs) shapes.outputs_.emplace_back(o.shape());
+    return shapes.to_string();
+  });
+}
+
 inline void PushFCompute(const FCompute& fn,
                   const nnvm::Op* op,
                   const nnvm::NodeAttrs& attrs,
@@ -415,6 +535,7 @@ inline void PushFCompute(const FCompute& fn,
   DerefInputOutput(p_inputs, p_outputs, &inputs, &outputs);
   Engine::Get()->PushSync(
     [=](RunContext rctx) {
+      RecordProfileShapes(inputs, outputs);
       std::vector<TBlob> input_blobs, output_blobs;
       // pre-fcompute and post-fcompute storage fallback src NDArrays and dst NDArrays
       std::vector<NDArray> pre_temp_src, pre_temp_dst, post_temp_dst, post_temp_src;
@@ -468,6 +589,7 @@ inline void PushFComputeEx(const FComputeEx& fn,
   std::vector<NDArray> inputs, outputs;
   DerefInputOutput(p_inputs, p_outputs, &inputs, &outputs);
   const auto& run = [=](RunContext rctx) {
+      RecordProfileShapes(inputs, outputs);
       OpContext opctx{need_grad, is_train, rctx, engine::CallbackOnComplete(), requested};
 #if MXNET_USE_MKLDNN == 1
       if (exec_type != ExecType::kCrossDeviceCopy) {
@@ -532,6 +654,7 @@ inline void PushOperator(const OpStatePtr& state,
   if (fcompute_ex != nullptr && dispatch_mode == DispatchMode::kFComputeEx) {
     const auto& run = [=](RunContext rctx,
                           engine::CallbackOnComplete on_complete) {
+      RecordProfileShapes(inputs, outputs);
       OpContext opctx{need_grad, is_train, rctx, on_complete, requested};
 #if MXNET_USE_MKLDNN == 1
       if (exec_type != ExecType::kCrossDeviceCopy) {
@@ -582,6 +705,7 @@ inline void PushOperator(const OpStatePtr& state,
         << "for stateful operator " << op->name;
 
     const auto& run = [=](RunContext rctx, engine::CallbackOnComplete on_complete) {
+        RecordProfileShapes(inputs, outputs);
         OpContext opctx{need_grad, is_train, rctx, on_complete, requested};
 
         std::vector<TBlob> input_blobs, output_blobs;
@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file block_cache.cc
+ * \brief binary cache of parsed rows
+ */
+#include "./block_cache.h"
+#include <cstdio>
+#include <cstring>
+
+namespace mxnet {
+namespace io {
+
+namespace {
+
+// File layout, all integers are uint64:
+//   magic, version, signature length, signature padded to 8 bytes,
+//   the arrays of every block, each starting at a multiple of kAlignment,
+//   the block directory, number of blocks, offset of the directory, magic.
+const uint64_t kBlockCacheMagic = 0x31454843414349ULL;  // "ICACHE1"
+const uint64_t kBlockCacheVersion = 1;
+const uint64_t kAlignment = 64;
+
+uint64_t RoundUp(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+std::string BlockCachePath(const std::string& uri) {
+  std::string path;
+  CHECK(common::LocalFilePath(uri, &path))
+      << "The cache of a data iterator must be a local file, got " << uri;
+  return path;
+}
+
+BlockCacheWriter::BlockCacheWriter(const std::string& path, const std::string& signature)
+    : path_(BlockCachePath(path)), tmp_path_(path_ + ".tmp") {
+  stream_.reset(dmlc::Stream::Create(tmp_path_.c_str(), "w"));
+  const uint64_t header[] = {kBlockCacheMagic, kBlockCacheVersion, signature.size()};
+  Write(header, sizeof(header));
+  Write(signature.data(), signature.size());
+  const char padding[8] = {0};
+  Write(padding, RoundUp(offset_, 8) - offset_);
+}
+
+BlockCacheWriter::~BlockCacheWriter() {
+  if (!finished_) {
+    stream_.reset();
+    std::remove(tmp_path_.c_str());
+  }
+}
+
+void BlockCacheWriter::Write(const void* data, size_t size) {
+  stream_->Write(data, size);
+  offset_ += size;
+}
+
+void BlockCacheWriter::WriteBlock(size_t num_rows,
+                                  const std::vector<std::pair<const void*, size_t> >& arrays) {
+  CHECK(!finished_);
+  directory_.push_back(num_rows);
+  directory_.push_back(arrays.size());
+  static const char padding[kAlignment] = {0};
+  for (const auto& array : arrays) {
+    Write(padding, RoundUp(offset_, kAlignment) - offset_);
+    directory_.push_back(offset_);
+    directory_.push_back(array.second);
+    Write(array.first, array.second);
+  }
+  ++num_blocks_;
+}
+
+void BlockCacheWriter::Finish() {
+  const uint64_t directory_offset = offset_;
+  Write(directory_.data(), directory_.size() * sizeof(uint64_t));
+  const uint64_t trailer[] = {num_blocks_, directory_offset, kBlockCacheMagic};
+  Write(trailer, sizeof(trailer));
+  stream_.reset();
+  std::remove(path_.c_str());
+  CHECK_EQ(std::rename(tmp_path_.c_str(), path_.c_str()), 0)
+      << "Failed to move the cache " << tmp_path_ << " to " << path_;
+  finished_ = true;
+}
+
+std::shared_ptr<BlockCache> BlockCache::Open(const std::string& path,
+                                             const std::string& signature) {
+  std::shared_ptr<BlockCache> cache(new BlockCache());
+  cache->file_ = common::MappedFile::Open(BlockCachePath(path));
+  if (!cache->file_) return nullptr;
+  cache->base_ = cache->file_->data();
+  const size_t size = cache->file_->size();
+  const char* base = cache->base_;
+  auto load = [&](uint64_t offset) {
+    uint64_t value;
+    std::memcpy(&value, base + offset, sizeof(value));
+    return value;
+  };
+  // a cache written by another version or for another input is rebuilt
+  if (size < 6 * sizeof(uint64_t) || load(0) != kBlockCacheMagic ||
+      load(8) != kBlockCacheVersion || load(16) != signature.size() ||
+      24 + signature.size() > size ||
+      std::memcmp(base + 24, signature.data(), signature.size()) != 0 ||
+      load(size - 8) != kBlockCacheMagic) {
+    return nullptr;
+  }
+  const uint64_t num_blocks = load(size - 24);
+  uint64_t offset = load(size - 16);
+  cache->blocks_.resize(num_blocks);
+  for (Block& block : cache->blocks_) {
+    CHECK_LE(offset + 16, size - 24) << "Invalid cache file " << path;
+    block.num_rows = load(offset);
+    block.arrays.resize(load(offset + 8));
+    offset += 16;
+    for (auto& array : block.arrays) {
+      CHECK_LE(offset + 16, size - 24) << "Invalid cache file " << path;
+      array.first = load(offset);
+      array.second = load(offset + 8);
+      CHECK_LE(array.first + array.second, size) << "Invalid cache file " << path;
+      offset += 16;
+    }
+  }
+  return cache;
+}
+
+}  // namespace io
+}  // namespace mxnet
@@ -0,0 +1,129 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file block_cache.h
+ * \brief binary cache of parsed rows, written in blocks during the first pass over a
+ *  text input and memory mapped on the following passes
+ */
+#ifndef MXNET_IO_BLOCK_CACHE_H_
+#define MXNET_IO_BLOCK_CACHE_H_
+
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../common/mapped_file.h"
+
+namespace mxnet {
+namespace io {
+
+/*!
+ * \brief the local path of a cache file with file:// stripped. Caches are memory mapped
+ *  and renamed into place, so other schemes are rejected.
+ */
+std::string BlockCachePath(const std::string& uri);
+
+/*!
+ * \brief Writes the blocks of a cache file. Each block holds a number of rows as a fixed
+ *  number of arrays. The blocks go to a temporary file which only replaces the cache on
+ *  Finish, so an interrupted pass never leaves a partial cache behind.
+ */
+class BlockCacheWriter {
+ public:
+  /*!
+   * \param path the cache file, a local path or file:// URI
+   * \param signature description of the input and its parsing, checked when reading
+   */
+  BlockCacheWriter(const std::string& path, const std::string& signature);
+  /*! \brief removes the temporary file unless Finish was called */
+  ~BlockCacheWriter();
+  /*! \brief append a block of num_rows rows, given as (data, bytes) for each array */
+  void WriteBlock(size_t num_rows, const std::vector<std::pair<const void*, size_t> >& arrays);
+  /*! \brief write the block directory and move the cache into place */
+  void Finish();
+
+ private:
+  void Write(const void* data, size_t size);
+
+  std::string path_, tmp_path_;
+  std::unique_ptr<dmlc::Stream> stream_;
+  uint64_t offset_{0};
+  /*! \brief per block the number of rows and arrays, then offset and size of each array */
+  std::vector<uint64_t> directory_;
+  uint64_t num_blocks_{0};
+  bool finished_{false};
+};
+
+/*! \brief read only, memory mapped view of a finished cache file */
+class BlockCache {
+ public:
+  /*!
+   * \return the cache at path, or nullptr if there is none or it was written with a
+   *  different signature
+   */
+  static std::shared_ptr<BlockCache> Open(const std::string& path,
+                                          const std::string& signature);
+
+  size_t num_blocks() const {
+    return blocks_.size();
+  }
+  size_t num_rows(size_t block) const {
+    return blocks_[block].num_rows;
+  }
+  /*! \brief the i-th array of a block */
+  template<typename T>
+  const T* array(size_t block, size_t i) const {
+    return reinterpret_cast<const T*>(base_ + blocks_[block].arrays[i].first);
+  }
+  /*! \brief size in bytes of the i-th array of a block */
+  size_t array_size(size_t block, size_t i) const {
+    return blocks_[block].arrays[i].second;
+  }
+
+ private:
+  BlockCache() = default;
+
+  struct Block {
+    size_t num_rows;
+    /*! \brief offset and size of each array */
+    std::vector<std::pair<uint64_t, uint64_t> > arrays;
+  };
+  std::shared_ptr<common::MappedFile> file_;
+  const char* base_{nullptr};
+  std::vector<Block> blocks_;
+};
+
+/*! \brief the order in which to read the blocks of a cache, shuffled if rng is given */
+inline std::vector<size_t> BlockOrder(const BlockCache& cache, std::mt19937* rng) {
+  std::vector<size_t> order(cache.num_blocks());
+  std::iota(order.begin(), order.end(), 0);
+  if (rng != nullptr) std::shuffle(order.begin(), order.end(), *rng);
+  return order;
+}
+
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_BLOCK_CACHE_H_
@@ -135,6 +135,10 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
   int shuffle_chunk_seed;
   /*! \brief random seed for augmentations */
   dmlc::optional<int> seed_aug;
+  /*! \brief number of batches in flight in the pipelined decoder, 0 to disable it */
+  int decode_pipeline_depth;
+  /*! \brief whether to pin the decoding threads to NUMA nodes */
+  bool bind_numa_nodes;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(ImageRecParserParam) {
@@ -176,6 +180,13 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
         .describe("The random seed for shuffling");
     DMLC_DECLARE_FIELD(seed_aug).set_default(dmlc::optional<int>())
         .describe("Random seed for augmentations.");
+    DMLC_DECLARE_FIELD(decode_pipeline_depth).set_lower_bound(0).set_default(0)
+        .describe("The number of batches in flight when records are read, decoded and "\
+                  "batched as a streaming pipeline instead of one chunk at a time. "\
+                  "0 disables the pipeline. Ignored for shuffling without an index file.");
+    DMLC_DECLARE_FIELD(bind_numa_nodes).set_default(false)
+        .describe("Pin the decoding threads of the pipeline round robin to the CPUs of "\
+                  "each NUMA node. Only used when decode_pipeline_depth > 0.");
   }
 };
 
@@ -27,6 +27,17 @@
 #include <dmlc/logging.h>
 #include <dmlc/parameter.h>
 #include <dmlc/data.h>
+#include <dmlc/io.h>
+#include <dmlc/omp.h>
+#include <dmlc/common.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <type_traits>
+#include "./block_cache.h"
 #include "./iter_prefetcher.h"
 #include "./iter_batchloader.h"
 
@@ -42,6 +53,14 @@ struct CSVIterParam : public dmlc::Parameter<CSVIterParam> {
   std::string label_csv;
   /*! \brief label shape */
   mxnet::TShape label_shape;
+  /*! \brief number of threads parsing chunks straight into batches, 0 for the row parser */
+  int parse_threads;
+  /*! \brief path to the binary cache of the parsed input */
+  std::string cache_file;
+  /*! \brief whether to shuffle the blocks of the cache */
+  bool shuffle;
+  /*! \brief random seed of the block shuffling */
+  int seed;
   // declare parameters
   DMLC_DECLARE_PARAMETER(CSVIterParam) {
     DMLC_DECLARE_FIELD(data_csv)
@@ -54,6 +73,19 @@ struct CSVIterParam : public dmlc::Parameter<CSVIterParam> {
     index_t shape1[] = {1};
     DMLC_DECLARE_FIELD(label_shape).set_default(mxnet::TShape(shape1, shape1 + 1))
         .describe("The shape of one label.");
+    DMLC_DECLARE_FIELD(parse_threads).set_default(0).set_lower_bound(0)
+        .describe("If positive, the input is read in chunks which are parsed by this "
+                  "many threads straight into the batch buffers. If 0, rows are parsed "
+                  "one at a time and copied into the batch.");
+    DMLC_DECLARE_FIELD(cache_file).set_default("NULL")
+        .describe("If set, the parsed rows are written to this local file during the first "
+                  "complete pass, and later passes read them from it without parsing. "
+                  "An existing cache written for the same input, shapes and dtype is reused.");
+    DMLC_DECLARE_FIELD(shuffle).set_default(false)
+        .describe("Whether to shuffle the order of the cached blocks in every pass. "
+                  "Only applies when reading from ``cache_file``.");
+    DMLC_DECLARE_FIELD(seed).set_default(0)
+        .describe("The random seed of the block shuffling.");
   }
 };
 
@@ -161,6 +193,25 @@ class CSVIterTyped: public CSVIterBase {
   std::unique_ptr<dmlc::Parser<uint32_t, DType> > data_parser_;
 };
 
+/*! \brief the element type requested by the dtype argument, float32 by default */
+inline int CSVDType(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+  int target_dtype = mshadow::kFloat32;
+  for (const auto& arg : kwargs) {
+    if (arg.first == "dtype") {
+      if (arg.second == "int32") {
+        target_dtype = mshadow::kInt32;
+      } else if (arg.second == "int64") {
+        target_dtype = mshadow::kInt64;
+      } else if (arg.second == "float32") {
+        target_dtype = mshadow::kFloat32;
+      } else {
+        CHECK(false) << arg.second << " is not supported for CSVIter";
+      }
+    }
+  }
+  return target_dtype;
+}
+
 class CSVIter: public IIterator<DataInst> {
  public:
   CSVIter() {}
@@ -169,28 +220,16 @@ class CSVIter: public IIterator<DataInst> {
   // intialize iterator loads data in
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
     param_.InitAllowUnknown(kwargs);
-    bool dtype_has_value = false;
-    int target_dtype = -1;
-    for (const auto& arg : kwargs) {
-      if (arg.first == "dtype") {
-        dtype_has_value = true;
-        if (arg.second == "int32") {
-          target_dtype = mshadow::kInt32;
-        } else if (arg.second == "int64") {
-          target_dtype = mshadow::kInt64;
-        } else if (arg.second == "float32") {
-          target_dtype = mshadow::kFloat32;
-        } else {
-          CHECK(false) << arg.second << " is not supported for CSVIter";
-        }
-      }
-    }
-    if (dtype_has_value && target_dtype == mshadow::kInt32) {
-      iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<int32_t>()));
-    } else if (dtype_has_value && target_dtype == mshadow::kInt64) {
-      iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<int64_t>()));
-    } else if (!dtype_has_value || target_dtype == mshadow::kFloat32) {
-      iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<float>()));
+    switch (CSVDType(kwargs)) {
+      case mshadow::kInt32:
+        iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<int32_t>()));
+        break;
+      case mshadow::kInt64:
+        iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<int64_t>()));
+        break;
+      default:
+        iterator_.reset(reinterpret_cast<CSVIterBase*>(new CSVIterTyped<float>()));
+        break;
     }
     iterator_->Init(kwargs);
   }
@@ -212,6 +251,575 @@ class CSVIter: public IIterator<DataInst> {
   std::unique_ptr<CSVIterBase> iterator_;
 };
 
+/*! \brief parse a decimal number, falling back to strtod for what the fast path rejects */
+inline double ParseCSVDouble(const char* begin, const char* end) {
+  static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  while (begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+  while (end != begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+  if (begin == end) return 0;
+  const char* p = begin;
+  const bool negative = *p == '-';
+  if (*p == '-' || *p == '+') ++p;
+  uint64_t mantissa = 0;
+  int num_digits = 0, exp10 = 0;
+  bool seen_digit = false;
+  for (; p != end && static_cast<unsigned>(*p - '0') < 10; ++p) {
+    seen_digit = true;
+    if (num_digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      num_digits += mantissa != 0;
+    } else {
+      ++exp10;
+    }
+  }
+  if (p != end && *p == '.') {
+    for (++p; p != end && static_cast<unsigned>(*p - '0') < 10; ++p) {
+      seen_digit = true;
+      if (num_digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        num_digits += mantissa != 0;
+        --exp10;
+      }
+    }
+  }
+  if (seen_digit && p != end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    const bool exp_negative = q != end && *q == '-';
+    if (q != end && (*q == '-' || *q == '+')) ++q;
+    int exponent = 0;
+    const char* digits = q;
+    for (; q != end && static_cast<unsigned>(*q - '0') < 10; ++q) {
+      exponent = std::min(exponent * 10 + (*q - '0'), 100000);
+    }
+    if (q != digits) {
+      exp10 += exp_negative ? -exponent : exponent;
+      p = q;
+    }
+  }
+  // mantissas below 2^53 times exact powers of ten round correctly
+  if (seen_digit && p == end && mantissa < (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+    const double value = exp10 < 0 ? mantissa / kPow10[-exp10] : mantissa * kPow10[exp10];
+    return negative ? -value : value;
+  }
+  char field[64];
+  const size_t length = std::min(static_cast<size_t>(end - begin), sizeof(field) - 1);
+  std::memcpy(field, begin, length);
+  field[length] = '\0';
+  return std::strtod(field, nullptr);
+}
+
+/*! \brief parse an integer exactly, or a decimal number truncated towards zero */
+inline int64_t ParseCSVInt(const char* begin, const char* end) {
+  const char* p = begin;
+  while (p != end && (*p == ' ' || *p == '\t')) ++p;
+  const bool negative = p != end && *p == '-';
+  if (p != end && (*p == '-' || *p == '+')) ++p;
+  const char* digits = p;
+  uint64_t value = 0;
+  for (; p != end && static_cast<unsigned>(*p - '0') < 10; ++p) value = value * 10 + (*p - '0');
+  const size_t num_digits = p - digits;
+  while (p != end && (*p == ' ' || *p == '\t')) ++p;
+  if (p != end || num_digits == 0) return static_cast<int64_t>(ParseCSVDouble(begin, end));
+  if (num_digits <= 18) return static_cast<int64_t>(negative ? 0 - value : value);
+  char field[64];
+  const size_t length = std::min(static_cast<size_t>(end - begin), sizeof(field) - 1);
+  std::memcpy(field, begin, length);
+  field[length] = '\0';
+  return std::strtoll(field, nullptr, 10);
+}
+
+template<typename DType>
+inline DType ParseCSVValue(const char* begin, const char* end) {
+  if (std::is_integral<DType>::value) return static_cast<DType>(ParseCSVInt(begin, end));
+  return static_cast<DType>(ParseCSVDouble(begin, end));
+}
+
+/*! \brief a stream of rows of the same size handed out in contiguous runs */
+template<typename DType>
+class CSVRowReader {
+ public:
+  virtual ~CSVRowReader() {}
+  /*! \brief restart from the first row */
+  virtual void BeforeFirst() = 0;
+  /*!
+   * \return the number of rows available at rows(), at least num_rows unless the input
+   *  ends before
+   */
+  virtual size_t Fill(size_t num_rows) = 0;
+  /*! \brief the first available row, valid until the next Fill */
+  virtual DType* rows() = 0;
+  /*! \brief drop the first num_rows available rows */
+  virtual void Consume(size_t num_rows) = 0;
+};
+
+/*!
+ * \brief Reads a CSV input in chunks of whole lines and parses each chunk with several
+ *  threads into one row major buffer, so that any batch_size consecutive rows can be
+ *  handed out as a batch without copying them.
+ */
+template<typename DType>
+class CSVChunkReader : public CSVRowReader<DType> {
+ public:
+  CSVChunkReader(const std::string& uri, const mxnet::TShape& shape, int nthread)
+      : shape_(shape), row_size_(shape.Size()), nthread_(nthread) {
+    split_.reset(dmlc::InputSplit::Create(uri.c_str(), 0, 1, "text"));
+    split_->HintChunkSize(static_cast<size_t>(nthread_) << 22);
+  }
+  void BeforeFirst() override {
+    split_->BeforeFirst();
+    head_ = tail_ = 0;
+  }
+  size_t Fill(size_t num_rows) override {
+    while (tail_ - head_ < num_rows && ParseChunk()) {}
+    return tail_ - head_;
+  }
+  DType* rows() override {
+    return buffer_.data() + head_ * row_size_;
+  }
+  void Consume(size_t num_rows) override {
+    CHECK_LE(head_ + num_rows, tail_);
+    head_ += num_rows;
+  }
+
+ private:
+  /*! \brief the next line of [*begin, end) and whether it holds any value */
+  static bool NextLine(const char** begin, const char* end,
+                       const char** line_begin, const char** line_end) {
+    const char* p = *begin;
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (eol == nullptr) eol = end;
+    *begin = eol == end ? end : eol + 1;
+    while (eol != p && (eol[-1] == '\r' || eol[-1] == ' ' || eol[-1] == '\t')) --eol;
+    *line_begin = p;
+    *line_end = eol;
+    return p != eol;
+  }
+
+  void ParseLine(const char* begin, const char* end, DType* out) const {
+    size_t length = 0;
+    for (const char* p = begin; ; ) {
+      const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+      const char* field_end = comma == nullptr ? end : comma;
+      if (length < row_size_) out[length] = ParseCSVValue<DType>(p, field_end);
+      ++length;
+      if (comma == nullptr || comma + 1 == end) break;
+      p = comma + 1;
+    }
+    CHECK_EQ(length, row_size_)
+        << "The data size in CSV do not match size of shape: "
+        << "specified shape=" << shape_ << ", the csv row-length=" << length;
+  }
+
+  /*! \brief append the rows of the next chunk to the buffer, false at the end of input */
+  bool ParseChunk() {
+    dmlc::InputSplit::Blob chunk;
+    if (!split_->NextChunk(&chunk)) return false;
+    if (head_ != 0) {
+      std::copy(buffer_.begin() + head_ * row_size_, buffer_.begin() + tail_ * row_size_,
+                buffer_.begin());
+      tail_ -= head_;
+      head_ = 0;
+    }
+    const char* begin = static_cast<const char*>(chunk.dptr);
+    const char* end = begin + chunk.size;
+    // split the chunk into one range of whole lines per thread
+    std::vector<const char*> bounds(nthread_ + 1, end);
+    bounds[0] = begin;
+    for (int i = 1; i < nthread_; ++i) {
+      const char* p = std::max(bounds[i - 1], begin + chunk.size * i / nthread_);
+      const char* eol = p == begin ? p :
+          static_cast<const char*>(std::memchr(p - 1, '\n', end - p + 1));
+      bounds[i] = eol == nullptr ? end : (p == begin ? begin : eol + 1);
+    }
+    std::vector<size_t> offsets(nthread_ + 1, 0);
+    #pragma omp parallel for num_threads(nthread_)
+    for (int i = 0; i < nthread_; ++i) {
+      size_t count = 0;
+      const char *line_begin, *line_end;
+      for (const char* p = bounds[i]; p != bounds[i + 1]; ) {
+        count += NextLine(&p, bounds[i + 1], &line_begin, &line_end);
+      }
+      offsets[i + 1] = count;
+    }
+    for (int i = 0; i < nthread_; ++i) offsets[i + 1] += offsets[i];
+    if (buffer_.size() < (tail_ + offsets[nthread_]) * row_size_) {
+      buffer_.resize((tail_ + offsets[nthread_]) * row_size_);
+    }
+    #pragma omp parallel for num_threads(nthread_)
+    for (int i = 0; i < nthread_; ++i) {
+      omp_exc_.Run([&] {
+        DType* out = buffer_.data() + (tail_ + offsets[i]) * row_size_;
+        const char *line_begin, *line_end;
+        for (const char* p = bounds[i]; p != bounds[i + 1]; ) {
+          if (NextLine(&p, bounds[i + 1], &line_begin, &line_end)) {
+            ParseLine(line_begin, line_end, out);
+            out += row_size_;
+          }
+        }
+      });
+    }
+    omp_exc_.Rethrow();
+    tail_ += offsets[nthread_];
+    return true;
+  }
+
+  std::unique_ptr<dmlc::InputSplit> split_;
+  mxnet::TShape shape_;
+  size_t row_size_;
+  int nthread_;
+  /*! \brief parsed rows, of which [head_, tail_) are not handed out yet */
+  std::vector<DType> buffer_;
+  size_t head_{0}, tail_{0};
+  dmlc::OMPException omp_exc_;
+};
+
+/*!
+ * \brief Reads the rows of one array of the blocks of a BlockCache. Runs of rows within a
+ *  block point into the mapped file; only runs across blocks are copied.
+ */
+template<typename DType>
+class CSVCachedRows : public CSVRowReader<DType> {
+ public:
+  CSVCachedRows(std::shared_ptr<BlockCache> cache, size_t array, size_t row_size,
+                const std::vector<size_t>* order)
+      : cache_(cache), array_(array), row_size_(row_size), order_(order) {}
+
+  void BeforeFirst() override {
+    block_ = row_ = 0;
+    staged_head_ = staged_tail_ = 0;
+  }
+  size_t Fill(size_t num_rows) override {
+    if (staged_head_ == staged_tail_) {
+      const size_t left = BlockLeft();
+      if (left >= num_rows || block_ + 1 >= order_->size()) return left;
+      staged_head_ = staged_tail_ = 0;
+    }
+    while (staged_tail_ - staged_head_ < num_rows && block_ < order_->size()) {
+      const size_t take = std::min(num_rows - (staged_tail_ - staged_head_), BlockLeft());
+      if (staged_.size() < (staged_tail_ + take) * row_size_) {
+        staged_.resize((staged_tail_ + take) * row_size_);
+      }
+      std::copy(BlockRows(), BlockRows() + take * row_size_,
+                staged_.begin() + staged_tail_ * row_size_);
+      staged_tail_ += take;
+      Advance(take);
+    }
+    return staged_tail_ - staged_head_;
+  }
+  DType* rows() override {
+    return staged_head_ != staged_tail_ ? staged_.data() + staged_head_ * row_size_ :
+                                          const_cast<DType*>(BlockRows());
+  }
+  void Consume(size_t num_rows) override {
+    if (staged_head_ != staged_tail_) {
+      CHECK_LE(staged_head_ + num_rows, staged_tail_);
+      staged_head_ += num_rows;
+    } else {
+      CHECK_LE(num_rows, BlockLeft());
+      Advance(num_rows);
+    }
+  }
+
+ private:
+  size_t BlockLeft() const {
+    return block_ < order_->size() ? cache_->num_rows((*order_)[block_]) - row_ : 0;
+  }
+  const DType* BlockRows() const {
+    return cache_->array<DType>((*order_)[block_], array_) + row_ * row_size_;
+  }
+  void Advance(size_t num_rows) {
+    row_ += num_rows;
+    if (row_ == cache_->num_rows((*order_)[block_])) {
+      ++block_;
+      row_ = 0;
+    }
+  }
+
+  std::shared_ptr<BlockCache> cache_;
+  size_t array_, row_size_;
+  const std::vector<size_t>* order_;
+  /*! \brief position in order_ and row within that block */
+  size_t block_{0}, row_{0};
+  /*! \brief rows copied from several blocks, of which [staged_head_, staged_tail_) are left */
+  std::vector<DType> staged_;
+  size_t staged_head_{0}, staged_tail_{0};
+};
+
+/*!
+ * \brief CSV batch iterator on CSVChunkReader, or on the cache written during its first
+ *  pass. Full batches point into the parsed buffers or the cache; only the last, padded
+ *  batch of an epoch is copied.
+ */
+template<typename DType>
+class CSVChunkIter : public IIterator<TBlobBatch> {
+ public:
+  virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+    param_.InitAllowUnknown(kwargs);
+    batch_param_.InitAllowUnknown(kwargs);
+    const size_t batch_size = batch_param_.batch_size;
+    rng_.seed(param_.seed);
+    if (param_.cache_file != "NULL") {
+      // fail before parsing anything if the cache cannot be written
+      param_.cache_file = BlockCachePath(param_.cache_file);
+      cache_ = BlockCache::Open(param_.cache_file, CacheSignature());
+    }
+    if (cache_) {
+      LOG(INFO) << "CSVIter: reading " << param_.data_csv << " from the cache "
+                << param_.cache_file;
+      UseCache();
+    } else {
+      const int nthread = std::max(param_.parse_threads, 1);
+      data_.reset(new CSVChunkReader<DType>(param_.data_csv, param_.data_shape, nthread));
+      if (param_.label_csv != "NULL") {
+        label_.reset(new CSVChunkReader<DType>(param_.label_csv, param_.label_shape, nthread));
+      }
+      if (param_.cache_file != "NULL") StartCache();
+    }
+    // without label_csv every label is a single 0, as in CSVIterTyped
+    const mxnet::TShape label_shape = label_ ? param_.label_shape : mxnet::TShape(1, 1);
+    data_shape_ = BatchShape(param_.data_shape);
+    label_shape_ = BatchShape(label_shape);
+    pad_data_.resize(data_shape_.Size());
+    pad_label_.resize(label_shape_.Size());
+    inst_index_.resize(batch_size);
+    out_.inst_index = inst_index_.data();
+    out_.batch_size = batch_size;
+    out_.data.resize(2);
+  }
+
+  virtual void BeforeFirst() {
+    if (!batch_param_.round_batch || num_overflow_ == 0) {
+      Restart();
+    } else {
+      num_overflow_ = 0;
+    }
+  }
+
+  virtual bool Next() {
+    out_.num_batch_padd = 0;
+    // the padded batch ended the epoch, until BeforeFirst is called
+    if (num_overflow_ != 0) return false;
+    const size_t batch_size = batch_param_.batch_size;
+    const size_t num_rows = std::min(data_->Fill(batch_size), batch_size);
+    CheckLabels(num_rows);
+    for (size_t i = 0; i < num_rows; ++i) inst_index_[i] = inst_counter_++;
+    if (num_rows == batch_size) {
+      SetOutput(data_->rows(), label_ ? label_->rows() : ZeroLabels());
+      Consume(num_rows);
+      return true;
+    }
+    // the input ends within this batch
+    if (num_rows != 0) CopyRows(0, num_rows);
+    if (writer_) FinishCache();
+    if (num_rows == 0) return false;
+    if (batch_param_.round_batch) {
+      Restart();
+      const size_t num_pad = batch_size - num_rows;
+      CHECK_GE(data_->Fill(num_pad), num_pad) << "number of input must be bigger than batch size";
+      CheckLabels(num_pad);
+      for (size_t i = num_rows; i < batch_size; ++i) inst_index_[i] = inst_counter_++;
+      CopyRows(num_rows, num_pad);
+      num_overflow_ = num_pad;
+      out_.num_batch_padd = num_pad;
+    } else {
+      out_.num_batch_padd = batch_size - num_rows;
+    }
+    SetOutput(pad_data_.data(), pad_label_.data());
+    return true;
+  }
+
+  virtual const TBlobBatch &Value() const {
+    return out_;
+  }
+
+ private:
+  mxnet::TShape BatchShape(const mxnet::TShape& shape) const {
+    mxnet::TShape batch_shape(shape.ndim() + 1, -1);
+    batch_shape[0] = batch_param_.batch_size;
+    for (int i = 0; i < shape.ndim(); ++i) batch_shape[i + 1] = shape[i];
+    return batch_shape;
+  }
+
+  void Restart() {
+    if (cache_ && !reading_cache_) {
+      UseCache();
+    } else if (cache_) {
+      order_ = BlockOrder(*cache_, param_.shuffle ? &rng_ : nullptr);
+    } else if (param_.cache_file != "NULL") {
+      // a pass which did not reach the end leaves no cache
+      StartCache();
+    }
+    data_->BeforeFirst();
+    if (label_) label_->BeforeFirst();
+    inst_counter_ = 0;
+  }
+
+  std::string CacheSignature() const {
+    std::ostringstream os;
+    os << "CSVIter dtype=" << mshadow::DataType<DType>::kFlag
+       << " data_csv=" << param_.data_csv << " label_csv=" << param_.label_csv
+       << " data_shape=" << param_.data_shape << " label_shape=" << param_.label_shape;
+    return os.str();
+  }
+
+  /*! \brief read the rows from cache_ from now on */
+  void UseCache() {
+    order_ = BlockOrder(*cache_, param_.shuffle ? &rng_ : nullptr);
+    data_.reset(new CSVCachedRows<DType>(cache_, 0, param_.data_shape.Size(), &order_));
+    if (param_.label_csv != "NULL") {
+      label_.reset(new CSVCachedRows<DType>(cache_, 1, param_.label_shape.Size(), &order_));
+    }
+    reading_cache_ = true;
+  }
+
+  void StartCache() {
+    // the old writer removes its temporary file, which is also the new one's
+    writer_.reset();
+    writer_.reset(new BlockCacheWriter(param_.cache_file, CacheSignature()));
+    block_data_.clear();
+    block_label_.clear();
+    // whole batches per block, so that the batches of a pass from the first row are
+    // never split between blocks
+    const size_t batch_size = batch_param_.batch_size;
+    const size_t batch_bytes = batch_size * sizeof(DType) *
+        (param_.data_shape.Size() + (label_ ? param_.label_shape.Size() : 0));
+    block_rows_ = batch_size * std::max<size_t>(kCacheBlockBytes / batch_bytes, 1);
+  }
+
+  void WriteBlock() {
+    const size_t num_rows = block_data_.size() / param_.data_shape.Size();
+    if (num_rows == 0) return;
+    std::vector<std::pair<const void*, size_t> > arrays;
+    arrays.emplace_back(block_data_.data(), block_data_.size() * sizeof(DType));
+    if (label_) arrays.emplace_back(block_label_.data(), block_label_.size() * sizeof(DType));
+    writer_->WriteBlock(num_rows, arrays);
+    block_data_.clear();
+    block_label_.clear();
+  }
+
+  void FinishCache() {
+    WriteBlock();
+    writer_->Finish();
+    writer_.reset();
+    cache_ = BlockCache::Open(param_.cache_file, CacheSignature());
+    CHECK(cache_) << "Failed to read back the cache " << param_.cache_file;
+  }
+
+  void CheckLabels(size_t num_rows) {
+    if (label_) {
+      CHECK_GE(label_->Fill(num_rows), num_rows)
+          << "Data CSV's row is smaller than the number of rows in label_csv";
+    }
+  }
+
+  DType* ZeroLabels() {
+    std::fill(pad_label_.begin(), pad_label_.end(), DType(0));
+    return pad_label_.data();
+  }
+
+  void Consume(size_t num_rows) {
+    if (writer_) {
+      const DType* data = data_->rows();
+      block_data_.insert(block_data_.end(), data, data + num_rows * param_.data_shape.Size());
+      if (label_) {
+        const DType* label = label_->rows();
+        block_label_.insert(block_label_.end(), label,
+                            label + num_rows * param_.label_shape.Size());
+      }
+      if (block_data_.size() >= block_rows_ * param_.data_shape.Size()) WriteBlock();
+    }
+    data_->Consume(num_rows);
+    if (label_) label_->Consume(num_rows);
+  }
+
+  /*! \brief copy the next num_rows rows into the padded batch, starting at row start */
+  void CopyRows(size_t start, size_t num_rows) {
+    const size_t data_size = param_.data_shape.Size();
+    std::copy(data_->rows(), data_->rows() + num_rows * data_size,
+              pad_data_.begin() + start * data_size);
+    if (label_) {
+      const size_t label_size = param_.label_shape.Size();
+      std::copy(label_->rows(), label_->rows() + num_rows * label_size,
+                pad_label_.begin() + start * label_size);
+    } else {
+      std::fill(pad_label_.begin() + start, pad_label_.begin() + start + num_rows, DType(0));
+    }
+    Consume(num_rows);
+  }
+
+  void SetOutput(DType* data, DType* label) {
+    out_.data[0] = TBlob(data, data_shape_, cpu::kDevMask, 0);
+    out_.data[1] = TBlob(label, label_shape_, cpu::kDevMask, 0);
+  }
+
+  CSVIterParam param_;
+  BatchParam batch_param_;
+  std::unique_ptr<CSVRowReader<DType> > data_, label_;
+  /*! \brief target size of a cache block */
+  static const size_t kCacheBlockBytes = 4 << 20;
+  /*! \brief the cache being written during a pass over the text input */
+  std::unique_ptr<BlockCacheWriter> writer_;
+  /*! \brief rows of the block being written */
+  std::vector<DType> block_data_, block_label_;
+  size_t block_rows_{0};
+  /*! \brief the finished cache, and whether data_ and label_ read from it */
+  std::shared_ptr<BlockCache> cache_;
+  bool reading_cache_{false};
+  /*! \brief order of the cache blocks in this pass */
+  std::vector<size_t> order_;
+  std::mt19937 rng_;
+  mxnet::TShape data_shape_, label_shape_;
+  /*! \brief the batch which wraps around the end of the input */
+  std::vector<DType> pad_data_, pad_label_;
+  std::vector<unsigned> inst_index_;
+  unsigned inst_counter_{0};
+  /*! \brief number of rows of the next epoch already returned in round_batch mode */
+  size_t num_overflow_{0};
+  TBlobBatch out_;
+};
+
+/*! \brief picks the batch iterator of CSVIter from parse_threads and dtype */
+class CSVBatchIter : public IIterator<TBlobBatch> {
+ public:
+  virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+    CSVIterParam param;
+    param.InitAllowUnknown(kwargs);
+    if (param.parse_threads == 0 && param.cache_file == "NULL") {
+      iterator_.reset(new BatchLoader(new CSVIter()));
+    } else {
+      switch (CSVDType(kwargs)) {
+        case mshadow::kInt32:
+          iterator_.reset(new CSVChunkIter<int32_t>());
+          break;
+        case mshadow::kInt64:
+          iterator_.reset(new CSVChunkIter<int64_t>());
+          break;
+        default:
+          iterator_.reset(new CSVChunkIter<float>());
+          break;
+      }
+    }
+    iterator_->Init(kwargs);
+  }
+
+  virtual void BeforeFirst() {
+    iterator_->BeforeFirst();
+  }
+
+  virtual bool Next() {
+    return iterator_->Next();
+  }
+
+  virtual const TBlobBatch &Value() const {
+    return iterator_->Value();
+  }
+
+ private:
+  std::unique_ptr<IIterator<TBlobBatch> > iterator_;
+};
 
 DMLC_REGISTER_PARAMETER(CSVIterParam);
 
@@ -238,6 +846,16 @@ By default, the CSVIter parses all entries in the data file as float32 data type
 if `dtype` argument is set to be 'int32' or 'int64' then CSVIter will parse all entries in the file
 as int32 or int64 data type accordingly.
 
+By default, rows are parsed one at a time and copied into the batch. If `parse_threads` is
+positive, the input is instead read in chunks of whole lines, each chunk is parsed by
+`parse_threads` threads and batches are returned straight from the parsed rows.
+
+If `cache_file` is set, the parsed rows are also written to that file in blocks during the first
+complete pass, and the following passes, as well as later iterators created with the same
+arguments, read the rows from the memory mapped file without parsing. With `shuffle` set to
+``True`` the order of the blocks, each holding many batches, is shuffled in every such pass.
+Delete the cache file when the input changes.
+
 Examples::
 
   // Contents of CSV file ``data/data.csv``.
@@ -311,8 +929,7 @@ Examples::
 .add_arguments(PrefetcherParam::__FIELDS__())
 .set_body([]() {
     return new PrefetcherIter(
-        new BatchLoader(
-            new CSVIter()));
+        new CSVBatchIter());
   });
 
 }  // namespace io
@@ -41,6 +41,7 @@
 #include "./image_augmenter.h"
 #include "./image_iter_common.h"
 #include "./inst_vector.h"
+#include "./record_pipeline.h"
 #include "../common/utils.h"
 
 namespace mxnet {
@@ -55,6 +56,9 @@ class ImageRecordIOParser2 {
 
   // set record to the head
   inline void BeforeFirst(void) {
+    if (pipeline_ != nullptr) {
+      return pipeline_->BeforeFirst();
+    }
     if (batch_param_.round_batch == 0 || !overflow) {
       n_parsed_ = 0;
       return source_->BeforeFirst();
@@ -75,9 +79,18 @@ class ImageRecordIOParser2 {
 #if MXNET_USE_LIBJPEG_TURBO
   cv::Mat TJimdecode(cv::Mat buf, int color);
 #endif
+  // decode and augment one record, the labels go to label_buf
+  cv::Mat DecodeRecord(int tid, size_t idx, const ImageRecordIO& rec,
+    std::vector<float>* label_buf);
+  // normalize, mirror and copy an augmented image into data
+  void WriteImage(int tid, const cv::Mat& res, mshadow::Tensor<cpu, 3, DType>* data);
 #endif
   inline size_t ParseChunk(DType* data_dptr, real_t* label_dptr, const size_t current_size,
     dmlc::InputSplit::Blob * chunk);
+  // decode one record into position idx of a batch, used by the pipeline
+  inline void ParseRecord(int tid, size_t idx, std::string* record, std::vector<NDArray>* data);
+  // allocate the data and label arrays of a batch
+  inline void AllocBatch(std::vector<NDArray>* data);
   inline void CreateMeanImg(void);
 
   // magic number to seed prng
@@ -98,6 +111,8 @@ class ImageRecordIOParser2 {
   common::RANDOM_ENGINE rnd_;
   /*! \brief data source */
   std::unique_ptr<dmlc::InputSplit> source_;
+  /*! \brief streaming decoder, replaces ParseChunk when enabled */
+  std::unique_ptr<RecordBatchPipeline> pipeline_;
   /*! \brief label information, if any */
   std::unique_ptr<ImageLabelMap> label_map_;
   /*! \brief temporary results */
@@ -138,6 +153,12 @@ inline void ImageRecordIOParser2<DType>::Init(
   prefetch_param.InitAllowUnknown(kwargs);
   n_parsed_ = 0;
   overflow = false;
+  // This assumes that DataInst given by
+  // InstVector contains only 2 elements in
+  // data vector (operator[] implementation)
+  unit_size_.resize(2);
+  unit_size_[0] = param_.data_shape.Size();
+  unit_size_[1] = param_.label_width;
   rnd_.seed(kRandMagic + record_param_.seed);
   int maxthread, threadget;
   if (prefetch_param.ctx == PrefetcherParam::CtxType::kCPU) {
@@ -256,52 +277,71 @@ inline void ImageRecordIOParser2<DType>::Init(
       }
     }
   }
+  if (param_.decode_pipeline_depth > 0 && !legacy_shuffle_) {
+    if (param_.verbose) {
+      LOG(INFO) << "ImageRecordIOParser2: decode as a pipeline of "
+                << param_.decode_pipeline_depth << " batches";
+    }
+    pipeline_.reset(new RecordBatchPipeline(
+        source_.get(), batch_param_.batch_size, batch_param_.round_batch,
+        threadget, param_.decode_pipeline_depth, param_.bind_numa_nodes,
+        [this](std::vector<NDArray>* data) { this->AllocBatch(data); },
+        [this](int tid, size_t idx, std::string* record, std::vector<NDArray>* data) {
+          this->ParseRecord(tid, idx, record, data);
+        }));
+  }
 #else
   LOG(FATAL) << "ImageRec need opencv to process";
 #endif
 }
 
+template<typename DType>
+inline void ImageRecordIOParser2<DType>::AllocBatch(std::vector<NDArray>* data) {
+  std::vector<index_t> shape_vec;
+  shape_vec.push_back(batch_param_.batch_size);
+  for (index_t dim = 0; dim < param_.data_shape.ndim(); ++dim) {
+    shape_vec.push_back(param_.data_shape[dim]);
+  }
+  mxnet::TShape data_shape(shape_vec.begin(), shape_vec.end());
+
+  shape_vec.clear();
+  shape_vec.push_back(batch_param_.batch_size);
+  shape_vec.push_back(param_.label_width);
+  mxnet::TShape label_shape(shape_vec.begin(), shape_vec.end());
+
+  auto ctx = Context::CPU(0);
+  auto dev_id = param_.device_id;
+  if (dev_id != -1) {
+    ctx = Context::CPUPinned(dev_id);
+  }
+  data->resize(2);
+  data->at(0) = NDArray(data_shape, ctx, false,
+    mshadow::DataType<DType>::kFlag);
+  data->at(1) = NDArray(label_shape, ctx, false,
+    mshadow::DataType<real_t>::kFlag);
+}
+
 template<typename DType>
 inline bool ImageRecordIOParser2<DType>::ParseNext(DataBatch *out) {
   if (overflow) {
     return false;
   }
   CHECK(source_ != nullptr);
+  out->index.resize(batch_param_.batch_size);
+  if (pipeline_ != nullptr) {
+    size_t num_pad = 0;
+    if (!pipeline_->Next(&out->data, &num_pad)) {
+      return false;
+    }
+    out->num_batch_padd = num_pad;
+    return true;
+  }
   dmlc::InputSplit::Blob chunk;
   size_t current_size = 0;
-  out->index.resize(batch_param_.batch_size);
 
   // InitBatch
   if (out->data.size() == 0) {
-    // This assumes that DataInst given by
-    // InstVector contains only 2 elements in
-    // data vector (operator[] implementation)
-    out->data.resize(2);
-    unit_size_.resize(2);
-
-    std::vector<index_t> shape_vec;
-    shape_vec.push_back(batch_param_.batch_size);
-    for (index_t dim = 0; dim < param_.data_shape.ndim(); ++dim) {
-      shape_vec.push_back(param_.data_shape[dim]);
-    }
-    mxnet::TShape data_shape(shape_vec.begin(), shape_vec.end());
-
-    shape_vec.clear();
-    shape_vec.push_back(batch_param_.batch_size);
-    shape_vec.push_back(param_.label_width);
-    mxnet::TShape label_shape(shape_vec.begin(), shape_vec.end());
-
-    auto ctx = Context::CPU(0);
-    auto dev_id = param_.device_id;
-    if (dev_id != -1) {
-      ctx = Context::CPUPinned(dev_id);
-    }
-    out->data.at(0) = NDArray(data_shape, ctx, false,
-      mshadow::DataType<DType>::kFlag);
-    out->data.at(1) = NDArray(label_shape, ctx, false,
-      mshadow::DataType<real_t>::kFlag);
-    unit_size_[0] = param_.data_shape.Size();
-    unit_size_[1] = param_.label_width;
+    AllocBatch(&out->data);
   }
 
   while (current_size < batch_param_.batch_size) {
@@ -508,6 +548,93 @@ cv::Mat ImageRecordIOParser2<DType>::TJimdecode(cv::Mat image, int color) {
   return ret;
 }
 #endif
+
+template<typename DType>
+cv::Mat ImageRecordIOParser2<DType>::DecodeRecord(int tid, size_t idx, const ImageRecordIO& rec,
+  std::vector<float>* label_out) {
+  cv::Mat res;
+  cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
+
+  // If augmentation seed is supplied
+  // Re-seed RNG to guarantee reproducible results
+  if (param_.seed_aug.has_value()) {
+    prnds_[tid]->seed(idx + param_.seed_aug.value() + kRandMagic);
+  }
+
+  switch (param_.data_shape[0]) {
+   case 1:
+#if MXNET_USE_LIBJPEG_TURBO
+    res = TJimdecode(buf, 0);
+#else
+    res = cv::imdecode(buf, 0);
+#endif
+    break;
+   case 3:
+#if MXNET_USE_LIBJPEG_TURBO
+    res = TJimdecode(buf, 1);
+#else
+    res = cv::imdecode(buf, 1);
+#endif
+    break;
+   case 4:
+    // -1 to keep the number of channel of the encoded image, and not force gray or color.
+    res = cv::imdecode(buf, -1);
+    CHECK_EQ(res.channels(), 4)
+      << "Invalid image with index " << rec.image_index()
+      << ". Expected 4 channels, got " << res.channels();
+    break;
+   default:
+    LOG(FATAL) << "Invalid output shape " << param_.data_shape;
+  }
+  // load label before augmentations
+  std::vector<float>& label_buf = *label_out;
+  if (label_map_ != nullptr) {
+    label_buf = label_map_->FindCopy(rec.image_index());
+  } else if (rec.label != nullptr) {
+    CHECK_EQ(param_.label_width, rec.num_label)
+      << "rec file provide " << rec.num_label << "-dimensional label "
+         "but label_width is set to " << param_.label_width;
+    label_buf.assign(rec.label, rec.label + rec.num_label);
+  } else {
+    CHECK_EQ(param_.label_width, 1)
+      << "label_width must be 1 unless an imglist is provided "
+         "or the rec file is packed with multi dimensional label";
+    label_buf.assign(&rec.header.label, &rec.header.label + 1);
+  }
+  for (auto& aug : augmenters_[tid]) {
+    res = aug->Process(res, &label_buf, prnds_[tid].get());
+  }
+  return res;
+}
+
+template<typename DType>
+void ImageRecordIOParser2<DType>::WriteImage(int tid, const cv::Mat& res,
+  mshadow::Tensor<cpu, 3, DType>* data_ptr) {
+  const int n_channels = res.channels();
+  std::uniform_real_distribution<float> rand_uniform(0, 1);
+  std::bernoulli_distribution coin_flip(0.5);
+  bool is_mirrored = (normalize_param_.rand_mirror && coin_flip(*(prnds_[tid])))
+                     || normalize_param_.mirror;
+  float contrast_scaled = 1;
+  float illumination_scaled = 0;
+  if (!std::is_same<DType, uint8_t>::value) {
+    contrast_scaled =
+      (rand_uniform(*(prnds_[tid])) * normalize_param_.max_random_contrast * 2
+      - normalize_param_.max_random_contrast + 1)*normalize_param_.scale;
+    illumination_scaled =
+      (rand_uniform(*(prnds_[tid])) * normalize_param_.max_random_illumination * 2
+      - normalize_param_.max_random_illumination) * normalize_param_.scale;
+  }
+  // For RGB or RGBA data, swap the B and R channel:
+  // OpenCV store as BGR (or BGRA) and we want RGB (or RGBA)
+  if (n_channels == 1) {
+    ProcessImage<1>(res, data_ptr, is_mirrored, contrast_scaled, illumination_scaled);
+  } else if (n_channels == 3) {
+    ProcessImage<3>(res, data_ptr, is_mirrored, contrast_scaled, illumination_scaled);
+  } else if (n_channels == 4) {
+    ProcessImage<4>(res, data_ptr, is_mirrored, contrast_scaled, illumination_scaled);
+  }
+}
 #endif
 
 // Returns the number of images that are put into output
@@ -545,60 +672,10 @@ inline size_t ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t*
       }
       if (!reader_has_data) break;
       // Opencv decode and augments
-      cv::Mat res;
       rec.Load(blob.dptr, blob.size);
-      cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
-
-      // If augmentation seed is supplied
-      // Re-seed RNG to guarantee reproducible results
-      if (param_.seed_aug.has_value()) {
-        prnds_[tid]->seed(idx + param_.seed_aug.value() + kRandMagic);
-      }
-
-      switch (param_.data_shape[0]) {
-       case 1:
-#if MXNET_USE_LIBJPEG_TURBO
-        res = TJimdecode(buf, 0);
-#else
-        res = cv::imdecode(buf, 0);
-#endif
-        break;
-       case 3:
-#if MXNET_USE_LIBJPEG_TURBO
-        res = TJimdecode(buf, 1);
-#else
-        res = cv::imdecode(buf, 1);
-#endif
-        break;
-       case 4:
-        // -1 to keep the number of channel of the encoded image, and not force gray or color.
-        res = cv::imdecode(buf, -1);
-        CHECK_EQ(res.channels(), 4)
-          << "Invalid image with index " << rec.image_index()
-          << ". Expected 4 channels, got " << res.channels();
-        break;
-       default:
-        LOG(FATAL) << "Invalid output shape " << param_.data_shape;
-      }
-      const int n_channels = res.channels();
-      // load label before augmentations
       std::vector<float> label_buf;
-      if (label_map_ != nullptr) {
-        label_buf = label_map_->FindCopy(rec.image_index());
-      } else if (rec.label != nullptr) {
-        CHECK_EQ(param_.label_width, rec.num_label)
-          << "rec file provide " << rec.num_label << "-dimensional label "
-             "but label_width is set to " << param_.label_width;
-        label_buf.assign(rec.label, rec.label + rec.num_label);
-      } else {
-        CHECK_EQ(param_.label_width, 1)
-          << "label_width must be 1 unless an imglist is provided "
-             "or the rec file is packed with multi dimensional label";
-        label_buf.assign(&rec.header.label, &rec.header.label + 1);
-      }
-      for (auto& aug : augmenters_[tid]) {
-        res = aug->Process(res, &label_buf, prnds_[tid].get());
-      }
+      cv::Mat res = DecodeRecord(tid, idx, rec, &label_buf);
+      const int n_channels = res.channels();
       mshadow::Tensor<cpu, 3, DType> data;
       if (idx < batch_param_.batch_size) {
         data = mshadow::Tensor<cpu, 3, DType>(data_dptr + idx*unit_size_[0],
@@ -609,30 +686,7 @@ inline size_t ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t*
                  mshadow::Shape1(param_.label_width));
         data = out_tmp.data().Back();
       }
-
-      std::uniform_real_distribution<float> rand_uniform(0, 1);
-      std::bernoulli_distribution coin_flip(0.5);
-      bool is_mirrored = (normalize_param_.rand_mirror && coin_flip(*(prnds_[tid])))
-                         || normalize_param_.mirror;
-      float contrast_scaled = 1;
-      float illumination_scaled = 0;
-      if (!std::is_same<DType, uint8_t>::value) {
-        contrast_scaled =
-          (rand_uniform(*(prnds_[tid])) * normalize_param_.max_random_contrast * 2
-          - normalize_param_.max_random_contrast + 1)*normalize_param_.scale;
-        illumination_scaled =
-          (rand_uniform(*(prnds_[tid])) * normalize_param_.max_random_illumination * 2
-          - normalize_param_.max_random_illumination) * normalize_param_.scale;
-      }
-      // For RGB or RGBA data, swap the B and R channel:
-      // OpenCV store as BGR (or BGRA) and we want RGB (or RGBA)
-      if (n_channels == 1) {
-        ProcessImage<1>(res, &data, is_mirrored, contrast_scaled, illumination_scaled);
-      } else if (n_channels == 3) {
-        ProcessImage<3>(res, &data, is_mirrored, contrast_scaled, illumination_scaled);
-      } else if (n_channels == 4) {
-        ProcessImage<4>(res, &data, is_mirrored, contrast_scaled, illumination_scaled);
-      }
+      WriteImage(tid, res, &data);
 
       mshadow::Tensor<cpu, 1, real_t> label;
       if (idx < batch_param_.batch_size) {
@@ -656,6 +710,28 @@ inline size_t ImageRecordIOParser2<DType>::ParseChunk(DType* data_dptr, real_t*
 #endif
 }
 
+template<typename DType>
+inline void ImageRecordIOParser2<DType>::ParseRecord(int tid, size_t idx, std::string* record,
+  std::vector<NDArray>* data) {
+#if MXNET_USE_OPENCV
+  ImageRecordIO rec;
+  rec.Load(&(*record)[0], record->size());
+  std::vector<float> label_buf;
+  cv::Mat res = DecodeRecord(tid, idx, rec, &label_buf);
+  DType* data_dptr = static_cast<DType*>(data->at(0).data().dptr_);
+  mshadow::Tensor<cpu, 3, DType> img(data_dptr + idx * unit_size_[0],
+    mshadow::Shape3(res.channels(), res.rows, res.cols));
+  WriteImage(tid, res, &img);
+  real_t* label_dptr = static_cast<real_t*>(data->at(1).data().dptr_);
+  mshadow::Copy(mshadow::Tensor<cpu, 1, real_t>(label_dptr + idx * unit_size_[1],
+                  mshadow::Shape1(param_.label_width)),
+                mshadow::Tensor<cpu, 1>(dmlc::BeginPtr(label_buf),
+                  mshadow::Shape1(label_buf.size())));
+#else
+  LOG(FATAL) << "Opencv is needed for image decoding and augmenting.";
+#endif
+}
+
 // create mean image.
 template<typename DType>
 inline void ImageRecordIOParser2<DType>::CreateMeanImg(void) {
@@ -26,6 +26,9 @@
 #include <dmlc/logging.h>
 #include <dmlc/parameter.h>
 #include <dmlc/data.h>
+#include <random>
+#include <sstream>
+#include "./block_cache.h"
 #include "./iter_sparse_prefetcher.h"
 #include "./iter_sparse_batchloader.h"
 
@@ -45,6 +48,12 @@ struct LibSVMIterParam : public dmlc::Parameter<LibSVMIterParam> {
   int num_parts;
   /*! \brief the index of the part will read*/
   int part_index;
+  /*! \brief path to the binary cache of the parsed input */
+  std::string cache_file;
+  /*! \brief whether to shuffle the blocks of the cache */
+  bool shuffle;
+  /*! \brief random seed of the block shuffling */
+  int seed;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LibSVMIterParam) {
     DMLC_DECLARE_FIELD(data_libsvm)
@@ -61,6 +70,15 @@ struct LibSVMIterParam : public dmlc::Parameter<LibSVMIterParam> {
         .describe("partition the data into multiple parts");
     DMLC_DECLARE_FIELD(part_index).set_default(0)
         .describe("the index of the part will read");
+    DMLC_DECLARE_FIELD(cache_file).set_default("NULL")
+        .describe("If set, the parsed rows are written to this local file during the first "
+                  "complete pass, and later passes read them from it without parsing. "
+                  "An existing cache written for the same input and shapes is reused.");
+    DMLC_DECLARE_FIELD(shuffle).set_default(false)
+        .describe("Whether to shuffle the order of the cached blocks in every pass. "
+                  "Only applies when reading from ``cache_file``.");
+    DMLC_DECLARE_FIELD(seed).set_default(0)
+        .describe("The random seed of the block shuffling.");
   }
 };
 
@@ -75,13 +93,30 @@ class LibSVMIter: public SparseIIterator<DataInst> {
     CHECK_EQ(param_.data_shape.ndim(), 1) << "dimension of data_shape is expected to be 1";
     CHECK_GT(param_.num_parts, 0) << "number of parts should be positive";
     CHECK_GE(param_.part_index, 0) << "part index should be non-negative";
-    data_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.data_libsvm.c_str(),
-                                                      param_.part_index,
-                                                      param_.num_parts, "libsvm"));
+    rng_.seed(param_.seed);
+    if (param_.cache_file != "NULL") {
+      // fail before parsing anything if the cache cannot be written
+      param_.cache_file = BlockCachePath(param_.cache_file);
+      cache_ = BlockCache::Open(param_.cache_file, CacheSignature());
+      if (cache_) {
+        LOG(INFO) << "LibSVMIter: reading " << param_.data_libsvm << " from the cache "
+                  << param_.cache_file;
+        order_ = BlockOrder(*cache_, param_.shuffle ? &rng_ : nullptr);
+      } else {
+        StartCache();
+      }
+    }
+    if (!cache_) {
+      data_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.data_libsvm.c_str(),
+                                                        param_.part_index,
+                                                        param_.num_parts, "libsvm"));
+    }
     if (param_.label_libsvm != "NULL") {
-      label_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.label_libsvm.c_str(),
-                                                         param_.part_index,
-                                                         param_.num_parts, "libsvm"));
+      if (!cache_) {
+        label_parser_.reset(dmlc::Parser<uint64_t>::Create(param_.label_libsvm.c_str(),
+                                                           param_.part_index,
+                                                           param_.num_parts, "libsvm"));
+      }
       CHECK_GT(param_.label_shape.Size(), 1)
         << "label_shape is not expected to be (1,) when param_.label_libsvm is set.";
     } else {
@@ -98,6 +133,14 @@ class LibSVMIter: public SparseIIterator<DataInst> {
   }
 
   virtual void BeforeFirst() {
+    inst_counter_ = 0;
+    if (cache_) {
+      order_ = BlockOrder(*cache_, param_.shuffle ? &rng_ : nullptr);
+      block_ = row_ = 0;
+      return;
+    }
+    // a pass which did not reach the end leaves no cache
+    if (param_.cache_file != "NULL") StartCache();
     data_parser_->BeforeFirst();
     if (label_parser_.get() != nullptr) {
       label_parser_->BeforeFirst();
@@ -109,9 +152,11 @@ class LibSVMIter: public SparseIIterator<DataInst> {
   }
 
   virtual bool Next() {
+    if (cache_) return NextCached();
     if (end_) return false;
     while (data_ptr_ >= data_size_) {
       if (!data_parser_->Next()) {
+        if (writer_) FinishCache();
         end_ = true; return false;
       }
       data_ptr_ = 0;
@@ -138,8 +183,10 @@ class LibSVMIter: public SparseIIterator<DataInst> {
       out_.data[3] = AsDataBlob(label_row);
       out_.data[4] = AsIdxBlob(label_row);
       out_.data[5] = AsIndPtrPlaceholder(label_row);
+      if (writer_) AppendRow(data_row, &label_row);
     } else {
       out_.data[3] = AsScalarLabelBlob(data_row);
+      if (writer_) AppendRow(data_row, nullptr);
     }
     return true;
   }
@@ -180,6 +227,108 @@ class LibSVMIter: public SparseIIterator<DataInst> {
     return TBlob((real_t*) ptr, mshadow::Shape1(1), cpu::kDevMask);  // NOLINT(*)
   }
 
+  /*! \brief arrays of a cache block, the label CSR arrays only exist with label_libsvm */
+  enum CacheArray {
+    kLabel, kIndPtr, kIndex, kValue, kLabelIndPtr, kLabelIndex, kLabelValue
+  };
+
+  std::string CacheSignature() const {
+    std::ostringstream os;
+    os << "LibSVMIter data_libsvm=" << param_.data_libsvm
+       << " label_libsvm=" << param_.label_libsvm
+       << " data_shape=" << param_.data_shape << " label_shape=" << param_.label_shape
+       << " part=" << param_.part_index << "/" << param_.num_parts;
+    return os.str();
+  }
+
+  /*! \brief TBlobs of the i-th row of a CSR block in the cache */
+  inline void SetCachedCSR(size_t block, size_t row, size_t indptr, size_t out) {
+    const int64_t* ptr = cache_->array<int64_t>(block, indptr);
+    const mxnet::TShape shape(mshadow::Shape1(ptr[row + 1] - ptr[row]));
+    const real_t* value = cache_->array<real_t>(block, indptr + 2) + ptr[row];
+    const int64_t* index = cache_->array<int64_t>(block, indptr + 1) + ptr[row];
+    out_.data[out] = TBlob((real_t*) value, shape, cpu::kDevMask);  // NOLINT(*)
+    out_.data[out + 1] = TBlob((int64_t*) index, shape, cpu::kDevMask);  // NOLINT(*)
+    out_.data[out + 2] = TBlob(nullptr, mshadow::Shape1(0), cpu::kDevMask, mshadow::kInt64);
+  }
+
+  bool NextCached() {
+    while (block_ < order_.size() && row_ >= cache_->num_rows(order_[block_])) {
+      ++block_;
+      row_ = 0;
+    }
+    if (block_ == order_.size()) return false;
+    const size_t block = order_[block_];
+    out_.index = inst_counter_++;
+    SetCachedCSR(block, row_, kIndPtr, 0);
+    if (param_.label_libsvm != "NULL") {
+      SetCachedCSR(block, row_, kLabelIndPtr, 3);
+    } else {
+      const real_t* label = cache_->array<real_t>(block, kLabel) + row_;
+      out_.data[3] = TBlob((real_t*) label, mshadow::Shape1(1), cpu::kDevMask);  // NOLINT(*)
+    }
+    ++row_;
+    return true;
+  }
+
+  static void AppendCSR(const dmlc::Row<uint64_t>& row, std::vector<int64_t>* indptr,
+                        std::vector<int64_t>* index, std::vector<real_t>* value) {
+    for (size_t i = 0; i < row.length; ++i) {
+      index->push_back(static_cast<int64_t>(row.index[i]));
+      value->push_back(row.get_value(i));
+    }
+    indptr->push_back(index->size());
+  }
+
+  void AppendRow(const dmlc::Row<uint64_t>& row, const dmlc::Row<uint64_t>* label_row) {
+    block_label_.push_back(row.get_label());
+    AppendCSR(row, &block_indptr_[0], &block_index_[0], &block_value_[0]);
+    if (label_row != nullptr) {
+      AppendCSR(*label_row, &block_indptr_[1], &block_index_[1], &block_value_[1]);
+    }
+    const size_t bytes = (block_index_[0].size() + block_index_[1].size()) *
+                         (sizeof(int64_t) + sizeof(real_t));
+    if (bytes >= kCacheBlockBytes) WriteBlock();
+  }
+
+  void StartCache() {
+    // the old writer removes its temporary file, which is also the new one's
+    writer_.reset();
+    writer_.reset(new BlockCacheWriter(param_.cache_file, CacheSignature()));
+    ClearBlock();
+  }
+
+  void ClearBlock() {
+    block_label_.clear();
+    for (int i = 0; i < 2; ++i) {
+      block_indptr_[i].assign(1, 0);
+      block_index_[i].clear();
+      block_value_[i].clear();
+    }
+  }
+
+  void WriteBlock() {
+    if (block_label_.empty()) return;
+    std::vector<std::pair<const void*, size_t> > arrays;
+    arrays.emplace_back(block_label_.data(), block_label_.size() * sizeof(real_t));
+    const int num_csr = param_.label_libsvm != "NULL" ? 2 : 1;
+    for (int i = 0; i < num_csr; ++i) {
+      arrays.emplace_back(block_indptr_[i].data(), block_indptr_[i].size() * sizeof(int64_t));
+      arrays.emplace_back(block_index_[i].data(), block_index_[i].size() * sizeof(int64_t));
+      arrays.emplace_back(block_value_[i].data(), block_value_[i].size() * sizeof(real_t));
+    }
+    writer_->WriteBlock(block_label_.size(), arrays);
+    ClearBlock();
+  }
+
+  void FinishCache() {
+    WriteBlock();
+    writer_->Finish();
+    writer_.reset();
+    cache_ = BlockCache::Open(param_.cache_file, CacheSignature());
+    CHECK(cache_) << "Failed to read back the cache " << param_.cache_file;
+  }
+
   LibSVMIterParam param_;
   // output instance
   DataInst out_;
@@ -192,6 +341,20 @@ class LibSVMIter: public SparseIIterator<DataInst> {
   size_t data_ptr_{0}, data_size_{0};
   std::unique_ptr<dmlc::Parser<uint64_t> > label_parser_;
   std::unique_ptr<dmlc::Parser<uint64_t> > data_parser_;
+  /*! \brief target size of the indices and values of a cache block */
+  static const size_t kCacheBlockBytes = 4 << 20;
+  /*! \brief the cache being written during a pass over the text input */
+  std::unique_ptr<BlockCacheWriter> writer_;
+  /*! \brief rows of the block being written, for the data and the label file */
+  std::vector<real_t> block_label_;
+  std::vector<int64_t> block_indptr_[2], block_index_[2];
+  std::vector<real_t> block_value_[2];
+  /*! \brief the finished cache, read instead of the text input when set */
+  std::shared_ptr<BlockCache> cache_;
+  /*! \brief order of the cache blocks in this pass, and the position in it */
+  std::vector<size_t> order_;
+  size_t block_{0}, row_{0};
+  std::mt19937 rng_;
 };
 
 
@@ -224,6 +387,12 @@ When `num_parts` and `part_index` are provided, the data is split into `num_part
 and the iterator only reads the `part_index`-th partition. However, the partitions are not
 guaranteed to be even.
 
+If `cache_file` is set, the parsed rows are also written to that file as blocks of CSR arrays
+during the first complete pass, and the following passes, as well as later iterators created
+with the same arguments, read the rows from the memory mapped file without parsing. With
+`shuffle` set to ``True`` the order of the blocks is shuffled in every such pass. Delete the
+cache file when the input changes, and use one cache file per `part_index`.
+
 ``reset()`` is expected to be called only after a complete pass of data.
 
 Example::
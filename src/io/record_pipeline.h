@@ -0,0 +1,371 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file record_pipeline.h
+ * \brief streaming pipeline that decodes the records of an InputSplit into batches
+ */
+#ifndef MXNET_IO_RECORD_PIPELINE_H_
+#define MXNET_IO_RECORD_PIPELINE_H_
+
+#include <dmlc/base.h>
+#include <dmlc/common.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <mxnet/ndarray.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mxnet {
+namespace io {
+
+/*! \return the CPUs of each NUMA node, empty if the topology is unknown */
+inline std::vector<std::vector<int> > GetNUMANodeCPUs() {
+  std::vector<std::vector<int> > nodes;
+#if defined(__linux__)
+  for (int node = 0; ; ++node) {
+    std::ifstream fin("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!fin) break;
+    std::string list;
+    std::getline(fin, list);
+    std::vector<int> cpus;
+    for (const std::string& range : dmlc::Split(list, ',')) {
+      if (range.empty()) continue;
+      const size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash));
+      const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) nodes.push_back(cpus);
+  }
+#endif
+  return nodes;
+}
+
+/*! \brief restrict the calling thread to a set of CPUs */
+inline void BindThreadToCPUs(const std::vector<int>& cpus) {
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuset);
+  }
+  const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (err != 0) {
+    LOG(WARNING) << "Failed to set the CPU affinity of a decoding thread, error " << err;
+  }
+#endif
+}
+
+/*!
+ * \brief Streaming pipeline that turns the records of an InputSplit into batches.
+ *
+ *  A reader thread copies records into a ring of batch slots and queues one
+ *  task per record; worker threads decode the records straight into the
+ *  arrays of their slot. Reading, decoding and the hand over of finished
+ *  batches overlap, and the workers never wait for each other at the end
+ *  of a batch. The reader runs ahead into the next epoch, so a reset at the
+ *  end of an epoch costs nothing; a reset in the middle of an epoch drains
+ *  the pipeline and rewinds the source.
+ *
+ *  Finished batches are handed out by swapping arrays with the caller, so
+ *  the output is never copied.
+ */
+class RecordBatchPipeline {
+ public:
+  /*! \brief allocate the arrays of one batch */
+  typedef std::function<void(std::vector<NDArray>* arrays)> AllocFn;
+  /*!
+   * \brief fill position pos of a batch from one record, called by the workers.
+   *  The record buffer may be modified.
+   */
+  typedef std::function<void(int worker, size_t pos, std::string* record,
+                             std::vector<NDArray>* arrays)> ProcessFn;
+  /*!
+   * \brief constructor
+   * \param source record source, owned by the caller and not used by it while the pipeline runs.
+   * \param batch_size number of records per batch.
+   * \param round_batch fill the last batch of an epoch with records of the next one.
+   * \param num_workers number of decoding threads.
+   * \param depth number of batches in flight.
+   * \param bind_numa pin the decoding threads round robin to the NUMA nodes.
+   */
+  RecordBatchPipeline(dmlc::InputSplit* source, size_t batch_size, bool round_batch,
+                      int num_workers, int depth, bool bind_numa,
+                      AllocFn alloc, ProcessFn process)
+      : source_(source), batch_size_(batch_size), round_batch_(round_batch),
+        num_workers_(num_workers), bind_numa_(bind_numa),
+        alloc_(alloc), process_(process), slots_(std::max(depth, 1)) {
+    CHECK_GT(num_workers_, 0);
+    if (bind_numa_) numa_nodes_ = GetNUMANodeCPUs();
+  }
+  ~RecordBatchPipeline() {
+    Stop();
+  }
+  /*!
+   * \brief get the next batch, blocking until it is decoded.
+   * \param arrays swapped with the arrays of the batch, the old arrays are reused.
+   * \param num_pad number of padded records at the end of the batch.
+   * \return false at the end of an epoch.
+   */
+  bool Next(std::vector<NDArray>* arrays, size_t* num_pad) {
+    if (at_epoch_end_) return false;
+    if (!started_) Start();
+    Slot& slot = slots_[consume_seq_ % slots_.size()];
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_cv_.wait(lock, [&]() { return slot.ready || error_ != nullptr; });
+      if (error_ != nullptr) {
+        std::exception_ptr error = error_;
+        lock.unlock();
+        Stop();
+        std::rethrow_exception(error);
+      }
+    }
+    const bool has_data = slot.size != 0;
+    at_epoch_end_ = slot.last;
+    if (has_data) {
+      arrays->swap(slot.arrays);
+      *num_pad = slot.num_pad;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot.ready = false;
+      slot.free = true;
+    }
+    slot_cv_.notify_all();
+    ++consume_seq_;
+    return has_data;
+  }
+  /*! \brief rewind to the beginning of the next epoch */
+  void BeforeFirst() {
+    if (started_ && at_epoch_end_) {
+      // the reader already went on with the next epoch
+      at_epoch_end_ = false;
+      return;
+    }
+    Stop();
+    source_->BeforeFirst();
+    at_epoch_end_ = false;
+  }
+
+ private:
+  /*! \brief a batch in flight */
+  struct Slot {
+    /*! \brief output arrays */
+    std::vector<NDArray> arrays;
+    /*! \brief raw records, reused across batches */
+    std::vector<std::string> records;
+    /*! \brief number of records, 0 marks the end of an epoch */
+    size_t size = 0;
+    /*! \brief number of padded records */
+    size_t num_pad = 0;
+    /*! \brief whether this is the last batch of an epoch */
+    bool last = false;
+    /*! \brief unfinished tasks, plus one until the reader is done with the slot */
+    size_t pending = 0;
+    /*! \brief whether all records are decoded */
+    bool ready = false;
+    /*! \brief whether the reader may fill the slot */
+    bool free = true;
+  };
+
+  void Start() {
+    stop_ = false;
+    reader_ = std::thread([this]() { this->ReadLoop(); });
+    for (int i = 0; i < num_workers_; ++i) {
+      workers_.emplace_back([this, i]() { this->WorkLoop(i); });
+    }
+    started_ = true;
+  }
+
+  void Stop() {
+    if (!started_) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    slot_cv_.notify_all();
+    reader_.join();
+    for (auto& t : workers_) t.join();
+    workers_.clear();
+    tasks_.clear();
+    for (Slot& slot : slots_) {
+      slot.pending = 0;
+      slot.ready = false;
+      slot.free = true;
+    }
+    produce_seq_ = 0;
+    consume_seq_ = 0;
+    error_ = nullptr;
+    started_ = false;
+  }
+
+  void SetError(std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error_ == nullptr) error_ = error;
+    }
+    slot_cv_.notify_all();
+  }
+
+  void ReadLoop() {
+    try {
+      dmlc::InputSplit::Blob blob;
+      while (true) {
+        const size_t index = produce_seq_ % slots_.size();
+        Slot& slot = slots_[index];
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          slot_cv_.wait(lock, [&]() { return stop_ || slot.free; });
+          if (stop_) return;
+          slot.free = false;
+          slot.pending = 1;
+        }
+        if (slot.arrays.empty()) {
+          alloc_(&slot.arrays);
+        }
+        // the consumer may still read the arrays it handed back
+        for (NDArray& arr : slot.arrays) {
+          arr.WaitToWrite();
+        }
+        slot.records.resize(batch_size_);
+        size_t n = 0, num_pad = 0;
+        bool last = false;
+        while (n < batch_size_) {
+          if (!source_->NextRecord(&blob)) {
+            source_->BeforeFirst();
+            if (n == 0 || !round_batch_) {
+              num_pad = n == 0 ? 0 : batch_size_ - n;
+              last = true;
+              break;
+            }
+            CHECK(!last) << "number of input images must be bigger than the batch size";
+            // fill the rest of the batch with the beginning of the next epoch
+            num_pad = batch_size_ - n;
+            last = true;
+            continue;
+          }
+          slot.records[n].assign(static_cast<const char*>(blob.dptr), blob.size);
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) return;
+            tasks_.emplace_back(index, n);
+            ++slot.pending;
+          }
+          task_cv_.notify_one();
+          ++n;
+        }
+        bool ready;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          slot.size = n;
+          slot.num_pad = num_pad;
+          slot.last = last;
+          ready = (--slot.pending == 0);
+          slot.ready = ready;
+        }
+        if (ready) slot_cv_.notify_all();
+        ++produce_seq_;
+      }
+    } catch (...) {
+      SetError(std::current_exception());
+    }
+  }
+
+  void WorkLoop(int worker) {
+    if (!numa_nodes_.empty()) {
+      BindThreadToCPUs(numa_nodes_[worker % numa_nodes_.size()]);
+    }
+    while (true) {
+      std::pair<size_t, size_t> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        if (stop_) return;
+        task = tasks_.front();
+        tasks_.pop_front();
+      }
+      Slot& slot = slots_[task.first];
+      try {
+        process_(worker, task.second, &slot.records[task.second], &slot.arrays);
+      } catch (...) {
+        SetError(std::current_exception());
+      }
+      bool ready;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready = (--slot.pending == 0);
+        slot.ready = ready;
+      }
+      if (ready) slot_cv_.notify_all();
+    }
+  }
+
+  /*! \brief record source */
+  dmlc::InputSplit* source_;
+  size_t batch_size_;
+  bool round_batch_;
+  int num_workers_;
+  bool bind_numa_;
+  AllocFn alloc_;
+  ProcessFn process_;
+  /*! \brief CPUs of each NUMA node, empty if the workers are not pinned */
+  std::vector<std::vector<int> > numa_nodes_;
+  /*! \brief ring of batches in flight */
+  std::vector<Slot> slots_;
+  /*! \brief pending tasks as (slot, position in batch) */
+  std::deque<std::pair<size_t, size_t> > tasks_;
+  /*! \brief protects the slot states, tasks_, stop_ and error_ */
+  std::mutex mutex_;
+  /*! \brief signaled when a slot becomes free or ready */
+  std::condition_variable slot_cv_;
+  /*! \brief signaled when a task is queued */
+  std::condition_variable task_cv_;
+  std::thread reader_;
+  std::vector<std::thread> workers_;
+  /*! \brief number of batches started by the reader */
+  size_t produce_seq_ = 0;
+  /*! \brief number of batches taken by the consumer */
+  size_t consume_seq_ = 0;
+  bool stop_ = false;
+  bool started_ = false;
+  /*! \brief whether the consumer reached the end of the current epoch */
+  bool at_epoch_end_ = false;
+  /*! \brief first error raised by the reader or a worker */
+  std::exception_ptr error_;
+};
+
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_RECORD_PIPELINE_H_
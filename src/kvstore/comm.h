@@ -32,6 +32,7 @@
 #include <thread>
 #include "mxnet/ndarray.h"
 #include "gradient_compression.h"
+#include "./comm_reduce.h"
 #include "../ndarray/ndarray_function.h"
 #include "../operator/tensor/sparse_retain-inl.h"
 #include "./kvstore_utils.h"
@@ -391,6 +392,22 @@ class CommCPU : public Comm {
     }
   }
 
+  // float, float16 and bfloat16 use the vectorized tiled kernels of comm_reduce.h
+  inline static void ReduceSumCPU(
+      const std::vector<float*> &dptr, size_t offset, index_t size) {
+    reduce::Sum(dptr.data(), dptr.size(), offset, size);
+  }
+
+  inline static void ReduceSumCPU(
+      const std::vector<mshadow::half::half_t*> &dptr, size_t offset, index_t size) {
+    reduce::Sum(dptr.data(), dptr.size(), offset, size);
+  }
+
+  inline static void ReduceSumCPU(
+      const std::vector<mshadow::bfloat::bf16_t*> &dptr, size_t offset, index_t size) {
+    reduce::Sum(dptr.data(), dptr.size(), offset, size);
+  }
+
   template<typename DType>
   inline void ReduceSumCPUImpl(std::vector<DType*> dptr, size_t total) {
     const size_t step = std::min(bigarray_bound_, static_cast<size_t>(4 << 10));
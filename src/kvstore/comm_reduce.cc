@@ -0,0 +1,235 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file comm_reduce.cc
+ * \brief vectorized cpu reduction of dense buffers for CommCPU
+ */
+#include "./comm_reduce.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MXNET_REDUCE_X86 1
+#include <immintrin.h>
+#define MXNET_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#define MXNET_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define MXNET_REDUCE_X86 0
+#endif
+
+namespace mxnet {
+namespace kvstore {
+namespace reduce {
+
+using mshadow::half::half_t;
+using mshadow::bfloat::bf16_t;
+
+namespace {
+
+/*! \brief number of elements summed at a time, the float accumulator fits in L1 */
+constexpr size_t kTile = 2048;
+
+/*!
+ * \brief sum elements [begin, end) of the tile starting at base into acc with
+ * plain c++, also used for the elements of a tile which do not fill a vector
+ */
+template<typename DType>
+inline void SumTileScalar(DType* const* dptr, size_t num, size_t base,
+                          size_t begin, size_t end, float* acc) {
+  const DType* dst = dptr[0] + base;
+  for (size_t j = begin; j < end; ++j) acc[j] = static_cast<float>(dst[j]);
+  for (size_t i = 1; i < num; ++i) {
+    const DType* src = dptr[i] + base;
+    for (size_t j = begin; j < end; ++j) acc[j] += static_cast<float>(src[j]);
+  }
+}
+
+template<typename DType>
+inline void StoreTileScalar(DType* dst, size_t begin, size_t end, const float* acc) {
+  for (size_t j = begin; j < end; ++j) dst[j] = DType(acc[j]);
+}
+
+template<typename DType>
+void SumScalar(DType* const* dptr, size_t num, size_t offset, size_t size) {
+  alignas(64) float acc[kTile];
+  for (size_t t = 0; t < size; t += kTile) {
+    const size_t n = std::min(kTile, size - t);
+    SumTileScalar(dptr, num, offset + t, 0, n, acc);
+    StoreTileScalar(dptr[0] + offset + t, 0, n, acc);
+  }
+}
+
+#if MXNET_REDUCE_X86
+
+/*!
+ * \brief Load converts kWidth elements to float, Store rounds them back.
+ * bfloat16 is truncated like mshadow::bfloat::bf16_t, float16 is rounded to nearest.
+ */
+template<typename DType> struct AVX2Ops;
+template<typename DType> struct AVX512Ops;
+
+template<> struct AVX2Ops<float> {
+  MXNET_TARGET_AVX2 static inline __m256 Load(const float* p) {
+    return _mm256_loadu_ps(p);
+  }
+  MXNET_TARGET_AVX2 static inline void Store(float* p, __m256 v) {
+    _mm256_storeu_ps(p, v);
+  }
+};
+
+template<> struct AVX2Ops<half_t> {
+  MXNET_TARGET_AVX2 static inline __m256 Load(const half_t* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  MXNET_TARGET_AVX2 static inline void Store(half_t* p, __m256 v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                     _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+template<> struct AVX2Ops<bf16_t> {
+  MXNET_TARGET_AVX2 static inline __m256 Load(const bf16_t* p) {
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+  }
+  MXNET_TARGET_AVX2 static inline void Store(bf16_t* p, __m256 v) {
+    const __m256i x = _mm256_srli_epi32(_mm256_castps_si256(v), 16);
+    // packing works within 128-bit lanes, gather the low halves of both lanes
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(x, x), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+  }
+};
+
+template<> struct AVX512Ops<float> {
+  MXNET_TARGET_AVX512 static inline __m512 Load(const float* p) {
+    return _mm512_loadu_ps(p);
+  }
+  MXNET_TARGET_AVX512 static inline void Store(float* p, __m512 v) {
+    _mm512_storeu_ps(p, v);
+  }
+};
+
+template<> struct AVX512Ops<half_t> {
+  MXNET_TARGET_AVX512 static inline __m512 Load(const half_t* p) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+  MXNET_TARGET_AVX512 static inline void Store(half_t* p, __m512 v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                        _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+template<> struct AVX512Ops<bf16_t> {
+  MXNET_TARGET_AVX512 static inline __m512 Load(const bf16_t* p) {
+    const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+  }
+  MXNET_TARGET_AVX512 static inline void Store(bf16_t* p, __m512 v) {
+    const __m512i x = _mm512_srli_epi32(_mm512_castps_si512(v), 16);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(x));
+  }
+};
+
+/*!
+ * \brief the tiled reduction for one instruction set. The destination tile is
+ * loaded into the accumulator, every source adds its tile to it and the result is
+ * written back once, so dptr[0] is read and written once per call whatever num is.
+ */
+#define MXNET_REDUCE_SUM_TILES(NAME, TARGET, OPS, VEC, WIDTH, ADD, LOADA, STOREA) \
+  template<typename DType>                                                       \
+  TARGET void NAME(DType* const* dptr, size_t num, size_t offset, size_t size) { \
+    alignas(64) float acc[kTile];                                                \
+    for (size_t t = 0; t < size; t += kTile) {                                   \
+      const size_t n = std::min(kTile, size - t);                                \
+      const size_t nv = n / WIDTH * WIDTH;                                       \
+      const size_t base = offset + t;                                            \
+      const DType* dst = dptr[0] + base;                                         \
+      for (size_t j = 0; j < nv; j += WIDTH) {                                   \
+        STOREA(acc + j, OPS<DType>::Load(dst + j));                              \
+      }                                                                          \
+      for (size_t i = 1; i < num; ++i) {                                         \
+        const DType* src = dptr[i] + base;                                       \
+        for (size_t j = 0; j < nv; j += WIDTH) {                                 \
+          const VEC sum = ADD(LOADA(acc + j), OPS<DType>::Load(src + j));        \
+          STOREA(acc + j, sum);                                                  \
+        }                                                                        \
+      }                                                                          \
+      SumTileScalar(dptr, num, base, nv, n, acc);                                \
+      for (size_t j = 0; j < nv; j += WIDTH) {                                   \
+        OPS<DType>::Store(dptr[0] + base + j, LOADA(acc + j));                   \
+      }                                                                          \
+      StoreTileScalar(dptr[0] + base, nv, n, acc);                               \
+    }                                                                            \
+  }
+
+MXNET_REDUCE_SUM_TILES(SumAVX2, MXNET_TARGET_AVX2, AVX2Ops, __m256, 8,
+                       _mm256_add_ps, _mm256_load_ps, _mm256_store_ps)
+MXNET_REDUCE_SUM_TILES(SumAVX512, MXNET_TARGET_AVX512, AVX512Ops, __m512, 16,
+                       _mm512_add_ps, _mm512_load_ps, _mm512_store_ps)
+#undef MXNET_REDUCE_SUM_TILES
+
+#endif  // MXNET_REDUCE_X86
+
+template<typename DType>
+void SumImpl(DType* const* dptr, size_t num, size_t offset, size_t size, ISA isa) {
+  if (num < 2 || size == 0) return;
+  switch (isa) {
+#if MXNET_REDUCE_X86
+    case ISA::kAVX512:
+      SumAVX512(dptr, num, offset, size);
+      break;
+    case ISA::kAVX2:
+      SumAVX2(dptr, num, offset, size);
+      break;
+#endif
+    default:
+      SumScalar(dptr, num, offset, size);
+  }
+}
+
+}  // namespace
+
+ISA DetectISA() {
+  static const ISA isa = []() {
+#if MXNET_REDUCE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return ISA::kAVX512;
+    // every cpu with avx2 also has f16c
+    if (__builtin_cpu_supports("avx2")) return ISA::kAVX2;
+#endif
+    return ISA::kScalar;
+  }();
+  return isa;
+}
+
+void Sum(float* const* dptr, size_t num, size_t offset, size_t size, ISA isa) {
+  SumImpl(dptr, num, offset, size, isa);
+}
+
+void Sum(half_t* const* dptr, size_t num, size_t offset, size_t size, ISA isa) {
+  SumImpl(dptr, num, offset, size, isa);
+}
+
+void Sum(bf16_t* const* dptr, size_t num, size_t offset, size_t size, ISA isa) {
+  SumImpl(dptr, num, offset, size, isa);
+}
+
+}  // namespace reduce
+}  // namespace kvstore
+}  // namespace mxnet
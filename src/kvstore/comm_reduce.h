@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file comm_reduce.h
+ * \brief vectorized cpu reduction of dense buffers for CommCPU
+ */
+#ifndef MXNET_KVSTORE_COMM_REDUCE_H_
+#define MXNET_KVSTORE_COMM_REDUCE_H_
+
+#include <mshadow/base.h>
+#include <cstddef>
+
+namespace mxnet {
+namespace kvstore {
+namespace reduce {
+
+/*!
+ * \brief the instruction set used by the reduction kernels
+ */
+enum class ISA {
+  kScalar,
+  kAVX2,
+  kAVX512
+};
+
+/*!
+ * \brief the best instruction set supported by this cpu, detected once at runtime
+ */
+ISA DetectISA();
+
+/*!
+ * \brief sum dptr[1..num) into dptr[0] over elements [offset, offset + size).
+ * The buffers are summed tile by tile so each of them is streamed from memory once.
+ * Half precision types are accumulated in float and rounded once per tile.
+ * \param dptr pointers to the buffers, dptr[0] is the destination
+ * \param num number of buffers
+ * \param offset first element to reduce
+ * \param size number of elements to reduce
+ * \param isa instruction set to use, must not be better than DetectISA()
+ */
+void Sum(float* const* dptr, size_t num, size_t offset, size_t size,
+         ISA isa = DetectISA());
+void Sum(mshadow::half::half_t* const* dptr, size_t num, size_t offset, size_t size,
+         ISA isa = DetectISA());
+void Sum(mshadow::bfloat::bf16_t* const* dptr, size_t num, size_t offset, size_t size,
+         ISA isa = DetectISA());
+
+}  // namespace reduce
+}  // namespace kvstore
+}  // namespace mxnet
+#endif  // MXNET_KVSTORE_COMM_REDUCE_H_
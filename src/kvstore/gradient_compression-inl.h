@@ -31,11 +31,26 @@
 namespace mxnet {
 namespace kvstore {
 
+/*! \brief number of values sharing one scale in 1bit compression */
+const int kOneBitBlockSize = 512;
+/*! \brief number of floats a block compresses to in 1bit compression, scale then sign bits */
+const int kOneBitCompressedBlockSize = 1 + kOneBitBlockSize / 32;
+/*! \brief number of values among which topk and randomk compression pick */
+const int kSparseBlockSize = 1024;
+
 // these gpu functions are defined in gradient_compression.cu
 void Quantize2BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
                       const float threshold);
 void Dequantize2BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
-                        const float threshold);
+                        const float threshold, const OpReqType req);
+void Quantize1BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs);
+void Dequantize1BitImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                        const OpReqType req);
+void QuantizeSparseImpl(mshadow::Stream<mshadow::gpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                        const int k, const bool random, const uint32_t seed);
+void DequantizeSparseImpl(mshadow::Stream<mshadow::gpu> *s,
+                          const std::vector<mxnet::TBlob> &inputs,
+                          const int k, const OpReqType req);
 
 struct quantize_2bit {
   MSHADOW_XINLINE static void Map(int out_block_id,
@@ -94,6 +109,7 @@ void Quantize2BitKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::
             threshold);               // positive threshold
 }
 
+template<int req>
 struct dequantize_2bit {
   MSHADOW_XINLINE static void Map(int i,
                                   float *out,
@@ -115,27 +131,206 @@ struct dequantize_2bit {
     const uint8_t negmask = negbits[col];
     const uint8_t masked = *ch_ptr & mask;
     if (masked == mask) {
-      *outval = pos_threshold;
+      KERNEL_ASSIGN(*outval, req, pos_threshold);
     } else if (masked == negmask) {
       // use posbits for mask as posbits are both 1s
       // then compare masked with negbits to see if only negbits were set
-      *outval = neg_threshold;
+      KERNEL_ASSIGN(*outval, req, neg_threshold);
     } else {
-      *outval = 0;
+      KERNEL_ASSIGN(*outval, req, 0);
     }
   }
 };
 
 template<typename xpu>
 void Dequantize2BitKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
-                                const float threshold) {
-  mxnet::op::mxnet_op::Kernel<dequantize_2bit, xpu>
-  ::Launch(s,
-          inputs[1].Size(),         // original size
-          inputs[1].dptr<float>(),  // out array
-          inputs[0].dptr<float>(),  // compressed array
-          -1 *threshold,            // negative threshold
-          threshold);               // positive threshold
+                                const float threshold, const OpReqType req) {
+  MXNET_ASSIGN_REQ_SWITCH(req, Req, {
+    mxnet::op::mxnet_op::Kernel<dequantize_2bit<Req>, xpu>
+    ::Launch(s,
+            inputs[1].Size(),         // original size
+            inputs[1].dptr<float>(),  // out array
+            inputs[0].dptr<float>(),  // compressed array
+            -1 *threshold,            // negative threshold
+            threshold);               // positive threshold
+  });
+}
+
+struct quantize_1bit {
+  MSHADOW_XINLINE static void Map(int out_block_id,
+                                  int original_size,
+                                  float *out,
+                                  float *grad,
+                                  float *residual) {
+    // this block holds the scale followed by the sign bits of
+    // upto kOneBitBlockSize values starting from out_block_id*kOneBitBlockSize
+    float *compr_block = out + out_block_id * kOneBitCompressedBlockSize;
+    const int start = out_block_id * kOneBitBlockSize;
+    const int end = (start + kOneBitBlockSize <= original_size) ?
+                    start + kOneBitBlockSize : original_size;
+    // scale is the mean magnitude of the updated gradient in this block
+    float scale = 0;
+    for (int i = start; i < end; i++) {
+      residual[i] += grad[i];
+      scale += residual[i] < 0 ? -residual[i] : residual[i];
+    }
+    scale /= end - start;
+    compr_block[0] = scale;
+    uint32_t *bits = reinterpret_cast<uint32_t *>(compr_block + 1);
+    for (int w = 0; w < kOneBitBlockSize / 32; w++) {
+      bits[w] = 0;
+    }
+    for (int i = start; i < end; i++) {
+      // set bit for non-negative values, which are sent as +scale
+      if (residual[i] >= 0) {
+        bits[(i - start) >> 5] |= 1u << ((i - start) & 31);
+        residual[i] -= scale;
+      } else {
+        residual[i] += scale;
+      }
+    }
+  }
+};
+
+template<typename xpu>
+void Quantize1BitKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs) {
+  mxnet::op::mxnet_op::Kernel<quantize_1bit, xpu>
+    ::Launch(s,
+            inputs[2].Size() / kOneBitCompressedBlockSize,  // number of blocks
+            inputs[0].Size(),         // original size
+            inputs[2].dptr<float>(),  // compressed array
+            inputs[0].dptr<float>(),  // original array
+            inputs[1].dptr<float>());  // residual array
+}
+
+template<int req>
+struct dequantize_1bit {
+  MSHADOW_XINLINE static void Map(int i,
+                                  float *out,
+                                  float *in) {
+    const float *compr_block = in + (i / kOneBitBlockSize) * kOneBitCompressedBlockSize;
+    const int pos = i % kOneBitBlockSize;
+    const uint32_t word = reinterpret_cast<const uint32_t *>(compr_block + 1)[pos >> 5];
+    const float scale = compr_block[0];
+    KERNEL_ASSIGN(out[i], req, ((word >> (pos & 31)) & 1) ? scale : -scale);
+  }
+};
+
+template<typename xpu>
+void Dequantize1BitKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                                const OpReqType req) {
+  MXNET_ASSIGN_REQ_SWITCH(req, Req, {
+    mxnet::op::mxnet_op::Kernel<dequantize_1bit<Req>, xpu>
+    ::Launch(s,
+            inputs[1].Size(),          // original size
+            inputs[1].dptr<float>(),   // out array
+            inputs[0].dptr<float>());  // compressed array
+  });
+}
+
+/*!
+ * \brief Picks `k` values out of each block of kSparseBlockSize values, either the largest
+ * in magnitude or at random, and writes them as (index in block, value) pairs.
+ * The index is stored in the bits of a float. Picked values are removed from the residual,
+ * so picking the same position twice sends a zero the second time.
+ */
+struct quantize_sparse {
+  MSHADOW_XINLINE static uint32_t Hash(uint32_t seed, uint32_t block, uint32_t j) {
+    uint32_t x = seed ^ (block * 0x9e3779b9u) ^ (j * 0x85ebca6bu);
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+  }
+
+  MSHADOW_XINLINE static void Map(int out_block_id,
+                                  int original_size,
+                                  float *out,
+                                  float *grad,
+                                  float *residual,
+                                  const int k,
+                                  const bool random,
+                                  const uint32_t seed) {
+    float *pairs = out + out_block_id * 2 * k;
+    const int start = out_block_id * kSparseBlockSize;
+    const int end = (start + kSparseBlockSize <= original_size) ?
+                    start + kSparseBlockSize : original_size;
+    for (int i = start; i < end; i++) {
+      residual[i] += grad[i];
+    }
+    for (int j = 0; j < k; j++) {
+      int pick = start;
+      if (random) {
+        pick += Hash(seed, out_block_id, j) % static_cast<uint32_t>(end - start);
+      } else {
+        float best = -1;
+        for (int i = start; i < end; i++) {
+          const float mag = residual[i] < 0 ? -residual[i] : residual[i];
+          if (mag > best) {
+            best = mag;
+            pick = i;
+          }
+        }
+      }
+      reinterpret_cast<int32_t *>(pairs)[2 * j] = pick - start;
+      pairs[2 * j + 1] = residual[pick];
+      residual[pick] = 0;
+    }
+  }
+};
+
+template<typename xpu>
+void QuantizeSparseKernelLaunch(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                                const int k, const bool random, const uint32_t seed) {
+  mxnet::op::mxnet_op::Kernel<quantize_sparse, xpu>
+    ::Launch(s,
+            inputs[2].Size() / (2 * k),  // number of blocks
+            inputs[0].Size(),         // original size
+            inputs[2].dptr<float>(),  // compressed array
+            inputs[0].dptr<float>(),  // original array
+            inputs[1].dptr<float>(),  // residual array
+            k, random, seed);
+}
+
+template<int req>
+struct dequantize_sparse {
+  MSHADOW_XINLINE static void Map(int block_id,
+                                  int original_size,
+                                  float *out,
+                                  float *in,
+                                  const int k) {
+    const float *pairs = in + block_id * 2 * k;
+    const int start = block_id * kSparseBlockSize;
+    const int end = (start + kSparseBlockSize <= original_size) ?
+                    start + kSparseBlockSize : original_size;
+    if (req == kNullOp) return;
+    if (req == kWriteTo || req == kWriteInplace) {
+      for (int i = start; i < end; i++) {
+        out[i] = 0;
+      }
+    }
+    // scatter-add, positions picked twice carry zero the second time
+    for (int j = 0; j < k; j++) {
+      out[start + reinterpret_cast<const int32_t *>(pairs)[2 * j]] += pairs[2 * j + 1];
+    }
+  }
+};
+
+template<typename xpu>
+void DequantizeSparseKernelLaunch(mshadow::Stream<xpu> *s,
+                                  const std::vector<mxnet::TBlob> &inputs,
+                                  const int k, const OpReqType req) {
+  MXNET_ASSIGN_REQ_SWITCH(req, Req, {
+    mxnet::op::mxnet_op::Kernel<dequantize_sparse<Req>, xpu>
+    ::Launch(s,
+            inputs[0].Size() / (2 * k),  // number of blocks
+            inputs[1].Size(),         // original size
+            inputs[1].dptr<float>(),  // out array
+            inputs[0].dptr<float>(),  // compressed array
+            k);
+  });
 }
 
 inline void Quantize2BitImpl(mshadow::Stream<mshadow::cpu> *s,
@@ -146,8 +341,31 @@ inline void Quantize2BitImpl(mshadow::Stream<mshadow::cpu> *s,
 
 inline void Dequantize2BitImpl(mshadow::Stream<mshadow::cpu> *s,
                                const std::vector<mxnet::TBlob> &inputs,
-                               const float threshold) {
-  Dequantize2BitKernelLaunch(s, inputs, threshold);
+                               const float threshold, const OpReqType req) {
+  Dequantize2BitKernelLaunch(s, inputs, threshold, req);
+}
+
+inline void Quantize1BitImpl(mshadow::Stream<mshadow::cpu> *s,
+                             const std::vector<mxnet::TBlob> &inputs) {
+  Quantize1BitKernelLaunch(s, inputs);
+}
+
+inline void Dequantize1BitImpl(mshadow::Stream<mshadow::cpu> *s,
+                               const std::vector<mxnet::TBlob> &inputs,
+                               const OpReqType req) {
+  Dequantize1BitKernelLaunch(s, inputs, req);
+}
+
+inline void QuantizeSparseImpl(mshadow::Stream<mshadow::cpu> *s,
+                               const std::vector<mxnet::TBlob> &inputs,
+                               const int k, const bool random, const uint32_t seed) {
+  QuantizeSparseKernelLaunch(s, inputs, k, random, seed);
+}
+
+inline void DequantizeSparseImpl(mshadow::Stream<mshadow::cpu> *s,
+                                 const std::vector<mxnet::TBlob> &inputs,
+                                 const int k, const OpReqType req) {
+  DequantizeSparseKernelLaunch(s, inputs, k, req);
 }
 }  // namespace kvstore
 }  // namespace mxnet
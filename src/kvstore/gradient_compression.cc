@@ -23,6 +23,8 @@
  * \author Rahul Huilgol
  */
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "kvstore_local.h"
 #include "gradient_compression.h"
@@ -41,9 +43,14 @@ void GradientCompression::SetParams(const std::vector<std::pair<std::string, std
                                     & kwargs) {
   GradientCompressionParam params;
   params.InitAllowUnknown(kwargs);
-  CHECK_GT(params.threshold, 0) << "threshold must be greater than 0";
   if (params.type == "2bit") {
+    CHECK_GT(params.threshold, 0) << "threshold must be greater than 0";
     SetTwoBitCompression(params.threshold);
+  } else if (params.type == "1bit") {
+    SetOneBitCompression();
+  } else if (params.type == "topk" || params.type == "randomk") {
+    CHECK(params.ratio > 0 && params.ratio <= 0.5) << "ratio must be in (0, 0.5]";
+    SetSparseCompression(params.ratio, params.type == "randomk");
   } else {
     LOG(FATAL) << "Unknown type for gradient compression " << params.type;
   }
@@ -62,11 +69,29 @@ void GradientCompression::SetTwoBitCompression(const float threshold) {
   threshold_ = threshold;
 }
 
+void GradientCompression::SetOneBitCompression() {
+  type_ = CompressionType::kOneBit;
+}
+
+void GradientCompression::SetSparseCompression(const float ratio, const bool random) {
+  type_ = random ? CompressionType::kRandomK : CompressionType::kTopK;
+  ratio_ = ratio;
+}
+
+/*!
+ * \brief number of values sent per block by sparse compression
+ */
+static int SparseBlockK(const float ratio) {
+  return std::max(1, static_cast<int>(std::round(ratio * kSparseBlockSize)));
+}
+
 std::string GradientCompression::EncodeParams() {
   using namespace std;  // to reduce length of next line
   string rval = get_type_str();
   if (type_ == CompressionType::kTwoBit) {
     rval += "," + to_string(threshold_);
+  } else if (type_ == CompressionType::kTopK || type_ == CompressionType::kRandomK) {
+    rval += ",," + to_string(ratio_);
   }
   return rval;
 }
@@ -80,22 +105,100 @@ void GradientCompression::DecodeParams(const std::string &s) {
       threshold_ = stof(elems[1]);
     }
   }
+  if (elems.size() > 2) {
+    if (!elems[2].empty()) {
+      ratio_ = stof(elems[2]);
+    }
+  }
 }
 
 int GradientCompression::GetCompressionFactor() {
-  if (type_ == CompressionType::kTwoBit) {
-    return 16;
-  } else {
-    LOG(FATAL) << "Unsupported compression type: " << get_type_str();
-    return 0;
+  return GetOriginalBlockSize() / GetCompressedBlockSize();
+}
+
+int GradientCompression::GetOriginalBlockSize() {
+  switch (type_) {
+    case CompressionType::kTwoBit:
+      return 16;
+    case CompressionType::kOneBit:
+      return kOneBitBlockSize;
+    case CompressionType::kTopK:
+    case CompressionType::kRandomK:
+      return kSparseBlockSize;
+    default:
+      LOG(FATAL) << "Unsupported compression type: " << get_type_str();
+      return 0;
+  }
+}
+
+int GradientCompression::GetCompressedBlockSize() {
+  switch (type_) {
+    case CompressionType::kTwoBit:
+      return 1;
+    case CompressionType::kOneBit:
+      return kOneBitCompressedBlockSize;
+    case CompressionType::kTopK:
+    case CompressionType::kRandomK:
+      // an index and a value for each picked value
+      return 2 * SparseBlockK(ratio_);
+    default:
+      LOG(FATAL) << "Unsupported compression type: " << get_type_str();
+      return 0;
   }
 }
 
 int64_t GradientCompression::GetCompressedSize(const int64_t original_size) {
-  const int bits = GetCompressionFactor();
-  return ((original_size % bits == 0) ?
-          original_size / bits :
-          original_size / bits + 1);
+  const int block = GetOriginalBlockSize();
+  const int64_t num_blocks = (original_size % block == 0) ?
+                             original_size / block :
+                             original_size / block + 1;
+  return num_blocks * GetCompressedBlockSize();
+}
+
+/*!
+ * \brief quantizes inputs = {from, residual, to} with the given type of compression
+ */
+template<typename xpu>
+static void QuantizeImpl(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                         const CompressionType type, const float threshold, const int k,
+                         const uint32_t seed) {
+  switch (type) {
+    case CompressionType::kTwoBit:
+      Quantize2BitImpl(s, inputs, threshold);
+      break;
+    case CompressionType::kOneBit:
+      Quantize1BitImpl(s, inputs);
+      break;
+    case CompressionType::kTopK:
+    case CompressionType::kRandomK:
+      QuantizeSparseImpl(s, inputs, k, type == CompressionType::kRandomK, seed);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported quantization of type " << static_cast<int>(type);
+  }
+}
+
+/*!
+ * \brief dequantizes inputs = {from, to} with the given type of compression
+ */
+template<typename xpu>
+static void DequantizeImpl(mshadow::Stream<xpu> *s, const std::vector<mxnet::TBlob> &inputs,
+                           const CompressionType type, const float threshold, const int k,
+                           const OpReqType req) {
+  switch (type) {
+    case CompressionType::kTwoBit:
+      Dequantize2BitImpl(s, inputs, threshold, req);
+      break;
+    case CompressionType::kOneBit:
+      Dequantize1BitImpl(s, inputs, req);
+      break;
+    case CompressionType::kTopK:
+    case CompressionType::kRandomK:
+      DequantizeSparseImpl(s, inputs, k, req);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported dequantization of type " << static_cast<int>(type);
+  }
 }
 
 void GradientCompression::Quantize(const mxnet::NDArray &from, mxnet::NDArray *to,
@@ -105,69 +208,75 @@ void GradientCompression::Quantize(const mxnet::NDArray &from, mxnet::NDArray *t
   CHECK(shape_is_known(residual->shape())) << "residual operand has undefined shape";
   const int a = from.ctx().dev_mask();
   const int b = to->ctx().dev_mask();
+  const CompressionType type = type_;
   const float threshold = threshold_;
-  if (type_ == CompressionType::kTwoBit) {
-    if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
-      mxnet::Engine::Get()->PushSync([from, to, residual, threshold](mxnet::RunContext ctx) {
+  const int k = SparseBlockK(ratio_);
+  const uint32_t seed = seed_++;
+  if (type_ == CompressionType::kNone) {
+    LOG(FATAL) << "Unsupported quantization of type " << get_type_str();
+  }
+  if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
+    mxnet::Engine::Get()->PushSync([from, to, residual, type, threshold, k, seed]
+                                   (mxnet::RunContext ctx) {
+      std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
+      QuantizeImpl(ctx.get_stream<mshadow::cpu>(), inputs, type, threshold, k, seed);
+    }, from.ctx(), {from.var()}, {to->var(), residual->var()},
+    mxnet::FnProperty::kNormal, priority, "QuantizeCPU");
+  } else {
+#if MXNET_USE_CUDA
+    if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
+      mxnet::Engine::Get()->PushSync([from, to, residual, type, threshold, k, seed]
+                                     (mxnet::RunContext ctx) {
         std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
-        Quantize2BitImpl(ctx.get_stream<mshadow::cpu>(), inputs, threshold);
+        QuantizeImpl(ctx.get_stream<mshadow::gpu>(), inputs, type, threshold, k, seed);
+        // Wait GPU kernel to complete
+        ctx.get_stream<mshadow::gpu>()->Wait();
       }, from.ctx(), {from.var()}, {to->var(), residual->var()},
-      mxnet::FnProperty::kNormal, priority, "QuantizeCPU");
+      mxnet::FnProperty::kNormal, priority, "QuantizeGPU");
     } else {
-#if MXNET_USE_CUDA
-      if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
-        mxnet::Engine::Get()->PushSync([from, to, residual, threshold](mxnet::RunContext ctx) {
-          std::vector<mxnet::TBlob> inputs = {from.data(), residual->data(), to->data()};
-          Quantize2BitImpl(ctx.get_stream<mshadow::gpu>(), inputs, threshold);
-          // Wait GPU kernel to complete
-          ctx.get_stream<mshadow::gpu>()->Wait();
-        }, from.ctx(), {from.var()}, {to->var(), residual->var()},
-        mxnet::FnProperty::kNormal, priority, "QuantizeGPU");
-      } else {
-        LOG(FATAL) << "unknown device mask";
-      }
+      LOG(FATAL) << "unknown device mask";
+    }
 #else
     LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
 #endif
-    }
-  } else {
-    LOG(FATAL) << "Unsupported quantization of type " << get_type_str();
   }
 }
 
 void GradientCompression::Dequantize(const mxnet::NDArray &from, mxnet::NDArray *to,
-                                     const int priority) {
+                                     const int priority, const bool accumulate) {
   CHECK(shape_is_known(from.shape())) << "source operand has undefined shape";
   CHECK(shape_is_known(to->shape())) << "destination operand has undefined shape";
   const int a = from.ctx().dev_mask();
   const int b = to->ctx().dev_mask();
+  const CompressionType type = type_;
   const float threshold = threshold_;
-  if (type_ == CompressionType::kTwoBit) {
-    if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
-      mxnet::Engine::Get()->PushSync([from, to, threshold](mxnet::RunContext ctx) {
+  const int k = SparseBlockK(ratio_);
+  const OpReqType req = accumulate ? kAddTo : kWriteTo;
+  if (type_ == CompressionType::kNone) {
+    LOG(FATAL) << "Unsupported dequantization of type " << get_type_str();
+  }
+  if (a == mshadow::cpu::kDevMask && b == mshadow::cpu::kDevMask) {
+    mxnet::Engine::Get()->PushSync([from, to, type, threshold, k, req](mxnet::RunContext ctx) {
+      std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
+      DequantizeImpl(ctx.get_stream<mshadow::cpu>(), inputs, type, threshold, k, req);
+    }, from.ctx(), {from.var()}, {to->var()},
+    mxnet::FnProperty::kNormal, priority, "DequantizeCPU");
+  } else {
+#if MXNET_USE_CUDA
+    if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
+      mxnet::Engine::Get()->PushSync([from, to, type, threshold, k, req](mxnet::RunContext ctx) {
         std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
-        Dequantize2BitImpl(ctx.get_stream<mshadow::cpu>(), inputs, threshold);
+        DequantizeImpl(ctx.get_stream<mshadow::gpu>(), inputs, type, threshold, k, req);
+        // Wait GPU kernel to complete
+        ctx.get_stream<mshadow::gpu>()->Wait();
       }, from.ctx(), {from.var()}, {to->var()},
-      mxnet::FnProperty::kNormal, priority, "DequantizeCPU");
+      mxnet::FnProperty::kNormal, priority, "DequantizeGPU");
     } else {
-#if MXNET_USE_CUDA
-      if (a == mshadow::gpu::kDevMask && b == mshadow::gpu::kDevMask) {
-        mxnet::Engine::Get()->PushSync([from, to, threshold](mxnet::RunContext ctx) {
-          std::vector<mxnet::TBlob> inputs = {from.data(), to->data()};
-          Dequantize2BitImpl(ctx.get_stream<mshadow::gpu>(), inputs, threshold);
-          // Wait GPU kernel to complete
-          ctx.get_stream<mshadow::gpu>()->Wait();
-        }, from.ctx(), {from.var()}, {to->var()},
-        mxnet::FnProperty::kNormal, priority, "DequantizeGPU");
-      } else {
-        LOG(FATAL) << "unknown device mask";
-      }
+      LOG(FATAL) << "unknown device mask";
+    }
 #else
-      LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
+    LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
 #endif
-    }
-  } else {
-    LOG(FATAL) << "Unsupported dequantization of type " << get_type_str();
   }
 }
 
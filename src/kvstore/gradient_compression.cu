@@ -33,8 +33,27 @@ void Quantize2BitImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
 }
 
 void Dequantize2BitImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
-                        const float threshold) {
-  Dequantize2BitKernelLaunch(s, inputs, threshold);
+                        const float threshold, const OpReqType req) {
+  Dequantize2BitKernelLaunch(s, inputs, threshold, req);
+}
+
+void Quantize1BitImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs) {
+  Quantize1BitKernelLaunch(s, inputs);
+}
+
+void Dequantize1BitImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
+                        const OpReqType req) {
+  Dequantize1BitKernelLaunch(s, inputs, req);
+}
+
+void QuantizeSparseImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
+                        const int k, const bool random, const uint32_t seed) {
+  QuantizeSparseKernelLaunch(s, inputs, k, random, seed);
+}
+
+void DequantizeSparseImpl(mshadow::Stream<gpu>* s, const std::vector<TBlob>& inputs,
+                          const int k, const OpReqType req) {
+  DequantizeSparseKernelLaunch(s, inputs, k, req);
 }
 }  // namespace kvstore
 }  // namespace mxnet
@@ -35,17 +35,21 @@ namespace mxnet {
 namespace kvstore {
 
 enum class CompressionType {
-  kNone, kTwoBit
+  kNone, kTwoBit, kOneBit, kTopK, kRandomK
 };
 
 struct GradientCompressionParam : public dmlc::Parameter<GradientCompressionParam> {
   std::string type;
   float threshold;
+  float ratio;
   DMLC_DECLARE_PARAMETER(GradientCompressionParam) {
     DMLC_DECLARE_FIELD(type)
-      .describe("Type of gradient compression to use, like `2bit` for example");
+      .describe("Type of gradient compression to use, one of `2bit`, `1bit`, `topk` "
+                "and `randomk`");
     DMLC_DECLARE_FIELD(threshold).set_default(0.5)
       .describe("Threshold to use for 2bit gradient compression");
+    DMLC_DECLARE_FIELD(ratio).set_default(0.01)
+      .describe("Fraction of the values sent by topk and randomk gradient compression");
   }
 };
 
@@ -78,6 +82,19 @@ class GradientCompression {
    */
   void SetTwoBitCompression(const float threshold);
 
+  /*!
+   * \brief sets one bit gradient compression, which sends the sign of each value
+   * and one scale per block of values
+   */
+  void SetOneBitCompression();
+
+  /*!
+   * \brief sets sparse gradient compression, which sends index and value pairs
+   * \param ratio fraction of the values of each block to send
+   * \param random whether to pick the values at random instead of the largest ones
+   */
+  void SetSparseCompression(const float ratio, const bool random);
+
   /*!
    * \brief encodes parameters of gc into a string
    */
@@ -94,6 +111,17 @@ class GradientCompression {
    */
   int GetCompressionFactor();
 
+  /*!
+   * \brief returns the number of original values which are compressed together.
+   * Arrays split across servers are split at multiples of this size
+   */
+  int GetOriginalBlockSize();
+
+  /*!
+   * \brief returns the number of float values a block of original values compresses to
+   */
+  int GetCompressedBlockSize();
+
   /*!
    * \brief returns the size of compressed gradients given an original sized gradient array
    */
@@ -117,8 +145,10 @@ class GradientCompression {
   * \param from the ndarray containing quantized data
   * \param to the target ndarray which contains final dequantized data
   * \param priority Priority of the action.
+  * \param accumulate whether to add the dequantized data to `to` instead of overwriting it
   */
-  void Dequantize(const mxnet::NDArray &from, mxnet::NDArray *to, const int priority);
+  void Dequantize(const mxnet::NDArray &from, mxnet::NDArray *to, const int priority,
+                  const bool accumulate = false);
 
  private:
   /*!
@@ -132,6 +162,16 @@ class GradientCompression {
    * all negative gradients will be thresholded to -1*`threshold_`
    */
   float threshold_ = 0;
+
+  /*!
+   * \brief denotes the fraction of values sent by sparse compression
+   */
+  float ratio_ = 0;
+
+  /*!
+   * \brief seed of the positions picked by randomk compression, changed on every quantize
+   */
+  uint32_t seed_ = 0;
 };
 }  // namespace kvstore
 }  // namespace mxnet
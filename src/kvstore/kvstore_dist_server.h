@@ -34,6 +34,7 @@
 #include <memory>
 #include <functional>
 #include <future>
+#include <thread>
 #include <vector>
 #include "../profiler/profiler.h"
 #include "../operator/tensor/elemwise_binary_op-inl.h"
@@ -134,6 +135,16 @@ class Executor {
     fut.wait();
   }
 
+  /**
+   * \brief let the thread called \ref Start exec a function without waiting for it. threadsafe
+   */
+  void Push(const Func& func) {
+    Block blk(func);
+    std::lock_guard<std::mutex> lk(mu_);
+    queue_.push(std::move(blk));
+    cond_.notify_one();
+  }
+
   /**
    * \brief stop the thread, threadsafe
    */
@@ -164,10 +175,20 @@ class KVStoreDistServer {
     sync_mode_ = false;
     gradient_compression_ = std::make_shared<GradientCompression>();
     log_verbose_ = dmlc::GetEnv("MXNET_KVSTORE_DIST_ROW_SPARSE_VERBOSE", false);
+    const int num_shards = dmlc::GetEnv("MXNET_KVSTORE_SERVER_UPDATE_THREADS", 1);
+    if (num_shards > 1) {
+      for (int i = 0; i < num_shards; ++i) {
+        shards_.emplace_back(new UpdateShard(i, &shard_domain_));
+      }
+    }
   }
 
   ~KVStoreDistServer() {
     profiler::Profiler::Get()->SetState(profiler::Profiler::ProfilerState(0));
+    for (auto& shard : shards_) {
+      shard->exec.Stop();
+      shard->thread.join();
+    }
     delete ps_server_;
   }
 
@@ -196,8 +217,35 @@ class KVStoreDistServer {
     NDArray temp_array;
   };
 
+  /**
+   * \brief handles the requests of a range of keys on its own thread
+   */
+  struct UpdateShard {
+    UpdateShard(int id, profiler::ProfileDomain* domain)
+      : queue_depth(("shard" + std::to_string(id) + ":queue_depth").c_str(), domain),
+        thread([this]() { exec.Start(); }) {}
+    Executor exec;
+    /*! \brief number of requests queued or running, recorded while the server is profiled */
+    profiler::ProfileCounter queue_depth;
+    std::thread thread;
+  };
+
+  /**
+   * \brief waits until every request handed to the update shards has been handled
+   */
+  void WaitShards() {
+    for (auto& shard : shards_) {
+      shard->exec.Exec([]() {});
+    }
+  }
+
   void CommandHandle(const ps::SimpleData& recved, ps::SimpleApp* app) {
     CommandType recved_type = static_cast<CommandType>(recved.head);
+    // commands change state used by the request handlers, except profiler commands,
+    // which also must not wait behind a backlog of updates
+    if (recved_type != CommandType::kSetProfilerParams) {
+      WaitShards();
+    }
     switch (recved_type) {
       case CommandType::kStopServer:
         exec_.Stop();
@@ -326,6 +374,26 @@ class KVStoreDistServer {
                     const ps::KVPairs<char>& req_data,
                     ps::KVServer<char>* server) {
     DataHandleType type = DepairDataHandleType(req_meta.cmd);
+    if (shards_.empty()) {
+      DataHandle(type, req_meta, req_data, server);
+      return;
+    }
+    // compressed pushes lead with a meta key holding the original size
+    const bool has_meta_key = type.requestType == RequestType::kCompressedPushPull &&
+                              req_meta.push;
+    const int key = DecodeKey(req_data.keys[has_meta_key ? 1 : 0]);
+    UpdateShard* shard = shards_[key % shards_.size()].get();
+    ++shard->queue_depth;
+    shard->exec.Push([this, type, req_meta, req_data, server, shard]() {
+      DataHandle(type, req_meta, req_data, server);
+      --shard->queue_depth;
+    });
+  }
+
+  void DataHandle(const DataHandleType type,
+                  const ps::KVMeta& req_meta,
+                  const ps::KVPairs<char>& req_data,
+                  ps::KVServer<char>* server) {
     switch (type.requestType) {
       case RequestType::kRowSparsePushPull:
         DataHandleRowSparse(type, req_meta, req_data, server);
@@ -339,6 +407,28 @@ class KVStoreDistServer {
     }
   }
 
+  /**
+   * \brief runs the updater. The update shards only merge, decompress and copy in
+   * parallel, the updater always runs on the main thread
+   */
+  inline void RunUpdater(const int key, const NDArray& recved, NDArray* stored) {
+    // let the main thread to execute updater_, which is necessary for python
+    exec_.Exec([this, key, &recved, stored]() {
+      CHECK(updater_);
+      updater_(key, recved, stored);
+    });
+  }
+
+  /**
+   * \brief returns the entry of a key in one of the per-key maps. The maps are shared by
+   * all update shards, but an entry is only used by the shard which owns its key
+   */
+  template<typename T>
+  inline T& KeyEntry(std::unordered_map<int, T>* map, const int key) {
+    std::lock_guard<std::mutex> lk(map_mu_);
+    return (*map)[key];
+  }
+
   inline bool has_multi_precision_copy(const DataHandleType type) {
     return multi_precision_ && type.dtype != mshadow::kFloat32;
   }
@@ -347,14 +437,11 @@ class KVStoreDistServer {
                            const ps::KVPairs<char>& req_data, UpdateBuf *update_buf,
                            ps::KVServer<char>* server) {
     if (!sync_mode_ || update_buf->request.size() == (size_t) ps::NumWorkers()) {
-      // let the main thread to execute updater_, which is necessary for python
-      auto& stored = has_multi_precision_copy(type) ? store_realt_[key] : store_[key];
+      auto& stored = has_multi_precision_copy(type) ? KeyEntry(&store_realt_, key)
+                                                  : KeyEntry(&store_, key);
       auto& update =  sync_mode_ ? update_buf->merged : update_buf->temp_array;
       if (updater_) {
-        exec_.Exec([this, key, &update, &stored](){
-          CHECK(updater_);
-          updater_(key, update, &stored);
-        });
+        RunUpdater(key, update, &stored);
       } else {
         CHECK(sync_mode_) << "Updater needs to be set for async mode";
         // if no updater, just copy
@@ -375,7 +462,7 @@ class KVStoreDistServer {
       }
       if (has_pull) {
         // if there is a pull request, perform WaitToRead() once before DefaultStorageResponse
-        if (has_multi_precision_copy(type)) CopyFromTo(stored, store_[key]);
+        if (has_multi_precision_copy(type)) CopyFromTo(stored, KeyEntry(&store_, key));
         stored.WaitToRead();
         for (const auto& req : update_buf->request) {
           if (req.pull) {
@@ -389,7 +476,7 @@ class KVStoreDistServer {
           server->Response(req);
         }
         update_buf->request.clear();
-        if (has_multi_precision_copy(type)) CopyFromTo(stored, store_[key]);
+        if (has_multi_precision_copy(type)) CopyFromTo(stored, KeyEntry(&store_, key));
         stored.WaitToRead();
       }
     } else {
@@ -442,7 +529,7 @@ class KVStoreDistServer {
       server->Response(req_meta, response);
       return;
     }
-    const NDArray& stored = store_[master_key];
+    const NDArray& stored = KeyEntry(&store_, master_key);
     if (has_multi_precision_copy(type)) stored.WaitToRead();
     CHECK(!stored.is_none()) << "init " << master_key << " first";
     auto shape = stored.shape();
@@ -476,7 +563,8 @@ class KVStoreDistServer {
                            const ps::KVMeta& req_meta,
                            const ps::KVPairs<char>& req_data,
                            ps::KVServer<char>* server) {
-    auto& stored = has_multi_precision_copy(type) ? store_realt_[master_key] : store_[master_key];
+    auto& stored = has_multi_precision_copy(type) ? KeyEntry(&store_realt_, master_key)
+                                                  : KeyEntry(&store_, master_key);
     int dtype = type.dtype;
     int num_bytes = mshadow::mshadow_sizeof(dtype);
     auto unit_len = req_data.lens[1] / num_bytes;
@@ -492,7 +580,8 @@ class KVStoreDistServer {
     stored = NDArray(kRowSparseStorage, dshape, Context(), true,
                      has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
     if (has_multi_precision_copy(type)) {
-      store_[master_key] = NDArray(kRowSparseStorage, dshape, Context(), true, type.dtype);
+      KeyEntry(&store_, master_key) = NDArray(kRowSparseStorage, dshape, Context(), true,
+                                              type.dtype);
     }
     Engine::Get()->PushAsync(
     [this, recved, stored, type](RunContext ctx, Engine::CallbackOnComplete on_complete) {
@@ -512,8 +601,8 @@ class KVStoreDistServer {
     }, recved.ctx(), {recved.var()}, {stored.var()},
     FnProperty::kNormal, 0, PROFILER_MESSAGE_FUNCNAME);
     if (has_multi_precision_copy(type)) {
-      CopyFromTo(stored, store_[master_key]);
-      store_[master_key].WaitToRead();
+      CopyFromTo(stored, KeyEntry(&store_, master_key));
+      KeyEntry(&store_, master_key).WaitToRead();
     }
     stored.WaitToRead();
     server->Response(req_meta);
@@ -524,7 +613,7 @@ class KVStoreDistServer {
                            ps::KVServer<char>* server) {
     int master_key = DecodeKey(req_data.keys[0]);
     auto num_rows = req_data.keys.size() - 1;
-    auto& stored = store_[master_key];
+    auto& stored = KeyEntry(&store_, master_key);
     if (req_meta.push) {
       CHECK_GT(req_data.lens.size(), 0) << "req_data.lens cannot be empty";
       CHECK_EQ(req_data.lens[0], 0);
@@ -536,7 +625,7 @@ class KVStoreDistServer {
         return;
       } else {
         if (log_verbose_) LOG(INFO) << "push: " << master_key << " " << req_data.keys;
-        auto& updates = update_buf_[master_key];
+        auto& updates = KeyEntry(&update_buf_, master_key);
         if (sync_mode_ && updates.merged.is_none()) {
           updates.merged = NDArray(kRowSparseStorage, stored.shape(), Context(), true,
                                    has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
@@ -608,7 +697,7 @@ class KVStoreDistServer {
                               const ps::KVPairs<char> &req_data,
                               ps::KVServer<char>* server) {
     ps::KVPairs<char> response;
-    const NDArray& stored = store_[key];
+    const NDArray& stored = KeyEntry(&store_, key);
     CHECK(!stored.is_none()) << "init " << key << " first";
 
     // as server returns when store_realt is ready in this case
@@ -640,14 +729,14 @@ class KVStoreDistServer {
 
       int original_size = DecodeKey(req_data.keys[0]);
       int key = DecodeKey(req_data.keys[1]);
-      auto& stored = store_[key];
+      auto& stored = KeyEntry(&store_, key);
 
       size_t ds[] = {(size_t)req_data.lens[1] / mshadow::mshadow_sizeof(type.dtype)};
       mxnet::TShape dshape(ds, ds + 1);
       TBlob recv_blob(reinterpret_cast<real_t*>(req_data.vals.data()), dshape, cpu::kDevMask);
       NDArray recved = NDArray(recv_blob, 0);
 
-      NDArray decomp_buf = decomp_buf_[key];
+      NDArray decomp_buf = KeyEntry(&decomp_buf_, key);
       dshape = mxnet::TShape{(int64_t) original_size};
 
       if (decomp_buf.is_none()) {
@@ -661,25 +750,20 @@ class KVStoreDistServer {
         stored.WaitToRead();
       } else if (sync_mode_) {
         // synced push
-        auto& merged = update_buf_[key];
+        auto& merged = KeyEntry(&update_buf_, key);
         if (merged.merged.is_none()) {
           merged.merged = NDArray(dshape, Context());
         }
-        if (merged.request.size() == 0) {
-          gradient_compression_->Dequantize(recved, &merged.merged, 0);
-        } else {
-          gradient_compression_->Dequantize(recved, &decomp_buf, 0);
-          merged.merged += decomp_buf;
-        }
+        // later pushes are dequantized straight into the merge buffer,
+        // topk and randomk only touch the positions that were sent
+        gradient_compression_->Dequantize(recved, &merged.merged, 0,
+                                          merged.request.size() != 0);
         merged.request.push_back(req_meta);
         ApplyUpdates(type, key, req_data, &merged, server);
       } else {
         // async push
         gradient_compression_->Dequantize(recved, &decomp_buf, 0);
-        exec_.Exec([this, key, &decomp_buf, &stored]() {
-          CHECK(updater_);
-          updater_(key, decomp_buf, &stored);
-        });
+        RunUpdater(key, decomp_buf, &stored);
         server->Response(req_meta);
         stored.WaitToRead();
       }
@@ -701,7 +785,8 @@ class KVStoreDistServer {
       CHECK_EQ(req_data.vals.size(), (size_t)req_data.lens[0]);
     }
     int key = DecodeKey(req_data.keys[0]);
-    auto& stored = has_multi_precision_copy(type) ? store_realt_[key] : store_[key];
+    auto& stored = has_multi_precision_copy(type) ? KeyEntry(&store_realt_, key)
+                                                  : KeyEntry(&store_, key);
     // there used several WaitToRead, this is because \a recved's memory
     // could be deallocated when this function returns. so we need to make sure
     // the operators with \a NDArray are actually finished
@@ -720,14 +805,14 @@ class KVStoreDistServer {
         CopyFromTo(recved, &stored, 0);
         server->Response(req_meta);
         if (has_multi_precision_copy(type)) {
-          auto& stored_dtype = store_[key];
+          auto& stored_dtype = KeyEntry(&store_, key);
           stored_dtype = NDArray(dshape, Context(), false, type.dtype);
           CopyFromTo(stored, stored_dtype);
           stored_dtype.WaitToRead();
         }
         stored.WaitToRead();
       } else {
-        auto &updates = update_buf_[key];
+        auto &updates = KeyEntry(&update_buf_, key);
         if (sync_mode_ && updates.merged.is_none()) {
           updates.merged = NDArray(dshape, Context(), false,
                                    has_multi_precision_copy(type) ? mshadow::kFloat32 : type.dtype);
@@ -797,6 +882,20 @@ class KVStoreDistServer {
   Executor exec_;
   ps::KVServer<char>* ps_server_;
 
+  /**
+   * \brief guards insertion into the per-key maps above when there are update shards
+   */
+  std::mutex map_mu_;
+  /**
+   * \brief profiler domain of the shard queue depth counters
+   */
+  profiler::ProfileDomain shard_domain_{"KVStoreServer"};
+  /**
+   * \brief update shards, key k is handled by shard k % shards_.size().
+   * Empty when requests are handled on the ps-lite thread, which is the default
+   */
+  std::vector<std::unique_ptr<UpdateShard>> shards_;
+
   // whether to LOG verbose information
   bool log_verbose_;
 
@@ -33,6 +33,9 @@
 #include <utility>
 #include <functional>
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <sstream>
 #include "./comm.h"
 #include "./comm_tree.h"
 #include "./kvstore_utils.h"
@@ -84,6 +87,13 @@ class KVStoreLocal : public KVStore {
     }
     pinned_ctx_ = comm_->pinned_ctx();
     gradient_compression_ = std::make_shared<GradientCompression>();
+    fusion_bucket_bytes_ = dmlc::GetEnv("MXNET_KVSTORE_FUSION_BUCKET_BYTES", 0);
+    // the tree comm allocates its merge buffers on the first reduce only, so it
+    // cannot take the keys of buckets planned later
+    if (fusion_bucket_bytes_ > 0 && dynamic_cast<CommDeviceTree*>(comm_) != nullptr) {
+      LOG(WARNING) << "MXNET_KVSTORE_FUSION_BUCKET_BYTES is ignored with MXNET_KVSTORE_USETREE";
+      fusion_bucket_bytes_ = 0;
+    }
   }
 
   virtual ~KVStoreLocal() {
@@ -338,10 +348,219 @@ class KVStoreLocal : public KVStore {
                             const std::vector<NDArray>& values,
                             const std::vector<NDArray*>& outs,
                             int priority) {
+    if (fusion_bucket_bytes_ > 0 && updater_ == nullptr && vkeys == okeys &&
+        gradient_compression_->get_type() == CompressionType::kNone) {
+      FusedPushPullImpl(vkeys, values, outs, priority);
+      return;
+    }
     PushImpl(vkeys, values, priority);
     PullImpl(okeys, outs, priority, true);
   }
 
+  /**
+   * \brief a group of keys which are reduced and broadcast as one array
+   */
+  struct FusionBucket {
+    /// key of the fused array in comm_
+    int fusion_key;
+    /// keys in the bucket, in the order they are laid out in the fused array
+    std::vector<int> keys;
+    /// offset of each key in the fused array, in elements
+    std::vector<size_t> offsets;
+    /// fused array on each context of the bucket
+    std::vector<NDArray> bufs;
+  };
+
+  /**
+   * \brief pushpull which packs small dense gradients into fusion buckets of
+   * at most MXNET_KVSTORE_FUSION_BUCKET_BYTES, so that each bucket is reduced and
+   * broadcast as a single array. Keys are visited in descending order, which is the
+   * order the backward pass produces them in, so the first bucket can be
+   * communicated while later gradients are still being computed.
+   */
+  void FusedPushPullImpl(const std::vector<int>& keys,
+                         const std::vector<NDArray>& values,
+                         const std::vector<NDArray*>& outs,
+                         int priority) {
+    std::map<int, std::pair<std::vector<NDArray>, std::vector<NDArray*>>,
+             std::greater<int>> groups;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      groups[keys[i]].first.push_back(values[i]);
+      groups[keys[i]].second.push_back(outs[i]);
+    }
+    std::vector<int> rest_keys, fused_keys;
+    std::vector<NDArray> rest_vals;
+    std::vector<NDArray*> rest_outs;
+    std::ostringstream signature;
+    for (const auto& kv : groups) {
+      const std::vector<NDArray>& vals = kv.second.first;
+      if (CanFuse(kv.first, vals, kv.second.second)) {
+        fused_keys.push_back(kv.first);
+        signature << kv.first << ':';
+        for (const auto& v : vals) signature << v.ctx() << ',';
+        signature << ';';
+      } else {
+        for (size_t j = 0; j < vals.size(); ++j) {
+          rest_keys.push_back(kv.first);
+          rest_vals.push_back(vals[j]);
+          rest_outs.push_back(kv.second.second[j]);
+        }
+      }
+    }
+    if (!fused_keys.empty()) {
+      std::vector<FusionBucket>& plan = fusion_plans_[signature.str()];
+      if (plan.empty()) CreateFusionPlan(fused_keys, groups, &plan);
+      for (auto& bucket : plan) {
+        const size_t num_ctx = bucket.bufs.size();
+        for (size_t j = 0; j < num_ctx; ++j) {
+          std::vector<NDArray> src, dst;
+          for (size_t k = 0; k < bucket.keys.size(); ++k) {
+            const NDArray& grad = groups[bucket.keys[k]].first[j];
+            src.push_back(grad);
+            dst.push_back(FusionView(bucket.bufs[j], bucket.offsets[k], grad.shape()));
+          }
+          FusionCopy(src, dst, priority, "KVStoreFusionPack");
+        }
+        const NDArray& merged = comm_->Reduce(bucket.fusion_key, bucket.bufs, priority);
+        std::vector<NDArray*> bufs(num_ctx);
+        for (size_t j = 0; j < num_ctx; ++j) bufs[j] = &bucket.bufs[j];
+        comm_->Broadcast(bucket.fusion_key, merged, bufs, priority);
+        for (size_t j = 0; j < num_ctx; ++j) {
+          std::vector<NDArray> src, dst;
+          for (size_t k = 0; k < bucket.keys.size(); ++k) {
+            const NDArray& out = *groups[bucket.keys[k]].second[j];
+            src.push_back(FusionView(bucket.bufs[j], bucket.offsets[k], out.shape()));
+            dst.push_back(out);
+          }
+          FusionCopy(src, dst, priority, "KVStoreFusionUnpack");
+        }
+        // the stored value of each key is a view of the reduced array, the
+        // same aliasing PushImpl has with the merge buffer of comm_
+        for (size_t k = 0; k < bucket.keys.size(); ++k) {
+          NDArray& local = local_[bucket.keys[k]];
+          local = FusionView(merged, bucket.offsets[k], local.shape());
+        }
+      }
+    }
+    if (!rest_keys.empty()) {
+      PushImpl(rest_keys, rest_vals, priority);
+      PullImpl(rest_keys, rest_outs, priority, true);
+    }
+  }
+
+  /**
+   * \brief whether the values and outputs of a key can go into a fusion bucket
+   */
+  bool CanFuse(int key, const std::vector<NDArray>& vals,
+               const std::vector<NDArray*>& outs) {
+    auto it = local_.find(key);
+    if (it == local_.end() || it->second.storage_type() != kDefaultStorage) return false;
+    if (vals.size() < 2 || vals.size() != outs.size()) return false;
+    const NDArray& local = it->second;
+    const size_t bytes = local.shape().Size() * mshadow::mshadow_sizeof(local.dtype());
+    if (bytes > fusion_bucket_bytes_) return false;
+    for (size_t j = 0; j < vals.size(); ++j) {
+      for (const NDArray* nd : {&vals[j], static_cast<const NDArray*>(outs[j])}) {
+        if (nd->storage_type() != kDefaultStorage || nd->dtype() != local.dtype() ||
+            nd->shape() != local.shape()) {
+          return false;
+        }
+      }
+      if (outs[j]->ctx() != vals[j].ctx()) return false;
+    }
+    return true;
+  }
+
+  /**
+   * \brief split fusable keys into buckets and allocate their fused arrays.
+   * Consecutive keys share a bucket while they have the same dtype and contexts
+   * and the bucket stays within fusion_bucket_bytes_.
+   */
+  template<typename Groups>
+  void CreateFusionPlan(const std::vector<int>& keys, const Groups& groups,
+                        std::vector<FusionBucket>* plan) {
+    std::vector<Context> ctxs;
+    int dtype = -1;
+    size_t size = 0;
+    auto finish = [&]() {
+      if (size == 0) return;
+      FusionBucket& bucket = plan->back();
+      bucket.fusion_key = next_fusion_key_++;
+      for (const auto& ctx : ctxs) {
+        bucket.bufs.emplace_back(mshadow::Shape1(size), ctx, false, dtype);
+      }
+      comm_->Init(bucket.fusion_key, kDefaultStorage, mshadow::Shape1(size), dtype);
+      size = 0;
+    };
+    for (int key : keys) {
+      const std::vector<NDArray>& vals = groups.at(key).first;
+      std::vector<Context> key_ctxs;
+      for (const auto& v : vals) key_ctxs.push_back(v.ctx());
+      const size_t n = vals[0].shape().Size();
+      const size_t elem_bytes = mshadow::mshadow_sizeof(vals[0].dtype());
+      if (size > 0 && (vals[0].dtype() != dtype || key_ctxs != ctxs ||
+                       (size + n) * elem_bytes > fusion_bucket_bytes_)) {
+        finish();
+      }
+      if (size == 0) {
+        plan->emplace_back();
+        ctxs = key_ctxs;
+        dtype = vals[0].dtype();
+      }
+      plan->back().keys.push_back(key);
+      plan->back().offsets.push_back(size);
+      size += n;
+    }
+    finish();
+  }
+
+  /**
+   * \brief view of n = shape.Size() elements of a fused array starting at offset
+   */
+  static NDArray FusionView(const NDArray& buf, size_t offset, const mxnet::TShape& shape) {
+    return buf.Slice(offset, offset + shape.Size()).Reshape(shape);
+  }
+
+  /**
+   * \brief copy each array of from into the matching array of to as one engine
+   * operation. All arrays must be dense and on the same context.
+   */
+  void FusionCopy(const std::vector<NDArray>& from, const std::vector<NDArray>& to,
+                  int priority, const char* opr_name) {
+    const Context ctx = to[0].ctx();
+    std::vector<Engine::VarHandle> const_vars, mutable_vars;
+    for (const auto& nd : from) const_vars.push_back(nd.var());
+    for (const auto& nd : to) mutable_vars.push_back(nd.var());
+    auto dedup = [](std::vector<Engine::VarHandle>* vars) {
+      std::sort(vars->begin(), vars->end());
+      vars->erase(std::unique(vars->begin(), vars->end()), vars->end());
+    };
+    dedup(&const_vars);
+    dedup(&mutable_vars);
+    Engine::Get()->PushSync([from, to, ctx](RunContext rctx) {
+        for (size_t i = 0; i < from.size(); ++i) {
+          TBlob dst = to[i].data();
+          switch (ctx.dev_mask()) {
+            case cpu::kDevMask:
+              ndarray::Copy<cpu, cpu>(from[i].data(), &dst, ctx, ctx, rctx);
+              break;
+#if MXNET_USE_CUDA
+            case gpu::kDevMask:
+              ndarray::Copy<gpu, gpu>(from[i].data(), &dst, ctx, ctx, rctx);
+              break;
+#endif
+            default:
+              LOG(FATAL) << MXNET_GPU_NOT_ENABLED_ERROR;
+          }
+        }
+#if MXNET_USE_CUDA
+        if (ctx.dev_mask() == gpu::kDevMask) {
+          rctx.get_stream<gpu>()->Wait();
+        }
+#endif
+      }, ctx, const_vars, mutable_vars, FnProperty::kNormal, priority, opr_name);
+  }
+
   /**
    * \brief group values on keys for push
    */
@@ -527,6 +746,12 @@ class KVStoreLocal : public KVStore {
   std::unordered_set<int> warnings_printed_;
   /// whether int or string is used for keys
   KeyType key_type_ = kUndefinedKey;
+  /// size limit of a fusion bucket in bytes, 0 disables fusion
+  size_t fusion_bucket_bytes_ = 0;
+  /// fusion buckets of each pushpull signature (keys and contexts)
+  std::unordered_map<std::string, std::vector<FusionBucket>> fusion_plans_;
+  /// the next key for a fused array, kept clear of user keys
+  int next_fusion_key_ = std::numeric_limits<int>::min();
 };
 }  // namespace kvstore
 }  // namespace mxnet
@@ -32,6 +32,7 @@
 #include <mxnet/ndarray.h>
 #include <mxnet/resource.h>
 
+#include "../common/mapped_file.h"
 #include "../common/utils.h"
 #include "../operator/nn/mkldnn/mkldnn_base-inl.h"
 #include "../operator/tensor/init_op.h"
@@ -2026,16 +2027,227 @@ void NDArray::Save(dmlc::Stream* fo,
   fo->Write(names);
 }
 
+/*
+ * Aligned list format. The metadata of all arrays comes first, followed by
+ * the raw data of each array at a file offset aligned to kNDArrayListAlignment,
+ * so a mapped file can back CPU NDArrays directly.
+ *
+ *   uint64_t magic, alignment, metadata size, number of arrays
+ *   per array: int32_t stype, [int32_t type_flag, TShape shape, Context ctx,
+ *              uint64_t offset, uint64_t nbytes] for non-none arrays
+ *   std::vector<std::string> names
+ *   padding, then the data of each array at its offset
+ */
+const uint64_t kMXAPINDArrayListAlignedMagic = 0x113;
+static const uint64_t kNDArrayListAlignment = 64;
+
+namespace {
+// metadata of one array in the aligned list format
+struct AlignedNDArrayEntry {
+  int32_t stype = kUndefinedStorage;
+  int32_t type_flag = mshadow::kFloat32;
+  mxnet::TShape shape;
+  Context ctx;
+  uint64_t offset = 0;
+  uint64_t nbytes = 0;
+
+  void Save(dmlc::Stream* strm) const {
+    strm->Write(stype);
+    if (stype == kUndefinedStorage) return;
+    strm->Write(type_flag);
+    shape.Save(strm);
+    ctx.Save(strm);
+    strm->Write(offset);
+    strm->Write(nbytes);
+  }
+  bool Load(dmlc::Stream* strm) {
+    if (!strm->Read(&stype)) return false;
+    if (stype == kUndefinedStorage) return true;
+    if (stype != kDefaultStorage) return false;
+    return strm->Read(&type_flag) && shape.Load(strm) && ctx.Load(strm) &&
+           strm->Read(&offset) && strm->Read(&nbytes) &&
+           nbytes == shape.Size() * mshadow::mshadow_sizeof(type_flag);
+  }
+};
+
+inline uint64_t RoundUpToAlignment(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+void SaveAlignedMeta(dmlc::Stream* strm,
+                     uint64_t meta_size,
+                     const std::vector<AlignedNDArrayEntry>& entries,
+                     const std::vector<std::string>& names) {
+  strm->Write(kMXAPINDArrayListAlignedMagic);
+  strm->Write(kNDArrayListAlignment);
+  strm->Write(meta_size);
+  strm->Write(static_cast<uint64_t>(entries.size()));
+  for (const auto& entry : entries) entry.Save(strm);
+  strm->Write(names);
+}
+
+// load the metadata that follows the magic number and alignment
+void LoadAlignedMeta(dmlc::Stream* strm,
+                     uint64_t* meta_size,
+                     std::vector<AlignedNDArrayEntry>* entries,
+                     std::vector<std::string>* names) {
+  uint64_t num_arrays;
+  CHECK(strm->Read(meta_size)) << "Invalid NDArray file format";
+  CHECK(strm->Read(&num_arrays)) << "Invalid NDArray file format";
+  entries->resize(num_arrays);
+  for (auto& entry : *entries) {
+    CHECK(entry.Load(strm)) << "Invalid NDArray file format";
+  }
+  CHECK(strm->Read(names)) << "Invalid NDArray file format";
+  CHECK(names->size() == 0 || names->size() == entries->size())
+      << "Invalid NDArray file format";
+}
+
+// move a loaded CPU array to the context it was saved from, as NDArray::Load does
+NDArray ToSavedContext(NDArray&& temp, const Context& ctx) {
+#if MXNET_USE_CUDA
+  if (ctx.dev_mask() != cpu::kDevMask) {
+    int device_count = -1;
+    cudaGetDeviceCount(&device_count);
+    if (device_count > 0) return temp.Copy(ctx);
+  }
+#endif
+  return std::move(temp);
+}
+
+// load the arrays of an aligned list from a stream, copying the data
+void LoadAligned(dmlc::Stream* fi, std::vector<NDArray>* data, std::vector<std::string>* keys) {
+  uint64_t meta_size;
+  std::vector<AlignedNDArrayEntry> entries;
+  LoadAlignedMeta(fi, &meta_size, &entries, keys);
+  uint64_t pos = meta_size;
+  std::vector<char> padding;
+  data->clear();
+  data->reserve(entries.size());
+  for (const auto& entry : entries) {
+    if (entry.stype == kUndefinedStorage) {
+      data->emplace_back();
+      continue;
+    }
+    CHECK_GE(entry.offset, pos) << "Invalid NDArray file format";
+    padding.resize(entry.offset - pos);
+    CHECK_EQ(fi->Read(padding.data(), padding.size()), padding.size())
+        << "Invalid NDArray file format";
+    NDArray temp(entry.shape, Context::CPU(), false, entry.type_flag);
+    CHECK_EQ(fi->Read(temp.data().dptr_, entry.nbytes), entry.nbytes)
+        << "Invalid NDArray file format";
+    pos = entry.offset + entry.nbytes;
+    data->push_back(ToSavedContext(std::move(temp), entry.ctx));
+  }
+}
+}  // namespace
+
 void NDArray::Load(dmlc::Stream* fi, std::vector<NDArray>* data, std::vector<std::string>* keys) {
   uint64_t header, reserved;
   CHECK(fi->Read(&header)) << "Invalid NDArray file format";
   CHECK(fi->Read(&reserved)) << "Invalid NDArray file format";
+  if (header == kMXAPINDArrayListAlignedMagic) {
+    LoadAligned(fi, data, keys);
+    return;
+  }
   CHECK(header == kMXAPINDArrayListMagic) << "Invalid NDArray file format";
   CHECK(fi->Read(data)) << "Invalid NDArray file format";
   CHECK(fi->Read(keys)) << "Invalid NDArray file format";
   CHECK(keys->size() == 0 || keys->size() == data->size()) << "Invalid NDArray file format";
 }
 
+void NDArray::SaveAligned(dmlc::Stream* fo,
+                          const std::vector<NDArray>& data,
+                          const std::vector<std::string>& names) {
+  std::vector<AlignedNDArrayEntry> entries(data.size());
+  std::vector<TBlob> blobs(data.size());
+  std::vector<NDArray> nd_cpu(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i].is_none()) continue;
+    CHECK_EQ(data[i].storage_type(), kDefaultStorage)
+        << "Only arrays of default storage type can be saved in the aligned format";
+    auto& entry = entries[i];
+    entry.stype = kDefaultStorage;
+    entry.ctx = data[i].ctx();
+    if (entry.ctx.dev_mask() != cpu::kDevMask) {
+      nd_cpu[i] = data[i].Copy(Context::CPU());
+    } else {
+      nd_cpu[i] = data[i];
+#if MXNET_USE_MKLDNN == 1
+      if (nd_cpu[i].IsMKLDNNData()) nd_cpu[i] = nd_cpu[i].Reorder2Default();
+#endif
+    }
+    nd_cpu[i].WaitToRead();
+    blobs[i] = nd_cpu[i].data();
+    CHECK(blobs[i].CheckContiguous());
+    entry.type_flag = blobs[i].type_flag_;
+    entry.shape = blobs[i].shape_;
+    entry.nbytes = blobs[i].Size() * mshadow::mshadow_sizeof(entry.type_flag);
+  }
+  // the metadata has a fixed size, so measure it first and then fill in the offsets
+  std::string meta;
+  {
+    dmlc::MemoryStringStream strm(&meta);
+    SaveAlignedMeta(&strm, 0, entries, names);
+  }
+  const uint64_t meta_size = meta.size();
+  uint64_t offset = RoundUpToAlignment(meta_size, kNDArrayListAlignment);
+  for (auto& entry : entries) {
+    if (entry.stype == kUndefinedStorage) continue;
+    entry.offset = offset;
+    offset = RoundUpToAlignment(offset + entry.nbytes, kNDArrayListAlignment);
+  }
+  meta.clear();
+  {
+    dmlc::MemoryStringStream strm(&meta);
+    SaveAlignedMeta(&strm, meta_size, entries, names);
+  }
+  CHECK_EQ(meta.size(), meta_size);
+  fo->Write(meta.data(), meta.size());
+
+  const std::vector<char> padding(kNDArrayListAlignment, 0);
+  uint64_t pos = meta_size;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i].stype == kUndefinedStorage) continue;
+    fo->Write(padding.data(), entries[i].offset - pos);
+    fo->Write(blobs[i].dptr_, entries[i].nbytes);
+    pos = entries[i].offset + entries[i].nbytes;
+  }
+}
+
+bool NDArray::LoadMapped(const std::string& fname,
+                         std::vector<NDArray>* data,
+                         std::vector<std::string>* keys) {
+  // Private writable mapping: an in-place update copies only the page it touches.
+  std::shared_ptr<common::MappedFile> file = common::MappedFile::Open(fname);
+  uint64_t header = 0;
+  if (!file || file->size() < sizeof(header)) return false;
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (header != kMXAPINDArrayListAlignedMagic) return false;
+
+  char* base = file->data();
+  dmlc::MemoryFixedSizeStream strm(base, file->size());
+  uint64_t alignment, meta_size;
+  std::vector<AlignedNDArrayEntry> entries;
+  CHECK(strm.Read(&header) && strm.Read(&alignment)) << "Invalid NDArray file format";
+  LoadAlignedMeta(&strm, &meta_size, &entries, keys);
+  data->clear();
+  data->reserve(entries.size());
+  for (const auto& entry : entries) {
+    if (entry.stype == kUndefinedStorage) {
+      data->emplace_back();
+      continue;
+    }
+    CHECK(entry.offset >= meta_size && entry.offset + entry.nbytes <= file->size())
+        << "Invalid NDArray file format";
+    TBlob blob(static_cast<void*>(base + entry.offset), entry.shape,
+               cpu::kDevMask, entry.type_flag);
+    NDArray temp(blob, 0, [file]() {});
+    data->push_back(ToSavedContext(std::move(temp), entry.ctx));
+  }
+  return true;
+}
+
 NDArray NDArray::Copy(Context ctx) const {
   NDArray ret;
   if (kDefaultStorage == storage_type()) {
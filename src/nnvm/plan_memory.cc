@@ -27,7 +27,12 @@
 #include <nnvm/graph_attr_types.h>
 #include <nnvm/op_attr_types.h>
 #include <mxnet/base.h>
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_map>
 #include "graph_algorithm.h"
 #include "../operator/operator_common.h"
 
@@ -61,6 +66,18 @@ static int MXGetDTypeSize(int type_flag) {
   }
 }
 
+// lifetime of a storage entry in node order, and its size.
+struct StorageInterval {
+  // the device id of the storage.
+  int device_id;
+  // node which allocates the storage.
+  uint32_t begin;
+  // node which releases the storage, the storage can be reused after it.
+  uint32_t end;
+  // size of the storage in bytes.
+  size_t bytes;
+};
+
 // simple graph based allocator.
 class MXGraphAllocator {
  public:
@@ -80,7 +97,7 @@ class MXGraphAllocator {
     // search memory block in [size / match_range_, size * match_range_)
     // TODO(tqchen) add size of the dtype, assume 4 bytes for now
     size_t size = shape.Size() * 4;
-    if (match_range_ == 0) return this->Alloc(dev_id, size);
+    if (match_range_ == 0) return this->Alloc(dev_id, size, node_id);
     auto begin = free_.lower_bound(size / match_range_);
     auto mid = free_.lower_bound(size);
     auto end = free_.upper_bound(size * match_range_);
@@ -110,7 +127,7 @@ class MXGraphAllocator {
       return e->id;
     }
     // cannot find anything return a new one.
-    return this->Alloc(dev_id, size);
+    return this->Alloc(dev_id, size, node_id);
   }
   // release a memory space.
   void Release(StorageID id, uint32_t node_id) {
@@ -118,9 +135,21 @@ class MXGraphAllocator {
     if (id == kExternalStorageID || id == kDynamicStorageID) return;
     StorageEntry *e = data_[id].get();
     e->released_by_node = node_id;
+    e->released = true;
     free_.insert({e->max_bytes, e});
   }
 
+  // lifetime of each storage entry, entries which are never released live until
+  // end_node. Only meaningful with match_range 0, where no entry is reused.
+  std::vector<StorageInterval> Intervals(uint32_t end_node) const {
+    std::vector<StorageInterval> ret;
+    for (auto &p : data_) {
+      ret.push_back({p->device_id, p->alloc_node,
+                     p->released ? p->released_by_node : end_node, p->max_bytes});
+    }
+    return ret;
+  }
+
   // totoal number of bytes allocated
   size_t TotalAllocBytes() const {
     size_t total = 0;
@@ -151,12 +180,13 @@ class MXGraphAllocator {
     }
   }
 
-  StorageID Alloc(int dev_id, size_t size) {
+  StorageID Alloc(int dev_id, size_t size, uint32_t node_id) {
     StorageID id = static_cast<StorageID>(data_.size());
     std::unique_ptr<StorageEntry> ptr(new StorageEntry());
     ptr->id = id;
     ptr->device_id = dev_id;
     ptr->max_bytes = size;
+    ptr->alloc_node = node_id;
     data_.emplace_back(std::move(ptr));
     return id;
   }
@@ -170,6 +200,10 @@ class MXGraphAllocator {
     size_t max_bytes{0};
     // node index that released it last time
     uint32_t released_by_node{0};
+    // node index that allocated it
+    uint32_t alloc_node{0};
+    // whether it has been released
+    bool released{false};
   };
   // scale used for rough match
   size_t match_range_;
@@ -325,6 +359,130 @@ size_t MXAllocMemory(const Graph& ret, const IndexedGraph& idx,
   return num_not_allocated;
 }
 
+// size in bytes of each storage id of a plan, from the entries it holds.
+std::vector<size_t> MXStorageBytes(const StorageVector& storage,
+                                   const mxnet::ShapeVector& shape_vec,
+                                   const DTypeVector& dtype_vec) {
+  std::vector<size_t> bytes;
+  for (size_t eid = 0; eid < storage.size(); ++eid) {
+    if (storage[eid] < 0 || !ndim_is_known(shape_vec[eid])) continue;
+    size_t sid = static_cast<size_t>(storage[eid]);
+    if (sid >= bytes.size()) bytes.resize(sid + 1, 0);
+    bytes[sid] = std::max(bytes[sid],
+                          shape_vec[eid].Size() * MXGetDTypeSize(dtype_vec[eid]));
+  }
+  return bytes;
+}
+
+// whether [begin, end] overlaps one of the disjoint intervals in used.
+bool MXOverlaps(const std::map<uint32_t, uint32_t>& used, uint32_t begin, uint32_t end) {
+  auto it = used.upper_bound(end);
+  if (it == used.begin()) return false;
+  --it;
+  return it->second >= begin;
+}
+
+/*
+ * Greedy by size: visit the tensors from the largest to the smallest and put each
+ * one into the smallest shared object whose tensors do not live at the same time.
+ * Returns the shared object of each tensor, object_bytes gets their sizes.
+ * */
+std::vector<int> MXPlanGreedyBySize(const std::vector<StorageInterval>& tensors,
+                                    std::vector<size_t>* object_bytes) {
+  std::vector<size_t> order(tensors.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&tensors](size_t a, size_t b) {
+    return tensors[a].bytes > tensors[b].bytes;
+  });
+  std::vector<int> assignment(tensors.size(), -1);
+  std::vector<int> object_device;
+  std::vector<std::map<uint32_t, uint32_t> > object_used;
+  for (size_t t : order) {
+    const StorageInterval& tensor = tensors[t];
+    int best = -1;
+    for (size_t o = 0; o < object_used.size(); ++o) {
+      if (object_device[o] != tensor.device_id) continue;
+      if (MXOverlaps(object_used[o], tensor.begin, tensor.end)) continue;
+      // objects only get smaller tensors, so every candidate is large enough
+      if (best < 0 || (*object_bytes)[o] < (*object_bytes)[best]) best = static_cast<int>(o);
+    }
+    if (best < 0) {
+      best = static_cast<int>(object_used.size());
+      object_device.push_back(tensor.device_id);
+      object_used.emplace_back();
+      object_bytes->push_back(tensor.bytes);
+    }
+    object_used[best][tensor.begin] = tensor.end;
+    assignment[t] = best;
+  }
+  return assignment;
+}
+
+/*
+ * Interval coloring: visit the tensors by the node which allocates them and give
+ * each one a shared object freed before that node, the best fit by size, growing the
+ * largest free object if none is large enough. This uses the minimal number of
+ * objects, which is the largest number of tensors alive at the same node.
+ * */
+std::vector<int> MXPlanIntervalColoring(const std::vector<StorageInterval>& tensors,
+                                        std::vector<size_t>* object_bytes) {
+  std::vector<size_t> order(tensors.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&tensors](size_t a, size_t b) {
+    if (tensors[a].begin != tensors[b].begin) return tensors[a].begin < tensors[b].begin;
+    return tensors[a].bytes > tensors[b].bytes;
+  });
+  std::vector<int> assignment(tensors.size(), -1);
+  // objects in use, by the node that releases them
+  std::multimap<uint32_t, int> active;
+  // free objects of each device, by size
+  std::unordered_map<int, std::multimap<size_t, int> > free_objects;
+  std::vector<int> object_device;
+  for (size_t t : order) {
+    const StorageInterval& tensor = tensors[t];
+    while (!active.empty() && active.begin()->first < tensor.begin) {
+      int o = active.begin()->second;
+      free_objects[object_device[o]].insert({(*object_bytes)[o], o});
+      active.erase(active.begin());
+    }
+    auto& pool = free_objects[tensor.device_id];
+    auto it = pool.lower_bound(tensor.bytes);
+    if (it == pool.end() && !pool.empty()) --it;
+    int obj;
+    if (it != pool.end()) {
+      obj = it->second;
+      pool.erase(it);
+      (*object_bytes)[obj] = std::max((*object_bytes)[obj], tensor.bytes);
+    } else {
+      obj = static_cast<int>(object_bytes->size());
+      object_bytes->push_back(tensor.bytes);
+      object_device.push_back(tensor.device_id);
+    }
+    active.insert({tensor.end, obj});
+    assignment[t] = obj;
+  }
+  return assignment;
+}
+
+// the largest total size of tensors alive at the same node, summed over devices.
+// No plan which keeps every tensor contiguous can use less memory.
+size_t MXLowerBoundBytes(const std::vector<StorageInterval>& tensors) {
+  std::map<int, std::map<uint32_t, int64_t> > delta;
+  for (const auto& t : tensors) {
+    delta[t.device_id][t.begin] += static_cast<int64_t>(t.bytes);
+    delta[t.device_id][t.end + 1] -= static_cast<int64_t>(t.bytes);
+  }
+  size_t total = 0;
+  for (const auto& dev : delta) {
+    int64_t live = 0, peak = 0;
+    for (const auto& kv : dev.second) {
+      live += kv.second;
+      peak = std::max(peak, live);
+    }
+    total += static_cast<size_t>(peak);
+  }
+  return total;
+}
 
 // function to plan memory
 Graph MXPlanMemory(Graph ret) {
@@ -369,6 +527,63 @@ Graph MXPlanMemory(Graph ret) {
     storage.resize(idx.num_node_entries(), -1);
   }
 
+  // the planner is chosen by the executor, see MXNET_MEMORY_PLANNER
+  std::string planner = "default";
+  if (ret.attrs.count("mem_planner") != 0) {
+    planner = ret.GetAttr<std::string>("mem_planner");
+  }
+  CHECK(planner == "default" || planner == "greedy_by_size" ||
+        planner == "interval_coloring" || planner == "auto")
+      << "Unknown memory planner " << planner << ", expected one of default, "
+      << "greedy_by_size, interval_coloring and auto";
+  const mxnet::ShapeVector& shape_vec = ret.GetAttr<mxnet::ShapeVector>("shape");
+  const DTypeVector& dtype_vec = ret.GetAttr<DTypeVector>("dtype");
+
+  // Offline planning: allocate every tensor on its own to learn all lifetimes, then
+  // pack the tensors into shared storage with one of the strategies
+  StorageVector offline_storage;
+  std::vector<int> offline_inplace_index;
+  size_t offline_bytes = 0, offline_num_not_allocated = 0;
+  if (planner != "default") {
+    offline_storage = storage;
+    offline_inplace_index.resize(idx.num_node_entries(), -1);
+    MXGraphAllocator allocator(&idx, 0);
+    offline_num_not_allocated =
+      MXAllocMemory(ret, idx, node_range, &offline_storage, &offline_inplace_index,
+                    ref_count, &allocator);
+    std::vector<StorageInterval> tensors = allocator.Intervals(node_range.second);
+    std::vector<size_t> tensor_bytes = MXStorageBytes(offline_storage, shape_vec, dtype_vec);
+    for (size_t i = 0; i < tensors.size(); ++i) {
+      tensors[i].bytes = i < tensor_bytes.size() ? tensor_bytes[i] : 0;
+    }
+    std::vector<int> assignment;
+    for (const char* strategy : {"greedy_by_size", "interval_coloring"}) {
+      if (planner != "auto" && planner != strategy) continue;
+      std::vector<size_t> bytes;
+      std::vector<int> plan = std::string(strategy) == "greedy_by_size" ?
+          MXPlanGreedyBySize(tensors, &bytes) : MXPlanIntervalColoring(tensors, &bytes);
+      size_t total = std::accumulate(bytes.begin(), bytes.end(), size_t(0));
+      if (assignment.empty() || total < offline_bytes) {
+        assignment = std::move(plan);
+        offline_bytes = total;
+      }
+    }
+    for (auto& sid : offline_storage) {
+      if (sid >= 0) sid = assignment[sid];
+    }
+    ret.attrs["storage_lower_bound_bytes"] = std::make_shared<any>(MXLowerBoundBytes(tensors));
+  }
+  auto use_offline_plan = [&]() {
+    ret.attrs["storage_id"] = std::make_shared<any>(std::move(offline_storage));
+    ret.attrs["storage_inplace_index"] = std::make_shared<any>(std::move(offline_inplace_index));
+    ret.attrs["storage_allocated_bytes"] = std::make_shared<any>(offline_bytes);
+    ret.attrs["storage_num_not_allocated"] = std::make_shared<any>(offline_num_not_allocated);
+  };
+  if (planner == "greedy_by_size" || planner == "interval_coloring") {
+    use_offline_plan();
+    return ret;
+  }
+
   // Search the best NNVM_EXEC_MATCH_RANGE parameter. This is turned off by default
   size_t min_allocated_bytes = -1;
   size_t max_match_range = dmlc::GetEnv("NNVM_EXEC_MATCH_RANGE", 16);
@@ -401,6 +616,15 @@ Graph MXPlanMemory(Graph ret) {
       break;
     }
   }
+  if (planner == "auto") {
+    // compare with the same byte count as the offline plans, the allocator above
+    // assumes 4 bytes per element
+    std::vector<size_t> bytes = MXStorageBytes(ret.GetAttr<StorageVector>("storage_id"),
+                                               shape_vec, dtype_vec);
+    if (offline_bytes < std::accumulate(bytes.begin(), bytes.end(), size_t(0))) {
+      use_offline_plan();
+    }
+  }
   return ret;
 }
 
@@ -43,6 +43,25 @@ struct InterleavedMatMulParam : public dmlc::Parameter<InterleavedMatMulParam> {
   }
 };
 
+struct InterleavedSelfAttFusedParam : public dmlc::Parameter<InterleavedSelfAttFusedParam> {
+  int heads;
+  bool causal;
+  bool use_cache;
+  int cache_offset;
+  DMLC_DECLARE_PARAMETER(InterleavedSelfAttFusedParam) {
+    DMLC_DECLARE_FIELD(heads)
+    .describe("Set number of heads");
+    DMLC_DECLARE_FIELD(causal).set_default(false)
+    .describe("Only attend to keys at the same or an earlier position than the query.");
+    DMLC_DECLARE_FIELD(use_cache).set_default(false)
+    .describe("Append the new keys and values to key_value_cache and attend over "
+              "all the steps in the cache.");
+    DMLC_DECLARE_FIELD(cache_offset).set_default(0).set_lower_bound(0)
+    .describe("Number of steps already in key_value_cache. The new keys and values "
+              "are written from this step on.");
+  }
+};
+
 template<typename xpu>
 static void DivSqrtDimForward_(const nnvm::NodeAttrs& attrs,
                   const OpContext& ctx,
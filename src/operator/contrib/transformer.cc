@@ -23,6 +23,9 @@
  * \brief CPU implementation of the operators used in Transformer
  */
 #include <mxnet/base.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "./transformer-inl.h"
 #include "../tensor/elemwise_unary_op.h"
 
@@ -30,6 +33,7 @@ namespace mxnet {
 namespace op {
 
 DMLC_REGISTER_PARAMETER(InterleavedMatMulParam);
+DMLC_REGISTER_PARAMETER(InterleavedSelfAttFusedParam);
 
 static bool InterleavedMatMulSelfAttQKShape(const NodeAttrs& attrs,
                                             mxnet::ShapeVector* in_shape,
@@ -122,6 +126,40 @@ static bool InterleavedMatMulEncDecValAttShape(const NodeAttrs& attrs,
   return true;
 }
 
+static bool InterleavedSelfAttFusedShape(const NodeAttrs& attrs,
+                                         mxnet::ShapeVector* in_shape,
+                                         mxnet::ShapeVector* out_shape) {
+  const auto& params = nnvm::get<InterleavedSelfAttFusedParam>(attrs.parsed);
+  CHECK_EQ(in_shape->size(), params.use_cache ? 2U : 1U)
+    << "Input:[queries_keys_values, key_value_cache] currently have, "
+    << in_shape->size() << " inputs";
+  auto qkv_shape = in_shape->at(0);
+  CHECK_EQ(qkv_shape.ndim(), 3U)
+    << "Input queries_keys_values should be 3D in seq_length-batch-3*proj_dim, "
+    << "currently is: " << qkv_shape.ndim() << "D";
+  CHECK_EQ(qkv_shape[2] % (3 * params.heads), 0)
+    << "queries_keys_values.shape[2] should be a multiple of 3 * heads, "
+    << "currently is " << qkv_shape[2];
+  if (params.use_cache && mxnet::ndim_is_known(in_shape->at(1))) {
+    auto cache_shape = in_shape->at(1);
+    CHECK_EQ(cache_shape.ndim(), 3U)
+      << "Input key_value_cache should be 3D in max_seq_length-batch-2*proj_dim, "
+      << "currently is: " << cache_shape.ndim() << "D";
+    CHECK_EQ(cache_shape[1], qkv_shape[1])
+      << "key_value_cache.shape[1] should be equal to queries_keys_values.shape[1], "
+      << "currently are: " << cache_shape[1] << " and " << qkv_shape[1];
+    CHECK_EQ(cache_shape[2] * 3, qkv_shape[2] * 2)
+      << "key_value_cache.shape[2] should be 2/3 of queries_keys_values.shape[2], "
+      << "currently are: " << cache_shape[2] << " and " << qkv_shape[2];
+    CHECK_LE(params.cache_offset + qkv_shape[0], cache_shape[0])
+      << "key_value_cache is too short for " << qkv_shape[0] << " more steps after step "
+      << params.cache_offset;
+  }
+  SHAPE_ASSIGN_CHECK(*out_shape, 0,
+    mxnet::TShape({qkv_shape[0], qkv_shape[1], qkv_shape[2] / 3}));
+  return true;
+}
+
 void strided_batch_sgemm(bool transA, bool transB,
                          index_t m, index_t n, index_t k,
                          float alpha, const float *a, index_t lda,
@@ -647,6 +685,151 @@ void BackwardInterleavedMatMulEncDecValAttCPU(const nnvm::NodeAttrs& attrs,
   }
 }
 
+// block sizes of the fused attention, the scores of one block stay in cache
+static const index_t kFusedAttQueryBlock = 32;
+static const index_t kFusedAttKeyBlock = 128;
+
+void InterleavedSelfAttFusedCPU(const nnvm::NodeAttrs& attrs,
+                                const OpContext &ctx,
+                                const std::vector<TBlob> &inputs,
+                                const std::vector<OpReqType> &req,
+                                const std::vector<TBlob> &outputs) {
+  const auto& params = nnvm::get<InterleavedSelfAttFusedParam>(attrs.parsed);
+
+  if (req[0] == kNullOp)
+    return;
+
+  CHECK_EQ(inputs[0].type_flag_, mshadow::kFloat32)
+    << "Only FP32 is supported on CPU at the moment";
+
+  mshadow::Stream<cpu>* s = ctx.get_stream<cpu>();
+  const float* queries_keys_values = inputs[0].dptr<float>();
+  float* output = outputs[0].dptr<float>();
+
+  const index_t q_seq_len      = inputs[0].shape_[0];
+  const index_t sequences      = inputs[0].shape_[1];
+  const index_t output_lin_dim = inputs[0].shape_[2];
+  const index_t embed_dim      = output_lin_dim / 3;
+  const index_t head_dim       = embed_dim / params.heads;
+  const index_t attn_batches   = params.heads * sequences;
+  const index_t qkv_lead_dim   = attn_batches * 3 * head_dim;
+  const index_t out_lead_dim   = attn_batches * head_dim;
+  const float scale            = 1.0 / sqrt(static_cast<float>(head_dim));
+  const int omp_threads        = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+
+  // keys and values are read from the input, or from the cache after the
+  // new steps are appended to it
+  const float* keys = queries_keys_values + head_dim;
+  const float* values = queries_keys_values + 2 * head_dim;
+  index_t kv_lead_dim = qkv_lead_dim;
+  index_t kv_batch_stride = 3 * head_dim;
+  index_t kv_seq_len = q_seq_len;
+  index_t q_offset = 0;
+  if (params.use_cache) {
+    CHECK_EQ(inputs[1].type_flag_, mshadow::kFloat32)
+      << "Only FP32 is supported on CPU at the moment";
+    float* cache = inputs[1].dptr<float>();
+    const index_t cache_lead_dim = attn_batches * 2 * head_dim;
+    q_offset = params.cache_offset;
+    CHECK_LE(q_offset + q_seq_len, inputs[1].shape_[0])
+      << "key_value_cache is too short for " << q_seq_len << " more steps after step "
+      << q_offset;
+    #pragma omp parallel for num_threads(omp_threads)
+    for (index_t t = 0; t < q_seq_len; ++t) {
+      for (index_t b = 0; b < attn_batches; ++b) {
+        // keys and values of a head are adjacent in both layouts
+        std::memcpy(cache + (q_offset + t) * cache_lead_dim + b * 2 * head_dim,
+                    queries_keys_values + t * qkv_lead_dim + b * 3 * head_dim + head_dim,
+                    2 * head_dim * sizeof(float));
+      }
+    }
+    keys = cache;
+    values = cache + head_dim;
+    kv_lead_dim = cache_lead_dim;
+    kv_batch_stride = 2 * head_dim;
+    kv_seq_len = q_offset + q_seq_len;
+  }
+
+  const index_t q_blocks = (q_seq_len + kFusedAttQueryBlock - 1) / kFusedAttQueryBlock;
+  const index_t thread_space = kFusedAttQueryBlock * (kFusedAttKeyBlock + head_dim + 2);
+  mshadow::Tensor<cpu, 1, float> workspace = ctx.requested[0].get_space_typed<cpu, 1, float>(
+      mshadow::Shape1(omp_threads * thread_space), s);
+
+  #pragma omp parallel for num_threads(omp_threads) schedule(dynamic)
+  for (index_t task = 0; task < attn_batches * q_blocks; ++task) {
+    const index_t batch = task / q_blocks;
+    const index_t q_start = (task % q_blocks) * kFusedAttQueryBlock;
+    const index_t rows = std::min(kFusedAttQueryBlock, q_seq_len - q_start);
+    float* scores = workspace.dptr_ + omp_get_thread_num() * thread_space;
+    float* acc = scores + kFusedAttQueryBlock * kFusedAttKeyBlock;
+    float* row_max = acc + kFusedAttQueryBlock * head_dim;
+    float* row_sum = row_max + kFusedAttQueryBlock;
+    const float* q = queries_keys_values + q_start * qkv_lead_dim + batch * 3 * head_dim;
+    const float* k = keys + batch * kv_batch_stride;
+    const float* v = values + batch * kv_batch_stride;
+    std::fill(acc, acc + rows * head_dim, 0.f);
+    std::fill(row_max, row_max + rows, -std::numeric_limits<float>::infinity());
+    std::fill(row_sum, row_sum + rows, 0.f);
+    // keys after the last query of the block are never visible when causal
+    const index_t k_end = params.causal ?
+        std::min(kv_seq_len, q_offset + q_start + rows) : kv_seq_len;
+    for (index_t k_start = 0; k_start < k_end; k_start += kFusedAttKeyBlock) {
+      const index_t cols = std::min(kFusedAttKeyBlock, k_end - k_start);
+      cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
+                  rows, cols, head_dim,
+                  scale, q, qkv_lead_dim,
+                  k + k_start * kv_lead_dim, kv_lead_dim,
+                  0.f, scores, kFusedAttKeyBlock);
+      // online softmax: rescale what was accumulated so far to the new row maximum
+      for (index_t r = 0; r < rows; ++r) {
+        float* score = scores + r * kFusedAttKeyBlock;
+        index_t visible = cols;
+        if (params.causal) {
+          visible = std::max<index_t>(0,
+              std::min(cols, q_offset + q_start + r + 1 - k_start));
+        }
+        std::fill(score + visible, score + cols, 0.f);
+        if (visible == 0) continue;
+        const float block_max = *std::max_element(score, score + visible);
+        const float new_max = std::max(row_max[r], block_max);
+        const float correction = std::exp(row_max[r] - new_max);
+        float sum = 0.f;
+        for (index_t c = 0; c < visible; ++c) {
+          score[c] = std::exp(score[c] - new_max);
+          sum += score[c];
+        }
+        row_sum[r] = row_sum[r] * correction + sum;
+        row_max[r] = new_max;
+        if (correction != 1.f) {
+          float* acc_row = acc + r * head_dim;
+          for (index_t i = 0; i < head_dim; ++i) {
+            acc_row[i] *= correction;
+          }
+        }
+      }
+      cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+                  rows, head_dim, cols,
+                  1.f, scores, kFusedAttKeyBlock,
+                  v + k_start * kv_lead_dim, kv_lead_dim,
+                  1.f, acc, head_dim);
+    }
+    for (index_t r = 0; r < rows; ++r) {
+      const float* acc_row = acc + r * head_dim;
+      float* out = output + (q_start + r) * out_lead_dim + batch * head_dim;
+      const float inv_sum = 1.f / row_sum[r];
+      if (req[0] == kAddTo) {
+        for (index_t i = 0; i < head_dim; ++i) {
+          out[i] += acc_row[i] * inv_sum;
+        }
+      } else {
+        for (index_t i = 0; i < head_dim; ++i) {
+          out[i] = acc_row[i] * inv_sum;
+        }
+      }
+    }
+  }
+}
+
 NNVM_REGISTER_OP(_contrib_interleaved_matmul_selfatt_qk)
 .describe(R"code(Compute the matrix multiplication between the projections of
 queries and keys in multihead attention use as self attention.
@@ -733,6 +916,65 @@ NNVM_REGISTER_OP(_backward_interleaved_matmul_selfatt_valatt)
 .set_attr_parser(ParamParser<InterleavedMatMulParam>)
 .set_attr<FCompute>("FCompute<cpu>", BackwardInterleavedMatMulSelfAttValAttCPU);
 
+NNVM_REGISTER_OP(_contrib_interleaved_selfatt_fused)
+.describe(R"code(Compute multihead self attention in a single pass over blocks of
+queries and keys, without materializing the attention weights.
+
+the input must be a single tensor of interleaved projections
+of queries, keys and values following the layout:
+(seq_length, batch_size, num_heads * head_dim * 3)
+
+and the output follows the layout of interleaved_matmul_selfatt_valatt:
+(seq_length, batch_size, num_heads * head_dim)
+
+the equivalent code would be:
+att = mx.nd.contrib.interleaved_matmul_selfatt_qk(queries_keys_values, heads=num_heads)
+att = mx.nd.softmax(att, axis=-1)
+output = mx.nd.contrib.interleaved_matmul_selfatt_valatt(queries_keys_values, att,
+                                                           heads=num_heads)
+
+With causal=True, a query only attends to the keys at the same or an earlier step.
+
+With use_cache=True, a second input key_value_cache of layout
+(max_seq_length, batch_size, num_heads * head_dim * 2), interleaving keys and
+values like the keys_values input of interleaved_matmul_encdec_qk, is updated in
+place: the keys and values of the new steps are written from step cache_offset on,
+and the queries attend over the first cache_offset + seq_length steps of the cache.
+Decoding one step at a time then only computes the projections of the new step.
+
+This operator is only implemented on CPU, for inference.
+)code" ADD_FILELINE)
+.set_num_inputs([](const NodeAttrs& attrs) {
+  const auto& params = nnvm::get<InterleavedSelfAttFusedParam>(attrs.parsed);
+  return params.use_cache ? 2 : 1;
+})
+.set_num_outputs(1)
+.set_attr_parser(ParamParser<InterleavedSelfAttFusedParam>)
+.set_attr<nnvm::FListInputNames>("FListInputNames", [](const NodeAttrs& attrs) {
+  const auto& params = nnvm::get<InterleavedSelfAttFusedParam>(attrs.parsed);
+  if (params.use_cache) {
+    return std::vector<std::string>{"queries_keys_values", "key_value_cache"};
+  }
+  return std::vector<std::string>{"queries_keys_values"};
+})
+.set_attr<nnvm::FListOutputNames>("FListOutputNames", [](const NodeAttrs& attrs) {
+  return std::vector<std::string>{"output"};
+})
+.set_attr<nnvm::FMutateInputs>("FMutateInputs", [](const nnvm::NodeAttrs& attrs) {
+  const auto& params = nnvm::get<InterleavedSelfAttFusedParam>(attrs.parsed);
+  return params.use_cache ? std::vector<uint32_t>{1} : std::vector<uint32_t>{};
+})
+.set_attr<mxnet::FInferShape>("FInferShape", InterleavedSelfAttFusedShape)
+.set_attr<nnvm::FInferType>("FInferType", ElemwiseType<-1, 1>)
+.set_attr<FResourceRequest>("FResourceRequest", [](const NodeAttrs& attrs) {
+  return std::vector<ResourceRequest>{ResourceRequest::kTempSpace};
+})
+.set_attr<FCompute>("FCompute<cpu>", InterleavedSelfAttFusedCPU)
+.add_argument("queries_keys_values", "NDArray-or-Symbol", "Interleaved queries, keys and values")
+.add_argument("key_value_cache", "NDArray-or-Symbol",
+              "Interleaved keys and values of the previous steps, used if use_cache is true")
+.add_arguments(InterleavedSelfAttFusedParam::__FIELDS__());
+
 NNVM_REGISTER_OP(_contrib_interleaved_matmul_encdec_qk)
 .describe(R"code(Compute the matrix multiplication between the projections of
 queries and keys in multihead attention use as encoder-decoder.
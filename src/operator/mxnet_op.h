@@ -1010,6 +1010,24 @@ struct Kernel<OP, cpu> {
   static void LaunchTuned(mshadow::Stream<cpu> *, const size_t N, Args... args) {
 #ifdef _OPENMP
     const int omp_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+#ifdef MXNET_USE_OPERATOR_TUNING
+    OperatorAutotune *autotune = OperatorAutotune::Get();
+    if (omp_threads >= 2 && autotune->enabled()
+        && OperatorTuneByType<DType>::tuning_mode() == tune::kAuto) {
+      tune::LaunchConfig config;
+      int candidate;
+      OperatorAutotune::Entry *entry = autotune->Select(
+        typeid(OP), mshadow::DataType<DType>::kFlag, N, omp_threads, &config, &candidate);
+      if (candidate < 0) {
+        LaunchWithConfig(config, N, args...);
+      } else {
+        const OperatorTuneBase::Timer timer;
+        LaunchWithConfig(config, N, args...);
+        autotune->Record(entry, candidate, N, timer.duration());
+      }
+      return;
+    }
+#endif  // MXNET_USE_OPERATOR_TUNING
     if (omp_threads < 2 || !tuned_op<PRIMITIVE_OP, DType>::UseOMP(
       N, static_cast<size_t>(omp_threads))) {
       for (size_t i = 0; i < N; ++i) {
@@ -1028,6 +1046,34 @@ struct Kernel<OP, cpu> {
 #endif
   }
 
+#ifdef _OPENMP
+  /*!
+   * \brief Launch a CPU kernel with a configuration chosen by OperatorAutotune
+   * \tparam Args Varargs type to eventually pass to the OP::Map() function
+   * \param config Thread count and schedule to use
+   * \param N Number of iterations
+   * \param args Varargs to eventually pass to the OP::Map() function
+   */
+  template<typename ...Args>
+  static void LaunchWithConfig(const tune::LaunchConfig &config, const size_t N, Args... args) {
+    if (config.threads < 2) {
+      for (size_t i = 0; i < N; ++i) {
+        OP::Map(i, args...);
+      }
+    } else if (config.grain > 0) {
+      #pragma omp parallel for num_threads(config.threads) schedule(dynamic, config.grain)
+      for (index_t i = 0; i < static_cast<index_t>(N); ++i) {
+        OP::Map(i, args...);
+      }
+    } else {
+      #pragma omp parallel for num_threads(config.threads)
+      for (index_t i = 0; i < static_cast<index_t>(N); ++i) {
+        OP::Map(i, args...);
+      }
+    }
+  }
+#endif  // _OPENMP
+
   /*!
    * \brief Launch custom-tuned kernel where each thread is set to
    *        operate on a contiguous partition
@@ -17,7 +17,13 @@
  * under the License.
  */
 #include <float.h>
+#include <dmlc/thread_local.h>
 #include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
 #include "./mxnet_op.h"
 #include "./mshadow_op.h"
 #include "./tensor/init_op.h"
@@ -34,6 +40,180 @@ std::atomic<bool> OperatorTuneBase::calculated_(false);
 bool OperatorTuneBase::verbose_tuning_info_ = false;
 double OperatorTuneBase::tuning_weight_scale_ = 0.0;
 
+/*! \brief Header of the autotuning file, followed by a version and the processor count */
+static const char *kAutotuneFileMagic = "mxnet_operator_autotune";
+/*! \brief Version of the autotuning file format */
+static constexpr int kAutotuneFileVersion = 1;
+/*! \brief Dynamic schedule candidates aim for this many chunks per thread */
+static constexpr size_t kAutotuneChunksPerThread = 8;
+/*! \brief Smallest chunk size tried for a dynamic schedule */
+static constexpr size_t kAutotuneMinGrain = 256;
+
+OperatorAutotune *OperatorAutotune::Get() {
+  static OperatorAutotune inst;
+  return &inst;
+}
+
+OperatorAutotune::OperatorAutotune() {
+  file_ = dmlc::GetEnv("MXNET_OPERATOR_AUTOTUNE_FILE", std::string());
+  trials_ = std::max(1, dmlc::GetEnv("MXNET_OPERATOR_AUTOTUNE_TRIALS", 3));
+  enabled_ = dmlc::GetEnv("MXNET_OPERATOR_AUTOTUNE", !file_.empty());
+  if (enabled_ && !file_.empty()) {
+    Load(file_);
+  }
+}
+
+OperatorAutotune::~OperatorAutotune() {
+  if (enabled_ && dirty_ && !file_.empty()) {
+    Save(file_);
+  }
+}
+
+std::string OperatorAutotune::KernelName(const std::type_info &kernel) {
+  static const char *kHex = "0123456789ABCDEF";
+  std::string name;
+  for (const char *p = kernel.name(); *p; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (std::isspace(c) || c == '%') {
+      name += '%';
+      name += kHex[c >> 4];
+      name += kHex[c & 0xF];
+    } else {
+      name += *p;
+    }
+  }
+  return name;
+}
+
+std::string OperatorAutotune::MakeName(const char *kernel, int dtype, int bucket, int threads) {
+  std::ostringstream os;
+  os << kernel << ' ' << dtype << ' ' << bucket << ' ' << threads;
+  return os.str();
+}
+
+OperatorAutotune::Entry *OperatorAutotune::Select(const std::type_info &kernel, int dtype,
+                                                  size_t N, int max_threads,
+                                                  tune::LaunchConfig *config, int *candidate) {
+  const Key key{kernel.hash_code(), dtype, SizeBucket(N), max_threads};
+  LocalCache *local = dmlc::ThreadLocalStore<LocalCache>::Get();
+  auto local_it = local->entries.find(key);
+  if (local_it != local->entries.end() && local_it->second->done.load(std::memory_order_acquire)) {
+    *config = local_it->second->config;
+    *candidate = -1;
+    return local_it->second;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  Entry *entry = it != entries_.end() ? it->second.get() : AddEntry(key, kernel, max_threads);
+  local->entries[key] = entry;
+  if (entry->done.load(std::memory_order_relaxed)) {
+    *config = entry->config;
+    *candidate = -1;
+  } else {
+    *candidate = static_cast<int>(entry->launched++ % entry->candidates.size());
+    *config = entry->candidates[*candidate];
+  }
+  return entry;
+}
+
+OperatorAutotune::Entry *OperatorAutotune::AddEntry(const Key &key,
+                                                    const std::type_info &kernel,
+                                                    int max_threads) {
+  std::unique_ptr<Entry> entry(new Entry());
+  entry->name = MakeName(KernelName(kernel).c_str(), key.dtype, key.bucket, key.threads);
+  auto it = loaded_.find(entry->name);
+  if (it != loaded_.end()) {
+    entry->config = it->second;
+    entry->done.store(true, std::memory_order_release);
+    loaded_.erase(it);
+  } else {
+    // smallest iteration count of the bucket
+    const size_t n = static_cast<size_t>(1) << key.bucket;
+    entry->candidates.push_back({1, 0});
+    int last_threads = 1;
+    for (int threads : {max_threads / 4, max_threads / 2, max_threads}) {
+      if (threads <= last_threads || static_cast<size_t>(threads) > n) continue;
+      last_threads = threads;
+      entry->candidates.push_back({threads, 0});
+      const size_t grain = n / (static_cast<size_t>(threads) * kAutotuneChunksPerThread);
+      if (grain >= kAutotuneMinGrain) {
+        entry->candidates.push_back({threads, static_cast<int>(grain)});
+      }
+    }
+    entry->best_ns.assign(entry->candidates.size(), std::numeric_limits<double>::max());
+    entry->timed.assign(entry->candidates.size(), 0);
+    // nothing to choose from
+    entry->done.store(entry->candidates.size() == 1, std::memory_order_release);
+  }
+  Entry *ret = entry.get();
+  entries_.emplace(key, std::move(entry));
+  return ret;
+}
+
+void OperatorAutotune::Record(Entry *entry, int candidate, size_t N, int64_t duration_ns) {
+  const double ns = static_cast<double>(duration_ns) / std::max<size_t>(N, 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entry->done.load(std::memory_order_relaxed)) return;
+  entry->best_ns[candidate] = std::min(entry->best_ns[candidate], ns);
+  ++entry->timed[candidate];
+  size_t best = 0;
+  for (size_t i = 0; i < entry->candidates.size(); ++i) {
+    if (entry->timed[i] < trials_) return;
+    if (entry->best_ns[i] < entry->best_ns[best]) best = i;
+  }
+  entry->config = entry->candidates[best];
+  entry->done.store(true, std::memory_order_release);
+  dirty_ = true;
+}
+
+bool OperatorAutotune::Load(const std::string &path) {
+  std::ifstream is(path);
+  if (!is) return false;
+  std::string magic;
+  int version = 0, procs = 0;
+  if (!(is >> magic >> version >> procs) || magic != kAutotuneFileMagic
+      || version != kAutotuneFileVersion) {
+    LOG(WARNING) << "Ignoring operator autotuning file " << path << " with unknown format";
+    return false;
+  }
+  if (procs != omp_get_num_procs()) {
+    LOG(WARNING) << "Ignoring operator autotuning file " << path << " made on a machine with "
+                 << procs << " processors instead of " << omp_get_num_procs();
+    return false;
+  }
+  std::string kernel;
+  int dtype, bucket, threads;
+  tune::LaunchConfig config;
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (is >> kernel >> dtype >> bucket >> threads >> config.threads >> config.grain) {
+    loaded_[MakeName(kernel.c_str(), dtype, bucket, threads)] = config;
+  }
+  return true;
+}
+
+bool OperatorAutotune::Save(const std::string &path) const {
+  // write to a temporary file first so that concurrent readers never see a partial file
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream os(tmp);
+    if (!os) return false;
+    os << kAutotuneFileMagic << ' ' << kAutotuneFileVersion << ' ' << omp_get_num_procs() << '\n';
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &kv : entries_) {
+      const Entry &e = *kv.second;
+      if (e.done.load(std::memory_order_relaxed)) {
+        os << e.name << ' ' << e.config.threads << ' ' << e.config.grain << '\n';
+      }
+    }
+    // keep configurations of keys not seen in this run
+    for (const auto &kv : loaded_) {
+      os << kv.first << ' ' << kv.second.threads << ' ' << kv.second.grain << '\n';
+    }
+    if (!os) return false;
+  }
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
 /*!
  * \brief Instantiate static variables for OperatorTune<DType>, where 'DType' is specified
  */
@@ -25,6 +25,10 @@
 #include <set>
 #include <atomic>
 #include <string>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
 
 // #define MXNET_DEBUG_TUNING_LAUNCH
 
@@ -215,6 +219,154 @@ class OperatorTuneByType : public OperatorTuneBase {
   static volatile tune::TuningMode tuning_mode_;
 };
 
+namespace tune {
+/*!
+ * \brief How a tuned CPU kernel loop is launched
+ */
+struct LaunchConfig {
+  /*! \brief Number of OMP threads, the loop runs serially if less than 2 */
+  int threads;
+  /*! \brief Chunk size for a dynamic OMP schedule, 0 for the default static schedule */
+  int grain;
+};
+}  // namespace tune
+
+/*!
+ * \brief Measured launch configurations for tuned CPU kernels
+ * \remarks IsOMPFaster() estimates OMP vs. serial from one workload number per operator.
+ *          When autotuning is enabled, every (kernel, data type, size bucket, thread count)
+ *          key instead runs each candidate LaunchConfig a few times on real calls, and then
+ *          sticks with the fastest one. The measured configurations can be saved to a file,
+ *          and keys loaded from that file on a later run skip the warm-up altogether.
+ *          Controlled by MXNET_OPERATOR_AUTOTUNE, MXNET_OPERATOR_AUTOTUNE_FILE
+ *          and MXNET_OPERATOR_AUTOTUNE_TRIALS.
+ */
+class OperatorAutotune {
+ public:
+  /*! \brief Tuning state of one key */
+  struct Entry {
+    /*! \brief Candidate configurations */
+    std::vector<tune::LaunchConfig> candidates;
+    /*! \brief Best time seen for each candidate, in nanoseconds per iteration */
+    std::vector<double> best_ns;
+    /*! \brief Number of timings reported for each candidate */
+    std::vector<int> timed;
+    /*! \brief Number of launches handed out while measuring */
+    size_t launched = 0;
+    /*! \brief Whether measuring is over, set with release order once config is final */
+    std::atomic<bool> done{false};
+    /*! \brief Chosen configuration, valid once done */
+    tune::LaunchConfig config{1, 0};
+    /*! \brief Persistent name of the key, see MakeName() */
+    std::string name;
+  };
+
+  /*! \brief Get the process-wide instance */
+  static OperatorAutotune *Get();
+
+  ~OperatorAutotune();
+
+  /*! \brief Whether kernels should go through Select() */
+  inline bool enabled() const {
+    return enabled_;
+  }
+
+  /*!
+   * \brief Choose the configuration for a kernel launch
+   * \param kernel Kernel operator type
+   * \param dtype Data type flag
+   * \param N Number of iterations
+   * \param max_threads Number of OMP threads available
+   * \param config Output configuration to launch with
+   * \param candidate Output candidate index if the launch should be timed and passed
+   *        to Record(), -1 otherwise
+   * \return Tuning entry for the key
+   * \remarks Keys which finished tuning are looked up in a thread local cache without
+   *          taking mutex_, so only launches of keys still being measured serialize.
+   */
+  Entry *Select(const std::type_info &kernel, int dtype, size_t N, int max_threads,
+                tune::LaunchConfig *config, int *candidate);
+
+  /*!
+   * \brief Report the duration of a launch selected for timing
+   * \param entry Entry returned by Select()
+   * \param candidate Candidate index returned by Select()
+   * \param N Number of iterations
+   * \param duration_ns Measured duration in nanoseconds
+   */
+  void Record(Entry *entry, int candidate, size_t N, int64_t duration_ns);
+
+  /*!
+   * \brief Load measured configurations from a file
+   * \return false if the file could not be read or was made on a different machine
+   */
+  bool Load(const std::string &path);
+
+  /*!
+   * \brief Save all measured configurations to a file
+   * \return false if the file could not be written
+   */
+  bool Save(const std::string &path) const;
+
+ private:
+  /*! \brief Runtime key, the type hash is only valid within this process */
+  struct Key {
+    size_t kernel;
+    int dtype;
+    int bucket;
+    int threads;
+    inline bool operator==(const Key &o) const {
+      return kernel == o.kernel && dtype == o.dtype && bucket == o.bucket && threads == o.threads;
+    }
+  };
+  struct KeyHash {
+    inline size_t operator()(const Key &k) const {
+      size_t h = k.kernel;
+      h = h * 31 + static_cast<size_t>(k.dtype);
+      h = h * 31 + static_cast<size_t>(k.bucket);
+      return h * 31 + static_cast<size_t>(k.threads);
+    }
+  };
+  /*! \brief Entries already looked up by a thread, never invalidated as entries live forever */
+  struct LocalCache {
+    std::unordered_map<Key, Entry *, KeyHash> entries;
+  };
+
+  OperatorAutotune();
+
+  /*! \brief Power-of-two bucket of the iteration count */
+  static inline int SizeBucket(size_t N) {
+    int bucket = 0;
+    while (N >>= 1) ++bucket;
+    return bucket;
+  }
+  /*!
+   * \brief File field of a kernel type, its type name with whitespace and '%' percent-encoded
+   * \remarks Type names are compiler-specific and contain spaces on MSVC, while the file is
+   *          whitespace separated. A file from another compiler just matches no kernel.
+   */
+  static std::string KernelName(const std::type_info &kernel);
+  /*! \brief Name of a key, stable across runs of the same build */
+  static std::string MakeName(const char *kernel, int dtype, int bucket, int threads);
+  /*! \brief Create the entry for a key seen for the first time, called with mutex_ held */
+  Entry *AddEntry(const Key &key, const std::type_info &kernel, int max_threads);
+
+  /*! \brief Whether autotuning is on */
+  bool enabled_ = false;
+  /*! \brief Number of timed launches per candidate */
+  int trials_ = 3;
+  /*! \brief File to save to at exit */
+  std::string file_;
+  /*! \brief Whether anything was measured since loading */
+  bool dirty_ = false;
+  /*! \brief Guards entries_, loaded_ and the measurements of entries not done yet */
+  mutable std::mutex mutex_;
+  /*! \brief Entries of keys seen in this process */
+  std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> entries_;
+  /*! \brief Configurations loaded from file, by name, until their key is seen */
+  std::unordered_map<std::string, tune::LaunchConfig> loaded_;
+};
+
 namespace mxnet_op {
 /*!
  * \brief Kernel operator wrapper used for tuning data
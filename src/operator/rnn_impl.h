@@ -30,6 +30,8 @@
 #include <dmlc/parameter.h>
 #include <mxnet/operator.h>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <random>
 #include <map>
 #include <vector>
@@ -55,6 +57,155 @@ inline DType relu(DType x) {
   return x > 0.0f ? static_cast<float>(x) : 0.0f;
 }
 
+/*!
+ * \brief Bitwise select of a or b. gcc does not if-convert float selects under the
+ *  default -ftrapping-math, which would keep the cell loops below from vectorizing.
+ */
+inline float RNNSelect(bool cond, float a, float b) {
+  const int32_t mask = -static_cast<int32_t>(cond);
+  int32_t ia, ib;
+  std::memcpy(&ia, &a, sizeof(ia));
+  std::memcpy(&ib, &b, sizeof(ib));
+  const int32_t bits = (ia & mask) | (ib & ~mask);
+  float out;
+  std::memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+/*!
+ * \brief exp without calls or branches, so that it vectorizes inside the cell loops.
+ *  exp(x) = 2^n * exp(r) with |r| <= ln(2) / 2 and a degree 6 polynomial for exp(r),
+ *  relative error is below 1e-7.
+ */
+inline float RNNExp(float x) {
+  x = RNNSelect(x < -87.3f, -87.3f, x);
+  x = RNNSelect(x > 88.3f, 88.3f, x);
+  // round to nearest without a call to rint
+  const float n = (x * 1.44269504f + 12582912.0f) - 12582912.0f;
+  const float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+template<typename DType>
+inline DType RNNSigmoid(DType x) {
+  return sigmoid<DType>(x);
+}
+
+template<>
+inline float RNNSigmoid<float>(float x) {
+  return 1.0f / (1.0f + RNNExp(-x));
+}
+
+template<typename DType>
+inline DType RNNTanh(DType x) {
+  return tanh(x);
+}
+
+template<>
+inline float RNNTanh<float>(float x) {
+  return 2.0f / (1.0f + RNNExp(-2.0f * x)) - 1.0f;
+}
+
+/*!
+ * \brief One LSTM step over elements [0, len) of a sample: gate nonlinearities, cell
+ *  and hidden state in a single pass. yx, yh, bx and bh hold the i, f, g, o gates H
+ *  apart, c may alias c_prev. Gates are saved in [len, 4] layout for backward when
+ *  kSaveGates is set.
+ */
+template<bool kSaveGates, typename DType>
+inline void LstmCellForward(const int len,
+                            const int H,
+                            const DType* yx,
+                            const DType* yh,
+                            const DType* bx,
+                            const DType* bh,
+                            const DType* c_prev,
+                            DType* c,
+                            DType* h,
+                            DType* y,
+                            DType* ifgo) {
+  #pragma omp simd
+  for (int k = 0; k < len; ++k) {
+    const DType it = RNNSigmoid<DType>(yx[k] + yh[k] + bx[k] + bh[k]);
+    const DType ft = RNNSigmoid<DType>(yx[H + k] + yh[H + k] + bx[H + k] + bh[H + k]);
+    const DType gt = RNNTanh<DType>(yx[2 * H + k] + yh[2 * H + k] +
+                                    bx[2 * H + k] + bh[2 * H + k]);
+    const DType ot = RNNSigmoid<DType>(yx[3 * H + k] + yh[3 * H + k] +
+                                       bx[3 * H + k] + bh[3 * H + k]);
+    const DType ct = c_prev[k] * ft + it * gt;
+    const DType ht = ot * RNNTanh<DType>(ct);
+    c[k] = ct;
+    h[k] = ht;
+    y[k] = ht;
+    if (kSaveGates) {
+      ifgo[4 * k] = it;
+      ifgo[4 * k + 1] = ft;
+      ifgo[4 * k + 2] = gt;
+      ifgo[4 * k + 3] = ot;
+    }
+  }
+}
+
+/*!
+ * \brief One GRU step over elements [0, len) of a sample, see LstmCellForward. gx, gh,
+ *  bx and bh hold the r, z, n gates H apart, h may alias h_prev. r, z, n and the
+ *  recurrent part of n are saved for backward when kSaveGates is set.
+ */
+template<bool kSaveGates, typename DType>
+inline void GruCellForward(const int len,
+                           const int H,
+                           const DType* gx,
+                           const DType* gh,
+                           const DType* bx,
+                           const DType* bh,
+                           const DType* h_prev,
+                           DType* h,
+                           DType* r,
+                           DType* z,
+                           DType* n,
+                           DType* mnh) {
+  #pragma omp simd
+  for (int k = 0; k < len; ++k) {
+    const DType rt = RNNSigmoid<DType>(gx[k] + gh[k] + bx[k] + bh[k]);
+    const DType zt = RNNSigmoid<DType>(gx[H + k] + gh[H + k] + bx[H + k] + bh[H + k]);
+    const DType mnht = gh[2 * H + k] + bh[2 * H + k];
+    const DType nt = RNNTanh<DType>(gx[2 * H + k] + bx[2 * H + k] + rt * mnht);
+    h[k] = (1 - zt) * nt + zt * h_prev[k];
+    if (kSaveGates) {
+      r[k] = rt;
+      z[k] = zt;
+      n[k] = nt;
+      mnh[k] = mnht;
+    }
+  }
+}
+
+/*!
+ * \brief Run f(j, k, len) over blocks of the N x H cell elements, so that the cell
+ *  loops use all threads even for a single sample.
+ */
+template<typename F>
+inline void RNNCellParallelFor(const index_t N, const int H, const int omp_threads, F f) {
+  const int block = 256;
+  const int blocks = (H + block - 1) / block;
+  #pragma omp parallel for num_threads(omp_threads)
+  for (index_t jb = 0; jb < N * blocks; ++jb) {
+    const index_t j = jb / blocks;
+    const int k = (jb % blocks) * block;
+    f(j, k, std::min(block, H - k));
+  }
+}
+
 template<typename DType>
 void LstmForwardTrainingSingleLayer(DType* ws,
                                     DType* rs,
@@ -96,29 +247,18 @@ void LstmForwardTrainingSingleLayer(DType* ws,
   for (index_t i = 0; i < T; ++i) {
     index_t t = bid ? T - 1 - i : i;
     linalg_gemm(i ? h : hx, wh, yh_flat, alpha, beta, false, true);
-    #pragma omp parallel for num_threads(omp_threads)
-    for (index_t jk = 0; jk < cell_size; ++jk) {
-      index_t j = jk / H;
-      index_t k = jk % H;
-      DType it = sigmoid<DType>(yx[t][j][0][k] + yh[j][0][k] + bx[0][k] + bh[0][k]);
-      DType ft = sigmoid<DType>(yx[t][j][1][k] + yh[j][1][k] + bx[1][k] + bh[1][k]);
-      DType gt =           tanh(yx[t][j][2][k] + yh[j][2][k] + bx[2][k] + bh[2][k]);
-      DType ot = sigmoid<DType>(yx[t][j][3][k] + yh[j][3][k] + bx[3][k] + bh[3][k]);
-      DType ct = (i ? c[i-1][j][k] : cx[j][k]) * ft + it * gt;
-      DType ht = ot * tanh(ct);
-      h[j][k] = ht;
-      // reserve
-      y[t][j][k + offset] = ht;
-      c[i][j][k] = ct;
-      ifgo[i][j][k][0] = it;
-      ifgo[i][j][k][1] = ft;
-      ifgo[i][j][k][2] = gt;
-      ifgo[i][j][k][3] = ot;
-      if (i == T - 1 && state_outputs) {
-        hy_ptr[jk] = ht;
-        cy_ptr[jk] = ct;
-      }
-    }
+    RNNCellParallelFor(N, H, omp_threads, [&](index_t j, int k, int len) {
+      // reserve c and ifgo for backward
+      LstmCellForward<true, DType>(len, H, yx[t][j].dptr_ + k, yh[j].dptr_ + k,
+                                   bx.dptr_ + k, bh.dptr_ + k,
+                                   (i ? c[i - 1][j].dptr_ : cx[j].dptr_) + k,
+                                   c[i][j].dptr_ + k, h[j].dptr_ + k,
+                                   y[t][j].dptr_ + offset + k, ifgo[i][j].dptr_ + 4 * k);
+    });
+  }
+  if (state_outputs) {
+    std::memcpy(hy_ptr, h.dptr_, cell_size * sizeof(DType));
+    std::memcpy(cy_ptr, c[T - 1].dptr_, cell_size * sizeof(DType));
   }
 }
 
@@ -248,25 +388,14 @@ void LstmForwardInferenceSingleLayer(DType* ws,
     } else {
       linalg_gemm(i ? h : hx, wh, yh_flat, alpha, beta, false, true);
     }
-    #pragma omp parallel for num_threads(omp_threads)
-    for (index_t jk = 0; jk < cell_size; ++jk) {
-      int j = jk / H;
-      int k = jk % H;
-      DType it = sigmoid<DType>(yx[t][j][0][k] + yh[j][0][k] + bx[0][k] + bh[0][k]);
-      DType ft = sigmoid<DType>(yx[t][j][1][k] + yh[j][1][k] + bx[1][k] + bh[1][k]);
-      DType gt =           tanh(yx[t][j][2][k] + yh[j][2][k] + bx[2][k] + bh[2][k]);
-      DType ot = sigmoid<DType>(yx[t][j][3][k] + yh[j][3][k] + bx[3][k] + bh[3][k]);
-      DType ct = (i ? c[j][k] : cx[j][k]) * ft + it * gt;
-      DType ht = ot * tanh(ct);
-      if (P == 0) y[t][j][k + offset] = ht;
-      if (i == T - 1 && state_outputs) {
-        if (P == 0) hy_ptr[jk] = ht;
-        cy_ptr[jk] = ct;
-      } else {
-        c[j][k] = ct;
-      }
-      h[j][k] = ht;
-    }
+    RNNCellParallelFor(N, H, omp_threads, [&](index_t j, int k, int len) {
+      // with a projection y is written from r below
+      DType* yt = P == 0 ? y[t][j].dptr_ + offset + k : h[j].dptr_ + k;
+      LstmCellForward<false, DType>(len, H, yx[t][j].dptr_ + k, yh[j].dptr_ + k,
+                                    bx.dptr_ + k, bh.dptr_ + k,
+                                    (i ? c[j].dptr_ : cx[j].dptr_) + k,
+                                    c[j].dptr_ + k, h[j].dptr_ + k, yt, nullptr);
+    });
     if (P > 0) {
       linalg_gemm(h, whr, r, alpha, beta, false, true);
       #pragma omp parallel for num_threads(omp_threads)
@@ -275,6 +404,11 @@ void LstmForwardInferenceSingleLayer(DType* ws,
       }
     }
   }
+  if (state_outputs) {
+    // with a projection hy already holds the last r
+    if (P == 0) std::memcpy(hy_ptr, h.dptr_, cell_size * sizeof(DType));
+    std::memcpy(cy_ptr, c.dptr_, cell_size * sizeof(DType));
+  }
 }
 
 template <typename DType>
@@ -634,9 +768,6 @@ void GruForwardInferenceSingleLayer(DType* ws,
   DType* back_ht = back_ht_1;
   DType* gemmC1  = ws;              // [D, T, N, 3 * H]
   DType* gemmC2  = gemmC1 + D * T * N * 3 * H;  // N * 3 * H
-  DType* rt = gemmC2 + N * 3 * H;
-  DType* zt = rt + N * H;
-  DType* nt = zt + N * H;
   DType* back_wx_ptr = wx_ptr + I * 3 * H + H * 3 * H;
   DType* back_wh_ptr = wh_ptr + I * 3 * H + H * 3 * H;
   DType* back_bx_ptr = (bx_ptr != nullptr)? bx_ptr + 3 * H * 2 : nullptr;
@@ -692,22 +823,12 @@ void GruForwardInferenceSingleLayer(DType* ws,
       linalg_gemm(dht_1_tmp[0], wh, dgemmC2, alpha, beta, true, true);
     }
     gemmC1_t = gemmC1 + t * N * 3 * H;
-    #pragma omp parallel for num_threads(omp_threads)
-    for (index_t i = 0; i < N; ++i) {
-      for (int j = 0; j < H; ++j) {
-        index_t rtb = i * 3 * H;
-        index_t ztb = i * 3 * H + H;
-        index_t ntb = i * 3 * H + 2 * H;
-        rt[i * H + j] = sigmoid(gemmC1_t[rtb + j] + gemmC2[rtb + j]
-            + bx[0][j] + bh[0][j]);
-        zt[i * H + j] = sigmoid(gemmC1_t[ztb + j] + gemmC2[ztb + j]
-            + bx[1][j] + bh[1][j]);
-        nt[i * H + j] = tanh(gemmC1_t[ntb + j] + bx[2][j] +
-            rt[i * H + j] * (gemmC2[ntb + j] + bh[2][j]));
-        ht[i * D * H + j] = (1-zt[i * H + j]) * nt[i * H + j] +
-            zt[i * H + j] * ht_1[i * D * H + j];
-      }
-    }
+    RNNCellParallelFor(N, H, omp_threads, [&](index_t i, int j, int len) {
+      GruCellForward<false, DType>(len, H, gemmC1_t + i * 3 * H + j,
+                                   gemmC2 + i * 3 * H + j, bx.dptr_ + j, bh.dptr_ + j,
+                                   ht_1 + i * D * H + j, ht + i * D * H + j,
+                                   nullptr, nullptr, nullptr, nullptr);
+    });
     ht_1 = ht;
     ht = ht + D * H * N;
     //  perform the second direction
@@ -719,22 +840,13 @@ void GruForwardInferenceSingleLayer(DType* ws,
       dback_ht_1_tmp = reshape(dback_ht_1.T(), Shape3(D, H, N));
       linalg_gemm(dback_ht_1_tmp[1], back_wh, dgemmC2, alpha, beta, true, true);
 
-      #pragma omp parallel for num_threads(omp_threads)
-      for (index_t i = 0; i < N; ++i) {
-        for (int j = 0; j < H; ++j) {
-          index_t rtb = i * 3 * H;
-          index_t ztb = i * 3 * H + H;
-          index_t ntb = i * 3 * H + 2 * H;
-          rt[i * H + j] = sigmoid(gemmC1_t[rtb + j] +
-              gemmC2[rtb + j] + back_bx[0][j] + back_bh[0][j]);
-          zt[i * H + j] = sigmoid(gemmC1_t[ztb + j] +
-              gemmC2[ztb + j] + back_bx[1][j]+ back_bh[1][j]);
-          nt[i * H + j] = tanh(gemmC1_t[ntb + j] + back_bx[2][j]
-              + rt[i * H + j] * (gemmC2[ntb + j] + back_bh[2][j]));
-          back_ht[i * D * H + j] = (1 - zt[i * H + j]) * nt[i * H + j]
-              + zt[i * H + j] * back_ht_1[i * D * H + j];
-        }
-      }
+      RNNCellParallelFor(N, H, omp_threads, [&](index_t i, int j, int len) {
+        GruCellForward<false, DType>(len, H, gemmC1_t + i * 3 * H + j,
+                                     gemmC2 + i * 3 * H + j, back_bx.dptr_ + j,
+                                     back_bh.dptr_ + j, back_ht_1 + i * D * H + j,
+                                     back_ht + i * D * H + j,
+                                     nullptr, nullptr, nullptr, nullptr);
+      });
       back_ht_1 = back_ht;
       back_ht = back_ht - D * H * N;
     }
@@ -909,23 +1021,12 @@ void GruForwardTrainingSingleLayer(DType* ws,
     nt = gateN + t * N * H;
     gemmC1_t = gemmC1 + t * N * 3 * H;
     DType* Mnht = Mnh + t * N * H;
-    #pragma omp parallel for num_threads(omp_threads)
-    for (index_t i = 0; i < N; ++i) {
-      for (int j = 0; j < H; ++j) {
-        index_t rtb = i * 3 * H;
-        index_t ztb = i * 3 * H + H;
-        index_t ntb = i * 3 * H + 2 * H;
-        Mnht[i * H + j] = gemmC2[ntb + j] + bh[2][j];
-        rt[i * H + j] = sigmoid(gemmC1_t[rtb + j] + gemmC2[rtb + j]
-            + bx[0][j] + bh[0][j]);
-        zt[i * H + j] = sigmoid(gemmC1_t[ztb + j] + gemmC2[ztb + j]
-            + bx[1][j] + bh[1][j]);
-        nt[i * H + j] = tanh(gemmC1_t[ntb + j] + bx[2][j] +
-            rt[i * H + j] * (gemmC2[ntb + j] + bh[2][j]));
-        ht[i * D * H + j] = (1-zt[i * H + j]) * nt[i * H + j] +
-            zt[i * H + j] * ht_1[i * D * H + j];
-      }
-    }
+    RNNCellParallelFor(N, H, omp_threads, [&](index_t i, int j, int len) {
+      GruCellForward<true>(len, H, gemmC1_t + i * 3 * H + j, gemmC2 + i * 3 * H + j,
+                           bx.dptr_ + j, bh.dptr_ + j, ht_1 + i * D * H + j,
+                           ht + i * D * H + j, rt + i * H + j, zt + i * H + j,
+                           nt + i * H + j, Mnht + i * H + j);
+    });
     ht_1 = ht;
     ht = ht + D * H * N;
     //  perform the second direction
@@ -941,23 +1042,13 @@ void GruForwardTrainingSingleLayer(DType* ws,
       linalg_gemm(dback_ht_1_tmp[1], back_wh, dgemmC2, alpha, beta, true, true);
 
       DType* back_Mnht = back_Mnh + (T - 1 - t) * N * H;
-      #pragma omp parallel for num_threads(omp_threads)
-      for (index_t i = 0; i < N; ++i) {
-        for (int j = 0; j < H; ++j) {
-          index_t rtb = i * 3 * H;
-          index_t ztb = i * 3 * H + H;
-          index_t ntb = i * 3 * H + 2 * H;
-          back_Mnht[i * H + j] = gemmC2[ntb + j] + back_bh[2][j];
-          rt[i * H + j] = sigmoid(gemmC1_t[rtb + j] +
-              gemmC2[rtb + j] + back_bx[0][j] + back_bh[0][j]);
-          zt[i * H + j] = sigmoid(gemmC1_t[ztb + j] +
-              gemmC2[ztb + j] + back_bx[1][j] + back_bh[1][j]);
-          nt[i * H + j] = tanh(gemmC1_t[ntb + j] + back_bx[2][j]
-              + rt[i * H + j] * (gemmC2[ntb + j] + back_bh[2][j]));
-          back_ht[i * D * H + j] = (1 - zt[i * H + j]) * nt[i * H + j]
-              + zt[i * H + j] * back_ht_1[i * D * H + j];
-        }
-      }
+      RNNCellParallelFor(N, H, omp_threads, [&](index_t i, int j, int len) {
+        GruCellForward<true>(len, H, gemmC1_t + i * 3 * H + j, gemmC2 + i * 3 * H + j,
+                             back_bx.dptr_ + j, back_bh.dptr_ + j,
+                             back_ht_1 + i * D * H + j, back_ht + i * D * H + j,
+                             rt + i * H + j, zt + i * H + j, nt + i * H + j,
+                             back_Mnht + i * H + j);
+      });
       back_ht_1 = back_ht;
       back_ht = back_ht - D * H * N;
     }
@@ -358,6 +358,100 @@ void TakeOpForward<cpu>(const nnvm::NodeAttrs& attrs,
   });
 }
 
+/*!
+ * \brief Stable parallel LSD radix sort of keys in [0, max_key], moving vals along.
+ *  Each pass sorts by 8 bits, so the cost is linear in n and does not depend on how
+ *  large max_key is beyond the number of passes.
+ * \param n          number of keys
+ * \param max_key    upper bound of the keys
+ * \param hist       num_threads * 256 counters
+ * \param keys       keys to sort, points to the sorted keys on return
+ * \param vals       values to sort, points to the sorted values on return
+ * \param tmp_keys   scratch of n keys, points to the other buffer on return
+ * \param tmp_vals   scratch of n values, points to the other buffer on return
+ */
+inline void RadixSortByKey(const nnvm::dim_t n, const nnvm::dim_t max_key,
+                           const int num_threads, nnvm::dim_t* hist,
+                           nnvm::dim_t** keys, nnvm::dim_t** vals,
+                           nnvm::dim_t** tmp_keys, nnvm::dim_t** tmp_vals) {
+  using nnvm::dim_t;
+  const int kBits = 8;
+  const dim_t kBuckets = 1 << kBits;
+  const dim_t chunk = (n + num_threads - 1) / num_threads;
+  for (int shift = 0; (max_key >> shift) > 0; shift += kBits) {
+    const dim_t* in_keys = *keys;
+    const dim_t* in_vals = *vals;
+    dim_t* out_keys = *tmp_keys;
+    dim_t* out_vals = *tmp_vals;
+    #pragma omp parallel for num_threads(num_threads)
+    for (int t = 0; t < num_threads; ++t) {
+      dim_t* count = hist + t * kBuckets;
+      std::fill(count, count + kBuckets, 0);
+      const dim_t end = std::min(n, (t + 1) * chunk);
+      for (dim_t i = t * chunk; i < end; ++i) {
+        ++count[(in_keys[i] >> shift) & (kBuckets - 1)];
+      }
+    }
+    // bucket major, thread minor offsets keep equal keys in input order
+    dim_t offset = 0;
+    for (dim_t b = 0; b < kBuckets; ++b) {
+      for (int t = 0; t < num_threads; ++t) {
+        const dim_t count = hist[t * kBuckets + b];
+        hist[t * kBuckets + b] = offset;
+        offset += count;
+      }
+    }
+    #pragma omp parallel for num_threads(num_threads)
+    for (int t = 0; t < num_threads; ++t) {
+      dim_t* pos = hist + t * kBuckets;
+      const dim_t end = std::min(n, (t + 1) * chunk);
+      for (dim_t i = t * chunk; i < end; ++i) {
+        const dim_t j = pos[(in_keys[i] >> shift) & (kBuckets - 1)]++;
+        out_keys[j] = in_keys[i];
+        out_vals[j] = in_vals[i];
+      }
+    }
+    std::swap(*keys, *tmp_keys);
+    std::swap(*vals, *tmp_vals);
+  }
+}
+
+/*!
+ * \brief Find where each run of equal keys starts in sorted keys.
+ * \param n          number of keys
+ * \param keys       the sorted keys
+ * \param hist       num_threads + 1 counters
+ * \param starts     n + 1 entries, holds the start of each run and n after the last one
+ * \return the number of runs
+ */
+inline nnvm::dim_t SegmentStarts(const nnvm::dim_t n, const nnvm::dim_t* keys,
+                                 const int num_threads, nnvm::dim_t* hist,
+                                 nnvm::dim_t* starts) {
+  using nnvm::dim_t;
+  const dim_t chunk = (n + num_threads - 1) / num_threads;
+  #pragma omp parallel for num_threads(num_threads)
+  for (int t = 0; t < num_threads; ++t) {
+    dim_t count = 0;
+    const dim_t end = std::min(n, (t + 1) * chunk);
+    for (dim_t i = t * chunk; i < end; ++i) {
+      count += (i == 0 || keys[i] != keys[i - 1]);
+    }
+    hist[t + 1] = count;
+  }
+  hist[0] = 0;
+  for (int t = 0; t < num_threads; ++t) hist[t + 1] += hist[t];
+  #pragma omp parallel for num_threads(num_threads)
+  for (int t = 0; t < num_threads; ++t) {
+    dim_t j = hist[t];
+    const dim_t end = std::min(n, (t + 1) * chunk);
+    for (dim_t i = t * chunk; i < end; ++i) {
+      if (i == 0 || keys[i] != keys[i - 1]) starts[j++] = i;
+    }
+  }
+  starts[hist[num_threads]] = n;
+  return hist[num_threads];
+}
+
 template<>
 inline void SparseEmbeddingOpBackwardRspImpl<cpu>(const bool deterministic,
                                                   const OpContext& ctx,
@@ -374,18 +468,30 @@ inline void SparseEmbeddingOpBackwardRspImpl<cpu>(const bool deterministic,
   CHECK_EQ(req, kWriteTo) << "SparseEmbedding layer doesn't support "
                           << "weight gradient calculation with req != write";
 
-  // Request temporary storage for marking non-zero rows and prefix sum
+  // The indices are sorted along with their positions and the output gradient rows of
+  // each unique index are summed, so that the cost scales with the number of indices
+  // rather than with the number of rows of the weight. Rows are summed in input order,
+  // which makes the result deterministic.
   Stream<cpu> *s = ctx.get_stream<cpu>();
   dim_t num_rows = output.shape()[0];
   dim_t row_length = output.shape()[1];
-  size_t workspace_size = num_rows * sizeof(dim_t);
+  dim_t data_size = static_cast<dim_t>(data.shape_.Size());
+  if (data_size == 0) {
+    FillZerosRspImpl(s, output);
+    return;
+  }
+  const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
+  // sorted indices, their positions and scratch for both. Key buffers have one extra
+  // entry, as the one not holding the sorted keys is reused for the segment starts.
+  size_t workspace_size = (data_size * 4 + 2 + num_threads * 256) * sizeof(dim_t);
   Tensor<cpu, 1, char> workspace =
     ctx.requested[embedding::kTempSpace].get_space_typed<cpu, 1, char>(
       Shape1(workspace_size), s);
-  dim_t* row_flg = reinterpret_cast<dim_t*>(workspace.dptr_);
-  // prefix sum array re-uses the row_flg array temp space
-  dim_t* prefix_sum = row_flg;
-  dim_t data_size = static_cast<dim_t>(data.shape_.Size());
+  dim_t* keys = reinterpret_cast<dim_t*>(workspace.dptr_);
+  dim_t* vals = keys + data_size + 1;
+  dim_t* tmp_keys = vals + data_size;
+  dim_t* tmp_vals = tmp_keys + data_size + 1;
+  dim_t* hist = tmp_vals + data_size;
 
   MSHADOW_TYPE_SWITCH(data.type_flag_, IType, {
     MSHADOW_SGL_DBL_TYPE_SWITCH(ograd.type_flag_, DType, {
@@ -399,37 +505,22 @@ inline void SparseEmbeddingOpBackwardRspImpl<cpu>(const bool deterministic,
           bool is_valid = CheckIndexOutOfBound(data_ptr, data.shape_.Size(), min, max);
           CHECK(is_valid) << "Embedding input contains data out of bound";
         }
-        // mark row flags
-        Fill<false>(s, TBlob(row_flg, Shape1(num_rows), cpu::kDevMask), kWriteTo, 0);
-        Kernel<MarkRowFlgKernel, cpu>::Launch(s, data_size, row_flg, data.dptr<IType>());
-        // calculate inclusive prefix sum
-        // TODO(haibin) ideally this is should be done in parallel
-        prefix_sum[0] = row_flg[0];
-        for (dim_t i = 1; i < num_rows; i++) {
-          prefix_sum[i] = prefix_sum[i - 1] + row_flg[i];
+        const IType* data_ptr = data.dptr<IType>();
+        #pragma omp parallel for num_threads(num_threads)
+        for (dim_t i = 0; i < data_size; ++i) {
+          keys[i] = static_cast<dim_t>(data_ptr[i]);
+          vals[i] = i;
         }
+        RadixSortByKey(data_size, num_rows - 1, num_threads, hist,
+                       &keys, &vals, &tmp_keys, &tmp_vals);
+        dim_t* segment_start = tmp_keys;
         // total number of non-zero rows
-        dim_t nnr = prefix_sum[num_rows - 1];
-        if (nnr == 0) {
-          FillZerosRspImpl(s, output);
-          return;
-        }
+        dim_t nnr = SegmentStarts(data_size, keys, num_threads, hist, segment_start);
         output.CheckAndAlloc({Shape1(nnr)});
-        RType* grad_row_idx = output.aux_data(kIdx).dptr<RType>();
-        // fill row_idx array of output matrix, using the row_flg values
-        Kernel<FillRspRowIdxKernel, cpu>::Launch(s, num_rows,
-            grad_row_idx, prefix_sum, num_rows);
-        // prefill with zeros
-        DType* grad_data = output.data().dptr<DType>();
-        Fill<false>(s, TBlob(grad_data, Shape1(nnr * row_length),
-            cpu::kDevMask), kWriteTo, 0);
-        // add the final gradients
-        const int num_threads = engine::OpenMP::Get()->GetRecommendedOMPThreadCount();
-        dim_t segment_len = (nnr + num_threads - 1) / num_threads;
-        Kernel<AddTakeGradRspKernel, cpu>::Launch(s, num_threads, grad_data, prefix_sum,
+        Kernel<AddTakeGradRspKernel, cpu>::Launch(s, nnr, output.data().dptr<DType>(),
+                                                  output.aux_data(kIdx).dptr<RType>(),
                                                   ograd.dptr<DType>(), row_length,
-                                                  data.dptr<IType>(), data_size, segment_len,
-                                                  num_rows);
+                                                  keys, vals, segment_start);
       });
     });
   });
@@ -554,41 +554,41 @@ void EmbeddingOpBackward(const nnvm::NodeAttrs& attrs,
 
 struct AddTakeGradRspKernel {
   /*!
-   * \brief Each thread i is responsible for row slices in [segment_start, segment_end)
-            of the result gradient
-   * \param tid             global thread id
+   * \brief Each thread i sums the output gradient rows of the i-th unique index,
+            in the order they appear in the input
+   * \param tid             global thread id, one per non-zero row of the result gradient
    * \param grad            the gradient to calculate
-   * \param prefix_sum      the inclusive prefix sum of row ids of the gradient
+   * \param grad_row_idx    the row indices of the gradient
    * \param ograd           output gradient
    * \param row_length      the length of the row slices of the gradient
-   * \param data_val        the values of input data
-   * \param data_size       number of values of input data
-   * \param segment_length  the length of row segment to process for each thread
-   * \param nnr             total number of non-zero rows of result gradient
+   * \param sorted_idx      the input indices, sorted
+   * \param original_pos    the position in the input of each sorted index
+   * \param segment_start   where the run of each unique index starts in sorted_idx,
+                            with nnr + 1 entries
    */
-  template<typename DType, typename IType>
-  MSHADOW_CINLINE static void Map(int tid,
+  template<typename DType, typename RType>
+  MSHADOW_XINLINE static void Map(int tid,
                                   DType* grad,
-                                  const nnvm::dim_t* prefix_sum,
+                                  RType* grad_row_idx,
                                   const DType* ograd,
                                   const nnvm::dim_t row_length,
-                                  const IType* data_val,
-                                  const nnvm::dim_t data_size,
-                                  const nnvm::dim_t segment_length,
-                                  const nnvm::dim_t nnr) {
+                                  const nnvm::dim_t* sorted_idx,
+                                  const nnvm::dim_t* original_pos,
+                                  const nnvm::dim_t* segment_start) {
     using nnvm::dim_t;
-    dim_t segment_start = tid * segment_length;
-    dim_t segment_end = std::min(nnr, segment_start + segment_length);
-    // scan all data
-    for (dim_t data_i = 0; data_i < data_size; data_i++) {
-      dim_t data = static_cast<dim_t>(data_val[data_i]);
-      dim_t grad_row_id = prefix_sum[data] - 1;
-      if (grad_row_id < segment_start || grad_row_id >= segment_end) continue;
-      // no projection is performed
-      dim_t ograd_i = data_i * row_length;
-      dim_t grad_i = grad_row_id * row_length;
+    const dim_t start = segment_start[tid];
+    const dim_t end = segment_start[tid + 1];
+    grad_row_idx[tid] = static_cast<RType>(sorted_idx[start]);
+    DType* grad_row = grad + tid * row_length;
+    // no projection is performed
+    const DType* ograd_row = ograd + original_pos[start] * row_length;
+    for (dim_t offset = 0; offset < row_length; offset++) {
+      grad_row[offset] = ograd_row[offset];
+    }
+    for (dim_t i = start + 1; i < end; i++) {
+      ograd_row = ograd + original_pos[i] * row_length;
       for (dim_t offset = 0; offset < row_length; offset++) {
-        grad[grad_i + offset] += ograd[ograd_i + offset];
+        grad_row[offset] += ograd_row[offset];
       }
     }
   }
@@ -29,6 +29,7 @@
 #include <dmlc/optional.h>
 #include <mshadow/tensor.h>
 #include <algorithm>
+#include <utility>
 #include <vector>
 #include <type_traits>
 #include "../mshadow_op.h"
@@ -204,6 +205,46 @@ struct fill_ind {
   }
 };
 
+/*!
+ * \brief Select the top K of n values with a heap of size K and write them sorted.
+ *  Ties are broken in favour of the smaller index, so selecting from candidates
+ *  that were themselves selected this way yields the same result.
+ * \param vals values to select from
+ * \param inds indices of the values, if nullptr the index of vals[j] is ind_offset+j
+ * \param out_vals the min(K, n) selected values, may alias vals
+ * \param out_inds the indices of the selected values, may alias inds
+ */
+template<typename DType>
+inline void TopKHeapSelect(const DType* vals, const index_t* inds, index_t n, index_t K,
+                           bool is_ascend, index_t ind_offset,
+                           DType* out_vals, index_t* out_inds) {
+  typedef std::pair<DType, index_t> Elem;
+  // Returns whether `a` comes before `b` in the result. As a heap comparator this
+  // keeps the worst selected element at the front.
+  auto better = [is_ascend](const Elem& a, const Elem& b) {
+    if (a.first == b.first) return a.second < b.second;
+    return is_ascend ? a.first < b.first : a.first > b.first;
+  };
+  std::vector<Elem> heap;
+  heap.reserve(K);
+  for (index_t j = 0; j < n; ++j) {
+    Elem cur(vals[j], inds ? inds[j] : ind_offset + j);
+    if (static_cast<index_t>(heap.size()) < K) {
+      heap.push_back(cur);
+      std::push_heap(heap.begin(), heap.end(), better);
+    } else if (better(cur, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), better);
+      heap.back() = cur;
+      std::push_heap(heap.begin(), heap.end(), better);
+    }
+  }
+  std::sort_heap(heap.begin(), heap.end(), better);
+  for (size_t j = 0; j < heap.size(); ++j) {
+    out_vals[j] = heap[j].first;
+    out_inds[j] = heap[j].second;
+  }
+}
+
 template<typename DType>
 MSHADOW_FORCE_INLINE void TopKSort(const Tensor<cpu, 1, DType>& dat,
                                    const Tensor<cpu, 1, index_t>& ind,
@@ -215,35 +256,51 @@ MSHADOW_FORCE_INLINE void TopKSort(const Tensor<cpu, 1, DType>& dat,
   // Batch size.
   const index_t M(work.size(0)/(sizeof(DType)*N));
   const int omp_threads(engine::OpenMP::Get()->GetRecommendedOMPThreadCount());
-  #pragma omp parallel for num_threads(omp_threads)
-  for (index_t i = 0; i < M; ++i) {
-    // Tensor `work` stores the flattened source data, while `dat` stores the sorted result.
-    DType *vals = reinterpret_cast<DType*>(work.dptr_);
-    DType *sorted_vals = dat.dptr_+i*N;
-    index_t *indices = ind.dptr_+i*N;
-    if (is_ascend) {
-      if (full_sort) {
+  // Tensor `work` stores the flattened source data, while `dat` stores the sorted result.
+  const DType *vals = reinterpret_cast<DType*>(work.dptr_);
+  if (full_sort) {
+    #pragma omp parallel for num_threads(omp_threads)
+    for (index_t i = 0; i < M; ++i) {
+      DType *sorted_vals = dat.dptr_+i*N;
+      index_t *indices = ind.dptr_+i*N;
+      for (index_t j = 0; j < N; ++j) {
+        indices[j] = i*N+j;
+      }
+      if (is_ascend) {
         std::sort(indices, indices+N,
                   [&](const index_t& i1, const index_t& i2){
           return vals[i1] < vals[i2]; });
       } else {
-        std::partial_sort(indices, indices+K, indices+N,
-                          [&](const index_t& i1, const index_t& i2){
-          return vals[i1] < vals[i2]; });
-      }
-    } else {
-      if (full_sort) {
         std::sort(indices, indices+N,
                   [&](const index_t& i1, const index_t& i2){
           return vals[i1] > vals[i2]; });
-      } else {
-        std::partial_sort(indices, indices+K, indices+N,
-                          [&](const index_t& i1, const index_t& i2){
-          return vals[i1] > vals[i2]; });
+      }
+      for (index_t j = 0; j < K; ++j) {
+        sorted_vals[j] = vals[indices[j]];
       }
     }
-    for (index_t j = 0; j < K; ++j) {
-      sorted_vals[j] = vals[indices[j]];
+    return;
+  }
+  // Select the top K of each row with a heap, which only touches the K winners
+  // besides a single pass over the row. When there are fewer rows than threads,
+  // rows are split into chunks whose top K are selected in parallel and merged
+  // afterwards. Each chunk has at least 8*K elements, so the K candidates of
+  // all chunks of a row fit in the first part of the row in `dat` and `ind`.
+  const index_t min_chunk_size(std::max(K*8, index_t{4096}));
+  const index_t chunks(M >= omp_threads ? 1 :
+    std::max(index_t{1}, std::min((omp_threads+M-1)/M, N/min_chunk_size)));
+  #pragma omp parallel for num_threads(omp_threads)
+  for (index_t t = 0; t < M*chunks; ++t) {
+    const index_t i(t/chunks), c(t%chunks);
+    const index_t begin(c*N/chunks), end((c+1)*N/chunks);
+    TopKHeapSelect(vals+i*N+begin, static_cast<const index_t*>(nullptr), end-begin, K,
+                   is_ascend, i*N+begin, dat.dptr_+i*N+c*K, ind.dptr_+i*N+c*K);
+  }
+  if (chunks > 1) {
+    #pragma omp parallel for num_threads(omp_threads)
+    for (index_t i = 0; i < M; ++i) {
+      TopKHeapSelect(dat.dptr_+i*N, ind.dptr_+i*N, chunks*K, K, is_ascend, index_t{0},
+                     dat.dptr_+i*N, ind.dptr_+i*N);
     }
   }
 }
@@ -476,8 +533,11 @@ void TopKImpl(const RunContext &ctx,
     workspace_curr_ptr += temp_size;
   }
 
-  mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, index_t{0}, index_t{1},
-    kWriteTo, indices.dptr_);
+  if (!std::is_same<xpu, cpu>::value) {
+    // The cpu sort only initializes the indices it needs.
+    mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, index_t{0},
+      index_t{1}, kWriteTo, indices.dptr_);
+  }
   CHECK_EQ(indices.CheckContiguous(), true);
 
   // 2. Perform inplace batch sort.
@@ -672,8 +732,11 @@ void TopKImplwithWorkspace(const RunContext &ctx,
     workspace_curr_ptr += temp_size;
   }
 
-  mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, index_t{0}, index_t{1},
-    kWriteTo, indices.dptr_);
+  if (!std::is_same<xpu, cpu>::value) {
+    // The cpu sort only initializes the indices it needs.
+    mxnet_op::Kernel<range_fwd, xpu>::Launch(s, batch_size * element_num, 1, index_t{0},
+      index_t{1}, kWriteTo, indices.dptr_);
+  }
   CHECK_EQ(indices.CheckContiguous(), true);
 
   // 2. Perform inplace batch sort.
@@ -24,12 +24,17 @@
  */
 #include <dmlc/base.h>
 #include <dmlc/logging.h>
+#include <dmlc/thread_local.h>
 #include <mxnet/base.h>
 #include <fstream>
 #include <thread>
 #include <iomanip>
 #include <queue>
 #include <utility>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_set>
 #include "./profiler.h"
 
 namespace mxnet {
@@ -37,6 +42,108 @@ namespace profiler {
 
 using pi = std::pair<double, std::string>;
 
+/*! \brief values below 2^kExactBits have a bucket each, then 2^(kExactBits-1) per octave */
+static constexpr int kExactBits = 7;
+static constexpr size_t kSubBuckets = 1 << (kExactBits - 1);
+
+/*! \brief Suffix of the categories holding the statistics per shape signature */
+static constexpr char PER_SHAPE_SUFFIX[] = " (per shape)";
+
+/*! \brief Percentiles reported for durations */
+static const std::array<std::pair<double, const char *>, 4> kPercentiles = {{
+  {0.5, "P50"}, {0.9, "P90"}, {0.99, "P99"}, {0.999, "P999"}
+}};
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < 2 * kSubBuckets) {
+    return value;
+  }
+  int msb = 63;
+  while (!(value >> msb)) --msb;
+  const int shift = msb - kExactBits + 1;
+  return (static_cast<size_t>(shift) * kSubBuckets) + (value >> shift);
+}
+
+uint64_t LatencyHistogram::BucketValue(size_t index) {
+  if (index < 2 * kSubBuckets) {
+    return index;
+  }
+  const int shift = static_cast<int>(index / kSubBuckets) - 1;
+  const uint64_t lowest = static_cast<uint64_t>(index - shift * kSubBuckets) << shift;
+  return lowest + ((uint64_t{1} << shift) - 1) / 2;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  const size_t index = BucketIndex(value);
+  if (index >= counts_.size()) {
+    counts_.resize(index + 1, 0);
+  }
+  ++counts_[index];
+  ++count_;
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+  if (!count_) {
+    return 0;
+  }
+  // smallest value with at least a fraction q of the values at or below it
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count_)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return BucketValue(i);
+    }
+  }
+  return BucketValue(counts_.size() - 1);
+}
+
+/*! \brief Percentile of a duration, clamped to the exact extremes */
+inline uint64_t DurationPercentile(const AggregateStats::StatData& data, double q) {
+  return std::min(std::max(data.histogram_.Percentile(q), data.min_aggregate_),
+                  data.max_aggregate_);
+}
+
+/*! \brief Signatures of all threads, guarded by m */
+struct ShapeSignatureTable {
+  std::mutex m;
+  std::unordered_map<uint64_t, std::string> signatures;
+};
+
+static ShapeSignatureTable *GetShapeSignatureTable() {
+  // never destroyed, engine threads may still add signatures at exit
+  static ShapeSignatureTable *table = new ShapeSignatureTable();
+  return table;
+}
+
+/*! \brief Hashes whose signature the thread already added */
+struct KnownShapeHashes {
+  std::unordered_set<uint64_t> hashes;
+};
+
+bool ShapeSignatures::IsNew(uint64_t hash) {
+  std::unordered_set<uint64_t> *hashes =
+      &dmlc::ThreadLocalStore<KnownShapeHashes>::Get()->hashes;
+  if (hashes->count(hash)) {
+    return false;
+  }
+  hashes->insert(hash);
+  return true;
+}
+
+void ShapeSignatures::Insert(uint64_t hash, std::string&& signature) {
+  ShapeSignatureTable *table = GetShapeSignatureTable();
+  std::unique_lock<std::mutex> lk(table->m);
+  table->signatures.emplace(hash, std::move(signature));
+}
+
+std::string ShapeSignatures::Get(uint64_t hash) {
+  ShapeSignatureTable *table = GetShapeSignatureTable();
+  std::unique_lock<std::mutex> lk(table->m);
+  auto it = table->signatures.find(hash);
+  return it == table->signatures.end() ? std::string() : it->second;
+}
+
 template<typename DType>
 inline float MicroToMilli(const DType micro) {
   return static_cast<float>(static_cast<double>(micro) / 1000);
@@ -75,6 +182,10 @@ inline std::priority_queue<pi>
       case AggregateStats::SortBy::Count:
         value = data.total_count_;
         break;
+      case AggregateStats::SortBy::P99:
+        value = data.type_ == AggregateStats::StatData::kDuration ?
+                DurationPercentile(data, 0.99) : data.max_aggregate_;
+        break;
       default:
         LOG(FATAL) << "Invalid value for parameter sort_by";
         break;
@@ -89,10 +200,35 @@ inline std::priority_queue<pi>
 void AggregateStats::OnProfileStat(const ProfileStat& stat) {
   std::unique_lock<std::mutex> lk(m_);
   if (stat.enable_aggregate_) {
-    stat.SaveAggregate(&stats_[stat.categories_.c_str()][stat.name_.c_str()]);
+    StatData *data = &stats_[stat.categories_.c_str()][stat.name_.c_str()];
+    stat.SaveAggregate(data);
+    const uint64_t shape_hash = stat.shape_hash();
+    if (shape_hash != 0) {
+      stat.SaveAggregate(&per_shape_[data][shape_hash]);
+    }
   }
 }
 
+AggregateStats::StatMap AggregateStats::WithPerShapeStats() const {
+  if (per_shape_.empty()) {
+    return stats_;
+  }
+  StatMap stats = stats_;
+  for (const auto& category : stats_) {
+    for (const auto& op : category.second) {
+      auto it = per_shape_.find(&op.second);
+      if (it == per_shape_.end()) {
+        continue;
+      }
+      auto& rows = stats[category.first + PER_SHAPE_SUFFIX];
+      for (const auto& shape : it->second) {
+        rows[op.first + " " + ShapeSignatures::Get(shape.first)] = shape.second;
+      }
+    }
+  }
+  return stats;
+}
+
 void AggregateStats::DumpTable(std::ostream& os, int sort_by, int ascending) {
   std::ios state(nullptr);
   state.copyfmt(os);
@@ -101,7 +237,8 @@ void AggregateStats::DumpTable(std::ostream& os, int sort_by, int ascending) {
      << "\tNote the difference in units for different entries."
      << std::endl;
   std::unique_lock<std::mutex> lk(m_);
-  for (const auto& stat : stats_) {
+  const StatMap stats = WithPerShapeStats();
+  for (const auto& stat : stats) {
     const std::string& type = stat.first;
     const std::unordered_map<std::string, StatData>& mm = stat.second;
     bool is_memory = (type == "Device Storage"  || type == "Pool Memory");
@@ -119,8 +256,14 @@ void AggregateStats::DumpTable(std::ostream& os, int sort_by, int ascending) {
         << (is_memory ? "Max Use  (kB)" : "Max Time (ms)")
         << " "
         << std::setw(16) << std::right
-        << (is_memory ? "Avg Use  (kB)" : "Avg Time (ms)")
-        << std::endl;
+        << (is_memory ? "Avg Use  (kB)" : "Avg Time (ms)");
+    if (!is_memory) {
+      for (const auto& percentile : kPercentiles) {
+        os << " " << std::setw(16) << std::right
+           << (std::string(percentile.second) + " Time (ms)");
+      }
+    }
+    os << std::endl;
     os << std::setw(25) << std::left  << "----"
         << std::setw(16) << std::right << "-----------"
         << " "
@@ -134,8 +277,13 @@ void AggregateStats::DumpTable(std::ostream& os, int sort_by, int ascending) {
         << "-------------"
         << " "
         << std::setw(16) << std::right
-        << "-------------"
-        << std::endl;
+        << "-------------";
+    if (!is_memory) {
+      for (size_t i = 0; i < kPercentiles.size(); ++i) {
+        os << " " << std::setw(16) << std::right << "-------------";
+      }
+    }
+    os << std::endl;
     auto heap = BuildHeap(mm, sort_by, ascending);
     while (!heap.empty()) {
       const std::string& name = heap.top().second;
@@ -157,6 +305,16 @@ void AggregateStats::DumpTable(std::ostream& os, int sort_by, int ascending) {
            << (data.type_ == AggregateStats::StatData::kCounter ?
                     ByteToKilobyte((data.max_aggregate_ - data.min_aggregate_) / 2) :
                     MicroToMilli(static_cast<double>(data.total_aggregate_)/ data.total_count_));
+        if (!is_memory) {
+          for (const auto& percentile : kPercentiles) {
+            os << " " << std::fixed << std::setw(16) << std::setprecision(4) << std::right;
+            if (data.type_ == StatData::kDuration) {
+              os << MicroToMilli(DurationPercentile(data, percentile.first));
+            } else {
+              os << "-";
+            }
+          }
+        }
         os << std::endl;
       }
       heap.pop();
@@ -174,7 +332,8 @@ void AggregateStats::DumpJson(std::ostream& os, int sort_by, int ascending) {
   std::stringstream memory_ss;
   std::stringstream time_ss;
   std::stringstream *ss;
-  for (const auto& stat : stats_) {
+  const StatMap stats = WithPerShapeStats();
+  for (const auto& stat : stats) {
     const std::string& type = stat.first;
     const std::unordered_map<std::string, StatData>& mm = stat.second;
     bool is_memory = (type == "Device Storage"  || type == "Pool Memory");
@@ -217,8 +376,16 @@ void AggregateStats::DumpJson(std::ostream& os, int sort_by, int ascending) {
             << std::setprecision(4)
             << (data.type_ == AggregateStats::StatData::kCounter ?
                  ByteToKilobyte((data.max_aggregate_ - data.min_aggregate_) / 2) :
-                 MicroToMilli(static_cast<double>(data.total_aggregate_) /  data.total_count_))
-            << std::endl
+                 MicroToMilli(static_cast<double>(data.total_aggregate_) /  data.total_count_));
+        if (data.type_ == AggregateStats::StatData::kDuration) {
+          for (const auto& percentile : kPercentiles) {
+            *ss << "," << std::endl
+                << "                \"" << percentile.second << "\": "
+                << std::setprecision(4)
+                << MicroToMilli(DurationPercentile(data, percentile.first));
+          }
+        }
+        *ss << std::endl
             << "            }" << std::endl;
       }
       heap.pop();
@@ -246,6 +413,7 @@ void AggregateStats::DumpJson(std::ostream& os, int sort_by, int ascending) {
 void AggregateStats::clear() {
   std::unique_lock<std::mutex> lk(m_);
   stats_.clear();
+  per_shape_.clear();
 }
 
 }  // namespace profiler
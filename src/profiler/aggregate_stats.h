@@ -25,6 +25,9 @@
 #include <cstdint>
 #include <ostream>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "./profiler.h"
 
 namespace mxnet {
@@ -32,6 +35,57 @@ namespace profiler {
 
 struct ProfileStat;
 
+/*!
+ * \brief Log-linear histogram of durations in the style of HdrHistogram. Values below 128 have
+ *  a bucket each, larger values share one of 64 buckets per power of two, so any percentile
+ *  is within 1% of a recorded value. Buckets are only allocated up to the largest value seen.
+ */
+class LatencyHistogram {
+ public:
+  /*! \brief add a value, constant time */
+  void Record(uint64_t value);
+  /*!
+   * \brief value below which a fraction q of the recorded values lie
+   * \param q quantile in [0, 1]
+   * \return the percentile, 0 if nothing was recorded
+   */
+  uint64_t Percentile(double q) const;
+  /*! \return number of recorded values */
+  uint64_t count() const {
+    return count_;
+  }
+
+  static size_t BucketIndex(uint64_t value);
+  /*! \return middle of the range of values falling in a bucket */
+  static uint64_t BucketValue(size_t index);
+
+ private:
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+};
+
+/*!
+ * \brief Signatures of the shapes operators run with, for the per shape statistics. A call
+ *  only carries a hash of its shapes; the signature is formatted the first time a thread sees
+ *  the hash and looked up when the statistics are dumped.
+ */
+class ShapeSignatures {
+ public:
+  /*! \brief register the signature of hash, calling format() only for a hash new to this thread */
+  template<typename Format>
+  static void Add(uint64_t hash, const Format& format) {
+    if (IsNew(hash)) {
+      Insert(hash, format());
+    }
+  }
+  /*! \return the signature of hash, empty if it was never added */
+  static std::string Get(uint64_t hash);
+
+ private:
+  static bool IsNew(uint64_t hash);
+  static void Insert(uint64_t hash, std::string&& signature);
+};
+
 class AggregateStats {
  public:
   struct StatData {
@@ -49,11 +103,16 @@ class AggregateStats {
     uint64_t  total_aggregate_ = 0;
     uint64_t  max_aggregate_ = 0;
     uint64_t  min_aggregate_ = INT_MAX;
+    /*! \brief distribution of the durations, kDuration only */
+    LatencyHistogram histogram_;
   };
 
+
   /*!
    * \brief Record aggregate profile data
    * \param stat SIngle profile statistics to add to the accumulates statistics
+   * \note A stat with a shape hash is also recorded per shape. The dumps show these in
+   *  the category's per shape counterpart, under the name followed by the signature.
    */
   void OnProfileStat(const ProfileStat& stat);
   /*!
@@ -74,14 +133,22 @@ class AggregateStats {
   void clear();
   /* !\brief by which stat to sort */
   enum class SortBy {
-    Total, Avg, Min, Max, Count
+    Total, Avg, Min, Max, Count, P99
   };
 
  private:
   /*! \brief Should rarely collide, so most locks should occur only in user-space (futex) */
   std::mutex m_;
+  using StatMap = std::map<std::string, std::unordered_map<std::string, StatData>>;
+  /*! \brief stats_ with the per shape categories added, m_ must be held */
+  StatMap WithPerShapeStats() const;
   /* !\brief Stat type -> State name -> Stats */
-  std::map<std::string, std::unordered_map<std::string, StatData>> stats_;
+  StatMap stats_;
+  /*!
+   * \brief Entry of stats_ -> shape hash -> Stats. The address of an entry does not change
+   *  while it is in stats_.
+   */
+  std::unordered_map<const StatData*, std::unordered_map<uint64_t, StatData>> per_shape_;
 };
 
 }  // namespace profiler
@@ -0,0 +1,244 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file binary_trace.cc
+ * \brief compact binary profiler output, streamed to a file while profiling
+ */
+#include "./binary_trace.h"
+#include <dmlc/logging.h>
+#include <dmlc/thread_local.h>
+#include <algorithm>
+
+namespace mxnet {
+namespace profiler {
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord is written to the trace as is");
+
+/*!
+ * \brief Single producer, single consumer ring of events. The owning thread advances head_,
+ *  the writer advances tail_.
+ */
+struct BinaryTrace::ThreadBuffer {
+  ThreadBuffer(size_t size, uint16_t thread)
+    : records(size), mask(size - 1), thread(thread) {}
+
+  /*! \return whether all the records fit, called by the owning thread */
+  bool Push(const TraceRecord* data, size_t count) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head + count - tail_.load(std::memory_order_acquire) > records.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      records[(head + i) & mask] = data[i];
+    }
+    head_.store(head + count, std::memory_order_release);
+    return true;
+  }
+
+  /*! \brief append the buffered records to out, called by the writer */
+  void Drain(std::vector<TraceRecord>* out) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; ++i) {
+      out->push_back(records[i & mask]);
+    }
+    tail_.store(head, std::memory_order_release);
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+  }
+
+  std::vector<TraceRecord> records;
+  const size_t mask;
+  const uint16_t thread;
+  /*! \brief string ids already looked up by the owning thread */
+  std::unordered_map<std::string, uint32_t> ids;
+  std::string key;
+
+ private:
+  std::atomic<uint64_t> head_{0};
+  /*! \brief keeps the positions of the two threads on different cache lines */
+  char padding_[64];
+  std::atomic<uint64_t> tail_{0};
+};
+
+namespace {
+
+/*! \brief buffer of the calling thread, released when the thread exits */
+struct TraceThreadState {
+  uint64_t trace_id = 0;
+  std::shared_ptr<void> buffer;
+};
+
+std::atomic<uint64_t> trace_count{0};
+
+size_t RoundUpPowerOf2(size_t size) {
+  size_t rounded = 16;
+  while (rounded < size) rounded <<= 1;
+  return rounded;
+}
+
+}  // namespace
+
+BinaryTrace::BinaryTrace(size_t buffer_size)
+  : id_(++trace_count), buffer_size_(RoundUpPowerOf2(buffer_size)) {}
+
+BinaryTrace::~BinaryTrace() {
+  Close();
+}
+
+BinaryTrace::ThreadBuffer* BinaryTrace::LocalBuffer() {
+  TraceThreadState* state = dmlc::ThreadLocalStore<TraceThreadState>::Get();
+  if (state->trace_id != id_) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    std::shared_ptr<ThreadBuffer> buffer =
+      std::make_shared<ThreadBuffer>(buffer_size_, static_cast<uint16_t>(num_threads_++));
+    buffers_.push_back(buffer);
+    state->trace_id = id_;
+    state->buffer = buffer;
+  }
+  return static_cast<ThreadBuffer*>(state->buffer.get());
+}
+
+uint32_t BinaryTrace::Intern(ThreadBuffer* buffer, const char* s) {
+  buffer->key.assign(s);
+  auto it = buffer->ids.find(buffer->key);
+  if (it != buffer->ids.end()) {
+    return it->second;
+  }
+  uint32_t id;
+  {
+    std::lock_guard<std::mutex> lock(strings_mutex_);
+    auto inserted = string_ids_.emplace(buffer->key, static_cast<uint32_t>(strings_.size()));
+    if (inserted.second) {
+      strings_.push_back(buffer->key);
+    }
+    id = inserted.first->second;
+  }
+  buffer->ids.emplace(buffer->key, id);
+  return id;
+}
+
+void BinaryTrace::Add(const char* name, const char* category, uint32_t process,
+                      TraceRecord* records, size_t count) {
+  ThreadBuffer* buffer = LocalBuffer();
+  const uint32_t name_id = Intern(buffer, name);
+  const uint32_t category_id = Intern(buffer, category);
+  for (size_t i = 0; i < count; ++i) {
+    records[i].name = name_id;
+    records[i].category = category_id;
+    records[i].process = process;
+    records[i].thread = buffer->thread;
+    records[i].reserved = 0;
+  }
+  if (!buffer->Push(records, count)) {
+    dropped_ += count;
+  }
+}
+
+void BinaryTrace::WriteChunk(ChunkType type, uint32_t count, const void* data, uint64_t size) {
+  const uint32_t header[] = {static_cast<uint32_t>(type), count};
+  file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  file_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  file_.write(static_cast<const char*>(data), size);
+}
+
+void BinaryTrace::Open(const std::string& filename, const std::vector<std::string>& processes) {
+  Close();
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  file_.open(filename, std::ios::binary | std::ios::trunc | std::ios::out);
+  CHECK(file_.is_open()) << "Failed to open the profiler trace " << filename;
+  const uint64_t magic = kMagic;
+  const uint32_t header[] = {kVersion, static_cast<uint32_t>(sizeof(TraceRecord))};
+  file_.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  std::string names;
+  for (const std::string& process : processes) {
+    const uint32_t length = static_cast<uint32_t>(process.size());
+    names.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    names.append(process);
+  }
+  WriteChunk(kProcessChunk, static_cast<uint32_t>(processes.size()), names.data(), names.size());
+  strings_written_ = 0;
+  file_.flush();
+}
+
+void BinaryTrace::Close() {
+  Flush();
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  if (file_.is_open()) {
+    file_.close();
+  }
+}
+
+bool BinaryTrace::is_open() {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  return file_.is_open();
+}
+
+void BinaryTrace::Flush() {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+  {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex_);
+    // forget the buffers of exited threads once they are drained
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                    return buffer.use_count() == 1 && buffer->empty();
+                                  }),
+                   buffers_.end());
+    buffers = buffers_;
+  }
+  staging_.clear();
+  for (const auto& buffer : buffers) {
+    buffer->Drain(&staging_);
+  }
+  const uint64_t dropped = dropped_.exchange(0);
+  if (!file_.is_open()) {
+    return;
+  }
+  // the records were drained first, so the table has every string they use
+  std::string strings;
+  uint32_t num_strings = 0;
+  {
+    std::lock_guard<std::mutex> strings_lock(strings_mutex_);
+    for (; strings_written_ < strings_.size(); ++strings_written_, ++num_strings) {
+      const uint32_t entry[] = {static_cast<uint32_t>(strings_written_),
+                                static_cast<uint32_t>(strings_[strings_written_].size())};
+      strings.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+      strings.append(strings_[strings_written_]);
+    }
+  }
+  if (num_strings) {
+    WriteChunk(kStringChunk, num_strings, strings.data(), strings.size());
+  }
+  if (!staging_.empty()) {
+    WriteChunk(kRecordChunk, static_cast<uint32_t>(staging_.size()), staging_.data(),
+               staging_.size() * sizeof(TraceRecord));
+  }
+  if (dropped) {
+    WriteChunk(kDroppedChunk, 0, &dropped, sizeof(dropped));
+  }
+  file_.flush();
+}
+
+}  // namespace profiler
+}  // namespace mxnet
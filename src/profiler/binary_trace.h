@@ -0,0 +1,152 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file binary_trace.h
+ * \brief compact binary profiler output, streamed to a file while profiling
+ */
+#ifndef MXNET_PROFILER_BINARY_TRACE_H_
+#define MXNET_PROFILER_BINARY_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mxnet {
+namespace profiler {
+
+/*!
+ * \brief One event of a binary trace: a chrome://tracing event whose name and category are
+ *  ids into the string table of the trace
+ */
+struct TraceRecord {
+  /*! \brief timestamp in microseconds */
+  uint64_t timestamp;
+  /*! \brief duration of a complete event, value of a counter or scope of an instant marker */
+  uint64_t value;
+  uint32_t name;
+  uint32_t category;
+  /*! \brief device index, or BinaryTrace::kCategoryProcess to group the event by category */
+  uint32_t process;
+  /*! \brief index of the thread which recorded the event */
+  uint16_t thread;
+  /*! \brief chrome://tracing event type (ProfileStat::EventType) */
+  char phase;
+  uint8_t reserved;
+};
+
+/*!
+ * \brief Streams profiler events to a binary file.
+ *
+ * Every thread recording events owns a fixed size ring buffer, so adding an event to the
+ * trace is a copy into that buffer and never takes a lock or allocates, except the first time
+ * a thread sees a name. This does not cover aggregate_stats: the profiler also adds each event
+ * to the AggregateStats shared by all threads, under its mutex. A single writer (the
+ * profiler's writer thread) periodically moves the buffered events to the file, so the memory
+ * used does not grow with the length of the run. Events which do not fit in a full buffer are
+ * dropped and counted in the trace.
+ *
+ * File layout, all integers little endian: uint64 magic, uint32 version, uint32 record size,
+ * followed by chunks of uint32 type, uint32 count, uint64 payload bytes and the payload:
+ *   kProcessChunk  count names of the device processes, each uint32 length and characters
+ *   kStringChunk   count strings, each uint32 id, uint32 length and characters
+ *   kRecordChunk   count TraceRecords
+ *   kDroppedChunk  uint64 number of events dropped since the previous chunk
+ * A string is always written before the first record using it, so a trace cut short by a
+ * crash is still readable. mxnet.profiler.trace_to_json and tools/trace2json.py convert a
+ * trace to chrome://tracing JSON.
+ */
+class BinaryTrace {
+ public:
+  enum ChunkType {
+    kProcessChunk = 1,
+    kStringChunk = 2,
+    kRecordChunk = 3,
+    kDroppedChunk = 4
+  };
+  static const uint64_t kMagic = 0x314543415254584DULL;  // "MXTRACE1"
+  static const uint32_t kVersion = 1;
+  static const uint32_t kCategoryProcess = 0xffffffffU;
+
+  /*! \param buffer_size number of events buffered per thread, rounded up to a power of 2 */
+  explicit BinaryTrace(size_t buffer_size);
+  ~BinaryTrace();
+
+  /*!
+   * \brief Start writing the trace to a file, closing the previous one
+   * \param filename Output file
+   * \param processes Names of the device processes, indexed by TraceRecord::process
+   */
+  void Open(const std::string& filename, const std::vector<std::string>& processes);
+  /*! \brief Write the buffered events and close the file */
+  void Close();
+  /*! \return whether a file is open */
+  bool is_open();
+  /*!
+   * \brief Record the events of one statistic from the calling thread
+   * \param name Event name
+   * \param category Event categories (comma-delimited)
+   * \param process Device index or kCategoryProcess
+   * \param records Events to record, name, category, process and thread are filled in here
+   * \param count Number of events
+   * \note All the events are dropped if they do not fit in the thread's buffer
+   */
+  void Add(const char* name, const char* category, uint32_t process,
+           TraceRecord* records, size_t count);
+  /*! \brief Move the buffered events of all threads to the file, called by the writer */
+  void Flush();
+  /*! \return number of events dropped since the last Flush */
+  uint64_t dropped() const {
+    return dropped_;
+  }
+
+ private:
+  struct ThreadBuffer;
+
+  ThreadBuffer* LocalBuffer();
+  uint32_t Intern(ThreadBuffer* buffer, const char* s);
+  void WriteChunk(ChunkType type, uint32_t count, const void* data, uint64_t size);
+
+  /*! \brief distinguishes the thread local buffers of different traces */
+  const uint64_t id_;
+  const size_t buffer_size_;
+  /*! \brief buffers of all threads which recorded events */
+  std::mutex buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers_;
+  uint32_t num_threads_ = 0;
+  /*! \brief string table, shared by all threads and only grown */
+  std::mutex strings_mutex_;
+  std::unordered_map<std::string, uint32_t> string_ids_;
+  std::vector<std::string> strings_;
+  /*! \brief writer state, the file and the number of strings it holds */
+  std::mutex writer_mutex_;
+  std::ofstream file_;
+  size_t strings_written_ = 0;
+  std::vector<TraceRecord> staging_;
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace profiler
+}  // namespace mxnet
+#endif  // MXNET_PROFILER_BINARY_TRACE_H_
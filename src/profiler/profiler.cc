@@ -78,6 +78,9 @@ Profiler::Profiler()
 
   this->profile_stat[cpu_num_ + gpu_num_ + 1].dev_name_ = "cpu shared/";
 
+  this->binary_trace_.reset(new BinaryTrace(
+    dmlc::GetEnv("MXNET_PROFILER_TRACE_BUFFER_SIZE", static_cast<size_t>(1 << 16))));
+
   this->mode_ = dmlc::GetEnv("MXNET_PROFILER_MODE", this->mode_);
   if (dmlc::GetEnv("MXNET_PROFILER_AUTOSTART", 0)) {
     this->state_ = ProfilerState::kRunning;
@@ -118,6 +121,10 @@ void Profiler::SetState(ProfilerState state) {
   // once running, output will be enabled.
   if (state == kRunning) {
     this->enable_output_ = true;
+    if (binary_output_) {
+      // Reopen a trace closed by the final dump
+      SetTraceWriter(true);
+    }
     set_paused(false);
   } else {
     set_paused(true);
@@ -128,16 +135,30 @@ void Profiler::SetConfig(int mode,
                          std::string output_filename,
                          bool continuous_dump,
                          float dump_period,
-                         bool aggregate_stats) {
+                         bool aggregate_stats,
+                         bool binary_trace) {
   CHECK(!continuous_dump || dump_period > 0);
   std::lock_guard<std::recursive_mutex> lock{this->m_};
   this->mode_ = mode;
+  // Finish the binary trace of the previous configuration, a new one is opened below
+  binary_trace_->Close();
   this->filename_ = output_filename;
   // Remove the output file to start
   if (!this->filename_.empty()) {
     ::unlink(this->filename_.c_str());
   }
-  SetContinuousProfileDump(continuous_dump, dump_period);
+  if (binary_trace) {
+    // The binary trace is always streamed, there is no json dump to schedule
+    SetContinuousProfileDump(false, dump_period);
+    binary_output_ = true;
+    SetTraceWriter(true);
+  } else {
+    if (binary_output_) {
+      binary_output_ = false;
+      SetTraceWriter(false);
+    }
+    SetContinuousProfileDump(continuous_dump, dump_period);
+  }
   // Adjust whether storing aggregate stats as necessary
   if (aggregate_stats) {
     if (!aggregate_stats_) {
@@ -171,6 +192,15 @@ void Profiler::DumpProfile(bool perform_cleanup) {
   if (perform_cleanup) {
     SetContinuousProfileDump(false, 1.0f);
   }
+  if (binary_output_) {
+    if (perform_cleanup) {
+      SetTraceWriter(false);
+      enable_output_ = false;
+    } else {
+      binary_trace_->Flush();
+    }
+    return;
+  }
   std::ofstream file;
   const bool first_pass = ++profile_dump_count_ == 1;
   const bool last_pass = perform_cleanup || !continuous_dump_;
@@ -253,6 +283,68 @@ void Profiler::DumpProfile(bool perform_cleanup) {
                                                     // Otherwise, profiling stops.
 }
 
+void Profiler::ExcludeQueuedFromAggregate() {
+  std::lock_guard<std::recursive_mutex> lock{this->m_};
+  std::vector<ProfileStat *> queued;
+  auto exclude = [&queued](DeviceStats *d) {
+    ProfileStat *stat;
+    while (d->opr_exec_stats_->try_dequeue(stat)) {
+      stat->enable_aggregate_ = false;
+      queued.push_back(stat);
+    }
+    d->opr_exec_stats_->enqueue_bulk(queued.begin(), queued.size());
+    queued.clear();
+  };
+  for (size_t i = 0; i < DeviceCount(); ++i) {
+    exclude(&profile_stat[i]);
+  }
+  exclude(&general_stats_);
+}
+
+static constexpr char TRACE_THREAD_NAME[] = "BinaryTraceWriter";
+
+void Profiler::SetTraceWriter(bool run) {
+  std::lock_guard<std::recursive_mutex> lock{this->m_};
+  std::shared_ptr<dmlc::ThreadGroup::Thread> old_thread =
+    thread_group_->thread_by_name(TRACE_THREAD_NAME);
+  if (run) {
+    if (!binary_trace_->is_open()) {
+      std::vector<std::string> processes;
+      for (size_t i = 0; i < DeviceCount(); ++i) {
+        processes.emplace_back(profile_stat[i].dev_name_);
+      }
+      binary_trace_->Open(filename_, processes);
+    }
+    if (old_thread && old_thread->is_shutdown_requested()) {
+      // Wait for a writer which is stopping, as in SetContinuousProfileDump()
+      if (old_thread->joinable()) {
+        old_thread->join();
+      } else {
+        do {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } while (thread_group_->thread_by_name(TRACE_THREAD_NAME));
+      }
+      old_thread.reset();
+    }
+    if (!old_thread) {
+      // Frequent enough that the per-thread buffers rarely fill up between two writes
+      dmlc::CreateTimer(
+        TRACE_THREAD_NAME,
+        std::chrono::milliseconds(dmlc::GetEnv("MXNET_PROFILER_TRACE_FLUSH_MS", 20)),
+        thread_group_.get(),
+        [this]() -> int {
+          binary_trace_->Flush();
+          return 0;
+        });
+    }
+  } else {
+    if (old_thread) {
+      old_thread->request_shutdown();
+    }
+    binary_trace_->Close();
+  }
+}
+
 static constexpr char TIMER_THREAD_NAME[] = "DumpProfileTimer";
 
 void Profiler::SetContinuousProfileDump(bool continuous_dump, float delay_in_seconds) {
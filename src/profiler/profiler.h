@@ -27,6 +27,7 @@
 
 #include <dmlc/concurrentqueue.h>
 #include <dmlc/thread_group.h>
+#include <dmlc/thread_local.h>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -35,6 +36,7 @@
 #include <array>
 #include "./vtune.h"
 #include "./aggregate_stats.h"
+#include "./binary_trace.h"
 #include "./nvtx.h"
 #include "../common/utils.h"
 
@@ -168,6 +170,34 @@ struct ProfileStat {
     }
   }
 
+  /*!
+   * \brief Write event statistics to a binary trace
+   * \param trace Binary trace
+   * \param process Device index, or BinaryTrace::kCategoryProcess to group by category
+   * \note A begin/end pair is written as a single complete event
+   */
+  void EmitTrace(BinaryTrace *trace, uint32_t process) const {
+    TraceRecord records[sizeof(items_) / sizeof(items_[0])];
+    size_t count = 0;
+    if (items_[0].enabled_ && items_[0].event_type_ == kDurationBegin &&
+        items_[1].enabled_ && items_[1].event_type_ == kDurationEnd && !items_[2].enabled_) {
+      records[0].phase = static_cast<char>(kComplete);
+      records[0].timestamp = items_[0].timestamp_;
+      records[0].value = items_[1].timestamp_ - items_[0].timestamp_;
+      count = 1;
+    } else {
+      for (size_t i = 0; i < sizeof(items_) / sizeof(items_[0]); ++i) {
+        if (items_[i].enabled_) {
+          records[count].phase = static_cast<char>(items_[i].event_type_);
+          records[count].timestamp = items_[i].timestamp_;
+          records[count].value = TraceValue(i);
+          ++count;
+        }
+      }
+    }
+    trace->Add(name_.c_str(), categories_.c_str(), process, records, count);
+  }
+
   /*!
    * \brief Virtual destructor
    */
@@ -183,6 +213,12 @@ struct ProfileStat {
     }
   }
 
+  /*!
+   * \brief Shapes this stat is also aggregated under, see AggregateStats::OnProfileStat()
+   * \return Hash of the shapes registered in ShapeSignatures, 0 if none
+   */
+  virtual uint64_t shape_hash() const { return 0; }
+
  protected:
   /*!
    * \brief Override to emit extra items within the json event data block. Append with a comma ",".
@@ -191,6 +227,13 @@ struct ProfileStat {
    */
   virtual void EmitExtra(std::ostream *os, size_t idx) {}
 
+  /*!
+   * \brief Override to store extra data with a sub-event in the binary trace
+   * \param idx Sub-even index (index into items_) being written
+   * \return The value of TraceRecord
+   */
+  virtual uint64_t TraceValue(size_t idx) const { return 0; }
+
   /*!
    * \brief Emit sub-event statistics
    * \param os Output stream
@@ -273,11 +316,14 @@ class Profiler {
    * \param output_filename profile output file name
    * \param continuous_dump true if profile information should be periodically dumped
    * \param dump_period Period (in seconds) of profile info dumping
+   * \param aggregate_stats Whether to maintain aggregate stats
+   * \param binary_trace Whether to stream a binary trace instead of dumping json
    */
   void SetConfig(int mode, std::string output_filename,
                  bool continuous_dump,
                  float dump_period,
-                 bool aggregate_stats);
+                 bool aggregate_stats,
+                 bool binary_trace = false);
 
   /*! \return mode of profiler */
   inline int GetMode() const {
@@ -297,6 +343,11 @@ class Profiler {
    * \param perform_cleanup Close off the json trace structures (ie last pass)
    */
   void DumpProfile(bool perform_cleanup = true);
+  /*!
+   * \brief keep the stats queued so far out of AggregateStats, they are still
+   *        written by the next dump
+   */
+  void ExcludeQueuedFromAggregate();
 
   /*! \return the profiler init time, time unit is microsecond (10^-6) s */
   uint64_t MSHADOW_CINLINE GetInitTime() const {
@@ -317,6 +368,13 @@ class Profiler {
   template<typename StatType, typename SetExtraInfoFunction, typename ...Args>
   void AddNewProfileStat(SetExtraInfoFunction set_extra_info_function, Args... args) {
     if (!paused_) {
+      if (binary_output_) {
+        // written straight to the thread's trace buffer, nothing is queued
+        StatType stat(args...);
+        set_extra_info_function(&stat);
+        AddTraceStat(stat);
+        return;
+      }
       std::unique_ptr<StatType> stat = CreateProfileStat<StatType>(args...);
       set_extra_info_function(stat.get());
       AddProfileStat(&stat);
@@ -429,6 +487,23 @@ class Profiler {
     general_stats_.opr_exec_stats_->enqueue(stat->release());
   }
 
+  /*!
+   * \brief Write a profile statistic object to the binary trace
+   * \tparam StatType Type of the statistic object
+   * \param stat The statistic object
+   */
+  template<typename StatType>
+  inline void AddTraceStat(const StatType &stat) {
+    stat.EmitTrace(binary_trace_.get(), BinaryTrace::kCategoryProcess);
+    std::shared_ptr<AggregateStats> ptr_aggregate_stats = aggregate_stats_;
+    if (ptr_aggregate_stats) {
+      ptr_aggregate_stats->OnProfileStat(stat);
+    }
+  }
+
+  /*! \brief Start or stop the thread writing the binary trace */
+  void SetTraceWriter(bool run);
+
   /*! \brief generate device information following chrome profile file format */
   void EmitPid(std::ostream *os, const std::string& name, size_t pid);
 
@@ -476,6 +551,10 @@ class Profiler {
   std::shared_ptr<dmlc::ThreadGroup> thread_group_ = std::make_shared<dmlc::ThreadGroup>();
   /* !\brief pids */
   std::unordered_set<uint32_t> process_ids_;
+  /*! \brief Whether statistics go to the binary trace instead of the json dump queues */
+  volatile bool binary_output_ = false;
+  /*! \brief Binary trace, streamed to filename_ by a writer thread */
+  std::unique_ptr<BinaryTrace> binary_trace_;
 };
 
 #ifdef MXNET_USE_VTUNE
@@ -646,6 +725,10 @@ struct ProfileCounter : public ProfileObject {
       *os << "        \"args\": { \"" << name_.c_str() << "\": " << value_ << " },\n";
     }
 
+    uint64_t TraceValue(size_t idx) const override {
+      return value_;
+    }
+
     /*!
      * \brief Save aggregate data for this stat
      * \param data Stat data
@@ -751,6 +834,7 @@ class ProfileDuration : public ProfileObject {
         CHECK_GE(items_[kStop].timestamp_, items_[kStart].timestamp_);
         const uint64_t duration = items_[kStop].timestamp_ - items_[kStart].timestamp_;
         data->total_aggregate_ += duration;
+        data->histogram_.Record(duration);
         if (duration > data->max_aggregate_) {
           data->max_aggregate_ = duration;
         }
@@ -1067,6 +1151,9 @@ struct ProfileMarker {
       ProfileStat::EmitExtra(os, idx);
       *os << "        \"s\": \"" << scope_char_ << "\",\n";
     }
+    uint64_t TraceValue(size_t idx) const override {
+      return static_cast<uint64_t>(scope_char_);
+    }
     const char scope_char_;
   };
 
@@ -1123,6 +1210,8 @@ struct ProfileOperator : public ProfileEvent {
     std::vector<mxnet::TShape> inputs_;
     std::vector<mxnet::TShape> outputs_;
     std::unordered_map<std::string, std::string> attr_;
+    /*! \brief hash of the shapes registered in ShapeSignatures, 0 if not recorded */
+    uint64_t shape_hash_ = 0;
     std::string to_string() const {
       std::stringstream ss;
       if (!inputs_.empty()) {
@@ -1136,6 +1225,9 @@ struct ProfileOperator : public ProfileEvent {
         ss << "]";
       }
       if (!outputs_.empty()) {
+        if (!inputs_.empty()) {
+          ss << " ";
+        }
         ss << "out: [";
         for (size_t i = 0, n = outputs_.size(); i < n; ++i) {
           if (i) {
@@ -1182,10 +1274,24 @@ struct ProfileOperator : public ProfileEvent {
     dev_type_ = dev_type;
     dev_id_ = dev_id;
     if (profiling_) {
+      current_attributes() = attributes_.get();
       ProfileEvent::start();
       as_task_.start();
     }
   }
+  /*!
+   * \brief Attributes of the operator started last on this thread, for its engine function
+   *  to record the shapes in. nullptr unless aggregate stats are collected.
+   * \note The engine resets it once the function returns
+   */
+  static Attributes *&current_attributes() {
+#if DMLC_CXX11_THREAD_LOCAL
+    static thread_local Attributes *attributes = nullptr;
+#else
+    static MX_THREAD_LOCAL Attributes *attributes = nullptr;
+#endif
+    return attributes;
+  }
   /*!
    * \brief Stop the profiling scope
    */
@@ -1213,11 +1319,9 @@ struct ProfileOperator : public ProfileEvent {
                        const Attributes *attributes)
       : DurationStat(ProfileStat::kDurationBegin, ProfileStat::kDurationEnd)
         , dev_type_(dev_type)
-        , dev_id_(dev_id) {
+        , dev_id_(dev_id)
+        , shape_hash_(attributes ? attributes->shape_hash_ : 0) {
       name_.set(name);
-      if (attributes) {
-        name_.append(attributes->to_string().c_str());
-      }
       if (IsSubOperatorOfCustom(name)) {
         categories_.set(custom_op_domain.name());
       } else {
@@ -1226,10 +1330,15 @@ struct ProfileOperator : public ProfileEvent {
       items_[kStart].timestamp_ = start_time;
       items_[kStop].timestamp_ = stop_time;
     }
+    uint64_t shape_hash() const override {
+      return shape_hash_;
+    }
     /*! \brief device type: CPU: 1, GPU: 2, CPUPinned: 3 */
     mxnet::Context::DeviceType dev_type_;
     /*! \brief device id */
     uint32_t dev_id_;
+    /*! \brief hash of the input and output shapes, 0 if not recorded */
+    uint64_t shape_hash_;
   };
 
  private:
@@ -1312,6 +1421,22 @@ inline void Profiler::AddProfileStat<ProfileOperator::OprExecStat>(
   dev_stat.opr_exec_stats_->enqueue((*opr_stat).release());
 }
 
+/*!
+ * \brief Explicit 'Profiler::AddTraceStat' override for 'OprExecStat'
+ * \param opr_stat The operator statistic, written to the process of its device
+ */
+template<>
+inline void Profiler::AddTraceStat<ProfileOperator::OprExecStat>(
+  const ProfileOperator::OprExecStat &opr_stat) {
+  const size_t idx = DeviceIndex(opr_stat.dev_type_, opr_stat.dev_id_);
+  CHECK_LT(idx, DeviceCount());
+  opr_stat.EmitTrace(binary_trace_.get(), static_cast<uint32_t>(idx));
+  std::shared_ptr<AggregateStats> ptr_aggregate_stats = aggregate_stats_;
+  if (ptr_aggregate_stats) {
+    ptr_aggregate_stats->OnProfileStat(opr_stat);
+  }
+}
+
 #undef VTUNE_ONLY_CODE  // This macro not meant to be used outside of this file
 
 }  // namespace profiler
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 #include "./profiler.h"
+#include "../storage/storage_manager.h"
 
 namespace mxnet {
 namespace storage {
@@ -75,6 +76,26 @@ class DeviceStorageProfiler {
     }
   }
 
+  /*!
+   * \brief Called after the pool of a storage manager may have changed in order to record
+   *        the memory it holds from the device and the part of it cached for reuse
+   * \param ctx Context of the storage manager
+   * \param manager Storage manager
+   */
+  void OnPoolUpdate(const Context &ctx, const StorageManager &manager) {
+    profiler::Profiler *prof = profiler::Profiler::Get();
+    if (prof->IsProfiling(profiler::Profiler::kMemory)) {
+      size_t reserved, cached;
+      if (manager.PoolStats(&reserved, &cached)) {
+        Init();
+        const size_t idx = prof->DeviceIndex(ctx.dev_type, ctx.dev_id);
+        CHECK_LT(idx, pool_reserved_counters_.size()) << "Invalid device index: " << idx;
+        *pool_reserved_counters_[idx] = reserved;
+        *pool_cached_counters_[idx] = cached;
+      }
+    }
+  }
+
  private:
   /*!
    * \brief Lazy initialization.  No locks occur except for on the first pass
@@ -87,13 +108,28 @@ class DeviceStorageProfiler {
       if (mem_counters_.empty()) {
         profiler::Profiler *prof = profiler::Profiler::Get();
         const size_t device_count = prof->DeviceCount();
-        mem_counters_.reserve(device_count);
+        pool_reserved_counters_.reserve(device_count);
+        pool_cached_counters_.reserve(device_count);
+        for (size_t i = 0, n = device_count; i < n; ++i) {
+          std::string name = "Pool Reserved: ";
+          name += prof->DeviceName(i);
+          pool_reserved_counters_.emplace_back(
+            std::make_shared<profiler::ProfileCounter>(name.c_str(), &domain_));
+          name = "Pool Cached: ";
+          name += prof->DeviceName(i);
+          pool_cached_counters_.emplace_back(
+            std::make_shared<profiler::ProfileCounter>(name.c_str(), &domain_));
+        }
+        // filled last, since its emptiness guards the lazy initialization
+        std::vector<std::shared_ptr<profiler::ProfileCounter>> mem_counters;
+        mem_counters.reserve(device_count);
         for (size_t i = 0, n = device_count; i < n; ++i) {
           std::string name = "Memory: ";
           name += prof->DeviceName(i);
-          mem_counters_.emplace_back(std::make_shared<profiler::ProfileCounter>(name.c_str(),
-                                                                              &domain_));
+          mem_counters.emplace_back(std::make_shared<profiler::ProfileCounter>(name.c_str(),
+                                                                             &domain_));
         }
+        mem_counters_.swap(mem_counters);
       }
     }
   }
@@ -104,6 +140,10 @@ class DeviceStorageProfiler {
   std::mutex init_mutex_;
   /*! \brief Constant-sized vector of memory profile counters */
   std::vector<std::shared_ptr<profiler::ProfileCounter>> mem_counters_;
+  /*! \brief Constant-sized vector of counters for the memory held by pools */
+  std::vector<std::shared_ptr<profiler::ProfileCounter>> pool_reserved_counters_;
+  /*! \brief Constant-sized vector of counters for the memory cached by pools */
+  std::vector<std::shared_ptr<profiler::ProfileCounter>> pool_cached_counters_;
 };
 
 }  // namespace storage
@@ -0,0 +1,336 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * Copyright (c) 2020 by Contributors
+ * \file cpu_pooled_storage_manager.h
+ * \brief Storage manager with a rounded memory pool and per-thread caches on cpu.
+ */
+#ifndef MXNET_STORAGE_CPU_POOLED_STORAGE_MANAGER_H_
+#define MXNET_STORAGE_CPU_POOLED_STORAGE_MANAGER_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <dmlc/thread_local.h>
+#include <mxnet/base.h>
+#include <mxnet/storage.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "./storage_manager.h"
+#include "./cpu_device_storage.h"
+#include "../common/utils.h"
+
+namespace mxnet {
+namespace storage {
+
+/*!
+ * \brief Storage manager with a memory pool, with rounded size, on cpu.
+ *
+ * Sizes are rounded into buckets the same way as GPUPooledRoundedStorageManager:
+ * exp2(page), ..., exp2(X), 2*exp2(X), 3*exp2(X), ... where X is the linear cutoff set
+ * through MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF.
+ *
+ * Freed chunks first go to a small cache owned by the freeing thread, so that engine
+ * worker threads recycling buffers of the ops they run never take the pool lock. Chunks
+ * which do not fit into the thread cache (MXNET_CPU_MEM_POOL_THREAD_CACHE_SIZE bytes) are
+ * returned to the shared pool. Once the total amount of cached memory would exceed
+ * MXNET_CPU_MEM_POOL_LIMIT, freed chunks are handed back to the system instead.
+ */
+class CPUPooledRoundedStorageManager final : public StorageManager {
+ public:
+  /*!
+   * \brief Default constructor.
+   */
+  CPUPooledRoundedStorageManager() : pool_(std::make_shared<Pool>()) {
+    size_t page_size = dmlc::GetEnv("MXNET_CPU_MEM_POOL_PAGE_SIZE", 4096);
+    size_t cut_off = dmlc::GetEnv("MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF", 24);
+    // both limits are given in MB
+    const size_t limit = dmlc::GetEnv("MXNET_CPU_MEM_POOL_LIMIT", 0);
+    size_t thread_cache_size = dmlc::GetEnv("MXNET_CPU_MEM_POOL_THREAD_CACHE_SIZE", 16);
+    if (page_size < 64) {
+      LOG(FATAL) << "MXNET_CPU_MEM_POOL_PAGE_SIZE cannot be set to a value smaller than 64. " \
+                 << "Got: " << page_size << ".";
+    }
+    if (page_size != 1ul << common::ilog2ul(page_size - 1)) {
+      LOG(FATAL) << "MXNET_CPU_MEM_POOL_PAGE_SIZE must be a power of 2. Got: " << page_size << ".";
+    }
+    page_size = common::ilog2ul(page_size - 1);
+    if (cut_off < 20 || cut_off > LOG2_MAX_MEM) {
+      LOG(FATAL) << "MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF cannot be set to a value " \
+                 << "smaller than 20 or greater than " << LOG2_MAX_MEM << ". Got: " \
+                 << cut_off << ".";
+    }
+    if (cut_off < page_size) {
+      LOG(FATAL) << "MXNET_CPU_MEM_POOL_ROUND_LINEAR_CUTOFF cannot be set to a value " \
+                 << "smaller than log2 of MXNET_CPU_MEM_POOL_PAGE_SIZE. Got: " \
+                 << cut_off << " vs " << page_size << ".";
+    }
+#if !DMLC_CXX11_THREAD_LOCAL
+    // thread caches need to be flushed on thread exit
+    thread_cache_size = 0;
+#endif
+    pool_->page_size = page_size;
+    pool_->cut_off = cut_off;
+    pool_->limit = limit << 20;
+    pool_->thread_cache_size = thread_cache_size << 20;
+    pool_->memory_pool.resize((1ul << (LOG2_MAX_MEM - cut_off)) + cut_off);
+  }
+  /*!
+   * \brief Default destructor.
+   */
+  ~CPUPooledRoundedStorageManager() {
+    std::lock_guard<std::mutex> lock(pool_->mutex);
+    // chunks still held in thread caches are freed when their thread exits
+    pool_->alive = false;
+    pool_->ReleaseAllNoLock();
+  }
+
+  void Alloc(Storage::Handle* handle) override;
+  void Free(Storage::Handle handle) override;
+
+  void DirectFree(Storage::Handle handle) override {
+    if (handle.dptr == nullptr) return;
+    const size_t bucket = pool_->get_bucket(handle.size);
+    pool_->DirectFree(handle.dptr, bucket < pool_->memory_pool.size() ?
+                                   pool_->get_size(bucket) : handle.size);
+  }
+
+  void ReleaseAll() override {
+    ThreadCache *cache = LocalCache();
+    if (cache != nullptr) cache->Flush();
+    std::lock_guard<std::mutex> lock(pool_->mutex);
+    pool_->ReleaseAllNoLock();
+  }
+
+  bool PoolStats(size_t *reserved, size_t *cached) const override {
+    *reserved = pool_->reserved_bytes.load(std::memory_order_relaxed);
+    *cached = pool_->cached_bytes.load(std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  /*!
+   * \brief Pool state shared between the manager and the thread caches, which can outlive it.
+   */
+  struct Pool {
+    // protects memory_pool and alive
+    std::mutex mutex;
+    // false once the owning manager has been destroyed
+    bool alive = true;
+    // log2 of page size
+    size_t page_size;
+    // log2 of memory size before switching to exponential mode to linear mode
+    size_t cut_off;
+    // maximum number of bytes kept cached, 0 for no limit
+    size_t limit;
+    // maximum number of bytes kept cached by one thread
+    size_t thread_cache_size;
+    // bytes currently allocated from the system
+    std::atomic<size_t> reserved_bytes{0};
+    // bytes currently cached in the shared pool and the thread caches
+    std::atomic<size_t> cached_bytes{0};
+    // shared memory pool
+    std::vector<std::vector<void*>> memory_pool;
+
+    inline int div_pow2_round_up(size_t s, int divisor_log2) {
+      size_t result = s >> divisor_log2;
+      return static_cast<int>(result + (s > (result << divisor_log2) ? 1 : 0));
+    }
+    inline int get_bucket(size_t s) {
+      int log_size = common::ilog2ul(s - 1);
+      if (log_size > static_cast<int>(cut_off))
+        return div_pow2_round_up(s, cut_off) - 1 + cut_off;
+      else
+        return std::max(log_size, static_cast<int>(page_size));
+    }
+    inline size_t get_size(int bucket) {
+      if (bucket <= static_cast<int>(cut_off))
+        return 1ul << bucket;
+      else
+        return (bucket - cut_off + 1) * (1ul << cut_off);
+    }
+    /*!
+     * \brief Whether a chunk of the given size may be cached without exceeding the limit.
+     */
+    inline bool CanCache(size_t size) {
+      return limit == 0 || cached_bytes.load(std::memory_order_relaxed) + size <= limit;
+    }
+
+    void DirectFree(void *dptr, size_t size) {
+      Storage::Handle handle;
+      handle.dptr = dptr;
+      handle.size = size;
+      CPUDeviceStorage::Free(handle);
+      reserved_bytes -= size;
+    }
+
+    void ReleaseAllNoLock() {
+      for (size_t i = 0; i < memory_pool.size(); ++i) {
+        const size_t size = get_size(i);
+        for (void *dptr : memory_pool[i]) {
+          DirectFree(dptr, size);
+          cached_bytes -= size;
+        }
+        memory_pool[i].clear();
+      }
+    }
+  };
+
+  /*!
+   * \brief Per-thread front cache of free chunks.
+   */
+  struct ThreadCache {
+    explicit ThreadCache(const std::shared_ptr<Pool>& p)
+      : pool(p), memory_pool(p->memory_pool.size()) {}
+    ~ThreadCache() {
+      Flush();
+    }
+    /*!
+     * \brief Return all chunks of this thread to the shared pool (or the system if the
+     *  manager is gone).
+     */
+    void Flush() {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      for (size_t i = 0; i < memory_pool.size(); ++i) {
+        const size_t size = pool->get_size(i);
+        for (void *dptr : memory_pool[i]) {
+          if (pool->alive) {
+            pool->memory_pool[i].push_back(dptr);
+          } else {
+            pool->DirectFree(dptr, size);
+            pool->cached_bytes -= size;
+          }
+        }
+        memory_pool[i].clear();
+      }
+      bytes = 0;
+    }
+
+    std::shared_ptr<Pool> pool;
+    std::vector<std::vector<void*>> memory_pool;
+    // bytes currently held by this cache
+    size_t bytes = 0;
+  };
+
+  /*!
+   * \brief Get the cache of the calling thread for this manager, nullptr if disabled.
+   */
+  ThreadCache* LocalCache() {
+    if (pool_->thread_cache_size == 0) return nullptr;
+#if DMLC_CXX11_THREAD_LOCAL
+    static thread_local std::vector<std::unique_ptr<ThreadCache>> caches;
+    for (auto& cache : caches) {
+      if (cache->pool == pool_) return cache.get();
+    }
+    caches.emplace_back(new ThreadCache(pool_));
+    return caches.back().get();
+#else
+    return nullptr;
+#endif
+  }
+
+  // log2 of maximum page size. 16GB
+  const size_t LOG2_MAX_MEM = 34;
+  // pool state
+  std::shared_ptr<Pool> pool_;
+  DISALLOW_COPY_AND_ASSIGN(CPUPooledRoundedStorageManager);
+};  // class CPUPooledRoundedStorageManager
+
+inline void CPUPooledRoundedStorageManager::Alloc(Storage::Handle* handle) {
+  // Set dptr to nullptr when handle size is 0.
+  if (handle->size == 0) {
+    handle->dptr = nullptr;
+    return;
+  }
+
+  Pool *pool = pool_.get();
+  const int bucket = pool->get_bucket(handle->size);
+  const size_t size = pool->get_size(bucket);
+  if (static_cast<size_t>(bucket) >= pool->memory_pool.size()) {
+    // too large to be pooled
+    CPUDeviceStorage::Alloc(handle);
+    pool->reserved_bytes += handle->size;
+    return;
+  }
+  ThreadCache *cache = LocalCache();
+  if (cache != nullptr && !cache->memory_pool[bucket].empty()) {
+    handle->dptr = cache->memory_pool[bucket].back();
+    cache->memory_pool[bucket].pop_back();
+    cache->bytes -= size;
+    pool->cached_bytes -= size;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    auto&& reuse_pool = pool->memory_pool[bucket];
+    if (!reuse_pool.empty()) {
+      handle->dptr = reuse_pool.back();
+      reuse_pool.pop_back();
+      pool->cached_bytes -= size;
+      return;
+    }
+  }
+
+  Storage::Handle hd;
+  hd.size = size;
+  try {
+    CPUDeviceStorage::Alloc(&hd);
+  } catch (const dmlc::Error&) {
+    // give the cached memory back to the system and retry
+    ReleaseAll();
+    CPUDeviceStorage::Alloc(&hd);
+  }
+  pool->reserved_bytes += size;
+  handle->dptr = hd.dptr;
+}
+
+inline void CPUPooledRoundedStorageManager::Free(Storage::Handle handle) {
+  // Do nothing if dptr is nullptr. Otherwise, nullptr may be reused.
+  if (handle.dptr == nullptr) return;
+
+  Pool *pool = pool_.get();
+  const int bucket = pool->get_bucket(handle.size);
+  const size_t size = pool->get_size(bucket);
+  if (static_cast<size_t>(bucket) >= pool->memory_pool.size()) {
+    pool->DirectFree(handle.dptr, handle.size);
+    return;
+  }
+  if (!pool->CanCache(size)) {
+    pool->DirectFree(handle.dptr, size);
+    return;
+  }
+  ThreadCache *cache = LocalCache();
+  pool->cached_bytes += size;
+  if (cache != nullptr && cache->bytes + size <= pool->thread_cache_size) {
+    cache->memory_pool[bucket].push_back(handle.dptr);
+    cache->bytes += size;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  pool->memory_pool[bucket].push_back(handle.dptr);
+}
+
+}  // namespace storage
+}  // namespace mxnet
+
+#endif  // MXNET_STORAGE_CPU_POOLED_STORAGE_MANAGER_H_
@@ -24,6 +24,7 @@
 #include "./storage_manager.h"
 #include "./naive_storage_manager.h"
 #include "./pooled_storage_manager.h"
+#include "./cpu_pooled_storage_manager.h"
 #include "./cpu_shared_storage_manager.h"
 #include "./cpu_device_storage.h"
 #include "./gpu_device_storage.h"
@@ -67,7 +68,17 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
         storage::StorageManager *ptr = nullptr;
         switch (handle->ctx.dev_type) {
           case Context::kCPU: {
-            ptr = new storage::NaiveStorageManager<storage::CPUDeviceStorage>();
+            const char *type = getenv("MXNET_CPU_MEM_POOL_TYPE");
+            std::string strategy = (type == nullptr) ? "Unpooled" : type;
+
+            if (strategy == "Round") {
+              ptr = new storage::CPUPooledRoundedStorageManager();
+              LOG(INFO) << "Using CPUPooledRoundedStorageManager.";
+            } else if (strategy == "Unpooled") {
+              ptr = new storage::NaiveStorageManager<storage::CPUDeviceStorage>();
+            } else {
+              LOG(FATAL) << "Unknown CPU memory pool strategy specified: " << strategy << ".";
+            }
             break;
           }
           case Context::kCPUShared: {
@@ -127,6 +138,7 @@ void StorageImpl::Alloc(Storage::Handle* handle) {
 
   manager->Alloc(handle);
   profiler_.OnAlloc(*handle);
+  profiler_.OnPoolUpdate(handle->ctx, *manager);
 }
 
 void StorageImpl::Free(Storage::Handle handle) {
@@ -144,6 +156,7 @@ void StorageImpl::Free(Storage::Handle handle) {
 
   manager->Free(handle);
   profiler_.OnFree(handle);
+  profiler_.OnPoolUpdate(ctx, *manager);
 }
 
 void StorageImpl::DirectFree(Storage::Handle handle) {
@@ -161,6 +174,7 @@ void StorageImpl::DirectFree(Storage::Handle handle) {
 
   manager->DirectFree(handle);
   profiler_.OnFree(handle);
+  profiler_.OnPoolUpdate(ctx, *manager);
 }
 
 void StorageImpl::ReleaseAll(Context ctx) {
@@ -171,6 +185,7 @@ void StorageImpl::ReleaseAll(Context ctx) {
     return nullptr;
   });
   manager->ReleaseAll();
+  profiler_.OnPoolUpdate(ctx, *manager);
 }
 
 void StorageImpl::SharedIncrementRefCount(Storage::Handle handle) {
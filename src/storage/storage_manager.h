@@ -60,6 +60,15 @@ class StorageManager {
   * For non-pool memory managers this has no effect.
   */
   virtual void ReleaseAll() {}
+  /*!
+  * \brief Query the memory held by a pool storage manager
+  * \param reserved Bytes currently allocated from the device
+  * \param cached Bytes currently cached by the pool and available for reuse
+  * \return false if the storage manager does not pool memory
+  */
+  virtual bool PoolStats(size_t *reserved, size_t *cached) const {
+    return false;
+  }
   /*!
    * \brief Destructor.
    */
@@ -34,6 +34,7 @@
 #include <cstdio>
 #include <thread>
 #include <chrono>
+#include <memory>
 #include <vector>
 #include <random>
 
@@ -128,12 +129,14 @@ double EvaluateWorkloads(const std::vector<Workload>& workloads,
 }
 
 TEST(Engine, start_stop) {
-  const int num_engine = 3;
+  const int num_engine = 4;
   std::vector<mxnet::Engine*> engine(num_engine);
   engine[0] = mxnet::engine::CreateNaiveEngine();
   engine[1] = mxnet::engine::CreateThreadedEnginePooled();
   engine[2] = mxnet::engine::CreateThreadedEnginePerDevice();
-  std::string type_names[3] = {"NaiveEngine", "ThreadedEnginePooled", "ThreadedEnginePerDevice"};
+  engine[3] = mxnet::engine::CreateThreadedEngineWorkStealing();
+  std::string type_names[4] = {"NaiveEngine", "ThreadedEnginePooled", "ThreadedEnginePerDevice",
+                               "ThreadedEngineWorkStealing"};
 
   for (int i = 0; i < num_engine; ++i) {
     LOG(INFO) << "Stopping: " << type_names[i];
@@ -147,7 +150,7 @@ TEST(Engine, start_stop) {
 TEST(Engine, RandSumExpr) {
   std::vector<Workload> workloads;
   int num_repeat = 5;
-  const int num_engine = 4;
+  const int num_engine = 5;
 
   std::vector<double> t(num_engine, 0.0);
   std::vector<mxnet::Engine*> engine(num_engine);
@@ -156,6 +159,7 @@ TEST(Engine, RandSumExpr) {
   engine[1] = mxnet::engine::CreateNaiveEngine();
   engine[2] = mxnet::engine::CreateThreadedEnginePooled();
   engine[3] = mxnet::engine::CreateThreadedEnginePerDevice();
+  engine[4] = mxnet::engine::CreateThreadedEngineWorkStealing();
 
   for (int repeat = 0; repeat < num_repeat; ++repeat) {
     srand(time(NULL) + repeat);
@@ -178,6 +182,120 @@ TEST(Engine, RandSumExpr) {
   LOG(INFO) << "NaiveEngine\t\t"  << t[1] << " sec";
   LOG(INFO) << "ThreadedEnginePooled\t" << t[2] << " sec";
   LOG(INFO) << "ThreadedEnginePerDevice\t" << t[3] << " sec";
+  LOG(INFO) << "ThreadedEngineWorkStealing\t" << t[4] << " sec";
+}
+
+/**
+ * push many tiny ops, each one reading a few vars and writing one,
+ * and return the number of ops completed per second
+ */
+double SmallOpsPerSecond(mxnet::Engine* engine, int num_ops, int num_var, int num_read) {
+  using namespace mxnet;
+  std::vector<Engine::VarHandle> vars;
+  std::vector<double> data(num_var, 1.0);
+  for (int i = 0; i < num_var; ++i) {
+    vars.push_back(engine->NewVariable());
+  }
+  std::mt19937 generator(seed_);
+  std::uniform_int_distribution<int> distribution_var(0, num_var - 1);
+  double t = dmlc::GetTime();
+  for (int i = 0; i < num_ops; ++i) {
+    const int write = distribution_var(generator);
+    std::vector<Engine::VarHandle> reads;
+    for (int j = 0; j < num_read; ++j) {
+      const int r = distribution_var(generator);
+      if (r != write) reads.push_back(vars[r]);
+    }
+    double *out = &data[write];
+    engine->PushSync([out](RunContext ctx) { *out += 1.0; },
+                     Context::CPU(), reads, {vars[write]});
+  }
+  engine->WaitForAll();
+  t = dmlc::GetTime() - t;
+  for (auto var : vars) {
+    engine->DeleteVariable([](RunContext) {}, Context::CPU(), var);
+  }
+  engine->WaitForAll();
+  return num_ops / t;
+}
+
+TEST(Engine, WorkStealingOpsPerSec) {
+  const int num_ops = mxnet::test::performance_run ? 1000000 : 50000;
+  const int num_repeat = mxnet::test::performance_run ? 5 : 2;
+  std::unique_ptr<mxnet::Engine> per_device(mxnet::engine::CreateThreadedEnginePerDevice());
+  std::unique_ptr<mxnet::Engine> stealing(mxnet::engine::CreateThreadedEngineWorkStealing());
+  // few vars give long dependency chains, many vars give wide independent work
+  for (int num_var : {16, 1024}) {
+    double per_device_ops = 0, stealing_ops = 0;
+    for (int repeat = 0; repeat < num_repeat; ++repeat) {
+      per_device_ops += SmallOpsPerSecond(per_device.get(), num_ops, num_var, 2);
+      stealing_ops += SmallOpsPerSecond(stealing.get(), num_ops, num_var, 2);
+    }
+    LOG(INFO) << num_var << " vars: ThreadedEnginePerDevice\t"
+              << per_device_ops / num_repeat << " ops/sec";
+    LOG(INFO) << num_var << " vars: ThreadedEngineWorkStealing\t"
+              << stealing_ops / num_repeat << " ops/sec";
+  }
+}
+
+/**
+ * several pusher threads hammer a few shared vars, like workers reading the
+ * same parameters during a data-parallel update, and each writes its own var
+ */
+TEST(Engine, VarContention) {
+  using namespace mxnet;
+  const int num_threads = 8;
+  const int num_hot_vars = 4;
+  const int num_ops = mxnet::test::performance_run ? 200000 : 10000;
+  std::unique_ptr<Engine> engine(engine::CreateThreadedEnginePerDevice());
+  std::vector<Engine::VarHandle> hot_vars, own_vars;
+  for (int i = 0; i < num_hot_vars; ++i) hot_vars.push_back(engine->NewVariable());
+  for (int i = 0; i < num_threads; ++i) own_vars.push_back(engine->NewVariable());
+  std::vector<int> hot_counts(num_hot_vars, 0);
+  std::vector<int> own_counts(num_threads, 0);
+  std::vector<double> push_time(num_threads, 0.0);
+
+  double t = dmlc::GetTime();
+  std::vector<std::thread> pushers;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    pushers.emplace_back([&, tid]() {
+      int *own = &own_counts[tid];
+      double start = dmlc::GetTime();
+      for (int i = 0; i < num_ops; ++i) {
+        if (i % 64 == 63) {
+          // occasional update of a shared var
+          const int h = (tid + i) % num_hot_vars;
+          int *hot = &hot_counts[h];
+          engine->PushSync([hot](RunContext) { ++*hot; },
+                           Context::CPU(), {}, {hot_vars[h]});
+        } else {
+          engine->PushSync([own](RunContext) { ++*own; },
+                           Context::CPU(), hot_vars, {own_vars[tid]});
+        }
+      }
+      push_time[tid] = dmlc::GetTime() - start;
+    });
+  }
+  for (auto& th : pushers) th.join();
+  engine->WaitForAll();
+  t = dmlc::GetTime() - t;
+
+  const int num_hot_writes = num_ops / 64;
+  int total_hot = 0;
+  for (int c : hot_counts) total_hot += c;
+  EXPECT_EQ(total_hot, num_threads * num_hot_writes);
+  double total_push_time = 0;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    EXPECT_EQ(own_counts[tid], num_ops - num_hot_writes);
+    total_push_time += push_time[tid];
+  }
+  for (auto var : hot_vars) engine->DeleteVariable([](RunContext) {}, Context::CPU(), var);
+  for (auto var : own_vars) engine->DeleteVariable([](RunContext) {}, Context::CPU(), var);
+  engine->WaitForAll();
+
+  const double total_ops = static_cast<double>(num_threads) * num_ops;
+  LOG(INFO) << "push latency\t" << total_push_time / total_ops * 1e6 << " us/op";
+  LOG(INFO) << "push to complete\t" << total_ops / t << " ops/sec";
 }
 
 void Foo(mxnet::RunContext, int i) { printf("The fox says %d\n", i); }
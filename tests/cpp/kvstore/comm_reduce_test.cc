@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file comm_reduce_test.cc
+ * \brief vectorized cpu reduction of CommCPU
+*/
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../src/kvstore/comm_reduce.h"
+
+using namespace mxnet::kvstore::reduce;
+
+namespace {
+
+/*!
+ * \brief reduces random buffers with every instruction set this cpu supports and
+ * compares against a double precision sum. The buffers are added in the same order
+ * by every instruction set, so the vectorized results match the scalar one exactly.
+ */
+template<typename DType>
+void CheckSum(size_t num, size_t total, size_t offset, size_t size, double tol) {
+  std::mt19937 gen(static_cast<unsigned>(num * 7919 + size));
+  std::uniform_real_distribution<float> dis(-2, 2);
+  std::vector<std::vector<DType>> init(num, std::vector<DType>(total));
+  for (auto& buf : init) {
+    for (auto& v : buf) v = DType(dis(gen));
+  }
+  std::vector<ISA> isas = {ISA::kScalar};
+  if (DetectISA() >= ISA::kAVX2) isas.push_back(ISA::kAVX2);
+  if (DetectISA() >= ISA::kAVX512) isas.push_back(ISA::kAVX512);
+  std::vector<float> scalar(total);
+  for (ISA isa : isas) {
+    std::vector<std::vector<DType>> bufs = init;
+    std::vector<DType*> dptr;
+    for (auto& buf : bufs) dptr.push_back(buf.data());
+    Sum(dptr.data(), num, offset, size, isa);
+    for (size_t j = 0; j < total; ++j) {
+      double expected = static_cast<float>(init[0][j]);
+      if (j >= offset && j < offset + size) {
+        for (size_t i = 1; i < num; ++i) expected += static_cast<float>(init[i][j]);
+      }
+      ASSERT_NEAR(static_cast<float>(bufs[0][j]), expected,
+                  tol * std::max(1.0, std::fabs(expected)))
+          << "isa " << static_cast<int>(isa) << " element " << j;
+      if (isa == ISA::kScalar) {
+        scalar[j] = static_cast<float>(bufs[0][j]);
+      } else {
+        ASSERT_EQ(static_cast<float>(bufs[0][j]), scalar[j])
+            << "isa " << static_cast<int>(isa) << " element " << j;
+      }
+      for (size_t i = 1; i < num; ++i) {
+        ASSERT_EQ(static_cast<float>(bufs[i][j]), static_cast<float>(init[i][j]));
+      }
+    }
+  }
+}
+
+template<typename DType>
+void CheckSumShapes(double tol) {
+  for (size_t num : {2, 3, 5, 9}) {
+    // whole tiles, a partial vector and a range which is not vector aligned
+    CheckSum<DType>(num, 4096, 0, 4096, tol);
+    CheckSum<DType>(num, 5000, 0, 5000, tol);
+    CheckSum<DType>(num, 3000, 13, 2071, tol);
+    CheckSum<DType>(num, 7, 1, 5, tol);
+  }
+}
+
+}  // namespace
+
+TEST(CommReduce, Float32) {
+  CheckSumShapes<float>(1e-5);
+}
+
+TEST(CommReduce, Float16) {
+  // rounded once from the float accumulator
+  CheckSumShapes<mshadow::half::half_t>(1e-3);
+}
+
+TEST(CommReduce, BFloat16) {
+  // truncated once from the float accumulator
+  CheckSumShapes<mshadow::bfloat::bf16_t>(1e-2);
+}
+
+TEST(CommReduce, SingleBuffer) {
+  std::vector<float> buf(100, 1.5f);
+  float* dptr = buf.data();
+  Sum(&dptr, 1, 0, buf.size());
+  for (float v : buf) EXPECT_EQ(v, 1.5f);
+}
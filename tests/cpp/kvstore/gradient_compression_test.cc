@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file gradient_compression_test.cc
+ * \brief cpu kernels of gradient compression
+*/
+
+#include <gtest/gtest.h>
+#include <mxnet/base.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../src/kvstore/gradient_compression.h"
+#include "../src/kvstore/gradient_compression-inl.h"
+
+using namespace mxnet;
+using namespace mxnet::kvstore;
+
+namespace {
+
+TBlob ToBlob(std::vector<float>* v) {
+  return TBlob(v->data(), mxnet::TShape{static_cast<int64_t>(v->size())}, cpu::kDevMask);
+}
+
+/*!
+ * \brief quantizes a random gradient twice and checks that what was sent plus
+ * what was kept as residual adds up to the gradients seen so far
+ */
+void CheckErrorFeedback(const std::vector<std::pair<std::string, std::string> >& params) {
+  const int size = 3000;  // not a multiple of any block size
+  GradientCompression gc;
+  gc.SetParams(params);
+  std::vector<float> grad(size), residual(size, 0), total(size, 0), received(size, 0);
+  std::vector<float> compr(gc.GetCompressedSize(size));
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dis(-1, 1);
+  mshadow::Stream<cpu> *s = nullptr;
+  for (int iter = 0; iter < 2; ++iter) {
+    for (int i = 0; i < size; ++i) {
+      grad[i] = dis(gen);
+      total[i] += grad[i];
+    }
+    std::vector<TBlob> qinputs = {ToBlob(&grad), ToBlob(&residual), ToBlob(&compr)};
+    std::vector<TBlob> dinputs = {ToBlob(&compr), ToBlob(&received)};
+    switch (gc.get_type()) {
+      case CompressionType::kTwoBit:
+        Quantize2BitImpl(s, qinputs, 0.5);
+        Dequantize2BitImpl(s, dinputs, 0.5, kAddTo);
+        break;
+      case CompressionType::kOneBit:
+        Quantize1BitImpl(s, qinputs);
+        Dequantize1BitImpl(s, dinputs, kAddTo);
+        break;
+      default:
+        QuantizeSparseImpl(s, qinputs, gc.GetCompressedBlockSize() / 2,
+                           gc.get_type() == CompressionType::kRandomK, iter);
+        DequantizeSparseImpl(s, dinputs, gc.GetCompressedBlockSize() / 2, kAddTo);
+        break;
+    }
+  }
+  for (int i = 0; i < size; ++i) {
+    EXPECT_NEAR(received[i] + residual[i], total[i], 1e-4) << "at " << i;
+  }
+}
+
+}  // namespace
+
+TEST(GradientCompression, CompressedSize) {
+  GradientCompression gc;
+  gc.SetParams({{"type", "2bit"}});
+  EXPECT_EQ(gc.GetCompressedSize(33), 3);
+  gc.SetParams({{"type", "1bit"}});
+  EXPECT_EQ(gc.GetCompressedSize(513), 2 * kOneBitCompressedBlockSize);
+  gc.SetParams({{"type", "topk"}, {"ratio", "0.01"}});
+  EXPECT_EQ(gc.GetCompressedBlockSize(), 20);
+  EXPECT_EQ(gc.GetCompressedSize(2048), 40);
+  // parameters survive the trip to the servers
+  GradientCompression server;
+  server.DecodeParams(gc.EncodeParams());
+  EXPECT_EQ(server.get_type(), CompressionType::kTopK);
+  EXPECT_EQ(server.GetCompressedBlockSize(), 20);
+}
+
+TEST(GradientCompression, ErrorFeedback) {
+  CheckErrorFeedback({{"type", "2bit"}, {"threshold", "0.5"}});
+  CheckErrorFeedback({{"type", "1bit"}});
+  CheckErrorFeedback({{"type", "topk"}, {"ratio", "0.05"}});
+  CheckErrorFeedback({{"type", "randomk"}, {"ratio", "0.05"}});
+}
+
+TEST(GradientCompression, TopKPicksLargest) {
+  const int size = kSparseBlockSize;
+  const int k = 4;
+  std::vector<float> grad(size, 0.01f), residual(size, 0), compr(2 * k), out(size, 1);
+  grad[3] = -5;
+  grad[100] = 4;
+  grad[512] = 3;
+  grad[1023] = -2;
+  std::vector<TBlob> qinputs = {ToBlob(&grad), ToBlob(&residual), ToBlob(&compr)};
+  QuantizeSparseImpl(nullptr, qinputs, k, false, 0);
+  std::vector<TBlob> dinputs = {ToBlob(&compr), ToBlob(&out)};
+  DequantizeSparseImpl(nullptr, dinputs, k, kWriteTo);
+  for (int i = 0; i < size; ++i) {
+    EXPECT_EQ(out[i], (i == 3 || i == 100 || i == 512 || i == 1023) ? grad[i] : 0);
+    EXPECT_EQ(residual[i], out[i] != 0 ? 0 : grad[i]);
+  }
+}
@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file imperative_dispatch_perf.cc
+ * \brief per call overhead of imperative invocation with and without the inference cache
+ */
+
+#include <gtest/gtest.h>
+#include <mxnet/imperative.h>
+#include <mxnet/ndarray.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "../include/test_util.h"
+#include "../../src/imperative/imperative_utils.h"
+
+using namespace mxnet;
+
+namespace {
+
+nnvm::NodeAttrs MakeAttrs(const char* op_name,
+                          const std::vector<std::pair<std::string, std::string> >& kwargs) {
+  nnvm::NodeAttrs attrs;
+  attrs.op = nnvm::Op::Get(op_name);
+  for (const auto& kv : kwargs) attrs.dict.insert(kv);
+  if (attrs.op->attr_parser != nullptr) attrs.op->attr_parser(&attrs);
+  return attrs;
+}
+
+NDArray Filled(const mxnet::TShape& shape, float start) {
+  NDArray arr(shape, Context::CPU());
+  std::vector<float> data(shape.Size());
+  for (size_t i = 0; i < data.size(); ++i) data[i] = start + i;
+  arr.SyncCopyFromCPU(data.data(), data.size());
+  return arr;
+}
+
+/*! \brief invokes a + (b + 1) on small arrays, returning the result */
+NDArray AddPlusScalar(NDArray a, NDArray b) {
+  static const nnvm::NodeAttrs add = MakeAttrs("elemwise_add", {});
+  static const nnvm::NodeAttrs plus = MakeAttrs("_plus_scalar", {{"scalar", "1"}});
+  NDArray tmp, out;
+  Imperative::Get()->Invoke(Context::CPU(), plus, {&b}, {&tmp});
+  Imperative::Get()->Invoke(Context::CPU(), add, {&a, &tmp}, {&out});
+  return out;
+}
+
+double TimeCalls(size_t iterations, const mxnet::TShape& shape) {
+  NDArray a = Filled(shape, 0), b = Filled(shape, 1);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) AddPlusScalar(a, b);
+  Engine::Get()->WaitForAll();
+  return std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / (2 * iterations);
+}
+
+}  // namespace
+
+TEST(IMPERATIVE_DISPATCH, InferCacheMatchesInference) {
+  imperative::InferCache* cache = imperative::InferCache::Get();
+  cache->set_capacity(16);
+  for (int repeat = 0; repeat < 2; ++repeat) {
+    for (const mxnet::TShape& shape : {mxnet::TShape({3, 4}), mxnet::TShape({5})}) {
+      NDArray out = AddPlusScalar(Filled(shape, 0), Filled(shape, 2));
+      out.WaitToRead();
+      EXPECT_EQ(out.shape(), shape);
+      EXPECT_EQ(out.dtype(), mshadow::kFloat32);
+      EXPECT_EQ(out.storage_type(), kDefaultStorage);
+      const float* data = out.data().dptr<float>();
+      for (size_t i = 0; i < shape.Size(); ++i) EXPECT_EQ(data[i], static_cast<float>(2 * i + 3));
+    }
+  }
+  // one entry per op and shape, the repeated calls hit
+  EXPECT_EQ(cache->size(), 4U);
+  cache->set_capacity(0);
+  AddPlusScalar(Filled(mxnet::TShape({3, 4}), 0), Filled(mxnet::TShape({3, 4}), 0));
+  EXPECT_EQ(cache->size(), 0U);
+  cache->set_capacity(1024);
+}
+
+TEST(IMPERATIVE_DISPATCH, TimingCPU) {
+  const size_t iterations = test::performance_run ? 100000 : 2000;
+  imperative::InferCache* cache = imperative::InferCache::Get();
+  for (const mxnet::TShape& shape : {mxnet::TShape({1}), mxnet::TShape({32, 32})}) {
+    cache->set_capacity(0);
+    TimeCalls(iterations / 10, shape);
+    const double uncached = TimeCalls(iterations, shape);
+    cache->set_capacity(1024);
+    TimeCalls(iterations / 10, shape);
+    const double cached = TimeCalls(iterations, shape);
+    std::cout << "shape " << shape << ": " << uncached << " us per call without the"
+              << " inference cache, " << cached << " us with it" << std::endl;
+  }
+}
@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rnn_cell_test.cc
+ * \brief fused cpu cell kernels of the native RNN operator
+*/
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../../src/operator/rnn_impl.h"
+
+using namespace mxnet::op;
+
+namespace {
+
+double Sigmoid(double x) {
+  return 1.0 / (1.0 + std::exp(-x));
+}
+
+std::vector<float> Random(size_t size, std::mt19937* gen) {
+  std::uniform_real_distribution<float> dis(-4, 4);
+  std::vector<float> v(size);
+  for (auto& x : v) x = dis(*gen);
+  return v;
+}
+
+}  // namespace
+
+TEST(RNNCell, Nonlinearities) {
+  for (float x = -100.0f; x < 100.0f; x += 0.013f) {
+    const double e = std::exp(static_cast<double>(x));
+    if (x > -87.0f && x < 88.0f) {
+      EXPECT_NEAR(RNNExp(x) / e, 1.0, 2e-7) << "at " << x;
+    }
+    EXPECT_NEAR(RNNSigmoid(x), Sigmoid(x), 2e-7) << "at " << x;
+    EXPECT_NEAR(RNNTanh(x), std::tanh(static_cast<double>(x)), 4e-7) << "at " << x;
+  }
+  EXPECT_EQ(RNNSigmoid(1e30f), 1.0f);
+  EXPECT_EQ(RNNTanh(-1e30f), -1.0f);
+}
+
+TEST(RNNCell, LstmCellForward) {
+  // not a multiple of any vector width
+  const int H = 37;
+  std::mt19937 gen(0);
+  auto yx = Random(4 * H, &gen), yh = Random(4 * H, &gen);
+  auto bx = Random(4 * H, &gen), bh = Random(4 * H, &gen);
+  auto c = Random(H, &gen);
+  const auto c_prev = c;
+  std::vector<float> h(H), y(H), ifgo(4 * H);
+  // c is updated in place as in inference
+  LstmCellForward<true>(H, H, yx.data(), yh.data(), bx.data(), bh.data(), c.data(),
+                        c.data(), h.data(), y.data(), ifgo.data());
+  for (int k = 0; k < H; ++k) {
+    double gates[4];
+    for (int g = 0; g < 4; ++g) {
+      const double a = static_cast<double>(yx[g * H + k]) + yh[g * H + k] +
+                       bx[g * H + k] + bh[g * H + k];
+      gates[g] = g == 2 ? std::tanh(a) : Sigmoid(a);
+      EXPECT_NEAR(ifgo[4 * k + g], gates[g], 1e-6);
+    }
+    const double ct = c_prev[k] * gates[1] + gates[0] * gates[2];
+    EXPECT_NEAR(c[k], ct, 1e-5);
+    EXPECT_NEAR(h[k], gates[3] * std::tanh(ct), 1e-6);
+    EXPECT_EQ(y[k], h[k]);
+  }
+}
+
+TEST(RNNCell, GruCellForward) {
+  const int H = 37;
+  std::mt19937 gen(0);
+  auto gx = Random(3 * H, &gen), gh = Random(3 * H, &gen);
+  auto bx = Random(3 * H, &gen), bh = Random(3 * H, &gen);
+  auto h_prev = Random(H, &gen);
+  std::vector<float> h(H), r(H), z(H), n(H), mnh(H);
+  GruCellForward<true>(H, H, gx.data(), gh.data(), bx.data(), bh.data(), h_prev.data(),
+                       h.data(), r.data(), z.data(), n.data(), mnh.data());
+  std::vector<float> h_only(H);
+  GruCellForward<false, float>(H, H, gx.data(), gh.data(), bx.data(), bh.data(),
+                               h_prev.data(), h_only.data(),
+                               nullptr, nullptr, nullptr, nullptr);
+  for (int k = 0; k < H; ++k) {
+    const double rt = Sigmoid(static_cast<double>(gx[k]) + gh[k] + bx[k] + bh[k]);
+    const double zt = Sigmoid(static_cast<double>(gx[H + k]) + gh[H + k] +
+                              bx[H + k] + bh[H + k]);
+    const double mnht = static_cast<double>(gh[2 * H + k]) + bh[2 * H + k];
+    const double nt = std::tanh(gx[2 * H + k] + bx[2 * H + k] + rt * mnht);
+    EXPECT_NEAR(r[k], rt, 1e-6);
+    EXPECT_NEAR(z[k], zt, 1e-6);
+    EXPECT_NEAR(n[k], nt, 1e-6);
+    EXPECT_NEAR(mnh[k], mnht, 1e-6);
+    EXPECT_NEAR(h[k], (1 - zt) * nt + zt * h_prev[k], 1e-6);
+    EXPECT_EQ(h_only[k], h[k]);
+  }
+}
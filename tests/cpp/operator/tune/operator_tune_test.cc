@@ -17,6 +17,9 @@
  * under the License.
  */
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <thread>
 #include <mxnet/tensor_blob.h>
 #include "../../src/operator/nn/activation-inl.h"
 #include "../../src/operator/operator_tune-inl.h"
@@ -174,5 +177,94 @@ TEST(OMP_TUNING, EvaluateTuneTestInt64) {
   std::cout << "Success rate for type " << test::type_name<DType>() << ": " << result << std::endl;
 }
 
+namespace {
+struct autotune_measured_kernel {};
+struct autotune_loaded_kernel {};
+struct autotune_concurrent_kernel {};
+}  // namespace
+
+/*! \brief Autotuning keeps the fastest measured configuration */
+TEST(OMP_TUNING, AutotuneMeasure) {
+  using mxnet::op::OperatorAutotune;
+  OperatorAutotune *autotune = OperatorAutotune::Get();
+  const size_t N = 1 << 20;
+  mxnet::op::tune::LaunchConfig config;
+  int candidate = -1;
+  OperatorAutotune::Entry *entry = nullptr;
+  for (int i = 0; i < 1000; ++i) {
+    entry = autotune->Select(typeid(autotune_measured_kernel), mshadow::kFloat32, N, 8,
+                             &config, &candidate);
+    if (candidate < 0) break;
+    // pretend that four threads with the static schedule are fastest
+    const bool fastest = config.threads == 4 && config.grain == 0;
+    autotune->Record(entry, candidate, N, fastest ? 1000 : 2000);
+  }
+  ASSERT_TRUE(entry->done);
+  EXPECT_GT(entry->candidates.size(), 3U);
+  EXPECT_EQ(config.threads, 4);
+  EXPECT_EQ(config.grain, 0);
+  // same size bucket maps to the same entry
+  EXPECT_EQ(autotune->Select(typeid(autotune_measured_kernel), mshadow::kFloat32, N + 1, 8,
+                             &config, &candidate), entry);
+  EXPECT_EQ(candidate, -1);
+}
+
+/*! \brief Threads selecting a tuned key concurrently all get the chosen configuration */
+TEST(OMP_TUNING, AutotuneConcurrentSelect) {
+  using mxnet::op::OperatorAutotune;
+  OperatorAutotune *autotune = OperatorAutotune::Get();
+  const size_t N = 1 << 20;
+  std::vector<std::thread> threads;
+  std::vector<int> wrong(8, 0);
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([autotune, N, t, &wrong]() {
+      mxnet::op::tune::LaunchConfig config;
+      int candidate = -1;
+      for (int i = 0; i < 1000; ++i) {
+        OperatorAutotune::Entry *entry = autotune->Select(
+          typeid(autotune_concurrent_kernel), mshadow::kFloat32, N, 8, &config, &candidate);
+        if (candidate >= 0) {
+          const bool fastest = config.threads == 8 && config.grain == 0;
+          autotune->Record(entry, candidate, N, fastest ? 1000 : 2000);
+        } else if (config.threads != 8 || config.grain != 0) {
+          ++wrong[t];
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < 8; ++t) {
+    EXPECT_EQ(wrong[t], 0);
+  }
+}
+
+/*! \brief Configurations loaded from file are used without measuring */
+TEST(OMP_TUNING, AutotuneLoad) {
+  using mxnet::op::OperatorAutotune;
+  const std::string path = "autotune_load_test.txt";
+  {
+    std::ofstream os(path);
+    os << "mxnet_operator_autotune 1 " << omp_get_num_procs() << std::endl;
+    os << typeid(autotune_loaded_kernel).name() << " 0 10 8 3 512" << std::endl;
+  }
+  OperatorAutotune *autotune = OperatorAutotune::Get();
+  ASSERT_TRUE(autotune->Load(path));
+  mxnet::op::tune::LaunchConfig config;
+  int candidate = 0;
+  autotune->Select(typeid(autotune_loaded_kernel), mshadow::kFloat32, 1 << 10, 8,
+                   &config, &candidate);
+  EXPECT_EQ(candidate, -1);
+  EXPECT_EQ(config.threads, 3);
+  EXPECT_EQ(config.grain, 512);
+  ASSERT_TRUE(autotune->Save(path));
+  std::ifstream is(path);
+  std::string line;
+  std::getline(is, line);
+  EXPECT_EQ(line.find("mxnet_operator_autotune 1 "), 0U);
+  std::remove(path.c_str());
+}
+
 #endif  // MXNET_USE_OPERATOR_TUNING
 
@@ -26,7 +26,9 @@
 #include <dmlc/logging.h>
 #include <mxnet/storage.h>
 #include <cstdio>
+#include <thread>
 #include "test_util.h"
+#include "../../src/storage/cpu_pooled_storage_manager.h"
 
 TEST(Storage, Basic_CPU) {
   constexpr size_t kSize = 1024;
@@ -47,6 +49,54 @@ TEST(Storage, Basic_CPU) {
   storage->Free(handle);
 }
 
+TEST(Storage, Pooled_CPU) {
+  putenv("MXNET_CPU_MEM_POOL_THREAD_CACHE_SIZE=1");
+  mxnet::storage::CPUPooledRoundedStorageManager manager;
+  mxnet::Storage::Handle handle, handle2;
+  handle.size = 32;
+  handle2.size = 2097153;
+  manager.Alloc(&handle);
+  manager.Alloc(&handle2);
+  auto ptr = handle.dptr;
+  auto ptr2 = handle2.dptr;
+  size_t reserved, cached;
+  EXPECT_TRUE(manager.PoolStats(&reserved, &cached));
+  EXPECT_EQ(reserved, 4096 + 4194304);
+  EXPECT_EQ(cached, 0);
+  manager.Free(handle);
+  manager.Free(handle2);
+  EXPECT_TRUE(manager.PoolStats(&reserved, &cached));
+  EXPECT_EQ(cached, reserved);
+
+  // served from the thread cache
+  handle.size = 4095;
+  manager.Alloc(&handle);
+  EXPECT_EQ(handle.dptr, ptr);
+  // too large for the thread cache, served from the shared pool
+  handle2.size = 3145728;
+  manager.Alloc(&handle2);
+  EXPECT_EQ(handle2.dptr, ptr2);
+
+  // chunks freed by another thread are returned to the pool when it exits
+  std::thread([&manager, &handle]() { manager.Free(handle); }).join();
+  handle.size = 4096;
+  manager.Alloc(&handle);
+  EXPECT_EQ(handle.dptr, ptr);
+  manager.Free(handle);
+  manager.Free(handle2);
+
+  manager.ReleaseAll();
+  EXPECT_TRUE(manager.PoolStats(&reserved, &cached));
+  EXPECT_EQ(reserved, 0);
+  EXPECT_EQ(cached, 0);
+
+  handle.size = 0;
+  manager.Alloc(&handle);
+  EXPECT_EQ(handle.dptr, nullptr);
+  manager.Free(handle);
+  unsetenv("MXNET_CPU_MEM_POOL_THREAD_CACHE_SIZE");
+}
+
 #if MXNET_USE_CUDA
 TEST(Storage_GPU, Basic_GPU) {
   if (mxnet::test::unitTestsWithCuda) {
@@ -648,6 +648,97 @@ TEST(ThreadSafety, Engine) {
   mxnet::cpp::NDArray::WaitAll();
 }
 
+/**
+ * Verifying that a thread safe cached op gives the right results when threads
+ * run it concurrently with different input shapes, while the graph cache is
+ * too small to hold all of them and keeps evicting graphs
+ */
+TEST(ThreadSafety, CachedOpMixedShapes) {
+  const int num_threads = 8;
+  const int num_shapes = 4;
+  const int num_inf_per_thread = 10;
+  mxnet::cpp::Context ctx = mxnet::cpp::Context::cpu(0);
+
+  mxnet::cpp::Symbol data = mxnet::cpp::Symbol::Variable("data");
+  mxnet::cpp::Symbol weight = mxnet::cpp::Symbol::Variable("weight");
+  mxnet::cpp::Symbol bias = mxnet::cpp::Symbol::Variable("bias");
+  auto fc = mxnet::cpp::Operator("FullyConnected")
+      .SetParam("num_hidden", 16)
+      .SetInput("data", data)
+      .SetInput("weight", weight)
+      .SetInput("bias", bias)
+      .CreateSymbol("fc");
+  auto out = mxnet::cpp::Operator("relu").SetInput("data", fc).CreateSymbol("relu");
+
+  // one input per shape, the batch size is the only difference
+  std::vector<mxnet::cpp::NDArray> data_arr, weight_arr, bias_arr;
+  for (int i = 0; i < num_shapes; ++i) {
+    prepare_input_data(mxnet::cpp::Shape(i + 1, 32), ctx, 1, &data_arr, true);
+  }
+  prepare_input_data(mxnet::cpp::Shape(16, 32), ctx, 1, &weight_arr, true);
+  prepare_input_data(mxnet::cpp::Shape(16), ctx, 1, &bias_arr, true);
+  std::vector<std::vector<NDArrayHandle>> arr_handles(num_shapes);
+  for (int i = 0; i < num_shapes; ++i) {
+    arr_handles[i] = {data_arr[i].GetHandle(), weight_arr[0].GetHandle(),
+                      bias_arr[0].GetHandle()};
+  }
+
+  std::vector<std::string> flag_keys{"data_indices", "param_indices"};
+  std::vector<std::string> flag_vals{"[0]", "[1,2]"};
+  std::vector<mxnet::NDArray*> result_expected(num_shapes);
+  CachedOpHandle hdl = CachedOpHandle();
+  get_expected_results(out, flag_keys, flag_vals, num_shapes,
+                       &arr_handles, &result_expected, &hdl);
+
+  for (bool static_alloc : {false, true}) {
+    std::vector<const char *> keys{"data_indices", "param_indices", "graph_cache_size",
+                                   "static_alloc"};
+    std::vector<const char *> vals{"[0]", "[1,2]", "2", static_alloc ? "true" : "false"};
+    CachedOpHandle hdl2 = CachedOpHandle();
+    if (MXCreateCachedOpEX(out.GetHandle(), keys.size(), keys.data(), vals.data(),
+                           &hdl2, true) < 0) {
+      LOG(FATAL) << MXGetLastError();
+    }
+
+    std::vector<std::vector<mxnet::NDArray*>> outputs(num_threads);
+    auto func = [&](int num) {
+      for (int i = 0; i < num_inf_per_thread; ++i) {
+        const int shape = (num + i) % num_shapes;
+        int num_output = 0;
+        const int *stypes;
+        NDArrayHandle *output_handles;
+        if (MXInvokeCachedOpEx(hdl2, arr_handles[shape].size(), arr_handles[shape].data(),
+                               &num_output, &output_handles, &stypes) < 0) {
+          LOG(FATAL) << MXGetLastError();
+        }
+        outputs[num].push_back(static_cast<mxnet::NDArray*>(*output_handles));
+      }
+    };
+
+    std::vector<std::thread> worker_threads;
+    for (int i = 0; i < num_threads; ++i) {
+      worker_threads.emplace_back(func, i);
+    }
+    for (auto &&t : worker_threads) {
+      t.join();
+    }
+
+    mxnet::cpp::NDArray::WaitAll();
+    for (int num = 0; num < num_threads; ++num) {
+      for (int i = 0; i < num_inf_per_thread; ++i) {
+        const int shape = (num + i) % num_shapes;
+        mxnet::test::AssertEqual({outputs[num][i]}, {result_expected[shape]}, 1e-5, 1e-6);
+      }
+    }
+    if (MXFreeCachedOp(hdl2) < 0) {
+      LOG(FATAL) << MXGetLastError();
+    }
+  }
+  if (MXFreeCachedOp(hdl) < 0) {
+    LOG(FATAL) << MXGetLastError();
+  }
+}
+
 TEST(ThreadSafety, CachedOpFullModel) {
   std::vector<std::string> models_list = {
       "imagenet1k-resnet-18", "imagenet1k-resnet-152", "imagenet1k-resnet-50"};
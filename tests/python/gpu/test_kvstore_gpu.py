@@ -18,6 +18,7 @@
 # pylint: skip-file
 import sys
 import os
+import json
 import mxnet as mx
 import numpy as np
 import unittest
@@ -133,6 +134,34 @@ def test_rsp_push_pull_large_rowid():
     kv.row_sparse_pull('a', out=out, row_ids=mx.nd.arange(0, num_rows, dtype='int64'))
     assert(out.indices.shape[0] == num_rows)
 
+
+@unittest.skipIf(mx.context.num_gpus() < 2, "test_pushpull_fusion_tree needs more than 1 GPU")
+def test_pushpull_fusion_tree():
+    """the tree comm cannot fuse keys, pushpull falls back to one reduce per key"""
+    devs = [mx.gpu(i) for i in range(2)]
+    shapes = [(4, 4), (2, 3, 4), (3, 2)]
+    keys = list(range(len(shapes)))
+    with environment({'MXNET_KVSTORE_USETREE': '1',
+                      'MXNET_KVSTORE_FUSION_BUCKET_BYTES': '1024'}):
+        kv = mx.kv.create('device')
+    kv.init(keys, [mx.nd.zeros(s) for s in shapes])
+    mx.profiler.set_config(profile_imperative=True, aggregate_stats=True,
+                           filename='test_pushpull_fusion_tree_profile.json')
+    mx.profiler.reset_stats()
+    mx.profiler.set_state('run')
+    for _ in range(2):
+        vals = [[mx.nd.array(np.random.uniform(size=s), d) for d in devs] for s in shapes]
+        outs = [[mx.nd.empty(s, d) for d in devs] for s in shapes]
+        kv.pushpull(keys, vals, out=outs)
+        for val, out in zip(vals, outs):
+            expected = sum(v.asnumpy() for v in val)
+            for o in out:
+                assert_almost_equal(o.asnumpy(), expected, rtol=1e-5, atol=1e-6)
+    mx.nd.waitall()
+    mx.profiler.set_state('stop')
+    stats = json.loads(mx.profiler.dumps(format='json', reset=True))
+    assert 'KVStoreFusionPack' not in stats['Time'].get('operator', {})
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
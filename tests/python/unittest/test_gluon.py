@@ -1737,6 +1737,31 @@ def test_hybrid_static_memory():
     check_hybrid_static_memory(static_alloc=True)
     check_hybrid_static_memory(static_alloc=True, static_shape=True)
 
+@with_seed()
+def test_hybrid_backward_checkpoint():
+    net = nn.HybridSequential()
+    for _ in range(3):
+        net.add(nn.Dense(32, activation='tanh'))
+        net.add(nn.Dense(32, activation='sigmoid'))
+    net.initialize()
+    x = mx.nd.random.uniform(shape=(16, 20))
+
+    def run(strategy, **kwargs):
+        # backward_checkpoint of the CachedOp defaults to MXNET_BACKWARD_CHECKPOINT
+        with environment('MXNET_BACKWARD_CHECKPOINT', strategy):
+            net.hybridize(**kwargs)
+            with mx.autograd.record():
+                y = net(x)
+            y.backward()
+        return y, {k: p.grad().copy() for k, p in net.collect_params().items()}
+
+    for kwargs in [{}, {'static_alloc': True}]:
+        expected_out, expected_grads = run('none', **kwargs)
+        out, grads = run('sqrt', **kwargs)
+        assert_almost_equal(out, expected_out)
+        for k in expected_grads:
+            assert_almost_equal(grads[k], expected_grads[k])
+
 def check_hybrid_static_memory_switching(**kwargs):
     net = gluon.model_zoo.vision.get_resnet(
         1, 18, pretrained=True, ctx=mx.context.current_context())
@@ -30,7 +30,7 @@ try:
 except ImportError:
     h5py = None
 import sys
-from common import assertRaises
+from common import assertRaises, TemporaryDirectory
 import unittest
 try:
     from itertools import izip_longest as zip_longest
@@ -92,6 +92,33 @@ def test_Cifar10Rec():
     for i in range(10):
         assert(labelcount[i] == 5000)
 
+def test_Cifar10Rec_pipelined():
+    get_cifar10()
+    def make_iter(depth):
+        return mx.io.ImageRecordIter(
+            path_imgrec="data/cifar/train.rec",
+            mean_img="data/cifar/cifar10_mean.bin",
+            rand_crop=False,
+            rand_mirror=False,
+            shuffle=False,
+            data_shape=(3, 28, 28),
+            batch_size=128,
+            preprocess_threads=4,
+            decode_pipeline_depth=depth)
+    chunked = make_iter(0)
+    pipelined = make_iter(3)
+    for epoch in range(2):
+        num_batches = 0
+        for batch1, batch2 in zip_longest(chunked, pipelined):
+            assert batch1 and batch2, 'The iterators do not contain the same number of batches'
+            assert batch1.pad == batch2.pad
+            assert_almost_equal(batch1.data[0].asnumpy(), batch2.data[0].asnumpy())
+            assert_almost_equal(batch1.label[0].asnumpy(), batch2.label[0].asnumpy())
+            num_batches += 1
+        assert num_batches == 391
+        chunked.reset()
+        pipelined.reset()
+
 def test_inter_methods_in_augmenter():
     def test_Cifar10Rec():
         get_cifar10()
@@ -410,6 +437,46 @@ def test_LibSVMIter():
     assertRaises(MXNetError, check_libSVMIter_exception)
 
 
+def test_LibSVMIter_cache():
+    def read_all(**kwargs):
+        it = mx.io.LibSVMIter(data_shape=(10,), batch_size=16, **kwargs)
+        epochs = []
+        for _ in range(3):
+            it.reset()
+            epochs.append([(b.data[0].asnumpy(), b.label[0].asnumpy(), b.pad) for b in it])
+        return epochs
+
+    with TemporaryDirectory() as tmpdir:
+        data_path = os.path.join(tmpdir, 'data.t')
+        label_path = os.path.join(tmpdir, 'label.t')
+        cache_path = os.path.join(tmpdir, 'data.cache')
+        with open(data_path, 'w') as fout, open(label_path, 'w') as lout:
+            for i in range(100):
+                cols = sorted(np.random.choice(10, np.random.randint(0, 5), replace=False))
+                fout.write('%d %s\n' % (i, ' '.join('%d:%d.5' % (c, i) for c in cols)))
+                lout.write('0 %d:1\n' % (i % 3))
+
+        for kwargs in [{}, {'label_libsvm': label_path, 'label_shape': (3,)}]:
+            expected = read_all(data_libsvm=data_path, **kwargs)
+            if os.path.exists(cache_path):
+                os.remove(cache_path)
+            # the first iterator parses and writes the cache, the second only reads it
+            for _ in range(2):
+                actual = read_all(data_libsvm=data_path, cache_file=cache_path, **kwargs)
+                assert os.path.exists(cache_path)
+                for epoch1, epoch2 in zip(actual, expected):
+                    assert len(epoch1) == len(epoch2)
+                    for (data1, label1, _), (data2, label2, _) in zip(epoch1, epoch2):
+                        assert_almost_equal(data1, data2)
+                        assert_almost_equal(label1, label2)
+            # the order of the blocks changes, but not the rows of a pass
+            shuffled = read_all(data_libsvm=data_path, cache_file=cache_path, shuffle=True,
+                                **kwargs)
+            for epoch1, epoch2 in zip(shuffled, expected):
+                rows1 = np.concatenate([d[:len(d) - pad] for d, _, pad in epoch1])
+                rows2 = np.concatenate([d[:len(d) - pad] for d, _, pad in epoch2])
+                assert_almost_equal(np.sort(rows1.sum(axis=1)), np.sort(rows2.sum(axis=1)))
+
 def test_DataBatch():
     from nose.tools import ok_
     from mxnet.io import DataBatch
@@ -451,6 +518,75 @@ def test_CSVIter():
     for dtype in ['int32', 'int64', 'float32']:
         check_CSVIter_synthetic(dtype=dtype)
 
+def test_CSVIter_parse_threads():
+    def read_all(data_path, **kwargs):
+        it = mx.io.CSVIter(data_csv=data_path, data_shape=(2, 3), batch_size=64, **kwargs)
+        batches = []
+        for _ in range(2):
+            it.reset()
+            batches.extend((b.data[0].asnumpy(), b.label[0].asnumpy(), b.pad) for b in it)
+        return batches
+
+    with TemporaryDirectory() as tmpdir:
+        data_path = os.path.join(tmpdir, 'data.csv')
+        label_path = os.path.join(tmpdir, 'label.csv')
+        data = np.random.uniform(-100, 100, size=(1003, 6)).astype('float32')
+        with open(data_path, 'w') as fout:
+            for i, row in enumerate(data):
+                fout.write(','.join('%.7g' % x for x in row) + ('\r\n' if i % 7 == 0 else '\n'))
+                if i % 100 == 0:
+                    fout.write('\n')
+        with open(label_path, 'w') as fout:
+            for i in range(len(data)):
+                fout.write('%d,%d\n' % (i, -i))
+
+        for round_batch in [True, False]:
+            for kwargs in [{}, {'label_csv': label_path, 'label_shape': (2,)}]:
+                expected = read_all(data_path, round_batch=round_batch, **kwargs)
+                for parse_threads in [1, 3]:
+                    actual = read_all(data_path, round_batch=round_batch,
+                                      parse_threads=parse_threads, **kwargs)
+                    assert len(actual) == len(expected)
+                    for (data1, label1, pad1), (data2, label2, pad2) in zip(actual, expected):
+                        assert pad1 == pad2
+                        n = data1.shape[0] - (0 if round_batch else pad1)
+                        assert_almost_equal(data1[:n], data2[:n])
+                        assert_almost_equal(label1[:n], label2[:n])
+
+def test_CSVIter_cache():
+    def read_all(data_path, **kwargs):
+        it = mx.io.CSVIter(data_csv=data_path, data_shape=(4,), batch_size=32, **kwargs)
+        epochs = []
+        for _ in range(3):
+            it.reset()
+            epochs.append([(b.data[0].asnumpy(), b.label[0].asnumpy(), b.pad) for b in it])
+        return epochs
+
+    with TemporaryDirectory() as tmpdir:
+        data_path = os.path.join(tmpdir, 'data.csv')
+        label_path = os.path.join(tmpdir, 'label.csv')
+        cache_path = os.path.join(tmpdir, 'data.cache')
+        data = np.random.uniform(-10, 10, size=(500, 4)).astype('float32')
+        np.savetxt(data_path, data, delimiter=',', fmt='%.7g')
+        np.savetxt(label_path, np.arange(500), fmt='%d')
+
+        for round_batch in [True, False]:
+            kwargs = {'label_csv': label_path, 'round_batch': round_batch}
+            expected = read_all(data_path, **kwargs)
+            if os.path.exists(cache_path):
+                os.remove(cache_path)
+            for parse_threads in [2, 0]:
+                actual = read_all(data_path, cache_file=cache_path,
+                                  parse_threads=parse_threads, **kwargs)
+                assert os.path.exists(cache_path)
+                for epoch1, epoch2 in zip(actual, expected):
+                    assert len(epoch1) == len(epoch2)
+                    for (data1, label1, pad1), (data2, label2, pad2) in zip(epoch1, epoch2):
+                        assert pad1 == pad2
+                        n = data1.shape[0] - (0 if round_batch else pad1)
+                        assert_almost_equal(data1[:n], data2[:n])
+                        assert_almost_equal(label1[:n], label2[:n])
+
 def test_ImageRecordIter_seed_augmentation():
     get_cifar10()
     seed_aug = 3
@@ -582,6 +718,7 @@ if __name__ == "__main__":
         test_NDArrayIter_h5py()
     test_MNISTIter()
     test_Cifar10Rec()
+    test_Cifar10Rec_pipelined()
     test_LibSVMIter()
     test_NDArrayIter_csr()
     test_CSVIter()
@@ -16,11 +16,12 @@
 # under the License.
 
 # pylint: skip-file
+import json
 import mxnet as mx
 import numpy as np
 import unittest
 from mxnet.test_utils import rand_ndarray, assert_almost_equal
-from common import setup_module, with_seed, assertRaises, teardown
+from common import setup_module, with_seed, assertRaises, teardown, with_environment
 from mxnet.base import py_str, MXNetError
 
 shape = (4, 4)
@@ -174,6 +175,48 @@ def test_aggregator():
         check_aggregator(init_kv_with_str(), 'a', str_keys, stype)
 
 
+@with_seed()
+@with_environment('MXNET_KVSTORE_FUSION_BUCKET_BYTES', '160')
+def test_pushpull_fusion():
+    """pushpull of dense values packed into fusion buckets"""
+    num_devs = 3
+    devs = [mx.Context('cpu', i) for i in range(num_devs)]
+    # keys are bucketed in descending order: (3, 2) and (2, 3, 4) take 120 bytes
+    # of the first bucket, (4, 4) does not fit in it anymore and starts a second
+    # one, and (50,) is too large to be fused
+    fusion_shapes = [(4, 4), (2, 3, 4), (50,), (3, 2)]
+    num_buckets = 2
+    num_steps = 3
+    kv = mx.kv.create()
+    fusion_keys = list(range(len(fusion_shapes)))
+    kv.init(fusion_keys, [mx.nd.zeros(s) for s in fusion_shapes])
+    # each bucket is packed and unpacked by one engine operation per device
+    mx.profiler.set_config(profile_imperative=True, aggregate_stats=True,
+                           filename='test_pushpull_fusion_profile.json')
+    mx.profiler.reset_stats()
+    mx.profiler.set_state('run')
+    for step in range(num_steps):
+        vals = [[mx.nd.array(np.random.uniform(size=s), d) for d in devs]
+                for s in fusion_shapes]
+        outs = [[mx.nd.empty(s, d) for d in devs] for s in fusion_shapes]
+        kv.pushpull(fusion_keys, vals, out=outs)
+        for val, out in zip(vals, outs):
+            expected = sum(v.asnumpy() for v in val)
+            for o in out:
+                assert_almost_equal(o.asnumpy(), expected, rtol=1e-5, atol=1e-6)
+        # pull returns the fused result too
+        pulled = [mx.nd.empty(s) for s in fusion_shapes]
+        kv.pull(fusion_keys, out=pulled)
+        for val, p in zip(vals, pulled):
+            assert_almost_equal(p.asnumpy(), sum(v.asnumpy() for v in val),
+                                rtol=1e-5, atol=1e-6)
+    mx.nd.waitall()
+    mx.profiler.set_state('stop')
+    operators = json.loads(mx.profiler.dumps(format='json', reset=True))['Time']['operator']
+    for name in ['KVStoreFusionPack', 'KVStoreFusionUnpack']:
+        assert operators[name]['Count'] == num_buckets * num_devs * num_steps, name
+
+
 @with_seed()
 def test_sparse_aggregator():
     """aggregate sparse ndarray on muliple devices"""
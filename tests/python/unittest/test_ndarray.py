@@ -418,6 +418,38 @@ def test_ndarray_saveload():
     os.remove(fname)
 
 
+@with_seed()
+def test_ndarray_saveload_aligned():
+    with TemporaryDirectory(prefix='test_ndarray_saveload_aligned_') as tmpdir:
+        fname = os.path.join(tmpdir, 'aligned.params')
+        data = [random_ndarray(np.random.randint(1, 5)) for _ in range(10)]
+        data.append(mx.nd.array(np.arange(7), dtype='int32'))
+        data.append(mx.nd.array(np.random.uniform(size=(3, 5)), dtype='float16'))
+        dmap = {'ndarray xx %s' % i : x for i, x in enumerate(data)}
+        mx.nd.save(fname, dmap, aligned=True)
+        dmap2 = mx.nd.load(fname)
+        assert len(dmap2) == len(dmap)
+        for k, x in dmap.items():
+            y = dmap2[k]
+            assert x.dtype == y.dtype
+            assert same(x.asnumpy(), y.asnumpy())
+        # writing to a mapped array must not change the file
+        key = 'ndarray xx 0'
+        dmap2[key][:] = 0
+        dmap3 = mx.nd.load(fname)
+        assert same(dmap3[key].asnumpy(), dmap[key].asnumpy())
+        # the aligned format also loads without mapping
+        with open(fname, 'rb') as f:
+            dmap4 = mx.nd.load_frombuffer(f.read())
+        for k, x in dmap.items():
+            assert same(x.asnumpy(), dmap4[k].asnumpy())
+        mx.nd.save(fname, data, aligned=True)
+        data2 = mx.nd.load(fname)
+        assert len(data2) == len(data)
+        for x, y in zip(data, data2):
+            assert same(x.asnumpy(), y.asnumpy())
+
+
 @with_seed()
 def test_ndarray_legacy_load():
     data = []
@@ -1257,6 +1289,39 @@ def test_cached():
         o.backward()
 
 
+@with_seed()
+def test_cached_mem_planner():
+    data = mx.sym.Variable('data')
+    sym = mx.sym.FullyConnected(data, num_hidden=64, name='fc0')
+    sym = mx.sym.FullyConnected(mx.sym.relu(sym), num_hidden=32, name='fc1')
+    sym = mx.sym.sum(mx.sym.relu(sym))
+    arrays = [mx.nd.random.uniform(shape=s)
+              for s in sym.infer_shape(data=(8, 20))[0]]
+
+    def run(flags):
+        op = mx.nd.CachedOp(sym, flags=[('static_alloc', True)] + flags)
+        args = [a.copy() for a in arrays]
+        for a in args:
+            a.attach_grad()
+        with mx.autograd.record():
+            out = op(*args)
+        out.backward()
+        return out, [a.grad for a in args]
+
+    expected, expected_grads = run([])
+    for planner in ['greedy_by_size', 'interval_coloring', 'auto']:
+        out, grads = run([('mem_planner', planner)])
+        assert_almost_equal(out, expected)
+        for grad, expected_grad in zip(grads, expected_grads):
+            assert_almost_equal(grad, expected_grad)
+
+    # the flag reaches the planner, and the environment is read for each new CachedOp
+    assert_raises(mx.MXNetError, run, [('mem_planner', 'unknown')])
+    with mx.test_utils.environment('MXNET_MEMORY_PLANNER', 'unknown'):
+        assert_raises(mx.MXNetError, run, [])
+        run([('mem_planner', 'greedy_by_size')])
+
+
 @with_seed()
 def test_output():
     shape = (2,2)
@@ -213,6 +213,26 @@ def test_np_ones():
             check_ones_array_creation(shape, dtype)
 
 
+@with_seed()
+@use_np
+def test_np_repeated_creation():
+    # repeated calls differ only in parameters which the FFI passes outside the
+    # attribute dict, so the inference of one call must not be reused for the next
+    for _ in range(2):
+        for shape in [(2, 3), (4, 5), (), (0, 2), 7]:
+            for dtype in [None, 'int32', 'float16', 'float64', 'bool']:
+                for creation, value in [(np.zeros, 0), (np.ones, 1)]:
+                    for ctx in [None, mx.cpu()]:
+                        out = creation(shape, dtype=dtype, ctx=ctx)
+                        expected = _np.full(shape, value, dtype=dtype or 'float32')
+                        assert out.shape == expected.shape
+                        assert out.dtype == expected.dtype
+                        assert same(out.asnumpy(), expected)
+    a = np.ones((3, 3))
+    for axes, shape in [(1, (3, 3)), (0, (3, 3, 3, 3)), (2, ()), (1, (3, 3))]:
+        assert np.tensordot(a, a, axes=axes).shape == shape
+
+
 @with_seed()
 @use_np
 def test_identity():
@@ -4612,6 +4612,26 @@ def test_order():
                     is_ascend=True)])
 
 
+@with_seed()
+def test_topk_large_row():
+    # few long rows are split into chunks whose top k are merged
+    for dtype in [np.float32, np.float64]:
+        for shape in [(1, 200000), (2, 100003)]:
+            data_npy = np.random.permutation(np.prod(shape)).reshape(shape).astype(dtype)
+            data = mx.nd.array(data_npy, dtype=dtype)
+            for k in [1, 5, 100]:
+                for is_ascend in [True, False]:
+                    val, ind = mx.nd.topk(data, axis=1, k=k, ret_typ="both",
+                                          is_ascend=is_ascend, dtype='int64')
+                    if is_ascend:
+                        expected_ind = np.argsort(data_npy, axis=1)[:, :k]
+                    else:
+                        expected_ind = np.argsort(-data_npy, axis=1)[:, :k]
+                    expected_val = np.take_along_axis(data_npy, expected_ind, axis=1)
+                    assert_almost_equal(val.asnumpy(), expected_val)
+                    assert_almost_equal(ind.asnumpy(), expected_ind)
+
+
 @with_seed()
 def test_blockgrad():
     a = mx.sym.Variable('a')
@@ -9691,6 +9711,44 @@ def test_multihead_attention_selfatt():
     for dtype in dtypes:
         check_multihead_attention_selfatt(dtype=dtype)
 
+@with_seed()
+def test_interleaved_selfatt_fused():
+    if default_context().device_type != 'cpu':
+        return
+    num_heads, head_dim, batch_size = 3, 8, 2
+
+    def reference(qkv, causal):
+        att = mx.nd.contrib.interleaved_matmul_selfatt_qk(qkv, heads=num_heads)
+        if causal:
+            seq_len = qkv.shape[0]
+            mask = np.triu(np.ones((seq_len, seq_len)), k=1) * -1e9
+            att = att + mx.nd.array(mask)
+        att = mx.nd.softmax(att, axis=-1)
+        return mx.nd.contrib.interleaved_matmul_selfatt_valatt(qkv, att, heads=num_heads)
+
+    # more steps than one block of queries and keys
+    for seq_len in [1, 7, 200]:
+        qkv = mx.nd.random.uniform(-1, 1, shape=(seq_len, batch_size, 3 * num_heads * head_dim))
+        for causal in [False, True]:
+            out = mx.nd.contrib.interleaved_selfatt_fused(qkv, heads=num_heads, causal=causal)
+            assert_almost_equal(out, reference(qkv, causal), rtol=1e-4, atol=1e-5)
+
+    # decoding step by step with the cache gives the same result as the full causal pass
+    seq_len = 20
+    qkv = mx.nd.random.uniform(-1, 1, shape=(seq_len, batch_size, 3 * num_heads * head_dim))
+    expected = reference(qkv, True)
+    cache = mx.nd.zeros((seq_len, batch_size, 2 * num_heads * head_dim))
+    prefix = 5
+    out = mx.nd.contrib.interleaved_selfatt_fused(qkv[:prefix], cache, heads=num_heads,
+                                                  causal=True, use_cache=True, cache_offset=0)
+    assert_almost_equal(out, expected[:prefix], rtol=1e-4, atol=1e-5)
+    for step in range(prefix, seq_len):
+        out = mx.nd.contrib.interleaved_selfatt_fused(qkv[step:step + 1], cache, heads=num_heads,
+                                                      causal=True, use_cache=True,
+                                                      cache_offset=step)
+        assert_almost_equal(out, expected[step:step + 1], rtol=1e-4, atol=1e-5)
+
+
 def check_multihead_attention_encdec(dtype):
     def convert_weight(F, k_weight, v_weight, num_heads):
         k_weight = F.reshape(k_weight, shape=(num_heads, -1, 0), reverse=True)
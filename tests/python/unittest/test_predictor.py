@@ -17,15 +17,19 @@
 
 from __future__ import print_function
 import sys, os
+import ctypes
+import threading
 curr_path = os.path.dirname(os.path.abspath(os.path.expanduser(__file__)))
 sys.path.append(os.path.join(curr_path, "../../../amalgamation/python/"))
-from mxnet_predict import Predictor, load_ndarray_file
+import mxnet_predict
+from mxnet_predict import Predictor, PredictorBatcher, load_ndarray_file
 
 import numpy as np
 import mxnet as mx
 import mxnet.ndarray as nd
 from mxnet import gluon
 from mxnet.test_utils import assert_almost_equal
+from nose.tools import assert_raises
 from common import setup_module, with_seed, teardown
 
 @with_seed()
@@ -67,6 +71,34 @@ def test_predictor():
     # destroy the predictor
     del predictor
 
+@with_seed()
+def test_predictor_reshape_cache():
+    symbol, params = _export_dense_model('test_predictor_reshape_cache')
+    exact = Predictor(symbol, params, {'data': (1, 3)})
+    bucketed = Predictor(symbol, params, {'data': (1, 3)})
+    bucketed.set_reshape_cache(4, bucket_axis=0, bucket_size=4)
+
+    def check(batch_size, bucket_shape, stats):
+        data = np.random.uniform(size=(batch_size, 3)).astype(np.float32)
+        exact.reshape({'data': data.shape})
+        exact.forward(data=data)
+        bucketed.reshape({'data': data.shape})
+        assert bucketed.get_input_shape('data') == bucket_shape
+        assert bucketed.get_reshape_cache_stats() == stats
+        # pad to the bucketed shape, the padded rows of the output are ignored
+        padded = np.zeros(bucket_shape, dtype=np.float32)
+        padded[:batch_size] = data
+        bucketed.forward(data=padded)
+        out = bucketed.get_output(0)
+        assert out.shape[0] == bucket_shape[0]
+        assert_almost_equal(out[:batch_size], exact.get_output(0), rtol=1e-5, atol=1e-6)
+
+    check(3, (4, 3), (0, 1))
+    # same bucket, the executor is reused
+    check(2, (4, 3), (1, 1))
+    check(5, (8, 3), (1, 2))
+    check(4, (4, 3), (2, 2))
+
 @with_seed()
 def test_load_ndarray():
     nd_file = 'test_predictor_load_ndarray.params'
@@ -82,6 +114,124 @@ def test_load_ndarray():
         assert_almost_equal(nd_data[k].asnumpy(), nd_load[k], rtol=1e-5, atol=1e-6)
 
 
+def _export_dense_model(prefix):
+    block = gluon.nn.HybridSequential()
+    block.add(gluon.nn.Dense(7))
+    block.add(gluon.nn.Dense(3))
+    block.hybridize()
+    block.initialize()
+    block.forward(nd.zeros((1, 3)))
+    block.export(prefix)
+    return open("%s-symbol.json" % prefix, "r").read(), open("%s-0000.params" % prefix, "rb").read()
+
+@with_seed()
+def test_predictor_batcher():
+    symbol, params = _export_dense_model('test_predictor_batcher')
+    batch_size = 4
+    num_threads = 8
+    num_samples = 5
+    samples = np.random.uniform(size=(num_threads, num_samples, 3)).astype(np.float32)
+
+    # single sample reference
+    single = Predictor(symbol, params, {'data': (1, 3)})
+    expected = np.empty((num_threads, num_samples, 3), dtype=np.float32)
+    for t in range(num_threads):
+        for i in range(num_samples):
+            single.forward(data=samples[t, i:i+1])
+            expected[t, i] = single.get_output(0)[0]
+
+    # concurrent callers, the long timeout lets them fill the batches
+    batcher = PredictorBatcher(Predictor(symbol, params, {'data': (batch_size, 3)}),
+                               batch_size, timeout_us=200000)
+    results = np.zeros_like(expected)
+    errors = []
+    barrier = threading.Barrier(num_threads)
+    def run(t):
+        try:
+            barrier.wait()
+            for i in range(num_samples):
+                results[t, i] = batcher.forward(data=samples[t, i])[0]
+        except Exception as e:  # pylint: disable=broad-except
+            errors.append(e)
+    threads = [threading.Thread(target=run, args=(t,)) for t in range(num_threads)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert not errors, errors
+    assert_almost_equal(results, expected, rtol=1e-5, atol=1e-6)
+    queue_time_hist, batch_size_hist = batcher.get_stats()
+    assert len(batch_size_hist) == batch_size + 1
+    assert sum(i * n for i, n in enumerate(batch_size_hist)) == num_threads * num_samples
+    assert sum(batch_size_hist[2:]) > 0
+    assert sum(queue_time_hist) == num_threads * num_samples
+    del batcher
+
+@with_seed()
+def test_predictor_batcher_timeout():
+    symbol, params = _export_dense_model('test_predictor_batcher_timeout')
+    single = Predictor(symbol, params, {'data': (1, 3)})
+    batcher = PredictorBatcher(Predictor(symbol, params, {'data': (4, 3)}), 4, timeout_us=1000)
+    # a lone request must be flushed by the timeout in a partial batch
+    for _ in range(3):
+        sample = np.random.uniform(size=(3,)).astype(np.float32)
+        out = batcher.forward(data=sample)[0]
+        single.forward(data=sample.reshape(1, 3))
+        assert_almost_equal(out, single.get_output(0)[0], rtol=1e-5, atol=1e-6)
+    _, batch_size_hist = batcher.get_stats()
+    assert batch_size_hist == [0, 3, 0, 0, 0]
+    del batcher
+
+@with_seed()
+def test_predictor_batcher_errors():
+    symbol, params = _export_dense_model('test_predictor_batcher_errors')
+    batcher = PredictorBatcher(Predictor(symbol, params, {'data': (2, 3)}), 2, timeout_us=1000)
+    sample = np.zeros((3,), dtype=np.float32)
+    # invalid requests are rejected before they are queued
+    assert_raises(RuntimeError, batcher.forward, wrong=sample)
+    assert_raises(RuntimeError, batcher.forward, data=np.zeros((6,), dtype=np.float32))
+    out = np.empty((3,), dtype=np.float32)
+    def forward_raw(batcher, keys, inputs):
+        f_p = mxnet_predict.mx_float_p
+        return mxnet_predict._LIB.MXPredBatcherForward(
+            batcher.handle, mxnet_predict.mx_uint(len(keys)),
+            mxnet_predict.c_str_array(keys),
+            mxnet_predict.c_array(f_p, [v.ctypes.data_as(f_p) for v in inputs]),
+            mxnet_predict.c_array(mxnet_predict.mx_uint, [v.size for v in inputs]),
+            mxnet_predict.mx_uint(1),
+            mxnet_predict.c_array(f_p, [out.ctypes.data_as(f_p)]),
+            mxnet_predict.c_array(mxnet_predict.mx_uint, [out.size]))
+    assert forward_raw(batcher, ['data'], [sample]) == 0
+    del batcher
+
+    # a key given twice is rejected even when the input count matches
+    prefix = 'test_predictor_batcher_twice'
+    a = mx.sym.Variable('a')
+    b = mx.sym.Variable('b')
+    weight = mx.sym.Variable('weight')
+    mx.sym.elemwise_add(mx.sym.broadcast_mul(a, weight), b).save('%s-symbol.json' % prefix)
+    nd.save('%s-0000.params' % prefix, {'arg:weight': nd.ones((1, 3))})
+    batcher = PredictorBatcher(Predictor(open('%s-symbol.json' % prefix, 'r').read(),
+                                         open('%s-0000.params' % prefix, 'rb').read(),
+                                         {'a': (2, 3), 'b': (2, 3)}), 2, timeout_us=1000)
+    assert forward_raw(batcher, ['a', 'a'], [sample, sample]) != 0
+    assert 'given twice' in mxnet_predict.py_str(mxnet_predict._LIB.MXGetLastError())
+    assert forward_raw(batcher, ['a', 'b'], [sample, sample]) == 0
+    del batcher
+
+    # errors raised while running a batch are returned to its requests
+    prefix = 'test_predictor_batcher_take'
+    data = mx.sym.Variable('data')
+    weight = mx.sym.Variable('weight')
+    mx.sym.take(weight, data, mode='raise').save('%s-symbol.json' % prefix)
+    nd.save('%s-0000.params' % prefix, {'arg:weight': nd.random.uniform(shape=(10, 3))})
+    batcher = PredictorBatcher(Predictor(open('%s-symbol.json' % prefix, 'r').read(),
+                                         open('%s-0000.params' % prefix, 'rb').read(),
+                                         {'data': (2,)}), 2, timeout_us=1000)
+    assert_raises(RuntimeError, batcher.forward, data=np.array([20], dtype=np.float32))
+    del batcher
+
+
 if __name__ == '__main__':
     import nose
     nose.runmodule()
@@ -236,6 +236,33 @@ def test_continuous_profile_and_instant_marker():
     profiler.set_state('stop')
 
 
+def test_binary_trace():
+    file_name = 'test_binary_trace.trace'
+    profiler.set_config(profile_all=True, filename=file_name, binary_trace=True,
+                        aggregate_stats=True)
+    profiler.set_state('run')
+    python_domain = profiler.Domain('PythonDomain::test_binary_trace')
+    profiler.Marker(python_domain, 'StartTrace').mark('process')
+    test_profile_event(False)
+    test_profile_counter(False)
+    a = mx.nd.ones((10, 10))
+    (a + a).wait_to_read()
+    profiler.set_state('stop')
+    assert len(profiler.dumps()) > 0
+    profiler.dump(True)
+    json_name = 'test_binary_trace.json'
+    num_events = profiler.trace_to_json(file_name, json_name)
+    with open(json_name) as f:
+        events = json.load(f)['traceEvents']
+    assert num_events == len([e for e in events if e['ph'] != 'M'])
+    assert any(e['ph'] == 'X' and e['name'] == 'test_profile_event' for e in events)
+    assert any(e['ph'] == 'X' and e['cat'] == 'operator' for e in events)
+    assert any(e['ph'] == 'C' and e['args'] == {e['name']: 6} for e in events)
+    assert any(e['ph'] == 'i' and e['s'] == 'p' and e['name'] == 'StartTrace' for e in events)
+    pids = set(e['pid'] for e in events if e['ph'] == 'M')
+    assert all(e['pid'] in pids for e in events)
+
+
 def test_aggregate_stats_valid_json_return():
     file_name = 'test_aggregate_stats_json_return.json'
     enable_profiler(file_name, True, True, True)
@@ -302,6 +329,46 @@ def test_aggregate_duplication():
     profiler.set_state('stop')
 
 
+def test_aggregate_stats_percentiles():
+    file_name = 'test_aggregate_stats_percentiles.json'
+    enable_profiler(file_name, True, True, True)
+    profiler.reset_stats()
+    for shape in [(10, 10), (100, 100)]:
+        inp = mx.nd.ones(shape)
+        for _ in range(20):
+            inp = mx.nd.sqrt(inp)
+    mx.nd.waitall()
+    target_dict = json.loads(profiler.dumps(format='json', sort_by='p99'))
+    sqrt = target_dict['Time']['operator']['sqrt']
+    assert sqrt['Count'] == 40
+    assert sqrt['Min'] <= sqrt['P50'] <= sqrt['P90'] <= sqrt['P99'] <= sqrt['P999'] <= sqrt['Max']
+    per_shape = target_dict['Time']['operator (per shape)']
+    assert per_shape['sqrt in: [[10,10]] out: [[10,10]]']['Count'] == 20
+    assert per_shape['sqrt in: [[100,100]] out: [[100,100]]']['Count'] == 20
+    assert 'P99' in profiler.dumps()
+    profiler.reset_stats()
+    target_dict = json.loads(profiler.dumps(format='json'))
+    assert 'operator' not in target_dict['Time']
+    assert 'operator (per shape)' not in target_dict['Time']
+    profiler.set_state('stop')
+
+
+def test_aggregate_stats_reset_without_continuous_dump():
+    file_name = 'test_aggregate_stats_reset_without_continuous_dump.json'
+    enable_profiler(file_name, run=True, continuous_dump=False, aggregate_stats=True)
+    inp = mx.nd.ones((10, 10))
+    for _ in range(3):
+        inp = mx.nd.sqrt(inp)
+    mx.nd.waitall()
+    profiler.reset_stats()
+    for _ in range(5):
+        inp = mx.nd.sqrt(inp)
+    mx.nd.waitall()
+    target_dict = json.loads(profiler.dumps(format='json'))
+    assert target_dict['Time']['operator']['sqrt']['Count'] == 5
+    profiler.set_state('stop')
+
+
 def test_custom_operator_profiling(seed=None, file_name=None):
     class Sigmoid(mx.operator.CustomOp):
         def forward(self, is_train, req, in_data, out_data, aux):
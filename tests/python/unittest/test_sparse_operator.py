@@ -1905,6 +1905,30 @@ def test_sparse_embedding():
             check_sparse_embedding(in_dim, out_dim, batch, densities, sparse_grad, weight_stype)
             check_sparse_embedding(in_dim, out_dim, batch, densities, sparse_grad, weight_stype)
 
+@with_seed()
+def test_sparse_embedding_large_vocab():
+    ''' row_sparse embedding gradient only holds the rows of the indices seen '''
+    in_dim, out_dim, batch = 2000000, 4, (64, 5)
+    data = mx.sym.Variable("data")
+    embed = mx.sym.Embedding(data=data, input_dim=in_dim, output_dim=out_dim,
+                             sparse_grad=True, name='embed')
+    grad_req = {'data': 'null', 'embed_weight': 'write'}
+    exe = embed.simple_bind(default_context(), grad_req=grad_req, data=batch)
+    # few unique ids, repeated, and both ends of the vocabulary
+    np_data = np.random.choice([0, 7, 70000, 1 << 20, in_dim - 1], size=batch)
+    exe.arg_dict['data'][:] = np_data
+    exe.forward(is_train=True)
+    np_ograd = np.random.uniform(-1, 1, exe.outputs[0].shape)
+    exe.backward([mx.nd.array(np_ograd)])
+    grad = exe.grad_dict['embed_weight']
+    assert grad.stype == 'row_sparse'
+    unique = np.unique(np_data)
+    assert_almost_equal(grad.indices.asnumpy(), unique)
+    expected = np.zeros((len(unique), out_dim))
+    np.add.at(expected, np.searchsorted(unique, np_data.reshape(-1)), np_ograd.reshape(-1, out_dim))
+    assert_almost_equal(grad.data.asnumpy(), expected, atol=1e-5)
+
+
 @with_seed()
 def test_sparse_broadcast_add_sub():
     def check_broadcast_add(mx_lhs, mx_rhs, np_lhs, np_rhs, dtype):
@@ -319,6 +319,77 @@ def test_zero_prop2():
     assert False
 
 
+def _bind_and_run(net, shapes, args, env_var, value):
+    """Bind net with env_var set to value, then run a forward and backward pass."""
+    with environment(env_var, value):
+        exe = net.simple_bind(ctx=mx.cpu(), **shapes)
+    for k, v in args.items():
+        v.copyto(exe.arg_dict[k])
+    exe.forward(is_train=True)
+    exe.backward()
+    return exe
+
+
+def test_memory_planner():
+    data = mx.sym.Variable('data')
+    net = data
+    for i in range(4):
+        net = mx.sym.FullyConnected(net, num_hidden=64 * (i % 2 + 1), name='fc%d' % i)
+        net = mx.sym.Activation(net, act_type='relu')
+    net = mx.sym.make_loss(mx.sym.sum(net))
+    shapes = {'data': (32, 100)}
+    args = {k: mx.nd.random.uniform(shape=s)
+            for k, s in zip(net.list_arguments(), net.infer_shape(**shapes)[0])}
+
+    expected = _bind_and_run(net, shapes, args, 'MXNET_MEMORY_PLANNER', 'default')
+    for planner in ['greedy_by_size', 'interval_coloring', 'auto']:
+        exe = _bind_and_run(net, shapes, args, 'MXNET_MEMORY_PLANNER', planner)
+        match = re.search(r'Planned (\d+) bytes, lower bound (\d+) bytes', exe.debug_str())
+        planned, lower_bound = int(match.group(1)), int(match.group(2))
+        # the largest activation alone is 32 * 128 float32 values
+        assert lower_bound >= 32 * 128 * 4
+        assert lower_bound <= planned
+        mx.test_utils.assert_almost_equal(exe.outputs[0], expected.outputs[0])
+        for k in args:
+            mx.test_utils.assert_almost_equal(exe.grad_dict[k], expected.grad_dict[k])
+
+
+def test_backward_checkpoint():
+    data = mx.sym.Variable('data')
+    net = data
+    for i in range(3):
+        net = mx.sym.FullyConnected(net, num_hidden=32, name='fc%d' % i)
+        net = mx.sym.Activation(net, act_type='tanh')
+        net = mx.sym.sigmoid(net * 2 + 1)
+    net = mx.sym.make_loss(mx.sym.sum(net))
+    shapes = {'data': (16, 20)}
+    args = {k: mx.nd.random.uniform(shape=s)
+            for k, s in zip(net.list_arguments(), net.infer_shape(**shapes)[0])}
+
+    expected = _bind_and_run(net, shapes, args, 'MXNET_BACKWARD_CHECKPOINT', 'none')
+    for strategy in ['sqrt', 'all']:
+        exe = _bind_and_run(net, shapes, args, 'MXNET_BACKWARD_CHECKPOINT', strategy)
+        assert '_mirror' in exe.debug_str()
+        mx.test_utils.assert_almost_equal(exe.outputs[0], expected.outputs[0])
+        for k in args:
+            mx.test_utils.assert_almost_equal(exe.grad_dict[k], expected.grad_dict[k])
+
+
+def test_backward_checkpoint_keeps_random_ops():
+    data = mx.sym.Variable('data')
+    with mx.AttrScope(force_mirroring='True'):
+        net = mx.sym.Activation(data, act_type='tanh', name='tanh')
+        net = mx.sym.Dropout(net, p=0.5, name='drop')
+        net = mx.sym.sigmoid(net, name='sigmoid')
+    net = mx.sym.make_loss(mx.sym.sum(net))
+    shapes = {'data': (16, 20)}
+    args = {'data': mx.nd.random.uniform(shape=shapes['data'])}
+
+    info = _bind_and_run(net, shapes, args, 'MXNET_BACKWARD_CHECKPOINT', 'all').debug_str()
+    assert 'tanh_mirror' in info
+    assert 'drop_mirror' not in info
+
+
 def test_simple_bind_incomplete_shape_inference_in_one_forward_pass():
     """This is a special case that results in shape inference
     failure after moving simple_bind logic from frontend to backend.
@@ -0,0 +1,38 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+
+"""Convert a binary profiler trace, written with
+`mx.profiler.set_config(binary_trace=True)`, to chrome://tracing json."""
+from __future__ import print_function
+import argparse
+import os
+
+# load the reader by path, importing the mxnet package would load libmxnet
+TRACE_PY = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        os.pardir, 'python', 'mxnet', 'profiler_trace.py')
+profiler = {'__file__': TRACE_PY}
+exec(compile(open(TRACE_PY, 'rb').read(), TRACE_PY, 'exec'), profiler, profiler)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Convert a binary profiler trace to json')
+    parser.add_argument('trace', help='binary trace written by the profiler')
+    parser.add_argument('output',
+                        help='json file to write, open it in chrome://tracing or Perfetto')
+    args = parser.parse_args()
+    num_events = profiler['trace_to_json'](args.trace, args.output)
+    print('Converted %d events to %s' % (num_events, args.output))